@@ -0,0 +1,28 @@
+#version 450
+
+// Writes the indirect arguments for the passes after it, so the CPU never needs to know how many particles are alive.
+// By default this prepares the simulation dispatch, with DRAW_ARGS it writes the draw for the survivors
+layout (local_size_x = 1) in;
+
+#include "../fragments/particle_pool.glsl"
+
+// Must match GpuParticlePool::GROUP_SIZE
+#define GROUP_SIZE 64u
+
+void main() {
+#ifdef DRAW_ARGS
+    // After simulating, the survivors are in the other list
+    DrawArgs[0] = uint(AliveCount[1u - u_CurrentList]);
+    DrawArgs[1] = 1u;
+    DrawArgs[2] = 0u;
+    DrawArgs[3] = 0u;
+#else
+    uint alive = uint(AliveCount[u_CurrentList]);
+    SimulateArgs[0] = (alive + GROUP_SIZE - 1) / GROUP_SIZE;
+    SimulateArgs[1] = 1u;
+    SimulateArgs[2] = 1u;
+
+    // Survivors get appended to the other list, which still has the count from last update
+    AliveCount[1u - u_CurrentList] = 0;
+#endif
+}
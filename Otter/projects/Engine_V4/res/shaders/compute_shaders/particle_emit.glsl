@@ -0,0 +1,60 @@
+#version 450
+
+// One workgroup per emitter, each thread spawns every 64th particle for it's emitter
+layout (local_size_x = 64) in;
+
+#include "../fragments/particle_pool.glsl"
+#include "../fragments/math_constants.glsl"
+
+uniform float u_TimeStep;
+
+// Returns a random direction within the given angle of the axis
+vec3 RandomInCone(vec3 axis, float angle, inout uint seed) {
+    float cosTheta = mix(1.0, cos(angle), Random(seed));
+    float sinTheta = sqrt(max(1.0 - cosTheta * cosTheta, 0.0));
+    float phi = M_2PI * Random(seed);
+
+    // Build a basis around the axis, see Duff et al. "Building an Orthonormal Basis, Revisited"
+    float s = axis.z >= 0.0 ? 1.0 : -1.0;
+    float a = -1.0 / (s + axis.z);
+    float b = axis.x * axis.y * a;
+    vec3 tangent = vec3(1.0 + s * axis.x * axis.x * a, s * b, -s * axis.x);
+    vec3 bitangent = vec3(b, s + axis.y * axis.y * a, -axis.y);
+
+    return (tangent * cos(phi) + bitangent * sin(phi)) * sinTheta + axis * cosTheta;
+}
+
+void main() {
+    Emitter emitter = Emitters[gl_WorkGroupID.x];
+
+    for (uint ix = gl_LocalInvocationID.x; ix < emitter.SpawnCount; ix += gl_WorkGroupSize.x) {
+        // Pop a free particle off of the dead list, if we went past the end then the pool is full
+        int deadIndex = atomicAdd(DeadCount, -1) - 1;
+        if (deadIndex < 0) {
+            atomicAdd(DeadCount, 1);
+            break;
+        }
+        uint index = DeadList[deadIndex];
+        uint seed = emitter.Seed ^ Hash(ix);
+
+        float speed = length(emitter.Velocity.xyz);
+        vec3 velocity = emitter.Velocity.xyz;
+        if (speed > 0.0 && emitter.PositionCone.w > 0.0) {
+            velocity = RandomInCone(velocity / speed, emitter.PositionCone.w, seed) * speed;
+        }
+        float lifetime = mix(emitter.LifetimeRange.x, emitter.LifetimeRange.y, Random(seed));
+
+        // Spread particles over the update so that they don't all spawn in a clump
+        vec3 position = emitter.PositionCone.xyz + velocity * (u_TimeStep * Random(seed));
+
+        Particle particle;
+        particle.PositionLife = vec4(position, lifetime);
+        particle.VelocityMaxLife = vec4(velocity, lifetime);
+        particle.Color = emitter.Color;
+        particle.Gravity = emitter.Gravity;
+        Particles[index] = particle;
+
+        // New particles get simulated along with the rest this update
+        AliveIn[atomicAdd(AliveCount[u_CurrentList], 1)] = index;
+    }
+}
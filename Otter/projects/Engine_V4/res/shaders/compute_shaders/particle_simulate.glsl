@@ -0,0 +1,33 @@
+#version 450
+
+// One thread per live particle, dispatched indirectly from the count left by particle_args.glsl
+layout (local_size_x = 64) in;
+
+#include "../fragments/particle_pool.glsl"
+
+uniform float u_TimeStep;
+
+void main() {
+    uint ix = gl_GlobalInvocationID.x;
+    if (ix >= uint(AliveCount[u_CurrentList])) {
+        return;
+    }
+
+    uint index = AliveIn[ix];
+    Particle particle = Particles[index];
+
+    float life = particle.PositionLife.w - u_TimeStep;
+    if (life > 0.0) {
+        // Update position and apply forces
+        particle.PositionLife.xyz += particle.VelocityMaxLife.xyz * u_TimeStep;
+        particle.PositionLife.w = life;
+        particle.VelocityMaxLife.xyz += particle.Gravity.xyz * u_TimeStep;
+        Particles[index] = particle;
+
+        // Compact the survivors into the other list
+        AliveOut[atomicAdd(AliveCount[1u - u_CurrentList], 1)] = index;
+    } else {
+        // Give the particle back to the pool
+        DeadList[atomicAdd(DeadCount, 1)] = index;
+    }
+}
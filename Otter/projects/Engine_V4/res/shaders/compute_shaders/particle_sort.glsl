@@ -0,0 +1,83 @@
+#version 450
+
+// A bitonic sort of our particle keys, see https://en.wikipedia.org/wiki/Bitonic_sorter
+// Each thread compares and swaps a single pair of keys, so a dispatch covers SortSize / 2 threads.
+//
+// Steps that compare keys within the same block of SORT_BLOCK_SIZE keys are done in shared memory, so we only need
+// one dispatch for all of them. This is compiled in three variants:
+//     PRESORT  - Fully sorts each block, alternating directions so that pairs of blocks form bitonic sequences
+//     MERGE    - Does every step of a merge where the distance between keys fits in a block
+//     (neither) - Does a single step of a merge across blocks, for distance u_J
+layout (local_size_x = 256) in;
+
+#include "../fragments/particle_pool.glsl"
+
+// Must match GpuParticlePool::SORT_BLOCK_SIZE, and be twice our local size
+#define SORT_BLOCK_SIZE 512u
+
+// The size of the sequences being merged
+uniform uint u_K;
+// The distance between keys that are compared in this step
+uniform uint u_J;
+
+#if defined(PRESORT) || defined(MERGE)
+
+shared SortEntry s_Entries[SORT_BLOCK_SIZE];
+
+// Compare and swap within shared memory for a single step
+void LocalStep(uint blockStart, uint k, uint j) {
+    uint t = gl_LocalInvocationID.x;
+    uint left = 2u * j * (t / j) + (t % j);
+    uint right = left + j;
+    bool ascending = ((blockStart + left) & k) == 0u;
+
+    SortEntry a = s_Entries[left];
+    SortEntry b = s_Entries[right];
+    if ((a.Key > b.Key) == ascending) {
+        s_Entries[left] = b;
+        s_Entries[right] = a;
+    }
+    barrier();
+}
+
+void main() {
+    uint blockStart = gl_WorkGroupID.x * SORT_BLOCK_SIZE;
+    uint t = gl_LocalInvocationID.x;
+
+    s_Entries[t] = SortEntries[blockStart + t];
+    s_Entries[t + gl_WorkGroupSize.x] = SortEntries[blockStart + t + gl_WorkGroupSize.x];
+    barrier();
+
+#ifdef PRESORT
+    for (uint k = 2u; k <= SORT_BLOCK_SIZE; k <<= 1) {
+        for (uint j = k >> 1; j > 0u; j >>= 1) {
+            LocalStep(blockStart, k, j);
+        }
+    }
+#else
+    for (uint j = SORT_BLOCK_SIZE >> 1; j > 0u; j >>= 1) {
+        LocalStep(blockStart, u_K, j);
+    }
+#endif
+
+    SortEntries[blockStart + t] = s_Entries[t];
+    SortEntries[blockStart + t + gl_WorkGroupSize.x] = s_Entries[t + gl_WorkGroupSize.x];
+}
+
+#else
+
+void main() {
+    uint t = gl_GlobalInvocationID.x;
+    uint left = 2u * u_J * (t / u_J) + (t % u_J);
+    uint right = left + u_J;
+    bool ascending = (left & u_K) == 0u;
+
+    SortEntry a = SortEntries[left];
+    SortEntry b = SortEntries[right];
+    if ((a.Key > b.Key) == ascending) {
+        SortEntries[left] = b;
+        SortEntries[right] = a;
+    }
+}
+
+#endif
@@ -0,0 +1,29 @@
+#version 450
+
+// Builds the keys that particle_sort.glsl sorts, one thread per key
+layout (local_size_x = 256) in;
+
+#include "../fragments/particle_pool.glsl"
+#include "../fragments/frame_uniforms.glsl"
+
+// The number of keys to fill, a power of two that is at least the number of live particles
+uniform uint u_SortSize;
+
+void main() {
+    uint ix = gl_GlobalInvocationID.x;
+    if (ix >= u_SortSize) {
+        return;
+    }
+
+    SortEntry entry;
+    if (ix < uint(AliveCount[u_CurrentList])) {
+        // We sort ascending, so negating the distance gives us back to front order for blending
+        entry.Index = AliveIn[ix];
+        entry.Key = -distance(Particles[entry.Index].PositionLife.xyz, u_CamPos.xyz);
+    } else {
+        // Unused keys sort to the end, where they won't be drawn
+        entry.Index = 0;
+        entry.Key = uintBitsToFloat(0x7F800000u);
+    }
+    SortEntries[ix] = entry;
+}
@@ -41,7 +41,8 @@ void main() {
 
 	vec3 toEye = normalize(u_CamPos.xyz - inWorldPos);
 	vec3 environmentDir = reflect(-toEye, normal);
-	vec3 reflected = SampleEnvironmentMap(environmentDir);
+	// Less shiny surfaces get blurrier reflections
+	vec3 reflected = SampleEnvironmentMap(environmentDir, 1.0 - u_Material.Shininess);
 
 	// Will accumulate the contributions of all lights on this fragment
 	// This is defined in the fragment file "multiple_point_lights.glsl"
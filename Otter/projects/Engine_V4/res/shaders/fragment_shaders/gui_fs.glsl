@@ -0,0 +1,44 @@
+#version 460
+
+layout (location = 0) in vec4 inColor;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec2 inScreenPos;
+layout (location = 3) in flat vec4 inClip;
+layout (location = 4) in flat uint inFlags;
+
+layout (location = 0) out vec4 outColor;
+
+#define GUI_FLAG_FONT 1u
+#define GUI_FLAG_SDF  2u
+// When drawing from the GUI atlas, the layer to sample is stored above the flag bits
+#define GUI_LAYER_SHIFT 8u
+
+#ifdef GUI_ATLAS
+uniform layout(binding = 0) sampler2DArray s_Texture;
+#else
+uniform layout(binding = 0) sampler2D s_Texture;
+#endif
+
+void main() {
+    // Scissor rects are applied per instance, so we don't need to split up the draw when they change
+    if (any(lessThan(inScreenPos, inClip.xy)) || any(greaterThan(inScreenPos, inClip.zw))) {
+        discard;
+    }
+
+#ifdef GUI_ATLAS
+    vec4 texel = texture(s_Texture, vec3(inUV, float(inFlags >> GUI_LAYER_SHIFT)));
+#else
+    vec4 texel = texture(s_Texture, inUV);
+#endif
+    if ((inFlags & GUI_FLAG_SDF) != 0u) {
+        // The red channel holds the distance to the edge of the glyph, with the edge at 0.5. Blend over
+        // about a pixel on screen so that the edge stays sharp no matter how the text is scaled
+        float dist  = texel.r;
+        float width = max(fwidth(dist), 0.0001) * 0.5;
+        outColor = vec4(inColor.rgb, inColor.a * smoothstep(0.5 - width, 0.5 + width, dist));
+    } else if ((inFlags & GUI_FLAG_FONT) != 0u) {
+        outColor = vec4(inColor.rgb, inColor.a * texel.r);
+    } else {
+        outColor = texel * inColor;
+    }
+}
@@ -1,5 +1,14 @@
 #version 440
 
+// Features are selected by compiling variants of this shader with these defines, see RenderLayer::_UpdateShaderVariants
+//   ENABLE_LIGHTS   - Accumulate the point lights from the light block
+//   ENABLE_SPECULAR - Accumulate specular highlights as well as diffuse
+//   DIFFUSE_WARP    - Remap the diffuse lighting through the diffuse ramp
+//   SPECULAR_WARP   - Remap the specular lighting through the specular ramp
+//   HAS_LIGHTMAP    - Add the baked lighting of static objects from the lightmap target
+//   SKIP_BAKED      - Every light in this batch is baked, lightmapped pixels already have their diffuse
+//                     lighting so they only add specular. Only used along with HAS_LIGHTMAP
+
 layout(location = 0) in vec2 inUV;
 layout(location = 0) out vec4 outDiffuse;
 layout(location = 1) out vec4 outSpecular;
@@ -7,6 +16,14 @@ layout(location = 1) out vec4 outSpecular;
 uniform layout(binding = 5) sampler1D diffuse_ramp;
 uniform layout(binding = 6) sampler1D specular_ramp;
 
+// How much of the ambient lighting to add, lights are drawn in batches and only the first batch adds ambient
+uniform float u_AmbientWeight;
+
+#ifdef HAS_LIGHTMAP
+// The baked lighting of static objects, with alpha set to 1 for pixels that have a lightmap
+uniform layout(binding = 7) sampler2D s_Lightmap;
+#endif
+
 // The maximum number of lights the shader supports, increasing this will lower performance!
 #define MAX_LIGHTS 8
 
@@ -57,10 +74,12 @@ void CalcPointLightContribution(vec3 viewPos, vec3 normal, Light light, float sh
         float NdotL = max(dot(normal, lightDir), 0.0);
         diffuse += NdotL * attenuation * light.PositionIntensity.w * light.ColorAttenuation.rgb;
         
+        #ifdef ENABLE_SPECULAR
         vec3 reflectDir = reflect(lightDir, normal);
         float VdotR = pow(max(dot(normalize(-viewPos), reflectDir), 0.0), pow(2, shininess * 8));
         
         specular += VdotR * light.ColorAttenuation.rgb * shininess * attenuation * light.PositionIntensity.w;
+        #endif
 }
 
 void main() {
@@ -77,26 +96,46 @@ void main() {
     
     float specularPow = texture(s_AlbedoSpec, inUV).a;
 
+    #ifdef HAS_LIGHTMAP
+    vec4 lightmap = texture(s_Lightmap, inUV);
+    #else
+    vec4 lightmap = vec4(0);
+    #endif
+
     vec3 diffuse = vec3(0);
     vec3 specular = vec3(0);
+    #ifdef ENABLE_LIGHTS
+    vec3 lightDiffuse = vec3(0);
     for (int ix = 0; ix < AmbientColAndNumLights.w && ix < MAX_LIGHTS; ix++) {
-        CalcPointLightContribution(viewPos, normal, Lights[ix], specularPow, diffuse, specular);
+        CalcPointLightContribution(viewPos, normal, Lights[ix], specularPow, lightDiffuse, specular);
     }
-
-    if (IsFlagSet(FLAG_DIFFUSE_WARP))
-    { 
-        diffuse.r = texture(diffuse_ramp, diffuse.r).r;
-        diffuse.g = texture(diffuse_ramp, diffuse.g).g;
-        diffuse.b = texture(diffuse_ramp, diffuse.b).b;
-    }
-
-    if (IsFlagSet(FLAG_SPECULAR_WARP))
-    {
-        specular.r = texture(specular_ramp, specular.r).r;
-        specular.g = texture(specular_ramp, specular.g).g;
-        specular.b = texture(specular_ramp, specular.b).b;
+    #ifdef SKIP_BAKED
+    if (lightmap.a < 0.5) {
+        diffuse += lightDiffuse;
     }
-
+    #else
+    diffuse += lightDiffuse;
+    #endif
+    #endif
+
+    // Baked lighting is added once, with the ambient
+    diffuse += lightmap.rgb * u_AmbientWeight;
+
+    #ifdef DIFFUSE_WARP
+    diffuse.r = texture(diffuse_ramp, diffuse.r).r;
+    diffuse.g = texture(diffuse_ramp, diffuse.g).g;
+    diffuse.b = texture(diffuse_ramp, diffuse.b).b;
+    #endif
+
+    #ifdef SPECULAR_WARP
+    specular.r = texture(specular_ramp, specular.r).r;
+    specular.g = texture(specular_ramp, specular.g).g;
+    specular.b = texture(specular_ramp, specular.b).b;
+    #endif
+
+    // Image based ambient from the skybox or nearest reflection probe, our normals are in view space so we
+    // rotate them into the space the harmonics were projected in
+    diffuse += EvaluateAmbientSH(normalize(EnvironmentRotation * normal)) * u_AmbientWeight;
 
     outDiffuse = vec4(diffuse, 1);
     outSpecular = vec4(specular, 1);
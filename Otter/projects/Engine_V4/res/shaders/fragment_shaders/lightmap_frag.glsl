@@ -0,0 +1,18 @@
+#version 440
+
+layout(location = 0) in vec2 inLightmapUV;
+
+layout(location = 0) out vec4 outLightmap;
+
+uniform layout(binding = 0) sampler2D s_Lightmap;
+
+// The range that lightmaps are encoded into, see LightmapBaker::RGBM_RANGE
+#define RGBM_RANGE 8.0
+
+void main() {
+	// Lightmaps are RGBM encoded, the color is rgb * a * RGBM_RANGE
+	vec4 rgbm = texture(s_Lightmap, inLightmapUV);
+
+	// Alpha marks the pixel as lightmapped, so the lighting pass knows to skip baked lights
+	outLightmap = vec4(rgbm.rgb * rgbm.a * RGBM_RANGE, 1.0);
+}
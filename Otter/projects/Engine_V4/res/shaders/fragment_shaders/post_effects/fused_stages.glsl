@@ -0,0 +1,27 @@
+#version 430
+
+// Template for post processing effects that have been merged into a single pass by the
+// PostProcessingLayer. The layer injects each effect's stage source at the STAGES marker,
+// and calls them in order at the COORDINATE_CALLS and COLOR_CALLS markers
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in vec3 inViewDir;
+layout(location = 0) out vec3 outColor;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+#include "../../fragments/frame_uniforms.glsl"
+
+//@STAGES
+
+void main() {
+    // Coordinate stages decide where we read the previous pass from
+    vec2 uv = inUV;
+    //@COORDINATE_CALLS
+
+    // Color stages then operate on that single sample
+    vec3 color = texture(s_Image, uv).rgb;
+    //@COLOR_CALLS
+
+    outColor = color;
+}
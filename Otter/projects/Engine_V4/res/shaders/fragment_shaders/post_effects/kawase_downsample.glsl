@@ -0,0 +1,40 @@
+#version 430
+
+// Downsampling half of the dual filter blur, see DualKawaseBlur.h
+// Each bilinear tap averages a 2x2 block of the input, so 5 taps cover a 4x4 area
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec3 outColor;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+// Half the size of a texel in the image we are reading
+uniform vec2  u_HalfTexel;
+uniform float u_Offset;
+// The largest UV we can read from without leaving the region that was drawn into
+uniform vec2  u_UvMax;
+// Pixels with a brightness below this are faded out, used for bloom
+uniform float u_Threshold;
+
+vec3 Sample(vec2 uv) {
+    return texture(s_Image, min(uv, u_UvMax)).rgb;
+}
+
+void main() {
+    vec2 offset = u_HalfTexel * u_Offset;
+
+    vec3 sum = Sample(inUV) * 4.0;
+    sum += Sample(inUV - offset);
+    sum += Sample(inUV + offset);
+    sum += Sample(inUV + vec2(offset.x, -offset.y));
+    sum += Sample(inUV - vec2(offset.x, -offset.y));
+    vec3 color = sum / 8.0;
+
+    // Scale the color by how far above the threshold it is, rather than cutting it off, so bright edges fade in smoothly
+    if (u_Threshold > 0.0) {
+        float brightness = max(color.r, max(color.g, color.b));
+        color *= max(brightness - u_Threshold, 0.0) / max(brightness, 0.0001);
+    }
+
+    outColor = color;
+}
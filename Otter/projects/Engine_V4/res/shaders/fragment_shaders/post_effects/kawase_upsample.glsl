@@ -0,0 +1,44 @@
+#version 430
+
+// Upsampling half of the dual filter blur, see DualKawaseBlur.h
+// We read a tent shaped pattern from the smaller level, which hides the blockiness of the downsamples
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec3 outColor;
+
+uniform layout(binding = 0) sampler2D s_Image;
+// The image the blur started from, only bound for the last pass
+uniform layout(binding = 1) sampler2D s_Source;
+
+// Half the size of a texel in the image we are reading
+uniform vec2  u_HalfTexel;
+uniform float u_Offset;
+// The largest UV we can read from without leaving the region that was drawn into
+uniform vec2  u_UvMax;
+// How the blurred and source images are added together in the output
+uniform float u_SourceWeight;
+uniform float u_BlurWeight;
+
+vec3 Sample(vec2 uv) {
+    return texture(s_Image, min(uv, u_UvMax)).rgb;
+}
+
+void main() {
+    vec2 offset = u_HalfTexel * u_Offset;
+
+    vec3 sum = Sample(inUV + vec2(-offset.x * 2.0, 0.0));
+    sum += Sample(inUV + vec2( offset.x * 2.0, 0.0));
+    sum += Sample(inUV + vec2(0.0, -offset.y * 2.0));
+    sum += Sample(inUV + vec2(0.0,  offset.y * 2.0));
+    sum += Sample(inUV + vec2(-offset.x,  offset.y)) * 2.0;
+    sum += Sample(inUV + vec2( offset.x,  offset.y)) * 2.0;
+    sum += Sample(inUV + vec2( offset.x, -offset.y)) * 2.0;
+    sum += Sample(inUV + vec2(-offset.x, -offset.y)) * 2.0;
+    vec3 color = (sum / 12.0) * u_BlurWeight;
+
+    if (u_SourceWeight > 0.0) {
+        color += texture(s_Source, inUV).rgb * u_SourceWeight;
+    }
+
+    outColor = color;
+}
@@ -0,0 +1,20 @@
+#version 430
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec3 outColor;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+// One half of a separable kernel, up to 9 taps wide
+uniform float u_Weights[9];
+uniform int   u_Radius;
+// The offset between taps in UV space, along the axis this pass is filtering
+uniform vec2  u_Step;
+
+void main() {
+    vec3 accumulator = vec3(0);
+    for (int ix = -u_Radius; ix <= u_Radius; ix++) {
+        accumulator += texture(s_Image, inUV + u_Step * ix).rgb * u_Weights[ix + u_Radius];
+    }
+    outColor = accumulator;
+}
@@ -0,0 +1,7 @@
+// Color stage, remaps the image's colors through a 3D lookup table
+uniform layout(binding = {SLOT0}) sampler3D {ID}_Lut;
+uniform float {ID}_Strength;
+
+vec3 {ID}(vec3 color, vec2 uv) {
+    return mix(color, texture({ID}_Lut, color).rgb, clamp({ID}_Strength, 0, 1));
+}
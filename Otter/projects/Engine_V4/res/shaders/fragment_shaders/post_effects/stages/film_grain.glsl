@@ -0,0 +1,8 @@
+// Color stage, adds animated noise to the image
+uniform float {ID}_Strength;
+
+vec3 {ID}(vec3 color, vec2 uv) {
+    float x = (uv.x + 4) * (uv.y + 4) * (u_Time * 10);
+    vec3 grain = vec3(mod((mod(x, 13) + 1) * (mod(x, 123) + 1), 0.01) - 0.005) * {ID}_Strength;
+    return color + grain;
+}
@@ -0,0 +1,6 @@
+// Coordinate stage, snaps our sampling position to a coarse grid
+uniform float {ID}_Resolution;
+
+vec2 {ID}(vec2 uv) {
+    return floor(uv * {ID}_Resolution) / {ID}_Resolution;
+}
@@ -0,0 +1,82 @@
+#version 440
+
+layout(location = 0) out vec4 outColor;
+
+// The freshly captured probe, with it's mips generated
+uniform layout(binding = 0) samplerCube s_Capture;
+
+// The face of the cubemap we're rendering into, in the order +X, -X, +Y, -Y, +Z, -Z
+uniform int   u_Face;
+// The size of the mip level we're rendering into, in pixels
+uniform float u_FaceSize;
+// How rough the reflections stored in this mip level are, between 0 and 1
+uniform float u_Roughness;
+// The mip level of the capture to sample from, picked so that our samples don't skip over texels
+uniform float u_SourceLod;
+
+const int   SAMPLE_COUNT = 32;
+const float PI = 3.14159265359;
+
+// Gets the direction through a point on a cubemap face, following OpenGL's cubemap conventions
+// @param face The index of the face
+// @param uv   The position on the face, between 0 and 1
+vec3 GetCubeDirection(int face, vec2 uv) {
+    vec2 p = uv * 2.0 - 1.0;
+    switch (face) {
+        case 0:  return normalize(vec3( 1.0, -p.y, -p.x));
+        case 1:  return normalize(vec3(-1.0, -p.y,  p.x));
+        case 2:  return normalize(vec3( p.x,  1.0,  p.y));
+        case 3:  return normalize(vec3( p.x, -1.0, -p.y));
+        case 4:  return normalize(vec3( p.x, -p.y,  1.0));
+        default: return normalize(vec3(-p.x, -p.y, -1.0));
+    }
+}
+
+// Low discrepancy sequence for spreading our samples evenly over the cone
+// https://learnopengl.com/PBR/IBL/Specular-IBL
+vec2 Hammersley(uint i, uint count) {
+    uint bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return vec2(float(i) / float(count), float(bits) * 2.3283064365386963e-10);
+}
+
+void main() {
+    vec3 normal = GetCubeDirection(u_Face, gl_FragCoord.xy / u_FaceSize);
+
+    // Mip 0 is a perfect mirror, so we can copy the capture straight across
+    if (u_Roughness <= 0.0) {
+        outColor = vec4(textureLod(s_Capture, normal, 0.0).rgb, 1.0);
+        return;
+    }
+
+    // Build a basis around the normal so we can spread our samples around it
+    vec3 up = abs(normal.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, normal));
+    vec3 bitangent = cross(normal, tangent);
+
+    // GGX importance sampling, where we treat the view direction as the normal
+    float alpha = u_Roughness * u_Roughness;
+    vec3  result = vec3(0.0);
+    float totalWeight = 0.0;
+    for (int ix = 0; ix < SAMPLE_COUNT; ix++) {
+        vec2 xi = Hammersley(uint(ix), uint(SAMPLE_COUNT));
+        float phi = 2.0 * PI * xi.x;
+        float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+        float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+        vec3 halfway = tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + normal * cosTheta;
+        vec3 dir = normalize(2.0 * dot(normal, halfway) * halfway - normal);
+
+        float weight = max(dot(normal, dir), 0.0);
+        if (weight > 0.0) {
+            result += textureLod(s_Capture, dir, u_SourceLod).rgb * weight;
+            totalWeight += weight;
+        }
+    }
+
+    outColor = vec4(result / max(totalWeight, 0.0001), 1.0);
+}
@@ -1,5 +1,12 @@
 #version 450
 
+// Features are selected per light by compiling variants of this shader with these defines,
+// which match the ShadowFlags on the shadow camera
+//   SHADOW_PROJECTION  - Multiply the light color by the projection mask
+//   SHADOW_PCF         - Soften the shadow edges with a 3x3 filter
+//   SHADOW_ATTENUATION - Fade the light out with distance
+//   SHADOW_WIDE_PCF    - Use a 5x5 filter instead, requires SHADOW_PCF
+
 layout(location = 0) in vec2 inUV;
 layout(location = 0) out vec4 outDiffuse;
 layout(location = 1) out vec4 outSpecular;
@@ -21,27 +28,12 @@ uniform vec3  u_LightPosViewspace;
 // Shadow settings
 uniform float u_ShadowBias;
 uniform float u_NormalBias;
-uniform uint  u_ShadowFlags;
 
 // Light settings
 uniform float u_Attenuation;
 uniform float u_Intensity;
 uniform vec3  u_LightColor;
 
-// Flags
-#define FLAG_PROJECTION_ENABLED (1 << 0)
-#define FLAG_ENABLE_PCF (1 << 1)
-#define FLAG_ENABLE_ATTENUATION (1 << 2)
-#define FLAG_ENABLE_WIDE_PCF (1 << 3)
-
-/*
- * Determines if one of the shadow option flags is set,
- * if multiple flags are provided, checks all of them
- */
-bool ShadowFlagSet(uint flag) {
-    return (u_ShadowFlags & flag) == flag;
-}
-
 // Represents a single light source
 struct Light {
 	vec4  PositionIntensity;
@@ -81,9 +73,9 @@ void CalcDirectionalLightContribution(vec3 viewPos, vec3 normal, Light light, fl
         float attenuation = 1.0;
         // We'll use a modified distance squared attenuation factor to keep it simple
         // We add the one to prevent divide by zero errors
-        if (ShadowFlagSet(FLAG_ENABLE_ATTENUATION)) {
-            attenuation = clamp(1.0 / (1.0 + light.ColorAttenuation.w * pow(dist, 2)), 0, 256);
-        }
+        #ifdef SHADOW_ATTENUATION
+        attenuation = clamp(1.0 / (1.0 + light.ColorAttenuation.w * pow(dist, 2)), 0, 256);
+        #endif
 
         // Dot product between normal and light
         float NdotL = max(dot(normal, lightDir), 0.0);
@@ -102,12 +94,12 @@ void CalcDirectionalLightContribution(vec3 viewPos, vec3 normal, Light light, fl
 float PCF(vec3 fragPos, float bias) {
 
     // If we're doing PCF, we want to take multiple samples
-    if (ShadowFlagSet(FLAG_ENABLE_PCF)) {
+    #ifdef SHADOW_PCF
         float result = 0.0; // accumulator
         vec2 texelSize = 1.0 / textureSize(s_ShadowDepth, 0); // Determine the texel size of the shadow sampler
         
         // 5x5 kernel
-        if (ShadowFlagSet(FLAG_ENABLE_WIDE_PCF)) {
+        #ifdef SHADOW_WIDE_PCF
             // Normalized 5x5 gaussian kernel
             const float kernel[5][5] = {
                 { 1.0/273,  4.0/273,  7.0/273,  4.0/273, 1.0/273 },
@@ -133,9 +125,8 @@ float PCF(vec3 fragPos, float bias) {
                     result += contrib * kernel[x+2][y+2];
                 }    
             }
-        }
         // 3x3 kernel
-        else {
+        #else
             // Normalized 3x3 gaussian kernel
             const float kernel[3][3] = {
                 { 1.0/16, 2.0/16, 1.0/16 },
@@ -151,16 +142,15 @@ float PCF(vec3 fragPos, float bias) {
                     result += contrib * kernel[x+1][y+1];
                 }    
             }
-        }
+        #endif
 
         return result;
-    }
     // PCF is not enabled, take 1 sample
-    else {
+    #else
         // See above notes about texture
         float contrib = texture(s_ShadowDepth, vec3(fragPos.xy, fragPos.z - bias));
         return contrib; // Perform the depth test, and return the result
-    }
+    #endif
 }
 
 void main() {
@@ -213,14 +203,13 @@ void main() {
         l.PositionIntensity = vec4(u_LightPosViewspace, u_Intensity);
 
         // If we want to use the projection mask, we sample it and multiply by light color
-        if (ShadowFlagSet(FLAG_PROJECTION_ENABLED)) {
-            vec3 color = texture(s_ProjectionMask, shadowPos.xy).rgb * u_LightColor;
-            l.ColorAttenuation = vec4(color, u_Attenuation);
-        }
+        #ifdef SHADOW_PROJECTION
+        vec3 color = texture(s_ProjectionMask, shadowPos.xy).rgb * u_LightColor;
+        l.ColorAttenuation = vec4(color, u_Attenuation);
         // We do not want to use the projection mask, just use the light color
-        else {
-            l.ColorAttenuation = vec4(u_LightColor, u_Attenuation);
-        }
+        #else
+        l.ColorAttenuation = vec4(u_LightColor, u_Attenuation);
+        #endif
 
         // We'll also grab specular power from the G-Buffer
         float specularPow = texture(s_AlbedoSpec, inUV).a;
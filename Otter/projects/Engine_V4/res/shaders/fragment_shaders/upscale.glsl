@@ -0,0 +1,37 @@
+#version 430
+
+layout(location = 0) in vec2 inUV;
+layout(location = 0) out vec4 outColor;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+// The largest UV we can sample without reading outside of the rendered region
+uniform vec2  u_UvMax;
+// How much sharpening to apply after upscaling, 0 is a plain bilinear upscale
+uniform float u_Sharpness;
+
+void main() {
+    vec2 uv = min(inUV, u_UvMax);
+    vec3 color = texture(s_Image, uv).rgb;
+
+    if (u_Sharpness > 0) {
+        vec2 texel = 1.0 / textureSize(s_Image, 0);
+
+        // Sample our 4 neighbours in a cross, clamped to the rendered region
+        vec3 n = texture(s_Image, min(uv + vec2(0, texel.y), u_UvMax)).rgb;
+        vec3 s = texture(s_Image, max(uv - vec2(0, texel.y), vec2(0))).rgb;
+        vec3 e = texture(s_Image, min(uv + vec2(texel.x, 0), u_UvMax)).rgb;
+        vec3 w = texture(s_Image, max(uv - vec2(texel.x, 0), vec2(0))).rgb;
+
+        // Unsharp mask, push the color away from the local average
+        vec3 blurred = (n + s + e + w) * 0.25;
+        vec3 sharpened = color + (color - blurred) * u_Sharpness;
+
+        // Clamp to the neighbourhood so we don't get ringing around hard edges
+        vec3 lo = min(color, min(min(n, s), min(e, w)));
+        vec3 hi = max(color, max(max(n, s), max(e, w)));
+        color = clamp(sharpened, lo, hi);
+    }
+
+    outColor = vec4(color, 1.0);
+}
@@ -18,6 +18,11 @@ layout (std140, binding = 0) uniform b_FrameLevelUniforms {
     uniform float u_ZNear;
     // Camera's far plane
     uniform float u_ZFar;
+    // The fraction of our render targets being rendered into this frame (dynamic resolution)
+    uniform float u_RenderScale;
+    // The ambient lighting as L2 spherical harmonics, with the cosine convolution and basis constants
+    // already applied, see SphericalHarmonics::GetDiffuseCoefficients
+    uniform vec4  u_AmbientSH[9];
 };
 
 // Stores uniforms that change every object/instance
@@ -30,6 +35,9 @@ layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
     uniform mat4 u_ModelView;
     // Normal Matrix for transforming normals
     uniform mat4 u_NormalMatrix;
+    // Decodes quantized vertex positions into model space, identity for full precision meshes
+    uniform vec4 u_PositionScale;
+    uniform vec4 u_PositionOffset;
 };
 
 #define FLAG_ENABLE_COLOR_CORRECTION (1 << 0)
@@ -43,6 +51,22 @@ bool IsFlagSet(uint flag) {
     return (u_Flags & flag) != 0;
 }
 
+// Evaluates the diffuse ambient lighting for a surface facing the given direction
+// @param dir The direction in skybox space (ie. with the environment rotation applied), normalized
+// @returns The ambient lighting, in the same units as the rest of our lights
+vec3 EvaluateAmbientSH(vec3 dir) {
+    vec3 result = u_AmbientSH[0].rgb
+        + u_AmbientSH[1].rgb * dir.y
+        + u_AmbientSH[2].rgb * dir.z
+        + u_AmbientSH[3].rgb * dir.x
+        + u_AmbientSH[4].rgb * (dir.x * dir.y)
+        + u_AmbientSH[5].rgb * (dir.y * dir.z)
+        + u_AmbientSH[6].rgb * (3.0 * dir.z * dir.z - 1.0)
+        + u_AmbientSH[7].rgb * (dir.x * dir.z)
+        + u_AmbientSH[8].rgb * (dir.x * dir.x - dir.y * dir.y);
+    return max(result, vec3(0.0));
+}
+
 float linearize(float depth) {
     return (2 * u_ZNear) / (u_ZFar + u_ZNear - depth * (u_ZFar - u_ZNear));
 }
\ No newline at end of file
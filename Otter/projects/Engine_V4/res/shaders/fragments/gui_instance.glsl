@@ -0,0 +1,30 @@
+// The instances drawn by GuiBatcher, this layout must match GuiBatcher::Instance
+
+struct GuiInstance {
+    // The bounds of the rectangle in model space, xy is the min and zw is the max
+    vec4  Rect;
+    // The UV coords at the min (xy) and max (zw) corners of Rect
+    vec4  UVRect;
+    // xy is the size of the 9-slice border in model space, zw is the size of the border in UV space
+    vec4  Border;
+    vec4  Color;
+    // The region of the screen that the instance is clipped to, xy is the min and zw is the max
+    vec4  Clip;
+    // The columns of the rotation and scale part of the model transform
+    vec4  Transform;
+    vec2  Translation;
+    // Unused, keeps Flags where std430 expects it
+    float Padding;
+    uint  Flags;
+};
+
+// The texture is a font atlas, it's red channel is used as alpha
+#define GUI_FLAG_FONT 1u
+// The texture is a signed distance field font atlas
+#define GUI_FLAG_SDF  2u
+// When drawing from the GUI atlas, the layer to sample is stored above the flag bits
+#define GUI_LAYER_SHIFT 8u
+
+layout (std430, binding = 0) readonly buffer b_GuiInstances {
+    GuiInstance Instances[];
+};
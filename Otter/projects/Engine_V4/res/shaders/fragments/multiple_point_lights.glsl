@@ -46,6 +46,17 @@ vec3 SampleEnvironmentMap(vec3 normal) {
 	return texture(s_EnvironmentMap, transformed).rgb;
 }
 
+// Samples a blurred version of the environment map at a given direction. Reflection probes
+// store rougher reflections in each mip level, so we pick a mip from the roughness
+// @param normal    The direction to sample
+// @param roughness How rough the surface is, between 0 (mirror) and 1
+// @returns The RGB color that was sampled from the environment map
+vec3 SampleEnvironmentMap(vec3 normal, float roughness) {
+	vec3 transformed = EnvironmentRotation * normal;
+	float lod = clamp(roughness, 0.0, 1.0) * float(textureQueryLevels(s_EnvironmentMap) - 1);
+	return textureLod(s_EnvironmentMap, transformed, lod).rgb;
+}
+
 // Calculates the contribution the given point light has 
 // for the current fragment
 // @param worldPos  The fragment's position in world space
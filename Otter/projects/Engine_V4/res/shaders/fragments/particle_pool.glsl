@@ -0,0 +1,81 @@
+// The storage buffers shared by all the passes of our GPU particle pool, see GpuParticlePool.h
+// These layouts must match the structs on the C++ side
+
+struct Particle {
+    // xyz is the world position, w is the remaining life in seconds
+    vec4 PositionLife;
+    // xyz is the velocity, w is the life the particle started with
+    vec4 VelocityMaxLife;
+    vec4 Color;
+    // xyz is the acceleration applied to the particle
+    vec4 Gravity;
+};
+
+struct Emitter {
+    // xyz is the world position, w is the cone angle in radians
+    vec4  PositionCone;
+    vec4  Velocity;
+    vec4  Color;
+    vec4  Gravity;
+    vec2  LifetimeRange;
+    uint  SpawnCount;
+    uint  Seed;
+};
+
+struct SortEntry {
+    float Key;
+    uint  Index;
+};
+
+layout (std430, binding = 0) buffer b_Particles {
+    Particle Particles[];
+};
+
+// Indices of particles that are free to be spawned
+layout (std430, binding = 1) buffer b_DeadList {
+    uint DeadList[];
+};
+
+// The particles that were alive after the last update
+layout (std430, binding = 2) buffer b_AliveIn {
+    uint AliveIn[];
+};
+
+// The particles that survive this update
+layout (std430, binding = 3) buffer b_AliveOut {
+    uint AliveOut[];
+};
+
+layout (std430, binding = 4) readonly buffer b_Emitters {
+    Emitter Emitters[];
+};
+
+// This is also bound as our indirect dispatch and draw buffer, so the arguments must stay at these offsets
+layout (std430, binding = 5) buffer b_Counters {
+    int  AliveCount[2];
+    int  DeadCount;
+    uint _padding0;
+    uint SimulateArgs[3];
+    uint _padding1;
+    uint DrawArgs[4];
+};
+
+layout (std430, binding = 6) buffer b_SortEntries {
+    SortEntry SortEntries[];
+};
+
+// Which of the alive counts belongs to AliveIn, the other belongs to AliveOut
+uniform uint u_CurrentList;
+
+// PCG hash, see https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+uint Hash(uint value) {
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Returns a random number between 0 and 1, and advances the seed
+float Random(inout uint seed) {
+    seed = Hash(seed);
+    return float(seed) / 4294967295.0;
+}
@@ -17,3 +17,8 @@ layout(location = 4) out mat3 outTBN;
 
 // Include the matrices and frame level parameters
 #include "frame_uniforms.glsl"
+
+// Meshes may store their positions quantized to their bounding box, this gets the model space position
+vec3 GetModelPosition() {
+    return inPosition * u_PositionScale.xyz + u_PositionOffset.xyz;
+}
@@ -4,12 +4,13 @@
 #include "../fragments/vs_common.glsl"
 
 void main() {
+	vec3 position = GetModelPosition();
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+	gl_Position = u_ModelViewProjection * vec4(position, 1.0);
 
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outViewPos = (u_ModelView * vec4(inPosition, 1.0)).xyz;
+	outViewPos = (u_ModelView * vec4(position, 1.0)).xyz;
 
 	// Normals
 	outNormal = (u_View * vec4(mat3(u_NormalMatrix) * inNormal, 0)).xyz;
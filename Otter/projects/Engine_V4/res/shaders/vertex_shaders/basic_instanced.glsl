@@ -11,11 +11,12 @@ layout(location = 12) in mat3 inNormalMatrix;
 
 void main() {
 	// We take the hit of doing a matrix multiplication instead of using more bandwidth to send all the matrices
-	gl_Position = (u_ViewProjection * inModelTransform) * vec4(inPosition, 1.0); 
+	vec3 position = GetModelPosition();
+	gl_Position = (u_ViewProjection * inModelTransform) * vec4(position, 1.0); 
 
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outWorldPos = (inModelTransform * vec4(inPosition, 1.0)).xyz;
+	outWorldPos = (inModelTransform * vec4(position, 1.0)).xyz;
 
 	// Normals
 	outNormal = mat3(inNormalMatrix) * inNormal;
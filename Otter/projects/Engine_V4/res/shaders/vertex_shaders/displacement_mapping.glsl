@@ -17,7 +17,7 @@ void main() {
     // We'll use our surface normal for the dispalcement. We could use a normal map,
     // but this should give us OK results. Note that our displacement will be in
     // object space
-    vec3 displacedPos = inPosition + (inNormal * displacement);
+    vec3 displacedPos = GetModelPosition() + (inNormal * displacement);
 
     // Transform to world position
 	gl_Position = u_ModelViewProjection * vec4(displacedPos, 1.0);
@@ -9,10 +9,11 @@ uniform float u_VerticalScale;
 uniform float u_WindSpeed;
 
 void main() {
+    vec3 position = GetModelPosition();
     // Determine the offset based on our simple wind calcualtion
-    vec3 windFactor = normalize(u_WindDirection) * sin(u_Time * u_WindSpeed) * cos(inPosition.z * u_VerticalScale) * u_WindStrength;
+    vec3 windFactor = normalize(u_WindDirection) * sin(u_Time * u_WindSpeed) * cos(position.z * u_VerticalScale) * u_WindStrength;
 	// Calculate the output world position
-	outViewPos = (u_ModelView * vec4(inPosition, 1.0)).xyz + windFactor;
+	outViewPos = (u_ModelView * vec4(position, 1.0)).xyz + windFactor;
     // Project the world position to determine the screenspace position
 	gl_Position = u_Projection * vec4(outViewPos, 1);
 
@@ -11,6 +11,8 @@ void main() {
     mat4 clipToView = inverse(u_Projection);
 
     gl_Position = vec4(inPos, 0, 1);
-    outUV = (inPos + 1) / 2;
+    // Our render targets may only be partially filled when using dynamic resolution,
+    // so we scale our UVs to only cover the region we are rendering into
+    outUV = ((inPos + 1) / 2) * u_RenderScale;
     outViewDir = (clipToView * vec4(inPos, 0, 1)).xyz;
 }
\ No newline at end of file
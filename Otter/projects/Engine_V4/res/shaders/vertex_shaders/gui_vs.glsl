@@ -0,0 +1,61 @@
+#version 460
+
+// Expands each GUI instance into a 9-sliced rectangle. There are no vertex attributes, each instance
+// is drawn with 54 vertices, 2 triangles for each of the 9 cells. Instances without a border collapse
+// every cell except the center one, so they end up as a single quad
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec2 outUV;
+layout (location = 2) out vec2 outScreenPos;
+layout (location = 3) out flat vec4 outClip;
+layout (location = 4) out flat uint outFlags;
+
+#include "../fragments/gui_instance.glsl"
+
+layout (location = 0) uniform mat4 u_Projection;
+
+// The corner of the cell for each vertex of it's 2 triangles
+const ivec2 CORNERS[6] = ivec2[](
+    ivec2(0, 0), ivec2(0, 1), ivec2(1, 1),
+    ivec2(0, 0), ivec2(1, 1), ivec2(1, 0)
+);
+
+// Gets one of the 4 lines along an axis that split a range into 3 cells
+float SliceLine(int index, float rangeMin, float rangeMax, float border) {
+    float direction = sign(rangeMax - rangeMin);
+    switch (index) {
+        case 0:  return rangeMin;
+        case 1:  return rangeMin + border * direction;
+        case 2:  return rangeMax - border * direction;
+        default: return rangeMax;
+    }
+}
+
+void main() {
+    GuiInstance instance = Instances[gl_BaseInstance + gl_InstanceID];
+
+    int cell = gl_VertexID / 6;
+    ivec2 line = ivec2(cell % 3, cell / 3) + CORNERS[gl_VertexID % 6];
+
+    // Borders can't be more than half the size of the rect, otherwise the slices would overlap
+    vec2 border = min(instance.Border.xy, abs(instance.Rect.zw - instance.Rect.xy) * 0.5);
+    vec2 borderUV = instance.Border.zw * (border / max(instance.Border.xy, vec2(0.0001)));
+
+    vec2 pos = vec2(
+        SliceLine(line.x, instance.Rect.x, instance.Rect.z, border.x),
+        SliceLine(line.y, instance.Rect.y, instance.Rect.w, border.y)
+    );
+    vec2 uv = vec2(
+        SliceLine(line.x, instance.UVRect.x, instance.UVRect.z, borderUV.x),
+        SliceLine(line.y, instance.UVRect.y, instance.UVRect.w, borderUV.y)
+    );
+
+    vec2 screenPos = mat2(instance.Transform.xy, instance.Transform.zw) * pos + instance.Translation;
+
+    outColor = instance.Color;
+    outUV = uv;
+    outScreenPos = screenPos;
+    outClip = instance.Clip;
+    outFlags = instance.Flags;
+
+    gl_Position = u_Projection * vec4(screenPos, 0, 1);
+}
@@ -0,0 +1,18 @@
+#version 440
+
+// Draws static objects with their lightmap UVs, see RenderLayer's lightmap pass
+layout(location = 0) in vec3 inPosition;
+// Lightmap coordinates, see MeshResource::LIGHTMAP_UV_SLOT
+layout(location = 7) in vec2 inLightmapUV;
+
+layout(location = 0) out vec2 outLightmapUV;
+
+#include "../fragments/frame_uniforms.glsl"
+
+void main() {
+	// This must match GetModelPosition in vs_common.glsl exactly, so we land on the same depth as the G-Buffer
+	vec3 position = inPosition * u_PositionScale.xyz + u_PositionOffset.xyz;
+	gl_Position = u_ModelViewProjection * vec4(position, 1.0);
+
+	outLightmapUV = inLightmapUV;
+}
@@ -0,0 +1,24 @@
+#version 450
+
+// Draws the particles in our GPU particle pool as points, back to front. There are no vertex attributes,
+// each vertex looks up it's particle through the sorted keys
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out flat uint outType;
+layout (location = 2) out vec3 viewPos;
+
+#include "../fragments/particle_pool.glsl"
+#include "../fragments/frame_uniforms.glsl"
+
+#define TYPE_PARTICLE 1
+
+void main() {
+    Particle particle = Particles[SortEntries[gl_VertexID].Index];
+
+    viewPos = (u_View * vec4(particle.PositionLife.xyz, 1)).xyz;
+    gl_Position = u_Projection * vec4(viewPos, 1);
+
+    // Fade out over the particle's life
+    fragColor = vec4(particle.Color.rgb, particle.Color.a * (particle.PositionLife.w / particle.VelocityMaxLife.w));
+    outType = TYPE_PARTICLE;
+    gl_PointSize = 10.0;
+}
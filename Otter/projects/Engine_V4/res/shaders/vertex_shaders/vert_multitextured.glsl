@@ -10,11 +10,12 @@ layout(location = 6) in vec4 inTextureWeights;
 layout(location = 7) out vec4 outTextureWeights;
 
 void main() {
+	vec3 position = GetModelPosition();
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+	gl_Position = u_ModelViewProjection * vec4(position, 1.0);
 
 	// Pass vertex pos in world space to frag shader
-	outViewPos = (u_ModelView * vec4(inPosition, 1.0)).xyz;
+	outViewPos = (u_ModelView * vec4(position, 1.0)).xyz;
 	// Normals
 	outNormal = (u_View * vec4(mat3(u_NormalMatrix) * inNormal, 1)).xyz;
 	// Pass our UV coords to the fragment shader
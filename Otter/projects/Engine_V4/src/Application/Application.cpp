@@ -29,6 +29,7 @@
 #include "Graphics/Font.h"
 #include "Graphics/GuiBatcher.h"
 #include "Graphics/Framebuffer.h"
+#include "Graphics/DebugDraw.h"
 
 // Gameplay
 #include "Gameplay/Material.h"
@@ -49,6 +50,7 @@
 #include "Gameplay/Components/EnemyMovement.h"
 #include "Gameplay/Components/CameraVanguard.h"
 #include "Gameplay/Components/ShadowCamera.h"
+#include "Gameplay/Components/ReflectionProbe.h"
 
 
 // Audio
@@ -70,6 +72,7 @@
 #include "Layers/InstancedRenderingTestLayer.h"
 #include "Layers/ParticleLayer.h"
 #include "Layers/PostProcessingLayer.h"
+#include "Layers/OcclusionCullingLayer.h"
 
 Application* Application::_singleton = nullptr;
 std::string Application::_applicationName = "INFR-2350U - DEMO";
@@ -165,6 +168,8 @@ void Application::_Run()
 	// TODO: Register layers
 	_layers.push_back(std::make_shared<GLAppLayer>());
 	_layers.push_back(std::make_shared<DefaultSceneLayer>());
+	// Occlusion culling must come before logic so that it can run in parallel with the scene update
+	_layers.push_back(std::make_shared<OcclusionCullingLayer>());
 	_layers.push_back(std::make_shared<LogicUpdateLayer>());
 	_layers.push_back(std::make_shared<RenderLayer>());
 	_layers.push_back(std::make_shared<ParticleLayer>());
@@ -250,6 +255,7 @@ void Application::_Run()
 
 		InputEngine::EndFrame();
 		ImGuiHelper::EndFrame();
+		DebugDrawer::EndFrame(dt);
 
 		glfwSwapBuffers(_window);
 
@@ -294,6 +300,7 @@ void Application::_RegisterClasses()
 	ComponentManager::RegisterType<ParticleSystem>();
 	ComponentManager::RegisterType<Light>();
 	ComponentManager::RegisterType<ShadowCamera>();
+	ComponentManager::RegisterType<ReflectionProbe>();
 
 	ComponentManager::RegisterType<EnemyMovement>();
 	ComponentManager::RegisterType<CameraVanguard>();
@@ -2,6 +2,7 @@
 #include "Utils/ObjLoader.h"
 #include "Gameplay/Scene.h"
 #include "Application/Application.h"
+#include "Application/Layers/RenderLayer.h"
 #include "Gameplay/Components/RotatingBehaviour.h"
 
 InstancedRenderingTestLayer::InstancedRenderingTestLayer()
@@ -81,6 +82,13 @@ void InstancedRenderingTestLayer::OnUpdate() {
 }
 
 void InstancedRenderingTestLayer::OnRender(const Framebuffer::Sptr& prevLayer) {
+	// Our mesh is quantized, so the shader needs to know how to decode it. The render layer leaves
+	// whatever the last object it drew used in the instance uniforms
+	const auto& instanceUniforms = Application::Get().GetLayer<RenderLayer>()->GetInstanceUniforms();
+	instanceUniforms->GetData().u_PositionScale = glm::vec4(_vao->GetPositionScale(), 0.0f);
+	instanceUniforms->GetData().u_PositionOffset = glm::vec4(_vao->GetPositionOffset(), 0.0f);
+	instanceUniforms->Update();
+
 	_shader->Bind();
 	_vao->DrawInstanced(_instances.size());
 }
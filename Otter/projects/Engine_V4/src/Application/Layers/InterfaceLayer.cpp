@@ -3,18 +3,32 @@
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
 #include "../Application.h"
+#include "RenderLayer.h"
 
 InterfaceLayer::InterfaceLayer() :
 	ApplicationLayer()
 {
 	Name = "Interface";
-	Overrides = AppLayerFunctions::OnRender | AppLayerFunctions::OnWindowResize;
+	Overrides = AppLayerFunctions::OnPreRender | AppLayerFunctions::OnWindowResize;
 }
 
 InterfaceLayer::~InterfaceLayer()
 { }
 
-void InterfaceLayer::OnRender(const Framebuffer::Sptr& prevLayer) {
+void InterfaceLayer::OnPreRender() {
+	RenderLayer::Sptr renderer = Application::Get().GetLayer<RenderLayer>();
+	RenderGraph::Sptr graph = renderer->GetRenderGraph();
+
+	// The GUI goes on top of the final image, so make sure the scene has been presented first
+	renderer->AddPresentPass();
+
+	RenderGraph::PassBuilder builder = graph->AddPass("Interface", [this](const RenderGraph::PassContext& context) {
+		_RenderInterface();
+	});
+	builder.Write(graph->GetBackbuffer(), RenderTargetAttachment::Color0);
+}
+
+void InterfaceLayer::_RenderInterface() {
 	// Gets the application instance
 	Application& app = Application::Get();
 
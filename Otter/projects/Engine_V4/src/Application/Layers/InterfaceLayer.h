@@ -12,6 +12,9 @@ public:
 		
 	// Inherited from ApplicationLayer
 
-	virtual void OnRender(const Framebuffer::Sptr& prevLayer) override;
+	virtual void OnPreRender() override;
 	virtual void OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) override;
+
+protected:
+	void _RenderInterface();
 };
\ No newline at end of file
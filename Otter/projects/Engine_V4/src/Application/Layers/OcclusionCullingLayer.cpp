@@ -0,0 +1,115 @@
+#include "OcclusionCullingLayer.h"
+#include "../Application.h"
+#include "Gameplay/Components/Camera.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/ShadowCamera.h"
+
+OcclusionCullingLayer::OcclusionCullingLayer() :
+	ApplicationLayer(),
+	_culler(std::make_shared<OcclusionCuller>()),
+	_job(),
+	_hasResults(false),
+	_occludeeIndices(),
+	_shadowViews()
+{
+	Name = "Occlusion Culling";
+	Overrides = AppLayerFunctions::OnUpdate | AppLayerFunctions::OnPreRender | AppLayerFunctions::OnSceneUnload;
+}
+
+OcclusionCullingLayer::~OcclusionCullingLayer() {
+	_WaitForJob();
+}
+
+bool OcclusionCullingLayer::IsVisible(const RenderComponent* renderable, int view) const {
+	// If we're disabled or haven't finished culling, we have to assume everything is visible
+	if (!Enabled || !_hasResults) {
+		return true;
+	}
+
+	auto it = _occludeeIndices.find(renderable);
+	return it == _occludeeIndices.end() || _culler->IsVisible(view, it->second);
+}
+
+int OcclusionCullingLayer::GetShadowView(const ShadowCamera* camera) const {
+	auto it = _shadowViews.find(camera);
+	return it != _shadowViews.end() ? it->second : -1;
+}
+
+const OcclusionCuller::Sptr& OcclusionCullingLayer::GetCuller() const {
+	return _culler;
+}
+
+void OcclusionCullingLayer::OnUpdate()
+{
+	using namespace Gameplay;
+
+	// Make sure last frame's job is done before we start touching the culler
+	_WaitForJob();
+	_hasResults = false;
+
+	Application& app = Application::Get();
+	Scene::Sptr& scene = app.CurrentScene();
+	if (scene == nullptr || scene->MainCamera == nullptr) {
+		return;
+	}
+
+	_culler->Clear();
+	_occludeeIndices.clear();
+	_shadowViews.clear();
+
+	// The main camera is always view 0, then one view per shadow caster
+	_culler->AddView(scene->MainCamera->GetViewProjection());
+	scene->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
+		_shadowViews[shadowCam.get()] = _culler->AddView(shadowCam->GetViewProjection());
+	});
+
+	// Snapshot all our renderables. Reading the CPU mesh data will hit OpenGL the first time we
+	// see a mesh, so this must happen here on the main thread
+	scene->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		MeshResource::Sptr mesh = renderable->GetMeshResource();
+		if (mesh == nullptr) {
+			return;
+		}
+
+		const MeshResource::CpuMeshData::Sptr& data = mesh->GetCpuData();
+		if (data == nullptr) {
+			return;
+		}
+
+		const glm::mat4& transform = renderable->GetGameObject()->GetTransform();
+		if (renderable->IsOccluder) {
+			_culler->AddOccluder(data, transform);
+		}
+		_occludeeIndices[renderable.get()] = _culler->AddOccludee(data->BoundsMin, data->BoundsMax, transform);
+	});
+
+	// Kick off the culling job, this will run while the logic layer updates the scene
+	OcclusionCuller::Sptr culler = _culler;
+	_job = std::async(std::launch::async, [culler]() {
+		culler->Execute();
+	});
+}
+
+void OcclusionCullingLayer::OnPreRender()
+{
+	// We need our results before the render layer starts submitting draws
+	if (_job.valid()) {
+		_WaitForJob();
+		_hasResults = true;
+	}
+}
+
+void OcclusionCullingLayer::OnSceneUnload()
+{
+	// The components we snapshotted are about to go away
+	_WaitForJob();
+	_hasResults = false;
+	_occludeeIndices.clear();
+	_shadowViews.clear();
+}
+
+void OcclusionCullingLayer::_WaitForJob() {
+	if (_job.valid()) {
+		_job.get();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <future>
+#include <unordered_map>
+#include "../ApplicationLayer.h"
+#include "Graphics/OcclusionCuller.h"
+
+class RenderComponent;
+class ShadowCamera;
+
+/**
+ * Handles software occlusion culling for the scene. At the start of the frame we snapshot the
+ * occluders, renderables and views (the main camera and each shadow camera), then run the culler
+ * on a worker thread while the scene is updating. The render layer then queries the results
+ * when submitting draws.
+ *
+ * Note that since we run in parallel with the scene update, the results lag a frame behind
+ * any movement. This layer must be registered before the logic update layer.
+ */
+class OcclusionCullingLayer final : public ApplicationLayer {
+public:
+	MAKE_PTRS(OcclusionCullingLayer);
+
+	// The view index of the main camera, shadow cameras can be found with GetShadowView
+	static const int MAIN_VIEW = 0;
+
+	OcclusionCullingLayer();
+	virtual ~OcclusionCullingLayer();
+
+	/**
+	 * Returns true if the given renderable may be visible in the given view. Anything we didn't
+	 * know about when we started culling this frame is always considered visible
+	 *
+	 * @param renderable The render component to check
+	 * @param view The view to test against, either MAIN_VIEW or a result of GetShadowView
+	 */
+	bool IsVisible(const RenderComponent* renderable, int view = MAIN_VIEW) const;
+
+	/**
+	 * Gets the culling view for the given shadow camera, or -1 if it has no view this frame
+	 */
+	int GetShadowView(const ShadowCamera* camera) const;
+
+	/**
+	 * Gets the underlying culler, for debugging and stats
+	 */
+	const OcclusionCuller::Sptr& GetCuller() const;
+
+	// Inherited from ApplicationLayer
+
+	virtual void OnUpdate() override;
+	virtual void OnPreRender() override;
+	virtual void OnSceneUnload() override;
+
+protected:
+	OcclusionCuller::Sptr _culler;
+	std::future<void>     _job;
+	bool                  _hasResults;
+
+	std::unordered_map<const RenderComponent*, int> _occludeeIndices;
+	std::unordered_map<const ShadowCamera*, int>    _shadowViews;
+
+	void _WaitForJob();
+};
@@ -1,50 +1,114 @@
 #include "ParticleLayer.h"
 #include "Gameplay/Components/ParticleSystem.h"
 #include "Application/Application.h"
+#include "Application/Timing.h"
 #include "RenderLayer.h"
+#include "Graphics/GpuParticlePool.h"
+#include "Graphics/CpuParticlePool.h"
+#include "Utils/JsonGlmHelpers.h"
 
 ParticleLayer::ParticleLayer() :
-	ApplicationLayer()
+	ApplicationLayer(),
+	_pool(nullptr),
+	_useCpuBackend(false),
+	_cpuThreadCount(0),
+	_cpuStreamToGpu(true)
 {
 	Name = "Particles";
-	Overrides = AppLayerFunctions::OnUpdate | AppLayerFunctions::OnPostRender;
+	Overrides = 
+		AppLayerFunctions::OnAppLoad | AppLayerFunctions::OnAppUnload | AppLayerFunctions::OnSceneUnload |
+		AppLayerFunctions::OnUpdate | AppLayerFunctions::OnPreRender;
 }
 
 ParticleLayer::~ParticleLayer()
 { }
 
+const IParticlePool::Sptr& ParticleLayer::GetPool() const {
+	return _pool;
+}
+
+void ParticleLayer::OnAppLoad(const nlohmann::json& config)
+{
+	if (config.contains(Name)) {
+		_useCpuBackend  = JsonGet<std::string>(config[Name], "backend", "gpu") == "cpu";
+		_cpuThreadCount = JsonGet(config[Name], "cpu_threads", _cpuThreadCount);
+		_cpuStreamToGpu = JsonGet(config[Name], "cpu_stream_to_gpu", _cpuStreamToGpu);
+	}
+
+	if (_useCpuBackend) {
+		_pool = std::make_shared<CpuParticlePool>(65536, _cpuThreadCount, _cpuStreamToGpu);
+	} else {
+		_pool = std::make_shared<GpuParticlePool>();
+	}
+}
+
+void ParticleLayer::OnAppUnload()
+{
+	_pool = nullptr;
+}
+
+void ParticleLayer::OnSceneUnload()
+{
+	// Particles from the old scene shouldn't hang around in the new one
+	if (_pool != nullptr) {
+		_pool->Clear();
+	}
+}
+
 void ParticleLayer::OnUpdate()
 {
 	Application& app = Application::Get();
 
-	// Only update the particle systems when the game is playing, so we can edit them in
+	// Only update the particles when the game is playing, so we can edit them in
 	// the inspector
-	if (app.CurrentScene()->IsPlaying) {
-		app.CurrentScene()->Components().Each<ParticleSystem>([](const ParticleSystem::Sptr& system) {
+	if (_pool != nullptr && app.CurrentScene()->IsPlaying) {
+		float dt = Timing::Current().DeltaTime();
+
+		// Every system reserves room in the pool for it's particles
+		uint32_t required = 0;
+		app.CurrentScene()->Components().Each<ParticleSystem>([&](const ParticleSystem::Sptr& system) {
+			if (system->IsEnabled) {
+				required += system->GetMaxParticles();
+			}
+		});
+		_pool->Reserve(required);
+
+		// Let every system queue up what it spawns, then simulate them all together
+		app.CurrentScene()->Components().Each<ParticleSystem>([&](const ParticleSystem::Sptr& system) {
 			if (system->IsEnabled) {
-				system->Update();
+				system->Update(*_pool, dt);
 			}
 		});
+		_pool->Simulate(dt);
 	}
 }
 
-void ParticleLayer::OnPostRender()
+void ParticleLayer::OnPreRender()
 {
-	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
-
-	// Restore viewport to game viewport
+	// Don't add a pass at all if there's nothing to draw. Particles keep living after their
+	// system is removed, so we go by the pool rather than the systems
+	if (_pool == nullptr || _pool->IsEmpty()) {
+		return;
+	}
 
+	// Particles are blended on top of the composited scene, and depth tested against it
+	Application& app = Application::Get();
 	RenderLayer::Sptr renderer = app.GetLayer<RenderLayer>();
-	const Framebuffer::Sptr renderOutput = renderer->GetRenderOutput();
-	renderOutput->Bind();
-	glViewport(0, 0, renderOutput->GetWidth(), renderOutput->GetHeight());
-
-	Application::Get().CurrentScene()->Components().Each<ParticleSystem>([](const ParticleSystem::Sptr& system) {
-		if (system->IsEnabled) {
-			system->Render(); 
-		}
+	RenderGraph::Sptr graph = renderer->GetRenderGraph();
+	IParticlePool::Sptr pool = _pool;
+	RenderGraph::PassBuilder builder = graph->AddPass("Particles", [pool](const RenderGraph::PassContext& context) {
+		// The graph has already bound the scene and set our viewport to the region the renderer is using
+		pool->Render();
 	});
+	builder.Write(graph->GetNamedResource(RenderLayer::SCENE_COLOR), RenderTargetAttachment::Color0);
+	builder.Write(graph->GetNamedResource(RenderLayer::SCENE_DEPTH), RenderTargetAttachment::Depth);
+}
 
-	renderer->GetRenderOutput()->Unbind();
+nlohmann::json ParticleLayer::GetDefaultConfig()
+{
+	return {
+		{ "backend",           _useCpuBackend ? "cpu" : "gpu" },
+		{ "cpu_threads",       _cpuThreadCount },
+		{ "cpu_stream_to_gpu", _cpuStreamToGpu }
+	};
 }
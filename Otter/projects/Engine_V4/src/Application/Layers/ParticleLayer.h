@@ -1,14 +1,41 @@
 #pragma once
 #include "../ApplicationLayer.h"
+#include "Graphics/IParticlePool.h"
 
-
+/**
+ * Owns the engine-wide particle pool. Each update, every enabled particle system queues up the
+ * particles its emitters spawn, then the whole pool is simulated at once. During rendering all
+ * particles are drawn together, regardless of which system spawned them.
+ *
+ * The pool runs on the GPU by default, setting "backend" to "cpu" in the layer's config simulates
+ * on the CPU instead (see CpuParticlePool)
+ */
 class ParticleLayer : public ApplicationLayer {
 public:
 	MAKE_PTRS(ParticleLayer);
 	ParticleLayer();
 	virtual ~ParticleLayer();
 
+	/**
+	 * Gets the particle pool shared by every particle system, or nullptr before the app has loaded
+	 */
+	const IParticlePool::Sptr& GetPool() const;
+
+	// Inherited from ApplicationLayer
+
+	void OnAppLoad(const nlohmann::json& config) override;
+	void OnAppUnload() override;
+	void OnSceneUnload() override;
 	void OnUpdate() override;
-	void OnPostRender() override;
+	void OnPreRender() override;
+	nlohmann::json GetDefaultConfig() override;
 
-};
\ No newline at end of file
+protected:
+	IParticlePool::Sptr _pool;
+	// True to simulate particles on the CPU rather than the GPU
+	bool     _useCpuBackend;
+	// The number of threads the CPU backend simulates with, 0 for one per hardware thread
+	uint32_t _cpuThreadCount;
+	// True if the CPU backend should upload particles for drawing
+	bool     _cpuStreamToGpu;
+};
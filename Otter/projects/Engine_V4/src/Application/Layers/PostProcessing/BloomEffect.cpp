@@ -0,0 +1,68 @@
+#include "BloomEffect.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ImGuiHelper.h"
+
+BloomEffect::BloomEffect() :
+	PostProcessingLayer::Effect(),
+	_blur(),
+	_threshold(0.8f),
+	_intensity(0.6f)
+{
+	Name = "Bloom";
+	_format = RenderTargetType::ColorRgb8;
+	Enabled = false;
+
+	// Bloom wants to spread quite far, so we go a level deeper than a regular blur
+	_blur.Iterations = 5;
+}
+
+BloomEffect::~BloomEffect() = default;
+
+int BloomEffect::GetPassCount()
+{
+	return _blur.GetPassCount();
+}
+
+PostProcessingLayer::Effect::PassDesc BloomEffect::GetPassDesc(int pass) const
+{
+	return _blur.GetPassDesc(pass, _outputScale, _format);
+}
+
+void BloomEffect::ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer)
+{
+	// The threshold is applied as we downsample, and the blurred highlights are added on top of the source as we finish
+	_blur.ApplyPass(pass, input, source, _threshold, 1.0f, _intensity);
+}
+
+bool BloomEffect::IsIdentity() const
+{
+	return _intensity <= 0.0f;
+}
+
+void BloomEffect::RenderImGui()
+{
+	LABEL_LEFT(ImGui::SliderFloat, "Threshold", &_threshold, 0.0f, 1.0f);
+	LABEL_LEFT(ImGui::SliderFloat, "Intensity", &_intensity, 0.0f, 4.0f);
+	_blur.RenderImGui();
+}
+
+BloomEffect::Sptr BloomEffect::FromJson(const nlohmann::json& data)
+{
+	BloomEffect::Sptr result = std::make_shared<BloomEffect>();
+	result->Enabled = JsonGet(data, "enabled", false);
+	result->_threshold = JsonGet(data, "threshold", result->_threshold);
+	result->_intensity = JsonGet(data, "intensity", result->_intensity);
+	result->_blur.FromJson(data);
+	return result;
+}
+
+nlohmann::json BloomEffect::ToJson() const
+{
+	nlohmann::json result = {
+		{ "enabled", Enabled },
+		{ "threshold", _threshold },
+		{ "intensity", _intensity }
+	};
+	_blur.ToJson(result);
+	return result;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "Application/Layers/PostProcessingLayer.h"
+#include "DualKawaseBlur.h"
+
+/**
+ * Makes bright areas of the image bleed light into their surroundings, by blurring
+ * everything above a brightness threshold and adding it back on top of the image
+ */
+class BloomEffect : public PostProcessingLayer::Effect {
+public:
+	MAKE_PTRS(BloomEffect);
+
+	BloomEffect();
+	virtual ~BloomEffect();
+
+	virtual int GetPassCount() override;
+	virtual PassDesc GetPassDesc(int pass) const override;
+	virtual void ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer) override;
+	virtual bool IsIdentity() const override;
+	virtual void RenderImGui() override;
+
+	// Inherited from IResource
+
+	BloomEffect::Sptr FromJson(const nlohmann::json& data);
+	virtual nlohmann::json ToJson() const override;
+
+protected:
+	DualKawaseBlur _blur;
+	// Pixels with a brightness below this won't bloom
+	float          _threshold;
+	// How strongly the bloom is added to the image
+	float          _intensity;
+};
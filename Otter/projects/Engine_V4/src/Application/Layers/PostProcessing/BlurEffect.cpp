@@ -0,0 +1,60 @@
+#include "BlurEffect.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ImGuiHelper.h"
+
+BlurEffect::BlurEffect() :
+	PostProcessingLayer::Effect(),
+	_blur(),
+	_strength(1.0f)
+{
+	Name = "Blur";
+	_format = RenderTargetType::ColorRgb8;
+	Enabled = false;
+}
+
+BlurEffect::~BlurEffect() = default;
+
+int BlurEffect::GetPassCount()
+{
+	return _blur.GetPassCount();
+}
+
+PostProcessingLayer::Effect::PassDesc BlurEffect::GetPassDesc(int pass) const
+{
+	return _blur.GetPassDesc(pass, _outputScale, _format);
+}
+
+void BlurEffect::ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer)
+{
+	_blur.ApplyPass(pass, input, source, 0.0f, 1.0f - _strength, _strength);
+}
+
+bool BlurEffect::IsIdentity() const
+{
+	return _strength <= 0.0f;
+}
+
+void BlurEffect::RenderImGui()
+{
+	LABEL_LEFT(ImGui::SliderFloat, "Strength", &_strength, 0.0f, 1.0f);
+	_blur.RenderImGui();
+}
+
+BlurEffect::Sptr BlurEffect::FromJson(const nlohmann::json& data)
+{
+	BlurEffect::Sptr result = std::make_shared<BlurEffect>();
+	result->Enabled = JsonGet(data, "enabled", false);
+	result->_strength = JsonGet(data, "strength", result->_strength);
+	result->_blur.FromJson(data);
+	return result;
+}
+
+nlohmann::json BlurEffect::ToJson() const
+{
+	nlohmann::json result = {
+		{ "enabled", Enabled },
+		{ "strength", _strength }
+	};
+	_blur.ToJson(result);
+	return result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "Application/Layers/PostProcessingLayer.h"
+#include "DualKawaseBlur.h"
+
+/**
+ * A wide, full screen blur that runs in roughly constant time regardless of it's radius
+ */
+class BlurEffect : public PostProcessingLayer::Effect {
+public:
+	MAKE_PTRS(BlurEffect);
+
+	BlurEffect();
+	virtual ~BlurEffect();
+
+	virtual int GetPassCount() override;
+	virtual PassDesc GetPassDesc(int pass) const override;
+	virtual void ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer) override;
+	virtual bool IsIdentity() const override;
+	virtual void RenderImGui() override;
+
+	// Inherited from IResource
+
+	BlurEffect::Sptr FromJson(const nlohmann::json& data);
+	virtual nlohmann::json ToJson() const override;
+
+protected:
+	DualKawaseBlur _blur;
+	// How much of the blurred image to show, 0 is the original image and 1 is entirely blurred
+	float          _strength;
+};
@@ -1,4 +1,5 @@
 #include "BoxFilter5x5.h"
+#include "SeparableKernel.h"
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Utils/ImGuiHelper.h"
@@ -7,7 +8,8 @@
 #include <GLM/glm.hpp>
 
 BoxFilter5x5::BoxFilter5x5() :
-	PostProcessingLayer::Effect()
+	PostProcessingLayer::Effect(),
+	_isSeparable(false)
 {
 	Name = "Box Filter";
 	_format = RenderTargetType::ColorRgb8;
@@ -19,15 +21,62 @@ BoxFilter5x5::BoxFilter5x5() :
 		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
 		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/box_filter_5.glsl" }
 	});
+	_separableShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
+		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/separable_filter.glsl" }
+	});
+
+	_filterUniform    = _shader->GetUniformHandle<float>("u_Filter");
+	_pixelSizeUniform = _shader->GetUniformHandle<glm::vec2>("u_PixelSize");
+	_weightsUniform   = _separableShader->GetUniformHandle<float>("u_Weights");
+	_radiusUniform    = _separableShader->GetUniformHandle<int>("u_Radius");
+	_stepUniform      = _separableShader->GetUniformHandle<glm::vec2>("u_Step");
 }
 
 BoxFilter5x5::~BoxFilter5x5() = default;
 
-void BoxFilter5x5::Apply(const Framebuffer::Sptr& gBuffer)
+int BoxFilter5x5::GetPassCount()
+{
+	// Most useful filters (box, gaussian) are separable, so we can do 5 + 5 taps instead of 25
+	_isSeparable = SeparableKernel::Separate(Filter, 5, _rowWeights, _columnWeights);
+	return _isSeparable ? 2 : 1;
+}
+
+PostProcessingLayer::Effect::PassDesc BoxFilter5x5::GetPassDesc(int pass) const
+{
+	// The horizontal pass can produce values outside of 0-1 with negative weights, so we keep it in a float target
+	if (_isSeparable && pass == 0) {
+		return { _outputScale, RenderTargetType::ColorRgb16F };
+	}
+	return { _outputScale, _format };
+}
+
+void BoxFilter5x5::ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer)
 {
-	_shader->Bind();
-	_shader->SetUniform("u_Filter", Filter, 25);
-	_shader->SetUniform("u_PixelSize", glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize()); 
+	// Our taps are one pixel apart in the image we're reading from, which may not be the same size as the G-Buffer
+	glm::vec2 pixelSize = glm::vec2(1.0f) / glm::vec2(input->GetWidth(), input->GetHeight());
+
+	if (_isSeparable) {
+		_separableShader->Bind();
+		_weightsUniform.Set(pass == 0 ? _rowWeights : _columnWeights, 5);
+		_radiusUniform.Set(2);
+		_stepUniform.Set(pass == 0 ? glm::vec2(pixelSize.x, 0.0f) : glm::vec2(0.0f, pixelSize.y));
+	} else {
+		_shader->Bind();
+		_filterUniform.Set(Filter, 25);
+		_pixelSizeUniform.Set(pixelSize);
+	}
+}
+
+bool BoxFilter5x5::IsIdentity() const
+{
+	// Only the center tap being set means we'd just be copying the image
+	for (int ix = 0; ix < 25; ix++) {
+		if (Filter[ix] != (ix == 12 ? 1.0f : 0.0f)) {
+			return false;
+		}
+	}
+	return true;
 }
 
 void BoxFilter5x5::RenderImGui()
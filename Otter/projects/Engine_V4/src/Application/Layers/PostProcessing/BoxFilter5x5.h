@@ -12,7 +12,10 @@ public:
 	BoxFilter5x5();
 	virtual ~BoxFilter5x5();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual int GetPassCount() override;
+	virtual PassDesc GetPassDesc(int pass) const override;
+	virtual void ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer) override;
+	virtual bool IsIdentity() const override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -21,5 +24,16 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
+	// Used when the filter can't be separated, samples all 25 taps in one pass
+	ShaderProgram::Sptr       _shader;
+	UniformHandle<float>      _filterUniform;
+	UniformHandle<glm::vec2>  _pixelSizeUniform;
+	// Used when the filter is separable, draws the rows and then the columns
+	ShaderProgram::Sptr       _separableShader;
+	UniformHandle<float>      _weightsUniform;
+	UniformHandle<int>        _radiusUniform;
+	UniformHandle<glm::vec2>  _stepUniform;
+	bool                _isSeparable;
+	float               _rowWeights[5];
+	float               _columnWeights[5];
 };
\ No newline at end of file
@@ -8,18 +8,12 @@ ColorCorrectionEffect::ColorCorrectionEffect() :
 
 ColorCorrectionEffect::ColorCorrectionEffect(bool defaultLut) :
 	PostProcessingLayer::Effect(),
-	_shader(nullptr),
 	_strength(1.0f),
 	Lut(nullptr)
 {
 	Name = "Color Correction";
 	_format = RenderTargetType::ColorRgb8;
 
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/color_correction.glsl" }
-	});
-	
 	if (defaultLut) {
 		Lut = ResourceManager::CreateAsset<Texture3D>("luts/cool.cube");
 	}
@@ -27,11 +21,23 @@ ColorCorrectionEffect::ColorCorrectionEffect(bool defaultLut) :
 
 ColorCorrectionEffect::~ColorCorrectionEffect() = default;
 
-void ColorCorrectionEffect::Apply(const Framebuffer::Sptr& gBuffer)
+std::string ColorCorrectionEffect::GetStageSource() const
 {
-	_shader->Bind();
-	Lut->Bind(1);
-	_shader->SetUniform("u_Strength", _strength);
+	return "shaders/fragment_shaders/post_effects/stages/color_correction.glsl";
+}
+
+void ColorCorrectionEffect::ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer)
+{
+	Lut->Bind(firstSlot);
+	if (_IsStageChanged(shader, id)) {
+		_strengthUniform = shader->GetUniformHandle<float>(id + "_Strength");
+	}
+	_strengthUniform.Set(_strength);
+}
+
+bool ColorCorrectionEffect::IsIdentity() const
+{
+	return Lut == nullptr || _strength <= 0.0f;
 }
 
 void ColorCorrectionEffect::RenderImGui()
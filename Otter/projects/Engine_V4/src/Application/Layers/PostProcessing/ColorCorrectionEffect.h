@@ -12,7 +12,10 @@ public:
 	ColorCorrectionEffect(bool defaultLut);
 	virtual ~ColorCorrectionEffect();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual Stage GetStage() const override { return Stage::Color; }
+	virtual std::string GetStageSource() const override;
+	virtual void ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer) override;
+	virtual bool IsIdentity() const override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -21,7 +24,7 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
 	float _strength;
+	UniformHandle<float> _strengthUniform;
 };
 
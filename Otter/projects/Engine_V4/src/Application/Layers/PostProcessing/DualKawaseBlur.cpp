@@ -0,0 +1,101 @@
+#include "DualKawaseBlur.h"
+#include "Application/Application.h"
+#include "Application/Layers/RenderLayer.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ImGuiHelper.h"
+
+DualKawaseBlur::DualKawaseBlur() :
+	Iterations(4),
+	Offset(1.0f),
+	_downsample(),
+	_upsample()
+{
+	_downsample.Load("shaders/fragment_shaders/post_effects/kawase_downsample.glsl", true);
+	_upsample.Load("shaders/fragment_shaders/post_effects/kawase_upsample.glsl", false);
+}
+
+DualKawaseBlur::~DualKawaseBlur() = default;
+
+void DualKawaseBlur::PassShader::Load(const std::string& fragmentShader, bool isDownsample)
+{
+	Shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
+		{ ShaderPartType::Fragment, fragmentShader }
+	});
+	HalfTexel = Shader->GetUniformHandle<glm::vec2>("u_HalfTexel");
+	Offset    = Shader->GetUniformHandle<float>("u_Offset");
+	UvMax     = Shader->GetUniformHandle<glm::vec2>("u_UvMax");
+	if (isDownsample) {
+		Threshold    = Shader->GetUniformHandle<float>("u_Threshold");
+	} else {
+		SourceWeight = Shader->GetUniformHandle<float>("u_SourceWeight");
+		BlurWeight   = Shader->GetUniformHandle<float>("u_BlurWeight");
+	}
+}
+
+int DualKawaseBlur::GetPassCount() const
+{
+	return glm::clamp(Iterations, 1, MAX_ITERATIONS) * 2;
+}
+
+PostProcessingLayer::Effect::PassDesc DualKawaseBlur::GetPassDesc(int pass, const glm::vec2& outputScale, RenderTargetType outputFormat) const
+{
+	int iterations = GetPassCount() / 2;
+
+	// The first half of the passes step down to 1/2, 1/4, 1/8..., the second half walk back up the same levels
+	int level = pass < iterations ? pass + 1 : (iterations * 2) - pass - 1;
+	if (level == 0) {
+		return { outputScale, outputFormat };
+	}
+
+	// We keep the chain in half floats so that we don't band or clip while averaging
+	return { outputScale / (float)(1 << level), RenderTargetType::ColorRgb16F };
+}
+
+void DualKawaseBlur::ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, float threshold, float sourceWeight, float blurWeight)
+{
+	int iterations = GetPassCount() / 2;
+	glm::vec2 inputSize = glm::vec2(input->GetWidth(), input->GetHeight());
+
+	// The input may only be partly filled when using dynamic resolution, so we keep our taps inside of what was drawn
+	float renderScale = Application::Get().GetLayer<RenderLayer>()->GetRenderScale();
+	glm::vec2 uvMax = (glm::max(glm::round(inputSize * renderScale), glm::vec2(1.0f)) - 0.5f) / inputSize;
+
+	const PassShader& shader = pass < iterations ? _downsample : _upsample;
+	shader.Shader->Bind();
+	shader.HalfTexel.Set(0.5f / inputSize);
+	shader.Offset.Set(Offset);
+	shader.UvMax.Set(uvMax);
+
+	if (pass < iterations) {
+		// Only the first downsample reads the full image, so that's where we apply the threshold
+		shader.Threshold.Set(pass == 0 ? threshold : 0.0f);
+	} else {
+		// The last upsample blends the result with the source image, the others just pass the blur along
+		bool isLast = pass == iterations * 2 - 1;
+		if (isLast) {
+			source->Bind(1);
+		}
+		shader.SourceWeight.Set(isLast ? sourceWeight : 0.0f);
+		shader.BlurWeight.Set(isLast ? blurWeight : 1.0f);
+	}
+}
+
+void DualKawaseBlur::RenderImGui()
+{
+	LABEL_LEFT(ImGui::SliderInt, "Iterations", &Iterations, 1, MAX_ITERATIONS);
+	LABEL_LEFT(ImGui::SliderFloat, "Offset", &Offset, 0.5f, 4.0f);
+}
+
+void DualKawaseBlur::FromJson(const nlohmann::json& data)
+{
+	Iterations = JsonGet(data, "iterations", Iterations);
+	Offset = JsonGet(data, "offset", Offset);
+}
+
+void DualKawaseBlur::ToJson(nlohmann::json& data) const
+{
+	data["iterations"] = Iterations;
+	data["offset"] = Offset;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "Application/Layers/PostProcessingLayer.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Framebuffer.h"
+
+/**
+ * A wide blur built from a chain of downsamples followed by a chain of upsamples, based on the
+ * "dual filter" from Marius Bjorge's Bandwidth-Efficient Rendering talk (SIGGRAPH 2015). Each level
+ * is a quarter of the size of the one before it, so the whole chain costs a little over one full
+ * resolution pass no matter how wide the blur is.
+ *
+ * This isn't an effect by itself, effects that need a wide blur (blur, bloom, soft outlines) embed one
+ * and forward their GetPassCount, GetPassDesc and ApplyPass calls to it
+ */
+class DualKawaseBlur {
+public:
+	// The largest number of downsamples we allow, at 1080p the last level is only 16x8 pixels
+	static const int MAX_ITERATIONS = 7;
+
+	// The number of times we halve the image, each iteration roughly doubles the radius of the blur
+	int   Iterations;
+	// How far apart the taps are, in texels of the level being read. Values above 1 widen the blur, at the cost of some artifacts
+	float Offset;
+
+	DualKawaseBlur();
+	~DualKawaseBlur();
+
+	/**
+	 * Gets the number of passes the blur will draw, one per downsample and one per upsample
+	 */
+	int GetPassCount() const;
+	/**
+	 * Gets the target the given pass should draw into
+	 * @param pass The index of the pass, between 0 and GetPassCount() - 1
+	 * @param outputScale The scale of the final output of the blur
+	 * @param outputFormat The format of the final output of the blur, the intermediate levels are always half floats
+	 */
+	PostProcessingLayer::Effect::PassDesc GetPassDesc(int pass, const glm::vec2& outputScale, RenderTargetType outputFormat) const;
+	/**
+	 * Binds the shader for the given pass and sets it's uniforms
+	 * @param pass The index of the pass, between 0 and GetPassCount() - 1
+	 * @param input The texture bound to texture slot 0
+	 * @param source The image being blurred, the last pass will blend it with the result
+	 * @param threshold Pixels darker than this are removed by the first downsample, 0 to keep everything
+	 * @param sourceWeight How much of the source image to add into the final output
+	 * @param blurWeight How much of the blurred image to add into the final output
+	 */
+	void ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, float threshold, float sourceWeight, float blurWeight);
+
+	/**
+	 * Renders the ImGui controls for the blur's settings
+	 */
+	void RenderImGui();
+
+	/**
+	 * Loads the blur's settings from a JSON blob, leaving missing settings as they are
+	 */
+	void FromJson(const nlohmann::json& data);
+	/**
+	 * Stores the blur's settings into a JSON blob
+	 */
+	void ToJson(nlohmann::json& data) const;
+
+protected:
+	/**
+	 * One of our shaders, along with handles to it's uniforms. Threshold only exists when downsampling,
+	 * and the weights only exist when upsampling
+	 */
+	struct PassShader {
+		ShaderProgram::Sptr      Shader;
+		UniformHandle<glm::vec2> HalfTexel;
+		UniformHandle<float>     Offset;
+		UniformHandle<glm::vec2> UvMax;
+		UniformHandle<float>     Threshold;
+		UniformHandle<float>     SourceWeight;
+		UniformHandle<float>     BlurWeight;
+
+		void Load(const std::string& fragmentShader, bool isDownsample);
+	};
+
+	PassShader _downsample;
+	PassShader _upsample;
+};
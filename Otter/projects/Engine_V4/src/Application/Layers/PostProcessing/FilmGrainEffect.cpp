@@ -0,0 +1,53 @@
+#include "FilmGrainEffect.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ImGuiHelper.h"
+
+FilmGrainEffect::FilmGrainEffect() :
+	PostProcessingLayer::Effect(),
+	_strength(30.0f)
+{
+	Name = "Film Grain";
+	_format = RenderTargetType::ColorRgb8;
+	Enabled = false;
+}
+
+FilmGrainEffect::~FilmGrainEffect() = default;
+
+std::string FilmGrainEffect::GetStageSource() const
+{
+	return "shaders/fragment_shaders/post_effects/stages/film_grain.glsl";
+}
+
+void FilmGrainEffect::ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer)
+{
+	if (_IsStageChanged(shader, id)) {
+		_strengthUniform = shader->GetUniformHandle<float>(id + "_Strength");
+	}
+	_strengthUniform.Set(_strength);
+}
+
+bool FilmGrainEffect::IsIdentity() const
+{
+	return _strength == 0.0f;
+}
+
+void FilmGrainEffect::RenderImGui()
+{
+	LABEL_LEFT(ImGui::SliderFloat, "Strength", &_strength, 0.0f, 100.0f);
+}
+
+FilmGrainEffect::Sptr FilmGrainEffect::FromJson(const nlohmann::json& data)
+{
+	FilmGrainEffect::Sptr result = std::make_shared<FilmGrainEffect>();
+	result->Enabled = JsonGet(data, "enabled", false);
+	result->_strength = JsonGet(data, "strength", result->_strength);
+	return result;
+}
+
+nlohmann::json FilmGrainEffect::ToJson() const
+{
+	return {
+		{ "enabled", Enabled },
+		{ "strength", _strength }
+	};
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "Application/Layers/PostProcessingLayer.h"
+#include "Graphics/ShaderProgram.h"
+
+class FilmGrainEffect : public PostProcessingLayer::Effect {
+public:
+	MAKE_PTRS(FilmGrainEffect);
+
+	FilmGrainEffect();
+	virtual ~FilmGrainEffect();
+
+	virtual Stage GetStage() const override { return Stage::Color; }
+	virtual std::string GetStageSource() const override;
+	virtual void ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer) override;
+	virtual bool IsIdentity() const override;
+	virtual void RenderImGui() override;
+
+	// Inherited from IResource
+
+	FilmGrainEffect::Sptr FromJson(const nlohmann::json& data);
+	virtual nlohmann::json ToJson() const override;
+
+protected:
+	float _strength;
+	UniformHandle<float> _strengthUniform;
+};
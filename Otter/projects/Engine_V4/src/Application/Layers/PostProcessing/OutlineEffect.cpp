@@ -20,6 +20,14 @@ OutlineEffect::OutlineEffect() :
 		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
 		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/outline.glsl" }
 	}); 
+
+	_outlineColorUniform              = _shader->GetUniformHandle<glm::vec4>("u_OutlineColor");
+	_scaleUniform                     = _shader->GetUniformHandle<float>("u_Scale");
+	_depthThresholdUniform            = _shader->GetUniformHandle<float>("u_DepthThreshold");
+	_normalThresholdUniform           = _shader->GetUniformHandle<float>("u_NormalThreshold");
+	_depthNormalThresholdUniform      = _shader->GetUniformHandle<float>("u_DepthNormThreshold");
+	_depthNormalThresholdScaleUniform = _shader->GetUniformHandle<float>("u_DepthNormThresholdScale");
+	_pixelSizeUniform                 = _shader->GetUniformHandle<glm::vec2>("u_PixelSize");
 }
 
 OutlineEffect::~OutlineEffect() = default;
@@ -27,13 +35,13 @@ OutlineEffect::~OutlineEffect() = default;
 void OutlineEffect::Apply(const Framebuffer::Sptr& gBuffer)
 {
 	_shader->Bind();
-	_shader->SetUniform("u_OutlineColor", _outlineColor);
-	_shader->SetUniform("u_Scale", _scale);
-	_shader->SetUniform("u_DepthThreshold", _depthThreshold);
-	_shader->SetUniform("u_NormalThreshold", _normalThreshold);
-	_shader->SetUniform("u_DepthNormThreshold", _depthNormalThreshold);
-	_shader->SetUniform("u_DepthNormThresholdScale", _depthNormalThresholdScale);
-	_shader->SetUniform("u_PixelSize", glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize());
+	_outlineColorUniform.Set(_outlineColor);
+	_scaleUniform.Set(_scale);
+	_depthThresholdUniform.Set(_depthThreshold);
+	_normalThresholdUniform.Set(_normalThreshold);
+	_depthNormalThresholdUniform.Set(_depthNormalThreshold);
+	_depthNormalThresholdScaleUniform.Set(_depthNormalThresholdScale);
+	_pixelSizeUniform.Set(glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize());
 	gBuffer->BindAttachment(RenderTargetAttachment::Depth, 1);
 	gBuffer->BindAttachment(RenderTargetAttachment::Color1, 2); // The normal buffer
 }
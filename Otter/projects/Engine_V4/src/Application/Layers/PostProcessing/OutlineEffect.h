@@ -11,6 +11,7 @@ public:
 	virtual ~OutlineEffect();
 
 	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual bool ReadsGBuffer() const override { return true; }
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -20,6 +21,14 @@ public:
 
 protected:
 	ShaderProgram::Sptr _shader;
+	UniformHandle<glm::vec4> _outlineColorUniform;
+	UniformHandle<float>     _scaleUniform;
+	UniformHandle<float>     _depthThresholdUniform;
+	UniformHandle<float>     _normalThresholdUniform;
+	UniformHandle<float>     _depthNormalThresholdUniform;
+	UniformHandle<float>     _depthNormalThresholdScaleUniform;
+	UniformHandle<glm::vec2> _pixelSizeUniform;
+
 	glm::vec4           _outlineColor;
 	float               _scale;
 	float               _depthThreshold;
@@ -5,33 +5,34 @@
 
 
 PixelationEffect::PixelationEffect() :
-	PostProcessingLayer::Effect()
+	PostProcessingLayer::Effect(),
+	_resolution(200.0f)
 {
 	Name = "Pixelation Effect";
 	_format = RenderTargetType::ColorRgb8;
 
 	memset(Filter, 0, sizeof(float) * 25);
 	Filter[12] = 1.0f;
-
-	//Need to write shader program
-
-	_shader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
-		{ ShaderPartType::Vertex, "shaders/vertex_shaders/fullscreen_quad.glsl" },
-		{ ShaderPartType::Fragment, "shaders/fragment_shaders/post_effects/pixel_effect.glsl" }
-	});
 }
 
 PixelationEffect::~PixelationEffect() = default;
 
-void PixelationEffect::Apply(const Framebuffer::Sptr & gBuffer)
+std::string PixelationEffect::GetStageSource() const
+{
+	return "shaders/fragment_shaders/post_effects/stages/pixelation.glsl";
+}
+
+void PixelationEffect::ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer)
 {
-	_shader->Bind();
-	_shader->SetUniform("u_Filter", Filter, 25);
-	_shader->SetUniform("u_PixelSize", glm::vec2(1.0f) / (glm::vec2)gBuffer->GetSize());
+	if (_IsStageChanged(shader, id)) {
+		_resolutionUniform = shader->GetUniformHandle<float>(id + "_Resolution");
+	}
+	_resolutionUniform.Set(_resolution);
 }
 
 void PixelationEffect::RenderImGui()
 {
+	LABEL_LEFT(ImGui::SliderFloat, "Resolution", &_resolution, 16.0f, 1024.0f);
 /*	ImGui::PushID(this);
 
 	ImGui::Columns(5);
@@ -81,6 +82,7 @@ PixelationEffect::Sptr PixelationEffect::FromJson(const nlohmann::json & data)
 //	std::vector<float> filter = JsonGet(data, "filter", std::vector<float>(25, 0.0f));
 //	for (int ix = 0; ix < 25; ix++) {
 ///		result->Filter[ix] = filter[ix];
+	result->_resolution = JsonGet(data, "resolution", result->_resolution);
 	return result;
 }
 
@@ -92,6 +94,7 @@ nlohmann::json PixelationEffect::ToJson() const
 	}
 	return {
 		{ "enabled", Enabled },
-		{ "filter", filter }
+		{ "filter", filter },
+		{ "resolution", _resolution }
 	};
 }
@@ -15,7 +15,9 @@ public:
 	PixelationEffect();
 	virtual ~PixelationEffect();
 
-	virtual void Apply(const Framebuffer::Sptr& gBuffer) override;
+	virtual Stage GetStage() const override { return Stage::Coordinate; }
+	virtual std::string GetStageSource() const override;
+	virtual void ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer) override;
 	virtual void RenderImGui() override;
 
 	// Inherited from IResource
@@ -24,7 +26,9 @@ public:
 	virtual nlohmann::json ToJson() const override;
 
 protected:
-	ShaderProgram::Sptr _shader;
+	// The number of pixels across the screen that we snap to
+	float _resolution;
+	UniformHandle<float> _resolutionUniform;
 
 };
 
@@ -0,0 +1,52 @@
+#include "SeparableKernel.h"
+
+#include <cmath>
+
+bool SeparableKernel::Separate(const float* kernel, int size, float* outRow, float* outColumn)
+{
+	if (size <= 0 || size > MAX_SIZE) {
+		return false;
+	}
+
+	// Pivot on the largest weight, so that we don't divide by anything tiny
+	int pivotX = 0, pivotY = 0;
+	float largest = 0.0f;
+	for (int iy = 0; iy < size; iy++) {
+		for (int ix = 0; ix < size; ix++) {
+			float weight = std::abs(kernel[iy * size + ix]);
+			if (weight > largest) {
+				largest = weight;
+				pivotX = ix;
+				pivotY = iy;
+			}
+		}
+	}
+
+	// An empty kernel is trivially separable
+	if (largest == 0.0f) {
+		for (int ix = 0; ix < size; ix++) {
+			outRow[ix] = 0.0f;
+			outColumn[ix] = 0.0f;
+		}
+		return true;
+	}
+
+	// If the kernel is rank 1, every row is a multiple of the pivot's row, so the pivot's
+	// column gives us the multipliers
+	float pivot = kernel[pivotY * size + pivotX];
+	for (int ix = 0; ix < size; ix++) {
+		outColumn[ix] = kernel[ix * size + pivotX];
+		outRow[ix] = kernel[pivotY * size + ix] / pivot;
+	}
+
+	// Make sure that the outer product gives us back the original kernel
+	const float tolerance = largest * 1e-4f;
+	for (int iy = 0; iy < size; iy++) {
+		for (int ix = 0; ix < size; ix++) {
+			if (std::abs(outColumn[iy] * outRow[ix] - kernel[iy * size + ix]) > tolerance) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+/**
+ * Helpers for splitting 2D convolution kernels into a pair of 1D kernels. A separable
+ * NxN filter can be drawn as a horizontal pass followed by a vertical pass, taking 2N
+ * samples per pixel rather than N*N
+ */
+class SeparableKernel {
+public:
+	// The largest kernel width that our separable shader supports
+	static const int MAX_SIZE = 9;
+
+	/**
+	 * Attempts to split a square kernel into row and column weights, such that
+	 * kernel[y * size + x] == column[y] * row[x]. This is only possible when the kernel
+	 * has a rank of 1 (ex: box and gaussian filters), sharpen filters and the like will fail
+	 * @param kernel The size * size kernel weights, in row-major order
+	 * @param size The width and height of the kernel
+	 * @param outRow Receives the horizontal weights, must hold size floats
+	 * @param outColumn Receives the vertical weights, must hold size floats
+	 * @returns True if the kernel was separable, false if otherwise
+	 */
+	static bool Separate(const float* kernel, int size, float* outRow, float* outColumn);
+
+protected:
+	SeparableKernel() = default;
+	~SeparableKernel() = default;
+};
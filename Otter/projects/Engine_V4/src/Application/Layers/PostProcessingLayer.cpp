@@ -8,15 +8,26 @@
 #include "PostProcessing/BoxFilter5x5.h"
 #include "PostProcessing/OutlineEffect.h"
 #include "PostProcessing/PixelationEffect.h"
+#include "PostProcessing/FilmGrainEffect.h"
+#include "PostProcessing/BloomEffect.h"
+#include "PostProcessing/BlurEffect.h"
+
+#include "Utils/FileHelpers.h"
+#include "Utils/StringUtils.h"
+#include "Utils/JsonGlmHelpers.h"
 
 PostProcessingLayer::PostProcessingLayer() :
-	ApplicationLayer()
+	ApplicationLayer(),
+	_fuseEffects(true),
+	_passes(),
+	_chainKey(""),
+	_stageShaders()
 {
 	Name = "Post Processing";
 	Overrides =
 		AppLayerFunctions::OnAppLoad |
 		AppLayerFunctions::OnSceneLoad | AppLayerFunctions::OnSceneUnload | 
-		AppLayerFunctions::OnPostRender |
+		AppLayerFunctions::OnPreRender |
 		AppLayerFunctions::OnWindowResize | AppLayerFunctions::OnUpdate;
 }
 
@@ -28,25 +39,22 @@ void PostProcessingLayer::AddEffect(const Effect::Sptr& effect) {
 
 void PostProcessingLayer::OnAppLoad(const nlohmann::json& config)
 {
+	if (config.contains(Name)) {
+		_fuseEffects = JsonGet(config[Name], "fuse_effects", _fuseEffects);
+	}
+
 	// Loads some effects in
 	_effects.push_back(std::make_shared<ColorCorrectionEffect>());
 	_effects.push_back(std::make_shared<BoxFilter3x3>());
 	_effects.push_back(std::make_shared<BoxFilter5x5>());
 	_effects.push_back(std::make_shared<OutlineEffect>());
+	_effects.push_back(std::make_shared<BloomEffect>());
+	_effects.push_back(std::make_shared<BlurEffect>());
 	_effects.push_back(std::make_shared<PixelationEffect>());
+	_effects.push_back(std::make_shared<FilmGrainEffect>());
 
-	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
-
-	// Initialize all the effect's output FBOs (inefficient) 
-	for (const auto& effect : _effects) {
-		FramebufferDescriptor fboDesc = FramebufferDescriptor();
-		fboDesc.Width  = viewport.z * effect->_outputScale.x;
-		fboDesc.Height = viewport.w * effect->_outputScale.y;
-		fboDesc.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(effect->_format);
-
-		effect->_output = std::make_shared<Framebuffer>(fboDesc);
-	}
+	// Note that we no longer allocate a framebuffer per effect, each pass gets a target from the render graph,
+	// which shares memory between targets that are never alive at the same time
 
 	// We need a mesh for drawing fullscreen quads
 	glm::vec2 positions[6] = {
@@ -69,65 +77,103 @@ void PostProcessingLayer::OnAppLoad(const nlohmann::json& config)
 
 }
 
-void PostProcessingLayer::OnPostRender()
+void PostProcessingLayer::OnPreRender()
 {
 	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
 
-	// Grab the render layer from the app, get it's output and the G-Buffer
+	// Grab the render layer from the app, we add our passes to it's graph
 	const RenderLayer::Sptr& renderer = app.GetLayer<RenderLayer>();
-	const Framebuffer::Sptr& output = renderer->GetRenderOutput();
-	const Framebuffer::Sptr& gBuffer = renderer->GetGBuffer();
+	RenderGraph& graph = *renderer->GetRenderGraph();
 
-	// Stores the input FBO to the effect, we start with the renderlayer's output 
-	Framebuffer::Sptr current = output;
-
-	// Disable depth testing and depth writing, as well as blending
-	glDisable(GL_DEPTH_TEST);
-	glDepthMask(false);
-	glDisable(GL_BLEND);
+	// Recompile our passes if any effects have been toggled since last frame
+	std::string chainKey = _fuseEffects ? "F" : "S";
+	for (const auto& effect : _effects) {
+		chainKey += (effect->Enabled && !effect->IsIdentity()) ? '1' : '0';
+	}
+	if (chainKey != _chainKey) {
+		_chainKey = chainKey;
+		_CompileChain();
+	}
 
-	// Bind the quad VAO so our effects can use it
-	_quadVAO->Bind();
+	// We start with the renderer's output, with no passes we leave the scene color alone
+	RenderGraph::ResourceHandle current = graph.GetNamedResource(RenderLayer::SCENE_COLOR);
+	for (int ix = 0; ix < (int)_passes.size(); ix++) {
+		const Pass& pass = _passes[ix];
 
-	// Iterate over all the effects in the queue
-	for (const auto& effect : _effects) {
-		// Only render if it's enabled
-		if (effect->Enabled) {
-			// Bind the FBO and make sure we're rendering to the whole thing
-			effect->_output->Bind();
-			glViewport(0, 0, effect->_output->GetWidth(), effect->_output->GetHeight());
-
-			// Bind color 0 from previous pass to texture slot 0 so our effects can access
-			current->BindAttachment(RenderTargetAttachment::Color0, 0);
-
-			// Apply the effect and render the fullscreen quad
-			effect->Apply(gBuffer, _quadVAO);
-			_quadVAO->Draw();
-
-			// Unbind output and set it as input for next pass
-			effect->_output->Unbind();
-			current = effect->_output;
+		// Fused passes are drawn in one go with our generated shader
+		if (pass.Shader != nullptr) {
+			current = _AddGraphPass(graph, ix, 0, current, current);
+		}
+		// Standalone effects may need several passes, each of which can have it's own size and format
+		else {
+			RenderGraph::ResourceHandle source = current;
+			int passCount = pass.Effects[0]->GetPassCount();
+			for (int effectPass = 0; effectPass < passCount; effectPass++) {
+				current = _AddGraphPass(graph, ix, effectPass, current, source);
+			}
 		}
 	}
-	_quadVAO->Unbind();
 
-	// Restore viewport to game viewport
-	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	// Hand our output on to whatever presents the scene
+	graph.SetNamedResource(RenderLayer::SCENE_COLOR, current);
+}
+
+RenderGraph::ResourceHandle PostProcessingLayer::_AddGraphPass(RenderGraph& graph, int passIx, int effectPass, RenderGraph::ResourceHandle input, RenderGraph::ResourceHandle source)
+{
+	const Pass& pass = _passes[passIx];
+
+	// Fused passes output at the scale and format of their last effect, standalone ones can pick per pass
+	Effect::PassDesc desc = { pass.Scale, pass.Format };
+	if (pass.Shader == nullptr) {
+		desc = pass.Effects[0]->GetPassDesc(effectPass);
+	}
 
-	// Bind the output of our post processing as the source for the blit
-	current->Bind(FramebufferBinding::Read);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	RenderGraph::PassBuilder builder = graph.AddPass(pass.Effects[0]->Name, [this, passIx, effectPass, input, source](const RenderGraph::PassContext& context) {
+		const Pass& pass = _passes[passIx];
+		const Framebuffer::Sptr& gBuffer = Application::Get().GetLayer<RenderLayer>()->GetGBuffer();
+
+		// Disable depth testing and depth writing, as well as blending
+		glDisable(GL_DEPTH_TEST);
+		glDepthMask(false);
+		glDisable(GL_BLEND);
+
+		// Bind the quad VAO so our effects can use it
+		_quadVAO->Bind();
+
+		// Targets are bilinearly filtered, so reading a larger or smaller input gives us our up/down sampling
+		Texture2D::Sptr inputTexture = context.GetTexture(input);
+		inputTexture->Bind(0);
+
+		// Fused passes use our generated shader, and let each effect feed it's uniforms
+		if (pass.Shader != nullptr) {
+			pass.Shader->Bind();
+			for (size_t ix = 0; ix < pass.Effects.size(); ix++) {
+				pass.Effects[ix]->ApplyStage(pass.Shader, pass.Ids[ix], pass.FirstSlots[ix], gBuffer);
+			}
+		} else {
+			pass.Effects[0]->ApplyPass(effectPass, inputTexture, context.GetTexture(source), gBuffer);
+		}
+		_quadVAO->Draw();
+		_quadVAO->Unbind();
+	});
 
-	// Blit the color buffer to our game window
-	current->Blit(
-		{ 0, 0, current->GetWidth(), current->GetHeight() },
-		{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
-		BufferFlags::Color,
-		MagFilter::Linear
-	);
+	// Every pass covers the whole target, so there's nothing to clear
+	RenderGraph::ResourceHandle target = builder.Create(pass.Effects[0]->Name, RenderGraph::TextureDesc(desc.Format, desc.Scale));
+	builder.Write(target, RenderTargetAttachment::Color0, RenderGraph::LoadOp::DontCare);
+	builder.Read(input);
+	if (source != input) {
+		builder.Read(source);
+	}
 
-	current->Unbind();
+	// Effects that look at the G-Buffer need it kept around until they've run
+	for (Effect* effect : pass.Effects) {
+		if (effect->ReadsGBuffer()) {
+			builder.Read(graph.GetNamedResource(RenderLayer::SCENE_DEPTH));
+			builder.Read(graph.GetNamedResource(RenderLayer::GBUFFER_NORMALS));
+			break;
+		}
+	}
+	return target;
 }
 
 void PostProcessingLayer::OnSceneLoad()
@@ -148,10 +194,127 @@ void PostProcessingLayer::OnWindowResize(const glm::ivec2& oldSize, const glm::i
 {
 	for (const auto& effect : _effects) {
 		effect->OnWindowResize(oldSize, newSize);
-		effect->_output->Resize(newSize.x, newSize.y);
 	}
 }
 
+nlohmann::json PostProcessingLayer::GetDefaultConfig()
+{
+	return {
+		{ "fuse_effects", _fuseEffects }
+	};
+}
+
+void PostProcessingLayer::_CompileChain()
+{
+	_passes.clear();
+
+	// Index of the pass we are currently fusing effects into, or -1 if we need to start a new one
+	int fusedPass = -1;
+	bool fusedHasColor = false;
+
+	for (const auto& effect : _effects) {
+		// Disabled effects (or ones that wouldn't do anything) don't cost a pass
+		if (!effect->Enabled || effect->IsIdentity()) {
+			continue;
+		}
+
+		Effect::Stage stage = effect->GetStage();
+		if (stage == Effect::Stage::Standalone) {
+			Pass pass;
+			pass.Effects.push_back(effect.get());
+			pass.Format = effect->_format;
+			pass.Scale  = effect->_outputScale;
+			_passes.push_back(pass);
+			fusedPass = -1;
+			continue;
+		}
+
+		// Coordinate stages change where the previous pass is read from, so once a color stage has
+		// run in a pass, a coordinate stage needs the result of that pass and must start a new one
+		bool canFuse = _fuseEffects && fusedPass >= 0 && !(stage == Effect::Stage::Coordinate && fusedHasColor);
+		if (!canFuse) {
+			_passes.push_back(Pass());
+			fusedPass = static_cast<int>(_passes.size()) - 1;
+			fusedHasColor = false;
+		}
+		_passes[fusedPass].Effects.push_back(effect.get());
+		// Fused passes output at the format and scale of their last effect
+		_passes[fusedPass].Format = effect->_format;
+		_passes[fusedPass].Scale  = effect->_outputScale;
+		fusedHasColor |= stage == Effect::Stage::Color;
+	}
+
+	size_t effectCount = 0;
+	for (Pass& pass : _passes) {
+		if (pass.Effects[0]->GetStage() != Effect::Stage::Standalone) {
+			_BuildStageShader(pass);
+		}
+		effectCount += pass.Effects.size();
+	}
+	LOG_TRACE("Compiled {} post processing effects into {} passes", effectCount, _passes.size());
+}
+
+void PostProcessingLayer::_BuildStageShader(Pass& pass)
+{
+	// Passes made from the same stages in the same order can share a shader
+	std::string key;
+	for (Effect* effect : pass.Effects) {
+		key += effect->GetStageSource() + ";";
+	}
+	auto it = _stageShaders.find(key);
+	if (it != _stageShaders.end()) {
+		pass.Shader     = it->second.Shader;
+		pass.Ids        = it->second.Ids;
+		pass.FirstSlots = it->second.FirstSlots;
+		return;
+	}
+
+	std::string source = FileHelpers::ReadResolveIncludes("shaders/fragment_shaders/post_effects/fused_stages.glsl");
+	std::string stages;
+	std::string coordinateCalls;
+	std::string colorCalls;
+
+	// Slot 0 is always the previous pass, effects get their own slots after that
+	int slot = 1;
+	pass.Ids.clear();
+	pass.FirstSlots.clear();
+	for (size_t ix = 0; ix < pass.Effects.size(); ix++) {
+		Effect* effect = pass.Effects[ix];
+		std::string id = "fx" + std::to_string(ix);
+		std::string snippet = FileHelpers::ReadFile(effect->GetStageSource());
+		StringTools::ReplaceAll(snippet, "{ID}", id);
+
+		pass.Ids.push_back(id);
+		pass.FirstSlots.push_back(slot);
+		int slotCount = 0;
+		for (int sampler = 0; sampler < 8; sampler++) {
+			if (StringTools::ReplaceAll(snippet, "{SLOT" + std::to_string(sampler) + "}", std::to_string(slot + sampler)) > 0) {
+				slotCount = sampler + 1;
+			}
+		}
+		slot += slotCount;
+
+		stages += snippet + "\n";
+		if (effect->GetStage() == Effect::Stage::Coordinate) {
+			// Each coordinate stage is reading the output of the one before it, so we apply them back to front
+			coordinateCalls = "uv = " + id + "(uv);\n    " + coordinateCalls;
+		} else {
+			colorCalls += "color = " + id + "(color, inUV);\n    ";
+		}
+	}
+
+	StringTools::ReplaceAll(source, "//@STAGES", stages);
+	StringTools::ReplaceAll(source, "//@COORDINATE_CALLS", coordinateCalls);
+	StringTools::ReplaceAll(source, "//@COLOR_CALLS", colorCalls);
+
+	pass.Shader = ShaderProgram::Create();
+	pass.Shader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
+	pass.Shader->LoadShaderPart(source.c_str(), ShaderPartType::Fragment);
+	pass.Shader->Link();
+
+	_stageShaders[key] = pass;
+}
+
 const std::vector<PostProcessingLayer::Effect::Sptr>& PostProcessingLayer::GetEffects() const
 {
 	return _effects;
@@ -162,6 +325,16 @@ void PostProcessingLayer::Effect::DrawFullscreen()
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
+bool PostProcessingLayer::Effect::_IsStageChanged(const ShaderProgram::Sptr& shader, const std::string& id)
+{
+	if (_stageShader == shader.get() && _stageId == id) {
+		return false;
+	}
+	_stageShader = shader.get();
+	_stageId = id;
+	return true;
+}
+
 void PostProcessingLayer::OnUpdate()
 {
 	if (InputEngine::GetKeyState(GLFW_KEY_9) == ButtonState::Pressed)//cool
@@ -5,6 +5,9 @@
 #include "Graphics/VertexArrayObject.h"
 #include "Gameplay/InputEngine.h"
 #include "Graphics/Textures/Texture3D.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Framebuffer.h"
+#include "Graphics/RenderGraph.h"
 
 /**
  * The post processing layer will handle rendering effects after the primary
@@ -29,14 +32,86 @@ public:
 
 		virtual ~Effect() = default;
 
+		/**
+		 * Describes how an effect can be merged with it's neighbours into a single pass
+		 *   Standalone - The effect reads neighbouring pixels of the previous pass, and is drawn by itself via Apply
+		 *   Coordinate - The effect only changes where the previous pass is sampled (ex: pixelation)
+		 *   Color      - The effect only changes the color of the pixel it is processing (ex: color correction)
+		 */
+		enum class Stage {
+			Standalone,
+			Coordinate,
+			Color
+		};
+
+		/**
+		 * Describes the render target that a single pass of a standalone effect draws into
+		 */
+		struct PassDesc {
+			// The scaling between the pass's output and the screen size
+			glm::vec2        Scale;
+			// The render target format for the pass's output
+			RenderTargetType Format;
+		};
+
 		//function specifically for color correction
 		virtual void ChangeLut(Texture3D::Sptr new_lut) {}
 		/**
-		 * Overload this in derived classes to apply the effect. Texture slot 0
+		 * Overload this in standalone effects to bind a shader and apply the effect. Texture slot 0
 		 * will contain the image from the previous pass
 		 * @param gBuffer The G-Buffer from the deferred rendering pipeline
 		 */
-		virtual void Apply(const Framebuffer::Sptr& gBuffer, VertexArrayObject::Sptr _quadVAO = nullptr) = 0;
+		virtual void Apply(const Framebuffer::Sptr& gBuffer) {}
+		/**
+		 * Gets the number of fullscreen passes this standalone effect needs, for effects such
+		 * as separable or downsampled blurs. Effects use a single pass by default
+		 */
+		virtual int GetPassCount() { return 1; }
+		/**
+		 * Gets the size and format of the target the given pass draws into. By default every pass
+		 * uses the effect's output scale and format
+		 * @param pass The index of the pass, between 0 and GetPassCount() - 1
+		 */
+		virtual PassDesc GetPassDesc(int pass) const { return { _outputScale, _format }; }
+		/**
+		 * Overload this in multi-pass effects to set up a single pass. Texture slot 0 will contain the
+		 * output of the previous pass, which may be a different size than the target being drawn into.
+		 * By default this calls Apply
+		 * @param pass The index of the pass, between 0 and GetPassCount() - 1
+		 * @param input The texture bound to texture slot 0
+		 * @param source The image that was fed into the effect's first pass
+		 * @param gBuffer The G-Buffer from the deferred rendering pipeline
+		 */
+		virtual void ApplyPass(int pass, const Texture2D::Sptr& input, const Texture2D::Sptr& source, const Framebuffer::Sptr& gBuffer) { Apply(gBuffer); }
+		/**
+		 * Gets how this effect can be merged with others, effects are standalone by default
+		 */
+		virtual Stage GetStage() const { return Stage::Standalone; }
+		/**
+		 * For coordinate and color effects, gets the path to the GLSL snippet that implements the effect.
+		 * The snippet must declare a function named {ID}, taking and returning a vec2 uv for coordinate
+		 * stages, or taking (vec3 color, vec2 uv) and returning a vec3 for color stages. Uniforms should
+		 * be prefixed with {ID}_, and samplers bound to {SLOT0}, {SLOT1}, etc...
+		 */
+		virtual std::string GetStageSource() const { return ""; }
+		/**
+		 * For coordinate and color effects, sets up the effect's uniforms and textures in a generated shader
+		 * @param shader The generated shader, which will already be bound
+		 * @param id The value that {ID} was replaced with, prefix uniform names with this
+		 * @param firstSlot The texture slot that {SLOT0} was replaced with
+		 * @param gBuffer The G-Buffer from the deferred rendering pipeline
+		 */
+		virtual void ApplyStage(const ShaderProgram::Sptr& shader, const std::string& id, int firstSlot, const Framebuffer::Sptr& gBuffer) {}
+		/**
+		 * Returns true if the effect would not change the image with it's current settings, allowing
+		 * the layer to skip it entirely (ex: a filter with only the center tap set)
+		 */
+		virtual bool IsIdentity() const { return false; }
+		/**
+		 * Returns true if the effect samples the G-Buffer's depth or normals, so that the render graph
+		 * keeps them alive until the effect has run
+		 */
+		virtual bool ReadsGBuffer() const { return false; }
 		/**
 		 * Allows this effect to perform logic when a new scene is loaded
 		 */
@@ -47,7 +122,7 @@ public:
 		virtual void OnSceneUnload() {}
 		/**
 		 * Allows this effect to perform additional logic when the window is resized
-		 * Note that the output framebuffer will already be resized by the post processing layer
+		 * Note that the render graph will re-allocate the effect's targets itself
 		 */
 		virtual void OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) {}
 		/**
@@ -65,14 +140,23 @@ public:
 	protected:
 		friend class PostProcessingLayer;
 
-		// The output that this effect will render into
-		Framebuffer::Sptr _output = nullptr;
-		// The scaling between this effect's output and the screen size, default 1
+		// The scaling between this effect's output and the screen size, default 1. Effects with
+		// a smaller output are drawn at reduced resolution, and bilinearly upsampled by the next pass
 		glm::vec2 _outputScale = glm::vec2(1);
 		// The render target format for the effect's buffer
 		RenderTargetType _format = RenderTargetType::ColorRgba8;
 
+		// The generated shader and ID we last resolved our stage uniforms for, see _IsStageChanged
+		const ShaderProgram* _stageShader = nullptr;
+		std::string          _stageId;
+
 		Effect() = default;
+
+		/**
+		 * For coordinate and color effects, returns true if the shader or ID passed to ApplyStage have changed
+		 * since the last call, meaning the effect needs to resolve it's uniform handles again
+		 */
+		bool _IsStageChanged(const ShaderProgram::Sptr& shader, const std::string& id);
 	};
 
 	PostProcessingLayer();
@@ -107,17 +191,59 @@ public:
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
 	virtual void OnUpdate() override;
-	virtual void OnPostRender() override;
+	virtual void OnPreRender() override;
 	virtual void OnSceneLoad() override;
 	virtual void OnSceneUnload() override;
 	virtual void OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) override;
+	virtual nlohmann::json GetDefaultConfig() override;
 
 protected:
 	friend class Effect;
 
+	/**
+	 * A single fullscreen pass in our compiled effect chain, either one standalone
+	 * effect or a run of coordinate and color effects fused into a generated shader
+	 */
+	struct Pass {
+		std::vector<Effect*>     Effects;
+		// The generated shader for fused passes, nullptr for standalone effects
+		ShaderProgram::Sptr      Shader;
+		// The {ID} and {SLOT0} values given to each effect in the generated shader
+		std::vector<std::string> Ids;
+		std::vector<int>         FirstSlots;
+		RenderTargetType         Format;
+		glm::vec2                Scale;
+	};
+
 	std::vector<Effect::Sptr> _effects;
 	VertexArrayObject::Sptr _quadVAO;
 
+	// True if compatible effects should be merged into single passes
+	bool                      _fuseEffects;
+	// The passes we compiled our effects into, and the state of the effects when we did
+	std::vector<Pass>         _passes;
+	std::string               _chainKey;
+	// Generated shaders, keyed by the stage sources they were built from
+	std::unordered_map<std::string, Pass> _stageShaders;
+
+	/**
+	 * Rebuilds our list of passes from the currently enabled effects
+	 */
+	void _CompileChain();
+	/**
+	 * Generates (or fetches from the cache) the shader for a fused pass
+	 */
+	void _BuildStageShader(Pass& pass);
+	/**
+	 * Adds a render graph pass that draws a single pass of our chain into a new target, and returns the target
+	 * @param graph The render graph to add the pass to
+	 * @param pass The index of the pass in our chain
+	 * @param effectPass For standalone effects, the index of the pass within the effect
+	 * @param input The resource to read from, bound to texture slot 0
+	 * @param source The resource that was fed into the effect's first pass
+	 */
+	RenderGraph::ResourceHandle _AddGraphPass(RenderGraph& graph, int pass, int effectPass, RenderGraph::ResourceHandle input, RenderGraph::ResourceHandle source);
+
 	bool lut1 = false;
 	bool lut2 = false;
 	bool lut3 = false;
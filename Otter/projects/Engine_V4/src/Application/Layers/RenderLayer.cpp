@@ -16,25 +16,65 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <GLM/gtx/common.hpp> // for fmod (floating modulus)
 #include "Gameplay/Components/ShadowCamera.h"
+#include "Gameplay/Components/ReflectionProbe.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "OcclusionCullingLayer.h"
+#include "Utils/MeshletBuilder.h"
 
 
+const std::string RenderLayer::SCENE_COLOR     = "SceneColor";
+const std::string RenderLayer::SCENE_DEPTH     = "SceneDepth";
+const std::string RenderLayer::GBUFFER_NORMALS = "GBufferNormals";
+
 RenderLayer::RenderLayer() :
 	ApplicationLayer(),
+	_renderGraph(nullptr),
+	_targetSize(glm::ivec2(1)),
+	_presentAdded(false),
+	_exportDebugTargets(false),
 	_primaryFBO(nullptr),
+	_lightingFBO(nullptr),
 	_blitFbo(true),
 	_frameUniforms(nullptr),
 	_instanceUniforms(nullptr),
 	_renderFlags(RenderFlags::EnableLights | RenderFlags::EnableSpecular | RenderFlags::EnableAmbient),
-	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f })
+	_lightAccumulationVariant(nullptr),
+	_variantFlags(RenderFlags::None),
+	_shadowVariants(),
+	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f }),
+	_dynamicResolution(true),
+	_renderScale(1.0f),
+	_minRenderScale(0.5f),
+	_maxRenderScale(1.0f),
+	_targetGpuTimeMs(12.0f),
+	_gpuTimeMs(0.0f),
+	_upscaleSharpness(0.25f),
+	_shadowLodBias(1),
+	_probeUpdateInterval(1),
+	_probeFrameCounter(0),
+	_probeIndex(0),
+	_activeProbes(),
+	_ambientCoefficients(),
+	_meshletCulling(true),
+	_meshletConeCulling(false),
+	_meshletCommandBuffer(nullptr),
+	_meshletCommands(),
+	_gpuTimers(),
+	_gpuTimerIssued(),
+	_gpuTimerIndex(0)
 {
 	Name = "Rendering";
 	Overrides =
 		AppLayerFunctions::OnAppLoad |
-		AppLayerFunctions::OnPreRender | AppLayerFunctions::OnRender | AppLayerFunctions::OnPostRender |
+		AppLayerFunctions::OnPreRender | AppLayerFunctions::OnRender |
 		AppLayerFunctions::OnWindowResize | AppLayerFunctions::OnUpdate;
 }
 
-RenderLayer::~RenderLayer() = default;
+RenderLayer::~RenderLayer() {
+	if (_gpuTimers[0] != 0) {
+		glDeleteQueries(GPU_TIMER_COUNT, _gpuTimers);
+	}
+}
 
 void RenderLayer::OnPreRender()
 {
@@ -42,18 +82,16 @@ void RenderLayer::OnPreRender()
 
 	Application& app = Application::Get();
 
-	// Clear the color and depth buffers
-	const glm::vec4 colors[4] = {
-		glm::vec4(0.0f),
-		glm::vec4(0.5f, 0.5f, 0.5f, 0.0f),
-		glm::vec4(0.0f),
-		glm::vec4(0.0f)
-	};
-
-	_primaryFBO->Bind();
-	// Clear the framebuffer. Note that this also binds and sets the viewport
-	_ClearFramebuffer(_primaryFBO, colors, 4);
+	// Pick our render scale for this frame from the GPU timings, this must happen before
+	// anything is declared so that every pass this frame agrees on the viewport size
+	_UpdateRenderScale();
 
+	// Start a fresh graph for this frame, the layers after us will add their passes to it
+	// during their own OnPreRender, and we'll execute the whole thing in OnRender
+	_renderGraph->Reset();
+	_renderGraph->SetTargetSize(_targetSize);
+	_renderGraph->SetRenderScale(_renderScale);
+	_presentAdded = false;
 
 	// Grab shorthands to the camera and shader from the scene
 	Gameplay::Camera::Sptr camera = app.CurrentScene()->MainCamera;
@@ -62,10 +100,6 @@ void RenderLayer::OnPreRender()
 	glm::mat4 viewProj = camera->GetViewProjection();
 	DebugDrawer::Get().SetViewProjection(viewProj);
 
-	// The current material that is bound for rendering
-	Gameplay::Material::Sptr currentMat = nullptr;
-	ShaderProgram::Sptr shader = nullptr;
-
 	// Bind the skybox texture to a reserved texture slot
 	// See Material.h and Material.cpp for how we're reserving texture slots
 	TextureCube::Sptr environment = app.CurrentScene()->GetSkyboxTexture();
@@ -87,73 +121,443 @@ void RenderLayer::OnPreRender()
 	// Draw physics debug
 	app.CurrentScene()->DrawPhysicsDebug();
 
+	_UpdateAmbient();
 	_InitFrameUniforms();
+
+	// Swap our lighting shaders over if our features have been toggled
+	if (_lightAccumulationVariant == nullptr || _renderFlags != _variantFlags) {
+		_UpdateShaderVariants();
+	}
+
+	_DeclarePasses();
 }
 
 void RenderLayer::OnRender(const Framebuffer::Sptr & prevLayer)
 {
-	using namespace Gameplay;
+	// If nothing has presented the scene yet (ex: the interface layer is disabled), do it ourselves
+	AddPresentPass();
 
-	Application& app = Application::Get();
+	// Start timing the GPU work for our frame, we'll read the result back in a few frames
+	glBeginQuery(GL_TIME_ELAPSED, _gpuTimers[_gpuTimerIndex]);
+
+	// Every layer has declared it's passes by now, so we can work out what actually needs to run
+	if (_renderGraph->Compile()) {
+		_renderGraph->Execute();
+	}
 
-	// Make sure depth testing and culling are re-enabled
+	// Make sure depth testing and writing are back on for anything rendering after us
 	glEnable(GL_DEPTH_TEST);
-	//glEnable(GL_CULL_FACE);
 	glDepthMask(true);
+	VertexArrayObject::Unbind();
+
+	glEndQuery(GL_TIME_ELAPSED);
+	_gpuTimerIssued[_gpuTimerIndex] = true;
+	_gpuTimerIndex = (_gpuTimerIndex + 1) % GPU_TIMER_COUNT;
+}
 
-	// Disable blending, we want to override any existing colors
+void RenderLayer::AddPresentPass()
+{
+	if (_presentAdded) {
+		return;
+	}
+	_presentAdded = true;
+
+	// Post processing may have replaced the scene color with it's own output, so we look it up by name
+	RenderGraph::ResourceHandle sceneColor = _renderGraph->GetNamedResource(SCENE_COLOR);
+	RenderGraph::PassBuilder builder = _renderGraph->AddPass("Present", [this, sceneColor](const RenderGraph::PassContext& context) {
+		UpscaleToViewport(context.GetTexture(sceneColor));
+	});
+	builder.Read(sceneColor);
+	builder.Write(_renderGraph->GetBackbuffer(), RenderTargetAttachment::Color0);
+}
+
+void RenderLayer::UpscaleToViewport(const Texture2D::Sptr& source)
+{
+	Application& app = Application::Get();
+	const glm::uvec4& viewport = app.GetPrimaryViewport();
+
+	// Render into the window over the entire game viewport
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+
+	// We cover the whole viewport, so there's no need to test or write depth
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(false);
 	glDisable(GL_BLEND);
 
-	// Grab shorthands to the camera and shader from the scene
-	Camera::Sptr camera = app.CurrentScene()->MainCamera;
+	// The region we rendered into, in UV space. Used to keep the bilinear filter from
+	// reading texels outside of what we rendered this frame. Post processing may hand us a
+	// reduced resolution texture, so we work this out from the source rather than our own targets
+	glm::vec2 sourceSize = glm::vec2(source->GetWidth(), source->GetHeight());
+	glm::vec2 renderSize = glm::max(glm::round(sourceSize * _renderScale), glm::vec2(1.0f));
+	glm::vec2 uvMax = (renderSize - 0.5f) / sourceSize;
+
+	source->Bind(0);
+	_upscaleShader->Bind();
+	_upscaleUvMaxUniform.Set(uvMax);
+	_upscaleSharpnessUniform.Set(_renderScale < 1.0f ? _upscaleSharpness : 0.0f);
+	_fullscreenQuad->Draw();
 
-	// We can now render all our scene elements via the helper function
-	_RenderScene(camera->GetView(), camera->GetProjection());
+	glDepthMask(true);
+	glEnable(GL_DEPTH_TEST);
+}
 
-	// Use our cubemap to draw our skybox
-	app.CurrentScene()->DrawSkybox();
+void RenderLayer::_UpdateRenderScale()
+{
+	// Read back the oldest timer in our ring, since it was issued a few frames ago it should
+	// be ready, and if it isn't we simply skip adjusting this frame rather than stalling
+	if (_gpuTimerIssued[_gpuTimerIndex]) {
+		GLint available = 0;
+		glGetQueryObjectiv(_gpuTimers[_gpuTimerIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(_gpuTimers[_gpuTimerIndex], GL_QUERY_RESULT, &elapsedNs);
+			_gpuTimerIssued[_gpuTimerIndex] = false;
+
+			// Smooth out the timings a bit so that a single spike doesn't make us jump around
+			float frameMs = static_cast<float>(elapsedNs) / 1000000.0f;
+			_gpuTimeMs = _gpuTimeMs <= 0.0f ? frameMs : glm::mix(_gpuTimeMs, frameMs, 0.1f);
+
+			if (_dynamicResolution && _gpuTimeMs > 0.0f) {
+				// Our cost is roughly proportional to the number of pixels, which grows with the
+				// square of the scale, so we use the square root of the ratio to the budget
+				float ideal = _renderScale * glm::sqrt(_targetGpuTimeMs / _gpuTimeMs);
+
+				// Drop quickly when over budget, but only creep back up when we have some headroom
+				// so that we don't oscillate around the target
+				if (_gpuTimeMs > _targetGpuTimeMs) {
+					_renderScale = glm::mix(_renderScale, ideal, 0.5f);
+				} else if (_gpuTimeMs < _targetGpuTimeMs * 0.85f) {
+					_renderScale = glm::mix(_renderScale, ideal, 0.05f);
+				}
+
+				_renderScale = glm::clamp(_renderScale, _minRenderScale, _maxRenderScale);
+			}
+		}
+	}
+}
 
-	VertexArrayObject::Unbind();
+void RenderLayer::_UpdateShaderVariants()
+{
+	// Only the features that are enabled get compiled into the shader
+	ShaderProgram::DefineSet defines;
+	if (*(_renderFlags & RenderFlags::EnableLights))   defines["ENABLE_LIGHTS"] = "1";
+	if (*(_renderFlags & RenderFlags::EnableSpecular)) defines["ENABLE_SPECULAR"] = "1";
+	if (*(_renderFlags & RenderFlags::EnableRDiffuse)) defines["DIFFUSE_WARP"] = "1";
+	if (*(_renderFlags & RenderFlags::EnableRSpec))    defines["SPECULAR_WARP"] = "1";
+
+	_lightAccumulationVariant = _lightAccumulationShader->GetVariant(defines);
+	_ambientWeightUniform = _lightAccumulationVariant->GetUniformHandle<float>("u_AmbientWeight");
+	_variantFlags = _renderFlags;
+}
+
+const RenderLayer::ShadowVariant& RenderLayer::_GetShadowVariant(uint32_t flags)
+{
+	uint32_t index = flags & 0x0F;
+	ShadowVariant& result = _shadowVariants[index];
+	if (result.Shader == nullptr) {
+		ShaderProgram::DefineSet defines;
+		if (flags & *ShadowFlags::ProjectionEnabled)  defines["SHADOW_PROJECTION"] = "1";
+		if (flags & *ShadowFlags::PcfEnabled)         defines["SHADOW_PCF"] = "1";
+		if (flags & *ShadowFlags::AttenuationEnabled) defines["SHADOW_ATTENUATION"] = "1";
+		if (flags & *ShadowFlags::WidePcfEnabled)     defines["SHADOW_WIDE_PCF"] = "1";
+		result.Shader = _shadowShader->GetVariant(defines);
+
+		// Resolve our uniforms once, so that setting them for each light doesn't need any lookups
+		result.ViewToShadow      = result.Shader->GetUniformHandle<glm::mat4>("u_ViewToShadow");
+		result.LightDirViewspace = result.Shader->GetUniformHandle<glm::vec3>("u_LightDirViewspace");
+		result.LightPosViewspace = result.Shader->GetUniformHandle<glm::vec3>("u_LightPosViewspace");
+		result.LightColor        = result.Shader->GetUniformHandle<glm::vec3>("u_LightColor");
+		result.ShadowBias        = result.Shader->GetUniformHandle<float>("u_ShadowBias");
+		result.NormalBias        = result.Shader->GetUniformHandle<float>("u_NormalBias");
+		// Attenuation is compiled out of variants without SHADOW_ATTENUATION
+		result.Attenuation       = result.Shader->GetUniformHandle<float>("u_Attenuation", false);
+		result.Intensity         = result.Shader->GetUniformHandle<float>("u_Intensity");
+	}
+	return result;
+}
+
+void RenderLayer::_DeclarePasses()
+{
+	using namespace Gameplay;
+
+	Application& app = Application::Get();
+	Scene::Sptr& scene = app.CurrentScene();
+	RenderGraph& graph = *_renderGraph;
+
+	// Reflection probes, we render one face of one probe every few frames so that the cost is fixed no matter
+	// how many probes are in the scene. These render into the probe's own cubemaps, so the pass has no attachments
+	if (_probeFrameCounter++ % _probeUpdateInterval == 0) {
+		std::vector<ReflectionProbe*> probes;
+		scene->Components().Each<ReflectionProbe>([&](const ReflectionProbe::Sptr& probe) {
+			probes.push_back(probe.get());
+		});
+
+		if (!probes.empty()) {
+			ReflectionProbe* probe = probes[_probeIndex % probes.size()];
+			RenderGraph::PassBuilder builder = graph.AddPass("ReflectionProbe", [this, probe](const RenderGraph::PassContext& context) {
+				_CaptureProbeFace(probe);
+			});
+			builder.SideEffect();
+		}
+	}
+
+	// G-Buffer, the graph clears only the region we're rendering into this frame
+	RenderGraph::ResourceHandle gBuffer[5];
+	{
+		RenderGraph::PassBuilder builder = graph.AddPass("G-Buffer", [this](const RenderGraph::PassContext& context) {
+			Application& app = Application::Get();
+			_primaryFBO = context.GetFramebuffer();
+
+			// Make sure depth testing and culling are re-enabled
+			glEnable(GL_DEPTH_TEST);
+			//glEnable(GL_CULL_FACE);
+			glDepthMask(true);
+
+			// Disable blending, we want to override any existing colors
+			glDisable(GL_BLEND);
+
+			// We can now render all our scene elements via the helper function
+			Camera::Sptr camera = app.CurrentScene()->MainCamera;
+			_RenderScene(camera->GetView(), camera->GetProjection(), OcclusionCullingLayer::MAIN_VIEW);
+
+			// Use our cubemap to draw our skybox
+			app.CurrentScene()->DrawSkybox();
+		});
+		// Depth, albedo + spec, normals + metallic, emissive, view space position
+		gBuffer[0] = builder.Create("Depth",    RenderTargetType::Depth32);
+		gBuffer[1] = builder.Create("Albedo",   RenderTargetType::ColorRgba8);
+		gBuffer[2] = builder.Create("Normals",  RenderTargetType::ColorRgba8);
+		gBuffer[3] = builder.Create("Emissive", RenderTargetType::ColorRgba8);
+		gBuffer[4] = builder.Create("ViewPos",  RenderTargetType::ColorRgba16F);
+		builder.Write(gBuffer[0], RenderTargetAttachment::Depth,  RenderGraph::LoadOp::Clear, glm::vec4(1.0f));
+		builder.Write(gBuffer[1], RenderTargetAttachment::Color0, RenderGraph::LoadOp::Clear, glm::vec4(0.0f));
+		builder.Write(gBuffer[2], RenderTargetAttachment::Color1, RenderGraph::LoadOp::Clear, glm::vec4(0.5f, 0.5f, 0.5f, 0.0f));
+		builder.Write(gBuffer[3], RenderTargetAttachment::Color2, RenderGraph::LoadOp::Clear, glm::vec4(0.0f));
+		builder.Write(gBuffer[4], RenderTargetAttachment::Color3, RenderGraph::LoadOp::Clear, glm::vec4(0.0f));
+	}
+
+	// Baked lighting for static objects, drawn on top of the G-Buffer's depth so that only visible surfaces
+	// write. We skip the pass entirely if nothing has been baked
+	RenderGraph::ResourceHandle lightmap = RenderGraph::INVALID_HANDLE;
+	bool hasLightmaps = false;
+	scene->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		hasLightmaps |= renderable->GetLightmap() != nullptr;
+	});
+	if (hasLightmaps) {
+		RenderGraph::PassBuilder builder = graph.AddPass("Lightmap", [this](const RenderGraph::PassContext& context) {
+			_RenderLightmaps();
+		});
+		lightmap = builder.Create("Lightmap", RenderTargetType::ColorRgba16F);
+		builder.Write(lightmap, RenderTargetAttachment::Color0, RenderGraph::LoadOp::Clear, glm::vec4(0.0f));
+		builder.Write(gBuffer[0], RenderTargetAttachment::Depth);
+	}
+
+	// Re-render the scene into each shadow camera's depth buffer, these are owned by the cameras so we import them
+	std::vector<RenderGraph::ResourceHandle> shadowMaps;
+	OcclusionCullingLayer::Sptr culling = app.GetLayer<OcclusionCullingLayer>();
+	scene->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
+		RenderGraph::ResourceHandle shadowMap = graph.Import(
+			"Shadow_" + shadowCam->GetGameObject()->Name,
+			shadowCam->GetDepthBuffer()->GetTextureAttachment(RenderTargetAttachment::Depth)
+		);
+		shadowMaps.push_back(shadowMap);
+
+		ShadowCamera* camera = shadowCam.get();
+		RenderGraph::PassBuilder builder = graph.AddPass("Shadow", [this, camera, culling](const RenderGraph::PassContext& context) {
+			// Shadow casters are culled against the light's own view, not the main camera's
+			int cullingView = culling != nullptr ? culling->GetShadowView(camera) : -1;
+			_RenderScene(camera->GetGameObject()->GetInverseTransform(), camera->GetProjection(), cullingView, true);
+		});
+		builder.Write(shadowMap, RenderTargetAttachment::Depth, RenderGraph::LoadOp::Clear, glm::vec4(1.0f));
+	});
+
+	// Light accumulation, both buffers start empty, the first batch of lights adds the ambient from our harmonics
+	RenderGraph::ResourceHandle diffuse, specular;
+	{
+		RenderGraph::PassBuilder builder = graph.AddPass("Lighting", [this, gBuffer, shadowMaps, lightmap](const RenderGraph::PassContext& context) {
+			_lightingFBO = context.GetFramebuffer();
+
+			Texture2D::Sptr gBufferTextures[5];
+			for (int ix = 0; ix < 5; ix++) {
+				gBufferTextures[ix] = context.GetTexture(gBuffer[ix]);
+			}
+			std::vector<Texture2D::Sptr> shadowTextures;
+			for (RenderGraph::ResourceHandle handle : shadowMaps) {
+				shadowTextures.push_back(context.GetTexture(handle));
+			}
+			Texture2D::Sptr lightmapTexture = lightmap != RenderGraph::INVALID_HANDLE ? context.GetTexture(lightmap) : nullptr;
+			_AccumulateLighting(gBufferTextures, shadowTextures, lightmapTexture);
+		});
+		diffuse  = builder.Create("LightDiffuse",  RenderTargetType::ColorRgba8);
+		specular = builder.Create("LightSpecular", RenderTargetType::ColorRgba8);
+		builder.Write(diffuse,  RenderTargetAttachment::Color0, RenderGraph::LoadOp::Clear, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		builder.Write(specular, RenderTargetAttachment::Color1, RenderGraph::LoadOp::Clear, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+		for (int ix = 0; ix < 5; ix++) {
+			builder.Read(gBuffer[ix]);
+		}
+		for (RenderGraph::ResourceHandle handle : shadowMaps) {
+			builder.Read(handle);
+		}
+		if (lightmap != RenderGraph::INVALID_HANDLE) {
+			builder.Read(lightmap);
+		}
+	}
+
+	// Composite, the fullscreen quad overwrites every pixel so the color doesn't need clearing. We render
+	// straight on top of the G-Buffer's depth, so there's no need to copy it anywhere
+	RenderGraph::ResourceHandle sceneColor;
+	{
+		RenderGraph::PassBuilder builder = graph.AddPass("Composite", [this, gBuffer, diffuse, specular](const RenderGraph::PassContext& context) {
+			// We want to switch to our compositing shader
+			_compositingShader->Bind();
+
+			// Disable blending, we want to override any existing colors, and keep the quad from being depth tested
+			glDisable(GL_BLEND);
+			glDisable(GL_DEPTH_TEST);
+			glDepthMask(false);
+
+			// Bind our albedo and lighting buffers so we can composite a final scene
+			context.GetTexture(gBuffer[1])->Bind(0);
+			context.GetTexture(gBuffer[2])->Bind(1);
+			context.GetTexture(diffuse)->Bind(2);
+			context.GetTexture(specular)->Bind(3);
+			context.GetTexture(gBuffer[3])->Bind(4);
+			_fullscreenQuad->Draw();
+
+			// Re-enable depth testing
+			glEnable(GL_DEPTH_TEST);
+			glDepthMask(true);
+
+			// Use our cubemap to draw our skybox
+			Application::Get().CurrentScene()->DrawSkybox();
+		});
+		sceneColor = builder.Create("SceneColor", RenderTargetType::ColorRgba8);
+		builder.Write(sceneColor, RenderTargetAttachment::Color0, RenderGraph::LoadOp::DontCare);
+		builder.Write(gBuffer[0], RenderTargetAttachment::Depth);
+		builder.Read(gBuffer[1]);
+		builder.Read(gBuffer[2]);
+		builder.Read(gBuffer[3]);
+		builder.Read(diffuse);
+		builder.Read(specular);
+	}
+
+	graph.SetNamedResource(SCENE_COLOR, sceneColor);
+	graph.SetNamedResource(SCENE_DEPTH, gBuffer[0]);
+	graph.SetNamedResource(GBUFFER_NORMALS, gBuffer[2]);
+
+	// Debug views read these after the graph has run, so they can't share memory with anything else
+	if (_exportDebugTargets) {
+		for (int ix = 0; ix < 5; ix++) {
+			graph.Export(gBuffer[ix]);
+		}
+		graph.Export(diffuse);
+		graph.Export(specular);
+		_exportDebugTargets = false;
+	}
 }
 
-void RenderLayer::OnPostRender() {
-	//using namespace Gameplay;
+void RenderLayer::_CaptureProbeFace(ReflectionProbe* probe)
+{
+	Application& app = Application::Get();
+	Gameplay::Scene::Sptr& scene = app.CurrentScene();
+
+	probe->BeginFace();
+	glClearColor(_clearColor.r, _clearColor.g, _clearColor.b, _clearColor.a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(true);
+	glDisable(GL_BLEND);
 
-	// Unbind our G-Buffer
-	_primaryFBO->Unbind();
+	// Probes go through the same low detail path as shadow maps, they're small and sampled blurry anyways
+	glm::mat4 view = probe->GetFaceView(probe->GetNextFace(), scene->GetSkyboxRotation());
+	glm::mat4 projection = probe->GetProjection();
+	_RenderScene(view, projection, -1, true);
+	scene->DrawSkybox(view, projection);
 
-	// Composite our lighting 
-	_Composite();
+	if (probe->EndFace()) {
+		_PrefilterProbe(probe);
+		_probeIndex++;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderLayer::_PrefilterProbe(ReflectionProbe* probe)
+{
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(false);
+
+	_probePrefilterShader->Bind();
+	probe->GetCaptureCubemap()->Bind(0);
+
+	// Each mip level holds a rougher reflection than the last, from a perfect mirror at mip 0 to fully rough
+	// at the smallest mip. Rougher levels sample lower mips of the capture so their samples don't skip texels
+	int mipLevels = static_cast<int>(probe->GetPrefilterTarget()->GetMipLevels());
+	for (int mip = 0; mip < mipLevels; mip++) {
+		_probeFaceSizeUniform.Set(static_cast<float>(glm::max(probe->GetResolution() >> mip, 1u)));
+		_probeRoughnessUniform.Set(mipLevels > 1 ? mip / static_cast<float>(mipLevels - 1) : 0.0f);
+		_probeSourceLodUniform.Set(static_cast<float>(mip));
+		for (int face = 0; face < 6; face++) {
+			probe->BindPrefilterTarget(face, mip);
+			_probeFaceUniform.Set(face);
+			_fullscreenQuad->Draw();
+		}
+	}
+	probe->PublishPrefilterTarget();
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(true);
+}
+
+void RenderLayer::_RenderLightmaps()
+{
+	using namespace Gameplay;
 
 	Application& app = Application::Get();
-	const glm::uvec4& viewport = app.GetPrimaryViewport();
+	Camera::Sptr camera = app.CurrentScene()->MainCamera;
+	glm::mat4 view = camera->GetView();
+	glm::mat4 viewProj = camera->GetProjection() * view;
+	OcclusionCullingLayer::Sptr culling = app.GetLayer<OcclusionCullingLayer>();
 
-	// Restore viewport to game viewport
-	glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	// We only want to write where the G-Buffer has the same surface, so we test against it's depth without writing
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(false);
+	glDisable(GL_BLEND);
 
-	// Blit our depth to the primary framebuffer so that other rendering can use it
-	glBlitNamedFramebuffer(
-		_primaryFBO->GetHandle(), 0,
-		0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight(),
-		viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w,
-		GL_DEPTH_BUFFER_BIT,
-		GL_NEAREST
-	);
+	_lightmapShader->Bind();
+	app.CurrentScene()->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		if (renderable->GetLightmap() == nullptr || renderable->GetMesh() == nullptr || !renderable->GetMeshResource()->HasLightmapUvs()) {
+			return;
+		}
+		if (culling != nullptr && !culling->IsVisible(renderable.get(), OcclusionCullingLayer::MAIN_VIEW)) {
+			return;
+		}
 
-	// TODO: post processing effects
+		// Use the same LOD as the G-Buffer so we land on exactly the same depth
+		GameObject* object = renderable->GetGameObject();
+		VertexArrayObject::Sptr mesh = renderable->GetMesh(renderable->GetCurrentLod());
+		renderable->GetLightmap()->Bind(0);
 
-	_outputBuffer->Unbind();
-	_outputBuffer->Bind(FramebufferBinding::Read);
-	Framebuffer::Blit(
-		{ 0, 0, _outputBuffer->GetWidth(), _outputBuffer->GetHeight() },
-		{ viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w },
-		BufferFlags::Color
-	);
+		auto& instanceData = _instanceUniforms->GetData();
+		instanceData.u_Model = object->GetTransform();
+		instanceData.u_ModelViewProjection = viewProj * object->GetTransform();
+		instanceData.u_ModelView = view * object->GetTransform();
+		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(object->GetTransform())));
+		instanceData.u_PositionScale = glm::vec4(mesh->GetPositionScale(), 0.0f);
+		instanceData.u_PositionOffset = glm::vec4(mesh->GetPositionOffset(), 0.0f);
+		_instanceUniforms->Update();
 
-	_outputBuffer->Unbind();
+		mesh->Draw();
+	});
+
+	glDepthFunc(GL_LESS);
+	glDepthMask(true);
 }
 
-void RenderLayer::_AccumulateLighting()
+void RenderLayer::_AccumulateLighting(const Texture2D::Sptr* gBuffer, const std::vector<Texture2D::Sptr>& shadowMaps, const Texture2D::Sptr& lightmap)
 {
 	using namespace Gameplay;
 
@@ -163,52 +567,27 @@ void RenderLayer::_AccumulateLighting()
 	Camera::Sptr camera = app.CurrentScene()->MainCamera;
 	const glm::mat4& view = camera->GetView();
 
+	// The shadow passes render the scene from each light's view, so restore our frame level uniforms
+	_InitFrameUniforms();
+
 	// Update our lighting UBO for any shaders that need it
 	LightingUboStruct& data = _lightingUbo->GetData();
-	data.AmbientCol = scene->GetAmbientLight();
+	data.AmbientCol = enable_ambient ? scene->GetAmbientLight() : glm::vec3(0);
 	data.EnvironmentRotation = scene->GetSkyboxRotation() * glm::inverse(glm::mat3(scene->MainCamera->GetView()));
 
-	const glm::vec3& ambient = scene->GetAmbientLight();
-	const glm::vec3& ambient2 = glm::vec3(0);
-	if (!enable_ambient)
-	{
-		data.AmbientCol = glm::vec3(0);
-		const glm::vec4 colors[2] = {
-		{ ambient2, 1.0f },         // diffuse (multiplicative)
-		{ 0.0f, 0.0f, 0.0f, 1.0f } // specular (additive)
-		};
-		_lightingFBO->Bind();
-		_ClearFramebuffer(_lightingFBO, colors, 2);
-	}
-	else
-	{
-		const glm::vec4 colors[2] = {
-		{ ambient, 1.0f },         // diffuse (multiplicative)
-		{ 0.0f, 0.0f, 0.0f, 1.0f } // specular (additive)
-		};
-		_lightingFBO->Bind();
-		_ClearFramebuffer(_lightingFBO, colors, 2);
-	}
-
-
-	//_lightingFBO->Bind();
-	//_ClearFramebuffer(_lightingFBO, colors, 2);
-
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
-	// Bind our shader for processing lighting
-	_lightAccumulationShader->Bind();
 	//bind the warp
 	diffusewarp->Bind(5);
 	specularwarp->Bind(6);
 
 	// Bind our G-Buffer textures so that they're readable
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Depth)->Bind(0);  // depth
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(1); // albedo + spec
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color1)->Bind(2); // normals + metallic
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color2)->Bind(3); // emissive
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color3)->Bind(4); // view pos
+	gBuffer[0]->Bind(0); // depth
+	gBuffer[1]->Bind(1); // albedo + spec
+	gBuffer[2]->Bind(2); // normals + metallic
+	gBuffer[3]->Bind(3); // emissive
+	gBuffer[4]->Bind(4); // view pos
 
 
 	// Send in how many active lights we have and the global lighting settings
@@ -216,74 +595,84 @@ void RenderLayer::_AccumulateLighting()
 	{
 		data.AmbientCol = glm::vec3(0.1f);
 	}
-	int ix = 0;
-	app.CurrentScene()->Components().Each<Light>([&](const Light::Sptr& light) {
-		// Get the light's position in view space, since we're doing view space lighting
-		glm::vec4 pos = glm::vec4(light->GetGameObject()->GetWorldPosition(), 1.0f);
-		pos = view * pos;
-
-		// Copy to the ubo data
-		data.Lights[ix].Position = (glm::vec3)(pos) / pos.w;
-		data.Lights[ix].Intensity = light->GetIntensity();
-		data.Lights[ix].Color = light->GetColor();
-		data.Lights[ix].Attenuation = 1.0f / (1.0f + light->GetRadius());
-
-		ix++;
-
-		// If we've reached the max # of lights the shader supports, draw to the screen and start the next batch
-		if (ix == MAX_LIGHTS) {
-			data.NumLights = MAX_LIGHTS;
-
-			// Send updated data to OpenGL
-			_lightingUbo->Update();
+	// Ambient lighting comes from the harmonics in our frame uniforms, only the first batch adds it
+	bool ambientAdded = false;
+
+	// Lightmapped pixels already have the diffuse lighting from baked lights, so when we have lightmaps on
+	// screen we draw the baked lights in their own batches that those pixels can skip
+	bool hasLightmap = lightmap != nullptr;
+	if (hasLightmap) {
+		lightmap->Bind(7);
+	}
 
-			// Draw the fullscreen quad to accumulate the lights
-			_fullscreenQuad->Draw();
+	for (int batchType = 0; batchType < (hasLightmap ? 2 : 1); batchType++) {
+		bool bakedBatch = batchType == 1;
 
-			ix = 0;
+		// The lightmap features are variants of the variant we picked for our render flags
+		ShaderProgram::Sptr variant = _lightAccumulationVariant;
+		if (hasLightmap) {
+			ShaderProgram::DefineSet defines;
+			defines["HAS_LIGHTMAP"] = "1";
+			if (bakedBatch) {
+				defines["SKIP_BAKED"] = "1";
+			}
+			variant = _lightAccumulationVariant->GetVariant(defines);
 		}
-		});
+		variant->Bind();
+		_ambientWeightUniform = variant->GetUniformHandle<float>("u_AmbientWeight");
+		_ambientWeightUniform.Set(ambientAdded ? 0.0f : 1.0f);
 
-	// If we have lights left over that haven't been drawn, draw them now
-	if (ix > 0) {
-		data.NumLights = ix;
+		int ix = 0;
+		app.CurrentScene()->Components().Each<Light>([&](const Light::Sptr& light) {
+			if (hasLightmap && light->IsBaked() != bakedBatch) {
+				return;
+			}
 
-		// Send updated data to OpenGL
-		_lightingUbo->Update();
+			// Get the light's position in view space, since we're doing view space lighting
+			glm::vec4 pos = glm::vec4(light->GetGameObject()->GetWorldPosition(), 1.0f);
+			pos = view * pos;
 
-		// Draw the fullscreen quad to accumulate the lights
-		_fullscreenQuad->Draw();
-	}
+			// Copy to the ubo data
+			data.Lights[ix].Position = (glm::vec3)(pos) / pos.w;
+			data.Lights[ix].Intensity = light->GetIntensity();
+			data.Lights[ix].Color = light->GetColor();
+			data.Lights[ix].Attenuation = 1.0f / (1.0f + light->GetRadius());
 
-	// Re-render the scene for shadows
-	app.CurrentScene()->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
-		// Bind the shadow camera's depth buffer and clear it
-		shadowCam->GetDepthBuffer()->Bind();
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, shadowCam->GetBufferResolution().x, shadowCam->GetBufferResolution().y);
+			ix++;
 
-		_RenderScene(shadowCam->GetGameObject()->GetInverseTransform(), shadowCam->GetProjection());
+			// If we've reached the max # of lights the shader supports, draw to the screen and start the next batch
+			if (ix == MAX_LIGHTS) {
+				data.NumLights = MAX_LIGHTS;
 
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		});
+				// Send updated data to OpenGL
+				_lightingUbo->Update();
 
-	// Restore frame level uniforms
-	_InitFrameUniforms();
+				// Draw the fullscreen quad to accumulate the lights
+				_fullscreenQuad->Draw();
+				_ambientWeightUniform.Set(0.0f);
+				ambientAdded = true;
 
-	_lightingFBO->Bind();
-	glViewport(0, 0, _lightingFBO->GetWidth(), _lightingFBO->GetHeight());
+				ix = 0;
+			}
+			});
 
-	// Bind our G-Buffer textures so that they're readable
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Depth)->Bind(0);  // depth
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(1); // albedo + spec
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color1)->Bind(2); // normals + metallic
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color2)->Bind(3); // emissive
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color3)->Bind(4); // view pos
+		// If we have lights left over that haven't been drawn, draw them now. If there were no lights at all
+		// we still need a draw for the ambient
+		if (ix > 0 || !ambientAdded) {
+			data.NumLights = ix;
+
+			// Send updated data to OpenGL
+			_lightingUbo->Update();
 
-	// Bind shadow composite shader
-	_shadowShader->Bind();
+			// Draw the fullscreen quad to accumulate the lights
+			_fullscreenQuad->Draw();
+			_ambientWeightUniform.Set(0.0f);
+			ambientAdded = true;
+		}
+	}
 
-	// Add each shadow casting light to the lighting buffers
+	// Add each shadow casting light to the lighting buffers, the shadow maps were rendered by earlier passes
+	int shadowIx = 0;
 	app.CurrentScene()->Components().Each<ShadowCamera>([&](const ShadowCamera::Sptr& shadowCam) {
 		// This gets us the light -> view space matrix, which we'll inverse to go from view space to light space
 		glm::mat4 lightSpaceMatrix = camera->GetView() * shadowCam->GetGameObject()->GetTransform();
@@ -296,120 +685,62 @@ void RenderLayer::_AccumulateLighting()
 		glm::vec3 lightPosViewSpace = lightSpaceMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 
 		// Bind depth and projection mask for reading, making sure not to stomp G-Buffer bindings
-		shadowCam->GetDepthBuffer()->BindAttachment(RenderTargetAttachment::Depth, 5);
+		shadowMaps[shadowIx++]->Bind(5);
 		if (shadowCam->GetProjectionMask() != nullptr) {
 			shadowCam->GetProjectionMask()->Bind(6);
 		}
 
-		//_shadowShader->SetUniformMatrix("u_ClipToShadow", clipToShadow); 
-		_shadowShader->SetUniformMatrix("u_ViewToShadow", viewToShadow);
+		// Each combination of shadow flags has it's own shader variant
+		const ShadowVariant& shadowVariant = _GetShadowVariant(*shadowCam->Flags);
+		shadowVariant.Shader->Bind();
+
+		shadowVariant.ViewToShadow.Set(viewToShadow);
 
 		// Get color and normalize it (strip the alpha)
 		glm::vec4 color = shadowCam->GetColor();
 		color *= color.w;
 
-		_shadowShader->SetUniform("u_LightDirViewspace", lightDirViewSpace);
-		_shadowShader->SetUniform("u_ShadowBias", shadowCam->Bias);
-		_shadowShader->SetUniform("u_NormalBias", shadowCam->NormalBias);
-		_shadowShader->SetUniform("u_Attenuation", 1 / shadowCam->Range);
-		_shadowShader->SetUniform("u_Intensity", shadowCam->Intensity);
-		_shadowShader->SetUniform("u_LightColor", (glm::vec3)color);
-		_shadowShader->SetUniform("u_LightPosViewspace", lightPosViewSpace);
-		_shadowShader->SetUniform("u_ShadowFlags", *shadowCam->Flags);
+		shadowVariant.LightDirViewspace.Set(lightDirViewSpace);
+		shadowVariant.ShadowBias.Set(shadowCam->Bias);
+		shadowVariant.NormalBias.Set(shadowCam->NormalBias);
+		shadowVariant.Attenuation.Set(1 / shadowCam->Range);
+		shadowVariant.Intensity.Set(shadowCam->Intensity);
+		shadowVariant.LightColor.Set((glm::vec3)color);
+		shadowVariant.LightPosViewspace.Set(lightPosViewSpace);
 
 		// Draw the fullscreen quad to accumulate the lights
 		_fullscreenQuad->Draw();
 		});
 
-	// Unbind the lighting FBO so we can read its textures
-	_lightingFBO->Unbind();
-}
-
-void RenderLayer::_Composite()
-{
-	using namespace Gameplay;
-	Application& app = Application::Get();
-
-	Scene::Sptr& scene = app.CurrentScene();
-
-	_AccumulateLighting();
-
-	// We want to switch to our compositing shader
-	_compositingShader->Bind();
-
-	// Switch rendering to output
-	_outputBuffer->Bind();
-	glViewport(0, 0, _outputBuffer->GetWidth(), _outputBuffer->GetHeight());
-
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	// Disable blending, we want to override any existing colors
 	glDisable(GL_BLEND);
-
-	// Bind our albedo and lighting buffers so we can composite a final scene
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(0);
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color1)->Bind(1);
-	_lightingFBO->GetTextureAttachment(RenderTargetAttachment::Color0)->Bind(2);
-	_lightingFBO->GetTextureAttachment(RenderTargetAttachment::Color1)->Bind(3);
-	_primaryFBO->GetTextureAttachment(RenderTargetAttachment::Color2)->Bind(4);
-	_fullscreenQuad->Draw();
-
-	// Re-enable depth testing
-	glEnable(GL_DEPTH_TEST);
-
-	// Blit our depth from primary FBO to our output depth buffer
-	glBlitNamedFramebuffer(
-		_primaryFBO->GetHandle(), _outputBuffer->GetHandle(),
-		0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight(),
-		0, 0, _outputBuffer->GetWidth(), _outputBuffer->GetHeight(),
-		GL_DEPTH_BUFFER_BIT,
-		GL_NEAREST
-	);
-
-	// Use our cubemap to draw our skybox
-	scene->DrawSkybox();
-
-	_outputBuffer->Unbind();
-}
-
-void RenderLayer::_ClearFramebuffer(Framebuffer::Sptr & buffer, const glm::vec4 * colors, int layers) {
-	// Make the entire buffer visible
-	glViewport(0, 0, buffer->GetWidth(), buffer->GetHeight());
-	// Disable depth testing
-	glEnable(GL_DEPTH_TEST);
-	// Enable depth writing
-	glDepthMask(true);
-	// Disable blending, we want to override the colors
-	glDisable(GL_BLEND);
-	// Ignore existing depth
-	glDepthFunc(GL_ALWAYS);
-
-	// Bind the buffer so we're writing to it
-	buffer->Bind();
-
-	// Bind our clear shader, and draw a fullscreen quad with all the clear colors
-	_clearShader->Bind();
-	_clearShader->SetUniform<glm::vec4>("ClearColors", colors, layers);
-	_fullscreenQuad->Draw();
-
-	// Reset depth test function to default
-	glDepthFunc(GL_LESS);
 }
 
 void RenderLayer::OnWindowResize(const glm::ivec2 & oldSize, const glm::ivec2 & newSize)
 {
 	if (newSize.x * newSize.y == 0) return;
 
-	// Set viewport and resize our primary FBO and light accumulation FBO
-	_primaryFBO->Resize(newSize);
-	_lightingFBO->Resize(newSize);
-	_outputBuffer->Resize(newSize);
+	// The render graph will re-allocate it's targets at the new size next frame
+	// Note that dynamic resolution never reallocates, it only renders to a fraction of these
+	_targetSize = newSize;
 
 	// Update the main camera's projection
 	Application& app = Application::Get();
 	app.CurrentScene()->MainCamera->ResizeWindow(newSize.x, newSize.y);
 }
 
+nlohmann::json RenderLayer::GetDefaultConfig() {
+	return {
+		{ "dynamic_resolution", _dynamicResolution },
+		{ "target_gpu_ms",      _targetGpuTimeMs },
+		{ "min_render_scale",   _minRenderScale },
+		{ "upscale_sharpness",  _upscaleSharpness },
+		{ "shadow_lod_bias",    _shadowLodBias },
+		{ "probe_update_interval", _probeUpdateInterval },
+		{ "meshlet_culling",      _meshletCulling },
+		{ "meshlet_cone_culling", _meshletConeCulling }
+	};
+}
+
 void RenderLayer::OnUpdate()
 {
 	using namespace Gameplay;
@@ -447,123 +778,41 @@ void RenderLayer::OnUpdate()
 	{
 		scene->SetAmbientLight(glm::vec3(0.0f));
 	}
-	if (enable_specular)
-	{
-		if (enable_ramp_d && enable_ramp_s && lights)
-		{
-			_renderFlags = RenderFlags::EnableSpecular | RenderFlags::EnableLights | RenderFlags::EnableRDiffuse | RenderFlags::EnableRSpec;
-		}
-		else if (enable_ramp_d && lights)//no spec ramp
-		{
-			_renderFlags = RenderFlags::EnableSpecular | RenderFlags::EnableLights | RenderFlags::EnableRDiffuse;
-		}
-		else if (enable_ramp_d && enable_ramp_s)//no lights
-		{
-			_renderFlags = RenderFlags::EnableSpecular | RenderFlags::EnableRDiffuse | RenderFlags::EnableRSpec;
-		}
-		else if (enable_ramp_d) //specular and ramp diffuse
-		{
-			_renderFlags = RenderFlags::EnableRDiffuse | RenderFlags::EnableSpecular;
-		}
-		else if (enable_ramp_s && lights)//no diff ramp
-		{
-			_renderFlags = RenderFlags::EnableSpecular | RenderFlags::EnableLights | RenderFlags::EnableRSpec;
-		}
-		else if (enable_ramp_s) //specular and ramp spec
-		{
-			_renderFlags = RenderFlags::EnableRSpec | RenderFlags::EnableSpecular;
-		}
-
-		else if (lights)//no ramps, but has lights
-		{
-			_renderFlags = RenderFlags::EnableSpecular | RenderFlags::EnableLights;
-		}
-		else //only specular
-		{
-			_renderFlags = RenderFlags::EnableSpecular;
-		}
-	}
-	else if (lights)
-	{
-		if (enable_ramp_s && enable_ramp_d) //no specular, but has lights
-		{
-			_renderFlags = RenderFlags::EnableLights | RenderFlags::EnableRDiffuse | RenderFlags::EnableRSpec;
-		}
-		else if (enable_ramp_s) //lights and ramp specular
-		{
-			_renderFlags = RenderFlags::EnableRSpec | RenderFlags::EnableLights;
-		}
-		else if (enable_ramp_d) //lights and ramp diffuse
-		{
-			_renderFlags = RenderFlags::EnableRDiffuse | RenderFlags::EnableLights;
-		}
-		else//only lights
-		{
-			_renderFlags = RenderFlags::EnableLights;
-		}
-	}
-	else if (enable_ramp_s)
-	{
-		if (enable_ramp_d) //only the ramps on
-		{
-			_renderFlags = RenderFlags::EnableRDiffuse | RenderFlags::EnableRSpec;
-		}
-		else//only ramp specular
-		{
-			_renderFlags = RenderFlags::EnableRSpec;
-		}
-	}
-	else if (enable_ramp_d)//only ramp diffuse
-	{
-		_renderFlags = RenderFlags::EnableRDiffuse;
-	}
-	else//none
-	{
-		_renderFlags = RenderFlags::None;
-	}
-
+	// Each toggle maps to a single feature, the lighting shader variants are swapped to match in OnPreRender
+	RenderFlags flags = RenderFlags::None;
+	if (lights)          flags = flags | RenderFlags::EnableLights;
+	if (enable_specular) flags = flags | RenderFlags::EnableSpecular;
+	if (enable_ramp_d)   flags = flags | RenderFlags::EnableRDiffuse;
+	if (enable_ramp_s)   flags = flags | RenderFlags::EnableRSpec;
+	_renderFlags = flags;
 }
 
 void RenderLayer::OnAppLoad(const nlohmann::json & config)
 {
 	Application& app = Application::Get();
 
+	// Load our dynamic resolution settings from the app config
+	if (config.contains(Name)) {
+		const nlohmann::json& settings = config[Name];
+		_dynamicResolution = JsonGet(settings, "dynamic_resolution", _dynamicResolution);
+		_targetGpuTimeMs   = JsonGet(settings, "target_gpu_ms", _targetGpuTimeMs);
+		_minRenderScale    = glm::clamp(JsonGet(settings, "min_render_scale", _minRenderScale), 0.1f, 1.0f);
+		_upscaleSharpness  = JsonGet(settings, "upscale_sharpness", _upscaleSharpness);
+		_shadowLodBias     = glm::max(JsonGet(settings, "shadow_lod_bias", _shadowLodBias), 0);
+		_probeUpdateInterval = glm::max(JsonGet(settings, "probe_update_interval", _probeUpdateInterval), 1);
+		_meshletCulling     = JsonGet(settings, "meshlet_culling", _meshletCulling);
+		_meshletConeCulling = JsonGet(settings, "meshlet_cone_culling", _meshletConeCulling);
+	}
+	_meshletCommandBuffer = IndirectBuffer::Create(BufferUsage::StreamDraw);
+
 	// GL states, we'll enable depth testing and backface fulling
 	glEnable(GL_DEPTH_TEST);
 	//glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
 
-	// Create a new descriptor for our FBO
-	FramebufferDescriptor fboDescriptor;
-	fboDescriptor.Width = app.GetWindowSize().x;
-	fboDescriptor.Height = app.GetWindowSize().y;
-
-	// We want to use a 32 bit depth buffer, we'll ignore the stencil buffer for now
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Depth] = RenderTargetDescriptor(RenderTargetType::Depth32);
-	// Color layer 0 (albedo, specular)
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
-	// Color layer 1 (normals, metallic)
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color1] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
-	// Color layer 2 (emissive)  
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color2] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
-	// Color layer 3 (view space position)  
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color3] = RenderTargetDescriptor(RenderTargetType::ColorRgba16F);
-
-	// Create the primary FBO
-	_primaryFBO = std::make_shared<Framebuffer>(fboDescriptor);
-
-	fboDescriptor.RenderTargets.clear();
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorRgba8); // Diffuse
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color1] = RenderTargetDescriptor(RenderTargetType::ColorRgba8); // Specular
-
-	_lightingFBO = std::make_shared<Framebuffer>(fboDescriptor);
-
-	// Create an FBO to store final output
-	fboDescriptor.RenderTargets.clear();
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Depth] = RenderTargetDescriptor(RenderTargetType::Depth32);
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color0] = RenderTargetDescriptor(RenderTargetType::ColorRgba8);
-
-	_outputBuffer = std::make_shared<Framebuffer>(fboDescriptor);
+	// All of our render targets are owned by the render graph, which allocates them as passes need them
+	_renderGraph = std::make_shared<RenderGraph>();
+	_targetSize = app.GetWindowSize();
 
 	// We'll use one shader for light accumulation for now
 	_lightAccumulationShader = ShaderProgram::Create();
@@ -590,16 +839,35 @@ void RenderLayer::OnAppLoad(const nlohmann::json & config)
 	_compositingShader->LoadShaderPartFromFile("shaders/fragment_shaders/deferred_composite.glsl", ShaderPartType::Fragment);
 	_compositingShader->Link();
 
-	_clearShader = ShaderProgram::Create();
-	_clearShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
-	_clearShader->LoadShaderPartFromFile("shaders/fragment_shaders/clear.glsl", ShaderPartType::Fragment);
-	_clearShader->Link();
-
 	_shadowShader = ShaderProgram::Create();
 	_shadowShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
 	_shadowShader->LoadShaderPartFromFile("shaders/fragment_shaders/shadow_composite.glsl", ShaderPartType::Fragment);
 	_shadowShader->Link();
 
+	_upscaleShader = ShaderProgram::Create();
+	_upscaleShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
+	_upscaleShader->LoadShaderPartFromFile("shaders/fragment_shaders/upscale.glsl", ShaderPartType::Fragment);
+	_upscaleShader->Link();
+	_upscaleUvMaxUniform     = _upscaleShader->GetUniformHandle<glm::vec2>("u_UvMax");
+	_upscaleSharpnessUniform = _upscaleShader->GetUniformHandle<float>("u_Sharpness");
+
+	_probePrefilterShader = ShaderProgram::Create();
+	_probePrefilterShader->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_quad.glsl", ShaderPartType::Vertex);
+	_probePrefilterShader->LoadShaderPartFromFile("shaders/fragment_shaders/reflection_probe_prefilter.glsl", ShaderPartType::Fragment);
+	_probePrefilterShader->Link();
+	_probeFaceUniform      = _probePrefilterShader->GetUniformHandle<int>("u_Face");
+	_probeFaceSizeUniform  = _probePrefilterShader->GetUniformHandle<float>("u_FaceSize");
+	_probeRoughnessUniform = _probePrefilterShader->GetUniformHandle<float>("u_Roughness");
+	_probeSourceLodUniform = _probePrefilterShader->GetUniformHandle<float>("u_SourceLod");
+
+	_lightmapShader = ShaderProgram::Create();
+	_lightmapShader->LoadShaderPartFromFile("shaders/vertex_shaders/lightmap_vert.glsl", ShaderPartType::Vertex);
+	_lightmapShader->LoadShaderPartFromFile("shaders/fragment_shaders/lightmap_frag.glsl", ShaderPartType::Fragment);
+	_lightmapShader->Link();
+
+	// Timer queries for measuring how long the GPU spends on our frame
+	glCreateQueries(GL_TIME_ELAPSED, GPU_TIMER_COUNT, _gpuTimers);
+
 	// We need a mesh for drawing fullscreen quads
 
 	glm::vec2 positions[6] = {
@@ -618,6 +886,9 @@ void RenderLayer::OnAppLoad(const nlohmann::json & config)
 	// Create our common uniform buffers
 	_frameUniforms = std::make_shared<UniformBuffer<FrameLevelUniforms>>(BufferUsage::DynamicDraw);
 	_instanceUniforms = std::make_shared<UniformBuffer<InstanceLevelUniforms>>(BufferUsage::DynamicDraw);
+	_instanceUniforms->GetData().u_PositionScale = glm::vec4(1.0f);
+	_instanceUniforms->GetData().u_PositionOffset = glm::vec4(0.0f);
+	_instanceUniforms->Update();
 	_lightingUbo = std::make_shared<UniformBuffer<LightingUboStruct>>(BufferUsage::DynamicDraw);
 }
 
@@ -633,8 +904,12 @@ void RenderLayer::SetBlitEnabled(bool value) {
 	_blitFbo = value;
 }
 
-const Framebuffer::Sptr& RenderLayer::GetRenderOutput() const {
-	return _outputBuffer;
+const RenderGraph::Sptr& RenderLayer::GetRenderGraph() const {
+	return _renderGraph;
+}
+
+void RenderLayer::SetDebugTargetsExported(bool value) {
+	_exportDebugTargets = value;
 }
 
 const glm::vec4& RenderLayer::GetClearColor() const {
@@ -662,6 +937,44 @@ const Framebuffer::Sptr& RenderLayer::GetGBuffer() const
 	return _primaryFBO;
 }
 
+const UniformBuffer<RenderLayer::InstanceLevelUniforms>::Sptr& RenderLayer::GetInstanceUniforms() const {
+	return _instanceUniforms;
+}
+
+float RenderLayer::GetRenderScale() const {
+	return _renderScale;
+}
+
+void RenderLayer::SetRenderScale(float value) {
+	_renderScale = glm::clamp(value, _minRenderScale, _maxRenderScale);
+}
+
+glm::ivec2 RenderLayer::GetRenderResolution() const {
+	// Round to the nearest pixel, but never go below 1 pixel in either direction
+	glm::vec2 size = glm::vec2(_targetSize) * _renderScale;
+	return glm::max(glm::ivec2(glm::round(size)), glm::ivec2(1));
+}
+
+bool RenderLayer::IsDynamicResolutionEnabled() const {
+	return _dynamicResolution;
+}
+
+void RenderLayer::SetDynamicResolutionEnabled(bool value) {
+	_dynamicResolution = value;
+}
+
+float RenderLayer::GetTargetGpuTime() const {
+	return _targetGpuTimeMs;
+}
+
+void RenderLayer::SetTargetGpuTime(float milliseconds) {
+	_targetGpuTimeMs = milliseconds;
+}
+
+float RenderLayer::GetGpuTime() const {
+	return _gpuTimeMs;
+}
+
 void RenderLayer::_InitFrameUniforms()
 {
 	using namespace Gameplay;
@@ -686,14 +999,58 @@ void RenderLayer::_InitFrameUniforms()
 	frameData.u_RenderFlags = _renderFlags;
 	frameData.u_ZNear = camera->GetNearPlane();
 	frameData.u_ZFar = camera->GetFarPlane();
+	frameData.u_RenderScale = _renderScale;
+	memcpy(frameData.u_AmbientSH, _ambientCoefficients, sizeof(_ambientCoefficients));
 	_frameUniforms->Update();
 }
 
-void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projection)
+void RenderLayer::_UpdateAmbient()
 {
 	using namespace Gameplay;
 
 	Application& app = Application::Get();
+	Scene::Sptr& scene = app.CurrentScene();
+
+	// Read back any probe captures that the GPU has finished with, and find the closest probe the camera is inside of
+	glm::vec3 cameraPos = scene->MainCamera->GetGameObject()->GetWorldPosition();
+	ReflectionProbe* closest = nullptr;
+	float closestDistSq = 0.0f;
+	scene->Components().Each<ReflectionProbe>([&](const ReflectionProbe::Sptr& probe) {
+		probe->PollAmbient();
+		if (probe->HasAmbient()) {
+			glm::vec3 delta = probe->GetGameObject()->GetWorldPosition() - cameraPos;
+			float distSq = glm::dot(delta, delta);
+			if (distSq <= probe->Radius * probe->Radius && (closest == nullptr || distSq < closestDistSq)) {
+				closest = probe.get();
+				closestDistSq = distSq;
+			}
+		}
+	});
+
+	// Probes and the skybox are both projected in skybox space, which the lighting shader rotates into. Scenes
+	// without a skybox fall back to their flat ambient color
+	SphericalHarmonics ambient;
+	if (enable_ambient) {
+		TextureCube::Sptr skybox = scene->GetSkyboxTexture();
+		if (closest != nullptr) {
+			ambient = closest->GetAmbient();
+		} else if (skybox != nullptr && skybox->GetSphericalHarmonics().Coefficients[0] != glm::vec3(0.0f)) {
+			ambient = skybox->GetSphericalHarmonics();
+		} else {
+			ambient = SphericalHarmonics::FromConstant(scene->GetAmbientLight());
+		}
+	}
+	ambient.GetDiffuseCoefficients(_ambientCoefficients);
+}
+
+void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projection, int cullingView, bool isShadowPass)
+{
+	using namespace Gameplay;
+
+	Application& app = Application::Get();
+
+	// Grab the occlusion culling results, if we have any
+	OcclusionCullingLayer::Sptr culling = cullingView >= 0 ? app.GetLayer<OcclusionCullingLayer>() : nullptr;
 
 	glm::mat4 viewProj = projection * view;
 
@@ -710,6 +1067,22 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 	frameData.u_CameraPos = view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 	_frameUniforms->Update();
 
+	// Objects near a reflection probe will sample it instead of the skybox. Shadow maps and probe captures
+	// don't need reflections, and a probe must never sample itself while it's being captured
+	_activeProbes.clear();
+	if (!isShadowPass) {
+		app.CurrentScene()->Components().Each<ReflectionProbe>([&](const ReflectionProbe::Sptr& probe) {
+			if (probe->GetCubemap() != nullptr) {
+				_activeProbes.push_back(probe.get());
+			}
+		});
+	}
+	ReflectionProbe* boundProbe = nullptr;
+
+	// Cone culling throws away meshlets that face away from the camera, which is only safe when back faces
+	// would be culled anyways. Most of our passes draw with face culling off (ex: open or double sided meshes)
+	bool coneCulling = _meshletConeCulling && glIsEnabled(GL_CULL_FACE);
+
 	// Render all our objects
 	app.CurrentScene()->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
 		// Early bail if mesh not set
@@ -717,6 +1090,16 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 			return;
 		}
 
+		// The main camera picks our LOD, we do this before culling since hidden objects may still cast shadows
+		if (!isShadowPass) {
+			renderable->UpdateLod(view, projection);
+		}
+
+		// Skip anything that is hidden behind an occluder
+		if (culling != nullptr && !culling->IsVisible(renderable.get(), cullingView)) {
+			return;
+		}
+
 		// If we don't have a material, try getting the scene's fallback material
 		// If none exists, do not draw anything
 		if (renderable->GetMaterial() == nullptr) {
@@ -741,16 +1124,69 @@ void RenderLayer::_RenderScene(const glm::mat4& view, const glm::mat4& projectio
 		// Grab the game object so we can do some stuff with it
 		GameObject* object = renderable->GetGameObject();
 
+		// Shadow maps don't need as much detail so they go a few levels coarser
+		int lod = renderable->GetCurrentLod() + (isShadowPass ? _shadowLodBias : 0);
+		VertexArrayObject::Sptr mesh = renderable->GetMesh(lod);
+
+		// Large meshes are split into meshlets, so we can skip the parts that are off screen or facing away
+		const std::vector<Meshlet>& meshlets = renderable->GetMeshResource()->GetMeshlets(lod);
+		bool drawMeshlets = false;
+		if (_meshletCulling && !meshlets.empty()) {
+			uint32_t visibleMeshlets = MeshletBuilder::Cull(meshlets, object->GetTransform(), view, projection, coneCulling, _meshletCommands);
+			if (visibleMeshlets == 0) {
+				return;
+			}
+			// If everything is visible, a regular draw call will do
+			drawMeshlets = visibleMeshlets < meshlets.size();
+		}
+
+		// Find the closest probe that we're within the radius of, and swap it into the environment slot
+		if (!_activeProbes.empty()) {
+			glm::vec3 position = object->GetWorldPosition();
+			ReflectionProbe* closest = nullptr;
+			float closestDistSq = 0.0f;
+			for (ReflectionProbe* probe : _activeProbes) {
+				glm::vec3 delta = probe->GetGameObject()->GetWorldPosition() - position;
+				float distSq = glm::dot(delta, delta);
+				if (distSq <= probe->Radius * probe->Radius && (closest == nullptr || distSq < closestDistSq)) {
+					closest = probe;
+					closestDistSq = distSq;
+				}
+			}
+			if (closest != boundProbe) {
+				if (closest != nullptr) {
+					closest->GetCubemap()->Bind(15);
+				} else if (app.CurrentScene()->GetSkyboxTexture() != nullptr) {
+					app.CurrentScene()->GetSkyboxTexture()->Bind(15);
+				}
+				boundProbe = closest;
+			}
+		}
+
 		// Use our uniform buffer for our instance level uniforms
 		auto& instanceData = _instanceUniforms->GetData();
 		instanceData.u_Model = object->GetTransform();
 		instanceData.u_ModelViewProjection = viewProj * object->GetTransform();
 		instanceData.u_ModelView = view * object->GetTransform();
 		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(object->GetTransform())));
+		// Meshes may have their positions quantized, pass along how to decode them
+		instanceData.u_PositionScale = glm::vec4(mesh->GetPositionScale(), 0.0f);
+		instanceData.u_PositionOffset = glm::vec4(mesh->GetPositionOffset(), 0.0f);
 		_instanceUniforms->Update();
 
 		// Draw the object
-		renderable->GetMesh()->Draw();
+		if (drawMeshlets) {
+			_meshletCommandBuffer->UpdateData(_meshletCommands.data(), sizeof(DrawElementsIndirectCommand), static_cast<uint32_t>(_meshletCommands.size()));
+			mesh->DrawIndirect(_meshletCommandBuffer, static_cast<uint32_t>(_meshletCommands.size()));
+		} else {
+			mesh->Draw();
+		}
 
 		});
+
+	// Put the skybox back in the environment slot for anything that renders after us
+	TextureCube::Sptr environment = app.CurrentScene()->GetSkyboxTexture();
+	if (boundProbe != nullptr && environment != nullptr) {
+		environment->Bind(15);
+	}
 }
\ No newline at end of file
@@ -1,11 +1,16 @@
 #pragma once
 #include "../ApplicationLayer.h"
 #include "Graphics/Framebuffer.h"
+#include "Graphics/RenderGraph.h"
 #include "Graphics/Buffers/UniformBuffer.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/Buffers/IndirectBuffer.h"
 #include "Gameplay/InputEngine.h"
 #include "Graphics/Textures/Texture1D.h"
+#include "Utils/SphericalHarmonics.h"
+
+class ReflectionProbe;
 
 
 #define MAX_LIGHTS 8
@@ -45,6 +50,12 @@ public:
 		RenderFlags u_RenderFlags;
 		float u_ZNear;
 		float u_ZFar;
+		// The fraction of our render targets that we are actually rendering into this frame
+		float u_RenderScale;
+		// Pads the harmonics out to a 16 byte boundary, as STD140 requires for arrays
+		float u_Padding[2];
+		// The ambient lighting as pre-convolved spherical harmonics, see SphericalHarmonics::GetDiffuseCoefficients
+		glm::vec4 u_AmbientSH[SphericalHarmonics::COEFFICIENT_COUNT];
 	};
 
 	// Structure for our instance-level uniforms, matches layout from
@@ -59,6 +70,9 @@ public:
 		glm::mat4 u_ModelView;
 		// Normal Matrix for transforming normals
 		glm::mat4 u_NormalMatrix;
+		// Used to decode quantized positions into model space (xyz only, w is padding)
+		glm::vec4 u_PositionScale;
+		glm::vec4 u_PositionOffset;
 	};
 
 	/// <summary>
@@ -87,11 +101,34 @@ public:
 		glm::mat4 EnvironmentRotation;
 	};
 
+	// Names of the graph resources that other layers can find with RenderGraph::GetNamedResource
+	// The final color of the scene, layers that process the image should replace this with their output
+	static const std::string SCENE_COLOR;
+	// The depth buffer of the scene, shared by the G-Buffer and the composited output
+	static const std::string SCENE_DEPTH;
+	// The view space normals from the G-Buffer
+	static const std::string GBUFFER_NORMALS;
+
 	RenderLayer();
 	virtual ~RenderLayer();
 
 	/// <summary>
-	/// Gets the primary framebuffer that is being rendered to
+	/// Gets the render graph that the frame is built from. Other layers add their passes to it
+	/// during OnPreRender, and it is compiled and executed during our OnRender
+	/// </summary>
+	const RenderGraph::Sptr& GetRenderGraph() const;
+
+	/// <summary>
+	/// Adds the pass that upscales the scene color to the game viewport, if it has not been added
+	/// already this frame. Layers that draw on top of the final image (ex: the GUI) should call this
+	/// before adding their own passes
+	/// </summary>
+	void AddPresentPass();
+
+	/// <summary>
+	/// Gets the framebuffer the G-Buffer was rendered into this frame, or nullptr if it has not been
+	/// rendered yet. Note that the graph may re-use it's textures later in the frame, unless they
+	/// have been exported with SetDebugTargetsExported
 	/// </summary>
 	const Framebuffer::Sptr& GetPrimaryFBO() const;
 
@@ -105,17 +142,70 @@ public:
 	RenderFlags GetRenderFlags() const;
 
 	const Framebuffer::Sptr& GetLightingBuffer() const;
-	const Framebuffer::Sptr& GetRenderOutput() const;
 	const Framebuffer::Sptr& GetGBuffer() const;
 
+	/// <summary>
+	/// Gets the uniform buffer for per-object uniforms, which stays bound for the whole frame. Layers that
+	/// draw their own meshes need to fill in the parts their shaders read (ex: the quantized position decode)
+	/// </summary>
+	const UniformBuffer<InstanceLevelUniforms>::Sptr& GetInstanceUniforms() const;
+
+	/// <summary>
+	/// Requests that the G-Buffer and lighting targets are kept alive until the end of the next frame,
+	/// rather than letting the render graph re-use their memory. Should be called every frame that
+	/// they are needed, ex: by debug windows
+	/// </summary>
+	void SetDebugTargetsExported(bool value);
+
+	/// <summary>
+	/// Gets the fraction of the allocated render targets that we are rendering into
+	/// this frame, in the range (0, 1]
+	/// </summary>
+	float GetRenderScale() const;
+	/// <summary>
+	/// Sets the fraction of the render targets to render into. Note that if dynamic
+	/// resolution is enabled, this will be overridden on the next frame
+	/// </summary>
+	void SetRenderScale(float value);
+
+	/// <summary>
+	/// Gets the size in pixels of the region of our render targets that we are rendering
+	/// into this frame. Any layer that renders into our targets should use this as it's viewport
+	/// </summary>
+	glm::ivec2 GetRenderResolution() const;
+
+	bool IsDynamicResolutionEnabled() const;
+	void SetDynamicResolutionEnabled(bool value);
+
+	/// <summary>
+	/// Gets the GPU time budget in milliseconds that dynamic resolution will try to stay within
+	/// </summary>
+	float GetTargetGpuTime() const;
+	/// <summary>
+	/// Sets the GPU time budget in milliseconds that dynamic resolution will try to stay within
+	/// </summary>
+	void SetTargetGpuTime(float milliseconds);
+
+	/// <summary>
+	/// Gets the smoothed GPU time in milliseconds taken by the last measured frame
+	/// </summary>
+	float GetGpuTime() const;
+
+	/// <summary>
+	/// Upscales the rendered region of the given texture to the application's primary viewport
+	/// in the default framebuffer
+	/// </summary>
+	/// <param name="source">The texture to upscale, only the region covered by the render scale is used</param>
+	void UpscaleToViewport(const Texture2D::Sptr& source);
+
 	// Inherited from ApplicationLayer
 	virtual void OnUpdate() override;
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
 	virtual void OnPreRender() override;
 	virtual void OnRender(const Framebuffer::Sptr& prevLayer) override;
-	virtual void OnPostRender() override;
 	virtual void OnWindowResize(const glm::ivec2& oldSize, const glm::ivec2& newSize) override;
+	virtual nlohmann::json GetDefaultConfig() override;
 
 protected:
 
@@ -129,21 +219,101 @@ protected:
 	Texture1D::Sptr specularwarp;
 
 
+	// The frame is declared as a graph of passes, which owns all of our transient render targets
+	RenderGraph::Sptr   _renderGraph;
+	glm::ivec2          _targetSize;
+	bool                _presentAdded;
+	bool                _exportDebugTargets;
+
+	// The framebuffers the graph built for the G-Buffer and lighting passes this frame
 	Framebuffer::Sptr   _primaryFBO;
 	Framebuffer::Sptr   _lightingFBO;
-	Framebuffer::Sptr   _outputBuffer;
 
-	ShaderProgram::Sptr _clearShader;
+	// Our lighting shaders are compiled into a variant for each combination of features, rather than
+	// branching on flags for every pixel. These are the variants we've selected for the current flags
 	ShaderProgram::Sptr _lightAccumulationShader;
+	ShaderProgram::Sptr _lightAccumulationVariant;
+	// How much of the ambient lighting the current light accumulation draw should add, since lights are drawn
+	// in batches we only want the first one to add it
+	UniformHandle<float> _ambientWeightUniform;
+	RenderFlags         _variantFlags;
 	ShaderProgram::Sptr _compositingShader;
 	ShaderProgram::Sptr _shadowShader;
 
+	/**
+	 * A variant of the shadow composite shader, along with handles to the uniforms we set for each light
+	 */
+	struct ShadowVariant {
+		ShaderProgram::Sptr        Shader;
+		UniformHandle<glm::mat4>   ViewToShadow;
+		UniformHandle<glm::vec3>   LightDirViewspace;
+		UniformHandle<glm::vec3>   LightPosViewspace;
+		UniformHandle<glm::vec3>   LightColor;
+		UniformHandle<float>       ShadowBias;
+		UniformHandle<float>       NormalBias;
+		UniformHandle<float>       Attenuation;
+		UniformHandle<float>       Intensity;
+	};
+	// Indexed by the shadow camera's flags, filled in as lights need them
+	ShadowVariant       _shadowVariants[16];
+
+	ShaderProgram::Sptr       _upscaleShader;
+	UniformHandle<glm::vec2>  _upscaleUvMaxUniform;
+	UniformHandle<float>      _upscaleSharpnessUniform;
+
+	// Filters a captured reflection probe into it's mip chain, see ReflectionProbe
+	ShaderProgram::Sptr       _probePrefilterShader;
+	UniformHandle<int>        _probeFaceUniform;
+	UniformHandle<float>      _probeFaceSizeUniform;
+	UniformHandle<float>      _probeRoughnessUniform;
+	UniformHandle<float>      _probeSourceLodUniform;
+
+	// Draws the lightmaps of static objects into the lightmap target, see LightmapBaker
+	ShaderProgram::Sptr       _lightmapShader;
+
 	VertexArrayObject::Sptr _fullscreenQuad;
 
 	bool              _blitFbo;
 	glm::vec4         _clearColor;
 	RenderFlags       _renderFlags;
 
+	// Dynamic resolution settings, the render scale is a fraction of our allocated
+	// targets so that we never need to reallocate when it changes
+	bool              _dynamicResolution;
+	float             _renderScale;
+	float             _minRenderScale;
+	float             _maxRenderScale;
+	float             _targetGpuTimeMs;
+	float             _gpuTimeMs;
+	float             _upscaleSharpness;
+
+	// How many levels coarser than the main camera's LOD shadow casters are drawn at
+	int               _shadowLodBias;
+
+	// Reflection probes are time sliced, we render a single face of a single probe every
+	// _probeUpdateInterval frames, and move on to the next probe once all it's faces are done
+	int               _probeUpdateInterval;
+	uint32_t          _probeFrameCounter;
+	size_t            _probeIndex;
+	// Probes that objects can sample, gathered each time we render the scene
+	std::vector<ReflectionProbe*> _activeProbes;
+	// The ambient lighting for this frame, in the form our frame uniforms expect
+	glm::vec4         _ambientCoefficients[SphericalHarmonics::COEFFICIENT_COUNT];
+
+	// Large meshes are split into meshlets, which are culled against each view and drawn with indirect draws
+	bool              _meshletCulling;
+	// Off by default, since it drops back facing meshlets and is only ever applied in passes that cull back faces
+	bool              _meshletConeCulling;
+	IndirectBuffer::Sptr _meshletCommandBuffer;
+	std::vector<DrawElementsIndirectCommand> _meshletCommands;
+
+	// We keep a ring of timer queries so that we can read results from a few frames
+	// ago without stalling the pipeline waiting on the GPU
+	static const int  GPU_TIMER_COUNT = 4;
+	GLuint            _gpuTimers[GPU_TIMER_COUNT];
+	bool              _gpuTimerIssued[GPU_TIMER_COUNT];
+	int               _gpuTimerIndex;
+
 	const int FRAME_UBO_BINDING = 0;
 	UniformBuffer<FrameLevelUniforms>::Sptr _frameUniforms;
 
@@ -154,9 +324,49 @@ protected:
 	UniformBuffer<LightingUboStruct>::Sptr _lightingUbo;
 
 	void _InitFrameUniforms();
-	void _RenderScene(const glm::mat4& view, const glm::mat4& projection);
+	/// <summary>
+	/// Picks the spherical harmonics for this frame's ambient lighting, from the reflection probe the camera is in,
+	/// or the skybox if there is none
+	/// </summary>
+	void _UpdateAmbient();
+	void _UpdateRenderScale();
+	/// <summary>
+	/// Selects the variant of our lighting shaders that matches the current render flags
+	/// </summary>
+	void _UpdateShaderVariants();
+	/// <summary>
+	/// Gets the variant of the shadow composite shader for a shadow camera's flags
+	/// </summary>
+	const ShadowVariant& _GetShadowVariant(uint32_t flags);
+	/// <summary>
+	/// Renders all render components in the scene with the given camera matrices
+	/// </summary>
+	/// <param name="cullingView">The occlusion culling view to test objects against, or -1 to draw everything</param>
+	/// <param name="isShadowPass">True if rendering into a shadow map, objects will re-use the main camera's LOD with our shadow bias applied</param>
+	void _RenderScene(const glm::mat4& view, const glm::mat4& projection, int cullingView = -1, bool isShadowPass = false);
+	/// <summary>
+	/// Renders the next face of a reflection probe, and prefilters it if that completes it's capture
+	/// </summary>
+	void _CaptureProbeFace(ReflectionProbe* probe);
+	/// <summary>
+	/// Filters a probe's completed capture into each mip level of it's output cubemap
+	/// </summary>
+	void _PrefilterProbe(ReflectionProbe* probe);
+
+	/// <summary>
+	/// Draws the baked lighting of every visible object with a lightmap, on top of the G-Buffer's depth
+	/// </summary>
+	void _RenderLightmaps();
 
-	void _AccumulateLighting();
-	void _Composite();
-	void _ClearFramebuffer(Framebuffer::Sptr& buffer, const glm::vec4* colors, int layers);
+	/// <summary>
+	/// Declares the reflection probe, G-Buffer, lightmap, shadow, lighting and composite passes for this frame
+	/// </summary>
+	void _DeclarePasses();
+	/// <summary>
+	/// Draws all point lights and shadow casting lights into the bound lighting buffer
+	/// </summary>
+	/// <param name="gBuffer">The G-Buffer textures, in the order depth, albedo, normals, emissive, view position</param>
+	/// <param name="shadowMaps">The depth texture for each shadow camera, in component order</param>
+	/// <param name="lightmap">The baked lighting for lightmapped pixels, or nullptr if nothing on screen has a lightmap</param>
+	void _AccumulateLighting(const Texture2D::Sptr* gBuffer, const std::vector<Texture2D::Sptr>& shadowMaps, const Texture2D::Sptr& lightmap);
 };
\ No newline at end of file
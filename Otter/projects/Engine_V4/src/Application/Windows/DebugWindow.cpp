@@ -2,6 +2,7 @@
 #include "Application/Application.h"
 #include "Application/ApplicationLayer.h"
 #include "Application/Layers/RenderLayer.h"
+#include "Gameplay/Lightmapper.h"
 
 DebugWindow::DebugWindow() :
 	IEditorWindow()
@@ -37,4 +38,11 @@ void DebugWindow::RenderMenuBar()
 	if (changed) {
 		renderLayer->SetRenderFlags(flags);
 	}
+
+	ImGui::Separator();
+
+	// Bakes the static objects' lighting, this blocks until the bake is done
+	if (ImGui::Button("Bake Lightmaps")) {
+		Gameplay::Lightmapper::BakeScene(app.CurrentScene());
+	}
 }
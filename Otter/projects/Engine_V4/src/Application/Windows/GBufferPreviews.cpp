@@ -20,8 +20,16 @@ void GBufferPreviews::Render()
 	Application& app = Application::Get();
 
 	RenderLayer::Sptr& renderLayer = app.GetLayer<RenderLayer>();
+
+	// The render graph re-uses the memory of these targets once the frame is done with them, so we ask
+	// for them to be kept around while the window is open
+	renderLayer->SetDebugTargetsExported(true);
+
 	const Framebuffer::Sptr& framebuffer = renderLayer->GetGBuffer();
 	const Framebuffer::Sptr& lightBuffer = renderLayer->GetLightingBuffer();
+	if (framebuffer == nullptr || lightBuffer == nullptr) {
+		return;
+	}
 
 	Texture2D::Sptr& depth = framebuffer->GetTextureAttachment(RenderTargetAttachment::Depth);
 	Texture2D::Sptr& color = framebuffer->GetTextureAttachment(RenderTargetAttachment::Color0);
@@ -72,10 +80,13 @@ void GBufferPreviews::_RenderTexture2D(const Texture2D::Sptr & value, const ImVe
 	ImGui::BeginChildFrame(ImGui::GetID(value.get()), ImVec2(size.x, size.y + ImGui::GetTextLineHeight() + 10));
 	ImDrawList* drawList = ImGui::GetWindowDrawList();
 
+	// Only show the region of the buffer that the renderer is using at it's current resolution
+	float scale = Application::Get().GetLayer<RenderLayer>()->GetRenderScale();
+
 	drawList->AddCallback([](const ImDrawList* parent_list, const ImDrawCmd* cmd) {
 		glDisable(GL_BLEND);
 	}, nullptr);
-	ImGui::Image((ImTextureID)value->GetHandle(), size, ImVec2(0, 1), ImVec2(1, 0));
+	ImGui::Image((ImTextureID)value->GetHandle(), size, ImVec2(0, scale), ImVec2(scale, 0));
 	drawList->AddCallback([](const ImDrawList* parent_list, const ImDrawCmd* cmd) {
 		glEnable(GL_BLEND);
 	}, nullptr);
@@ -15,6 +15,7 @@ GuiPanel::~GuiPanel() = default;
 
 void GuiPanel::SetColor(const glm::vec4& color) {
 	_color = color;
+	_MarkDirty();
 }
 
 const glm::vec4& GuiPanel::GetColor() const {
@@ -27,6 +28,7 @@ int GuiPanel::GetBorderRadius() const {
 
 void GuiPanel::SetBorderRadius(int value) {
 	_borderRadius = value;
+	_MarkDirty();
 }
 
 Texture2D::Sptr GuiPanel::GetTexture() const {
@@ -35,6 +37,9 @@ Texture2D::Sptr GuiPanel::GetTexture() const {
 
 void GuiPanel::SetTexture(const Texture2D::Sptr& value) {
 	_texture = value;
+	// Pack the texture into the GUI atlas so we can be drawn with everything else
+	GuiBatcher::AddToAtlas(_texture);
+	_MarkDirty();
 }
 
 void GuiPanel::Awake() {
@@ -43,6 +48,7 @@ void GuiPanel::Awake() {
 		IsEnabled = false;
 		LOG_WARN("Failed to find a rect transform for a GUI panel, disabling");
 	}
+	GuiBatcher::AddToAtlas(_texture);
 }
 
 void GuiPanel::StartGUI() {
@@ -57,8 +63,19 @@ void GuiPanel::FinishGUI() {
 
 void GuiPanel::RenderImGui()
 {
-	LABEL_LEFT(ImGui::ColorEdit4, "Color ", &_color.x);
-	LABEL_LEFT(ImGui::DragInt,    "Radius", &_borderRadius, 1, 0, 128);
+	bool changed = false;
+	changed |= LABEL_LEFT(ImGui::ColorEdit4, "Color ", &_color.x);
+	changed |= LABEL_LEFT(ImGui::DragInt,    "Radius", &_borderRadius, 1, 0, 128);
+	if (changed) {
+		_MarkDirty();
+	}
+}
+
+void GuiPanel::_MarkDirty() {
+	// Our geometry is cached by our rect transform, we can't do anything until we've found it in Awake
+	if (_transform != nullptr) {
+		_transform->MarkGeometryDirty();
+	}
 }
 
 nlohmann::json GuiPanel::ToJson() const {
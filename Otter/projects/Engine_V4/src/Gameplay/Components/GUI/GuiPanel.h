@@ -59,4 +59,6 @@ protected:
 	glm::vec4       _color;
 
 	RectTransform::Sptr _transform;
+
+	void _MarkDirty();
 };
\ No newline at end of file
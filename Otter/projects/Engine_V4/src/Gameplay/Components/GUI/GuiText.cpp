@@ -1,26 +1,26 @@
 #include "Gameplay/Components/GUI/GuiText.h"
-#include <locale>
-#include <codecvt>
 #include "Graphics/GuiBatcher.h"
 #include "Utils/ImGuiHelper.h"
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/StringUtils.h"
 #include "Gameplay/GameObject.h"
 
-std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> StringConvert;
-
 GuiText::GuiText() :
 	IComponent(),
 	_text(LR"()"), // The LR and parenthesis tell us it's a unicode string (wide string)
 	_color(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)),
 	_font(nullptr),
 	_textSize(glm::vec2(0.0f)),
-	_textScale(1.0f)
+	_textScale(1.0f),
+	_layout(TextLayout()),
+	_layoutDirty(true)
 { }
 
 GuiText::~GuiText() = default;
 
 void GuiText::SetColor(const glm::vec4& color) {
 	_color = color;
+	_MarkDirty();
 }
 
 const glm::vec4& GuiText::GetColor() const {
@@ -28,11 +28,11 @@ const glm::vec4& GuiText::GetColor() const {
 }
 
 std::string GuiText::GetText() const {
-	return StringConvert.to_bytes(_text);
+	return StringTools::ToUtf8(_text);
 }
 
 void GuiText::SetText(const std::string& value) {
-	SetTextUnicode(StringConvert.from_bytes(value));
+	SetTextUnicode(StringTools::ToUnicode(value));
 }
 
 const std::wstring& GuiText::GetTextUnicode() const {
@@ -40,11 +40,12 @@ const std::wstring& GuiText::GetTextUnicode() const {
 }
 
 void GuiText::SetTextUnicode(const std::wstring& value) {
-	_text = value;
-	
-	if (_font != nullptr) {
-		_textSize = _font->MeausureString(_text, _textScale);
+	// Text is often set every frame, so avoid rebuilding if nothing changed
+	if (value == _text) {
+		return;
 	}
+	_text = value;
+	_MarkLayoutDirty();
 }
 
 const float GuiText::GetTextScale() const {
@@ -53,6 +54,7 @@ const float GuiText::GetTextScale() const {
 
 void GuiText::SetTextScale(float value) {
 	_textScale = value;
+	_MarkLayoutDirty();
 }
 
 const Font::Sptr& GuiText::GetFont() const {
@@ -62,8 +64,10 @@ const Font::Sptr& GuiText::GetFont() const {
 void GuiText::SetFont(const Font::Sptr& font) {
 	_font = font;
 	if (_font != nullptr) {
-		_textSize = _font->MeausureString(_text, _textScale);
+		// Pack the font's glyphs into the GUI atlas so we can be drawn with everything else
+		GuiBatcher::AddToAtlas(_font->GetAtlas());
 	}
+	_MarkLayoutDirty();
 }
 
 void GuiText::Awake() {
@@ -72,34 +76,65 @@ void GuiText::Awake() {
 		IsEnabled = false;
 		LOG_WARN("Failed to find a rect transform for a GUI panel, disabling");
 	}
+	if (_font != nullptr) {
+		GuiBatcher::AddToAtlas(_font->GetAtlas());
+	}
 }
 
 void GuiText::RenderGUI()
 {
 	if (_font != nullptr && !_text.empty()) {
+		// If our geometry is cached there's no need to touch the layout
+		if (!GuiBatcher::IsReplayingCache()) {
+			// Glyphs we were using may have been evicted from the font's glyph cache
+			if (_layout.Generation != _font->GetGlyphGeneration()) {
+				_layoutDirty = true;
+			}
+			_UpdateLayout();
+		}
 		glm::vec2 position = _transform->GetSize() / 2.0f;
 		position -= _textSize / 2.0f;
-		GuiBatcher::RenderText(_text, _font, position, _color, _textScale);
+		GuiBatcher::RenderText(_layout, _font, position, _color);
 	}
 }
 
 void GuiText::RenderImGui()
 {
 	static char buffer[4096];
-	std::string ascii = StringConvert.to_bytes(_text);
-	memcpy(buffer, ascii.data(), ascii.size());
+	std::string ascii = StringTools::ToUtf8(_text);
+	size_t length = glm::min(ascii.size(), sizeof(buffer) - 1);
+	memcpy(buffer, ascii.data(), length);
+	buffer[length] = '\0';
 
 	if (LABEL_LEFT(ImGui::InputTextMultiline, "Text", buffer, 4096)) {
-		_text = StringConvert.from_bytes(buffer);
-		if (_font != nullptr) {
-			_textSize = _font->MeausureString(_text, _textScale);
-		}
+		_text = StringTools::ToUnicode(buffer);
+		_MarkLayoutDirty();
+	}
+	if (LABEL_LEFT(ImGui::ColorEdit4, "Color", &_color.x)) {
+		_MarkDirty();
 	}
-	LABEL_LEFT(ImGui::ColorEdit4, "Color", &_color.x);
 	if (LABEL_LEFT(ImGui::DragFloat, "Scale", &_textScale, 0.01f)) {
-		if (_font != nullptr) {
-			_textSize = _font->MeausureString(_text, _textScale);
-		}
+		_MarkLayoutDirty();
+	}
+}
+
+void GuiText::_MarkDirty() {
+	// Our geometry is cached by our rect transform, we can't do anything until we've found it in Awake
+	if (_transform != nullptr) {
+		_transform->MarkGeometryDirty();
+	}
+}
+
+void GuiText::_MarkLayoutDirty() {
+	_layoutDirty = true;
+	_MarkDirty();
+}
+
+void GuiText::_UpdateLayout() {
+	if (_layoutDirty && _font != nullptr) {
+		_font->LayoutText(_text, _textScale, _layout);
+		_textSize = _layout.Size;
+		_layoutDirty = false;
 	}
 }
 
@@ -81,5 +81,14 @@ protected:
 	glm::vec2       _textSize;
 	float           _textScale;
 
+	// The glyph positions for our text, only rebuilt when the text, font or scale change
+	TextLayout      _layout;
+	bool            _layoutDirty;
+
 	RectTransform::Sptr _transform;
+
+	void _MarkDirty();
+	// Flags the layout to be rebuilt before the next time we render, and marks our geometry dirty
+	void _MarkLayoutDirty();
+	void _UpdateLayout();
 };
\ No newline at end of file
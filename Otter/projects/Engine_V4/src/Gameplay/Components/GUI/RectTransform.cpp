@@ -36,6 +36,7 @@ void RectTransform::SetMin(const glm::vec2& value)
 	_halfSize = newSize / 2.0f;
 	_position = value + _halfSize;
 	_transformDirty = true;
+	MarkGeometryDirty();
 }
 
 glm::vec2 RectTransform::GetMax() const {
@@ -46,17 +47,21 @@ void RectTransform::SetMax(const glm::vec2& value) {
 	_halfSize = newSize / 2.0f;
 	_position = value - _halfSize;
 	_transformDirty = true;
+	MarkGeometryDirty();
 }
 
 glm::vec2 RectTransform::GetSize() const {
 	return _halfSize * 2.0f;
 }
 void RectTransform::SetSize(const glm::vec2& value) {
-	_halfSize = value * 2.0f;
+	_halfSize = value / 2.0f;
+	_transformDirty = true;
+	MarkGeometryDirty();
 }
 
 void RectTransform::SetRotationDeg(float value) {
 	_rotation = glm::radians(value);
+	_transformDirty = true;
 }
 
 float RectTransform::GetRotationDeg() const {
@@ -68,6 +73,10 @@ const glm::mat3& RectTransform::GetLocalTransform() const {
 	return _transform;
 }
 
+void RectTransform::MarkGeometryDirty() {
+	_geometry.Dirty = true;
+}
+
 void RectTransform::RenderImGui()
 {
 	_transformDirty |= LABEL_LEFT(ImGui::DragFloat2, "Position", &_position.x, 0.01f);
@@ -101,10 +110,13 @@ nlohmann::json RectTransform::ToJson() const {
 void RectTransform::StartGUI() {
 	//GuiBatcher::PushScissorRect(_position - _halfSize, _position + _halfSize);
 	GuiBatcher::PushModelTransform(GetLocalTransform());
+	// Anything drawn by this object goes into our cache, and only gets rebuilt when it changes
+	GuiBatcher::BeginCache(_geometry);
 }
 
 void RectTransform::FinishGUI()
 {
+	GuiBatcher::EndCache();
 	GuiBatcher::PopModelTransform();
 	//GuiBatcher::PopScissorRect();
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "Gameplay/Components/IComponent.h"
+#include "Graphics/GuiBatcher.h"
 
 /// <summary>
 /// A rect transform is used by 2D GUI components for positioning within
@@ -67,6 +68,12 @@ public:
 	/// </summary>
 	const glm::mat3& GetLocalTransform() const;
 
+	/// <summary>
+	/// Forces the GUI geometry for this object to be rebuilt the next time it is drawn.
+	/// GUI components should call this whenever something they draw has changed
+	/// </summary>
+	void MarkGeometryDirty();
+
 public:
 	// Inherited from IComponent
 
@@ -86,5 +93,8 @@ protected:
 	mutable glm::mat3 _transform;
 	mutable bool _transformDirty;
 
+	// The geometry drawn by the components on this object, children have their own caches
+	GuiBatcher::GeometryCache _geometry;
+
 	void __RecalcTransforms() const;
 };
\ No newline at end of file
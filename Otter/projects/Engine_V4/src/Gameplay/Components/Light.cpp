@@ -9,7 +9,8 @@ Light::Light() :
 	_params(glm::vec3(0.0f)),
 	_radius(1.0f),
 	_intensity(10.0f),
-	_type(LightType::Point)
+	_type(LightType::Point),
+	_baked(false)
 {
 
 }
@@ -64,6 +65,14 @@ void Light::SetType(LightType value) {
 	_type = value;
 }
 
+bool Light::IsBaked() const {
+	return _baked;
+}
+
+void Light::SetBaked(bool value) {
+	_baked = value;
+}
+
 /// <summary>
 /// Loads a light from a JSON blob
 /// </summary>
@@ -75,6 +84,7 @@ Light::Sptr Light::FromJson(const nlohmann::json& data) {
 	result->_params = JsonGet(data, "params", result->_params);
 	result->_intensity = JsonGet(data, "intensity", result->_intensity);
 	result->_type = JsonParseEnum(LightType, data, "type", LightType::Point);
+	result->_baked = JsonGet(data, "baked", result->_baked);
 	return result;
 }
 
@@ -88,7 +98,8 @@ inline nlohmann::json Light::ToJson() const {
 		{ "direction", _direction },
 		{ "params", _params },
 		{ "type", ~_type },
-		{ "intensity", _intensity }
+		{ "intensity", _intensity },
+		{ "baked", _baked }
 	};
 }
 
@@ -101,5 +112,6 @@ void Light::RenderImGui()
 	LABEL_LEFT(ImGui::DragFloat3,   "   Params", &_params.x, 0.01f);
 
 	ENUM_COMBO("     Type", &_type, LightType);
+	LABEL_LEFT(ImGui::Checkbox,     "    Baked", &_baked);
 
 }
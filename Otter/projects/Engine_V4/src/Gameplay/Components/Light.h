@@ -40,6 +40,13 @@ public:
 	LightType GetType() const;
 	void SetType(LightType value);
 
+	/// <summary>
+	/// Baked lights are included when baking lightmaps, and are skipped at runtime for any pixel that
+	/// already has a lightmap, see Gameplay::Lightmapper
+	/// </summary>
+	bool IsBaked() const;
+	void SetBaked(bool value);
+
 public:
 	virtual void RenderImGui() override;
 	MAKE_TYPENAME(Light);
@@ -53,4 +60,5 @@ protected:
 	glm::vec3 _params;
 	float     _radius;
 	float     _intensity;
+	bool      _baked;
 };
\ No newline at end of file
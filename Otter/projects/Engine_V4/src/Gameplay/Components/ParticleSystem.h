@@ -1,12 +1,19 @@
 #pragma once
+#include <EnumToString.h>
 #include "Gameplay/Components/IComponent.h"
-#include "Graphics/ShaderProgram.h"
+#include "Graphics/IParticlePool.h"
 
 ENUM(ParticleType, uint32_t,
 	Emitter       = 0,
 	Particle      = 1
 );
 
+/// <summary>
+/// A set of particle emitters attached to a game object. Particles aren't owned by the system, every
+/// update the emitters queue up the particles they spawn in the engine-wide particle pool (see ParticleLayer),
+/// which simulates and draws the particles for every system at once. This means emitters can be added,
+/// edited or removed at any time, and any particles that were already spawned will live out their lives
+/// </summary>
 class ParticleSystem : public Gameplay::IComponent{
 public:
 	MAKE_PTRS(ParticleSystem);
@@ -14,46 +21,44 @@ public:
 	ParticleSystem();
 	~ParticleSystem();
 
-	void Update();
-	void Render();
+	/// <summary>
+	/// Advances the emitters, and queues any particles they spawn in the pool
+	/// </summary>
+	/// <param name="pool">The pool to spawn particles into</param>
+	/// <param name="deltaTime">The time since the last update, in seconds</param>
+	void Update(IParticlePool& pool, float deltaTime);
 
 	void AddEmitter(const glm::vec3& position, const glm::vec3& direction, float emitRate = 1.0f, const glm::vec4& color = glm::vec4(1.0f));
+	void RemoveEmitter(int index);
+	int GetEmitterCount() const;
+
+	/// <summary>
+	/// Gets the number of particles that this system reserves room for in the particle pool
+	/// </summary>
+	uint32_t GetMaxParticles() const;
 
 	// Inherited from IComponent
 
 	virtual void RenderImGui() override;
-	virtual void Awake() override;
 	virtual nlohmann::json ToJson() const override;
 	static ParticleSystem::Sptr FromJson(const nlohmann::json& blob);
 	MAKE_TYPENAME(ParticleSystem);
 
 protected:
-	struct ParticleData {
-		ParticleType Type;     // uint32_t, 0 for emitters, 1 for particles
-		glm::vec3    Position;
-		glm::vec3    Velocity; // For emitters, this is initial velocity
-		glm::vec4    Color;
-		float        Lifetime; // For emitters, this is the time to next particle spawn
-
-		// For emitters, x is time to next particle, y is max deviation from direction in radians, z-w is lifetime range
-		glm::vec4    Metadata;
-	};
-
-	bool _hasInit;
+	struct EmitterData {
+		glm::vec3 Position; // Local to the game object
+		glm::vec3 Velocity; // Initial velocity, local to the game object
+		glm::vec4 Color;
+		float     SpawnRate;  // Particles per second
+		float     ConeAngle;  // Max deviation from velocity in radians
+		glm::vec2 LifetimeRange;
 
-	uint32_t _maxParticles;
-	GLuint _numParticles;
-
-	uint32_t _particleBuffers[2];
-	uint32_t _feedbackBuffers[2];
-	uint32_t _query;
-
-	uint32_t _currentVertexBuffer;
-	uint32_t _currentFeedbackBuffer;
+		// The fraction of a particle that we still owe from previous updates
+		float     SpawnRemainder;
+	};
 
-	ShaderProgram::Sptr _updateShader;
-	ShaderProgram::Sptr _renderShader;
-	glm::vec3           _gravity;
+	uint32_t  _maxParticles;
+	glm::vec3 _gravity;
 
-	std::vector<ParticleData> _emitters;
-};
\ No newline at end of file
+	std::vector<EmitterData> _emitters;
+};
@@ -0,0 +1,249 @@
+#include "ReflectionProbe.h"
+#include "Gameplay/GameObject.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/ImGuiHelper.h"
+#include "GLM/gtc/matrix_transform.hpp"
+
+// The direction and up vector for each face of a cubemap, in the order of CubeMapFace. These follow
+// OpenGL's cubemap conventions, so a regular perspective projection renders the face the right way up
+static const glm::vec3 FACE_FORWARD[6] = {
+	{  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f },
+	{  0.0f,  1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f },
+	{  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f }
+};
+static const glm::vec3 FACE_UP[6] = {
+	{  0.0f, -1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f },
+	{  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f },
+	{  0.0f, -1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f }
+};
+
+ReflectionProbe::ReflectionProbe() :
+	IComponent(),
+	Radius(10.0f),
+	NearPlane(0.1f),
+	FarPlane(100.0f),
+	_resolution(128),
+	_captureCube(nullptr),
+	_outputCube(nullptr),
+	_prefilterCube(nullptr),
+	_depthBuffer(nullptr),
+	_framebuffer(0),
+	_nextFace(0),
+	_readbackBuffer(0),
+	_readbackFence(nullptr),
+	_readbackSize(0),
+	_ambient(),
+	_hasAmbient(false)
+{ }
+
+ReflectionProbe::~ReflectionProbe() {
+	if (_framebuffer != 0) {
+		glDeleteFramebuffers(1, &_framebuffer);
+		_framebuffer = 0;
+	}
+	if (_readbackFence != nullptr) {
+		glDeleteSync(_readbackFence);
+		_readbackFence = nullptr;
+	}
+	if (_readbackBuffer != 0) {
+		glDeleteBuffers(1, &_readbackBuffer);
+		_readbackBuffer = 0;
+	}
+}
+
+void ReflectionProbe::SetResolution(uint32_t value) {
+	LOG_ASSERT(value > 0, "Probe resolution must be > 0");
+	if (value != _resolution) {
+		_resolution = value;
+		if (_framebuffer != 0) {
+			_Allocate();
+		}
+	}
+}
+
+uint32_t ReflectionProbe::GetResolution() const {
+	return _resolution;
+}
+
+const TextureCube::Sptr& ReflectionProbe::GetCubemap() const {
+	return _outputCube;
+}
+
+int ReflectionProbe::GetNextFace() const {
+	return _nextFace;
+}
+
+glm::mat4 ReflectionProbe::GetFaceView(int face, const glm::mat3& environmentRotation) const {
+	// Shaders rotate directions by the skybox rotation before sampling, so we rotate our faces the opposite
+	// way to line them up with it
+	glm::mat3 toWorld = glm::transpose(environmentRotation);
+	glm::vec3 position = GetGameObject()->GetWorldPosition();
+	return glm::lookAt(position, position + toWorld * FACE_FORWARD[face], toWorld * FACE_UP[face]);
+}
+
+glm::mat4 ReflectionProbe::GetProjection() const {
+	return glm::perspective(glm::radians(90.0f), 1.0f, NearPlane, FarPlane);
+}
+
+void ReflectionProbe::BeginFace() {
+	glNamedFramebufferTextureLayer(_framebuffer, GL_COLOR_ATTACHMENT0, _captureCube->GetHandle(), 0, _nextFace);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	glViewport(0, 0, _resolution, _resolution);
+}
+
+bool ReflectionProbe::EndFace() {
+	_nextFace = (_nextFace + 1) % 6;
+	if (_nextFace == 0) {
+		// The prefilter samples the lower mips of the capture to reduce aliasing in the rough reflections
+		glGenerateTextureMipmap(_captureCube->GetHandle());
+		return true;
+	}
+	return false;
+}
+
+const TextureCube::Sptr& ReflectionProbe::GetCaptureCubemap() const {
+	return _captureCube;
+}
+
+const TextureCube::Sptr& ReflectionProbe::GetPrefilterTarget() const {
+	return _prefilterCube;
+}
+
+void ReflectionProbe::BindPrefilterTarget(int face, int mip) {
+	glNamedFramebufferTextureLayer(_framebuffer, GL_COLOR_ATTACHMENT0, _prefilterCube->GetHandle(), mip, face);
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	int size = glm::max(static_cast<int>(_resolution) >> mip, 1);
+	glViewport(0, 0, size, size);
+}
+
+void ReflectionProbe::PublishPrefilterTarget() {
+	// Swap the finished prefilter in, and re-use the old output for the next capture
+	std::swap(_outputCube, _prefilterCube);
+	if (_prefilterCube == nullptr) {
+		_prefilterCube = _CreateCube(false);
+	}
+
+	// Queue up a copy of a small mip of the capture for our ambient lighting. If the previous copy hasn't
+	// been read yet we just replace it, since this one is newer anyways
+	if (_readbackFence != nullptr) {
+		glDeleteSync(_readbackFence);
+	}
+	uint32_t mip = _GetReadbackMip();
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _readbackBuffer);
+	glGetTextureImage(_captureCube->GetHandle(), mip, GL_RGBA, GL_UNSIGNED_BYTE, _readbackSize * _readbackSize * 4 * 6, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void ReflectionProbe::PollAmbient() {
+	if (_readbackFence == nullptr) {
+		return;
+	}
+
+	// A timeout of 0 just checks the fence without waiting on it
+	GLenum status = glClientWaitSync(_readbackFence, 0, 0);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+		glDeleteSync(_readbackFence);
+		_readbackFence = nullptr;
+
+		std::vector<uint8_t> pixels((size_t)_readbackSize * _readbackSize * 4 * 6);
+		glGetNamedBufferSubData(_readbackBuffer, 0, pixels.size(), pixels.data());
+		_ambient = SphericalHarmonics::ProjectCubemap(pixels.data(), _readbackSize, 4);
+		_hasAmbient = true;
+	}
+}
+
+bool ReflectionProbe::HasAmbient() const {
+	return _hasAmbient;
+}
+
+const SphericalHarmonics& ReflectionProbe::GetAmbient() const {
+	return _ambient;
+}
+
+uint32_t ReflectionProbe::_GetReadbackMip() const {
+	// The harmonics are very low frequency, so we only need a handful of texels per face
+	uint32_t mip = 0;
+	while ((_resolution >> mip) > 16) {
+		mip++;
+	}
+	return mip;
+}
+
+void ReflectionProbe::OnLoad() {
+	_Allocate();
+}
+
+void ReflectionProbe::_Allocate() {
+	if (_framebuffer == 0) {
+		glCreateFramebuffers(1, &_framebuffer);
+		glNamedFramebufferDrawBuffer(_framebuffer, GL_COLOR_ATTACHMENT0);
+	}
+
+	_captureCube = _CreateCube(true);
+	_prefilterCube = _CreateCube(false);
+	_outputCube = nullptr;
+	_nextFace = 0;
+
+	// Any copy that's in flight is for the old size, so we throw it away
+	if (_readbackFence != nullptr) {
+		glDeleteSync(_readbackFence);
+		_readbackFence = nullptr;
+	}
+	if (_readbackBuffer == 0) {
+		glCreateBuffers(1, &_readbackBuffer);
+	}
+	_readbackSize = glm::max(_resolution >> _GetReadbackMip(), 1u);
+	glNamedBufferData(_readbackBuffer, (size_t)_readbackSize * _readbackSize * 4 * 6, nullptr, GL_STREAM_READ);
+
+	// The depth buffer is only used while rendering a face, so one is enough for all of them
+	RenderbufferDescription depthDesc;
+	depthDesc.Width = _resolution;
+	depthDesc.Height = _resolution;
+	depthDesc.Format = RenderTargetType::Depth32;
+	_depthBuffer = std::make_shared<Renderbuffer>(depthDesc);
+	glNamedFramebufferRenderbuffer(_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer->GetHandle());
+}
+
+TextureCube::Sptr ReflectionProbe::_CreateCube(bool isCapture) const {
+	TextureCubeDescription desc;
+	desc.Size = _resolution;
+	desc.Format = InternalFormat::RGBA8;
+	desc.GenerateMipMaps = true;
+	desc.MinificationFilter = MinFilter::LinearMipLinear;
+	desc.MagnificationFilter = MagFilter::Linear;
+	TextureCube::Sptr result = std::make_shared<TextureCube>(desc);
+	result->SetDebugName(GetGameObject()->Name + (isCapture ? " Probe Capture" : " Probe"));
+	return result;
+}
+
+void ReflectionProbe::RenderImGui() {
+	LABEL_LEFT(ImGui::DragFloat, "Radius", &Radius, 0.1f, 0.0f, 1000.0f);
+	LABEL_LEFT(ImGui::DragFloat, "Near Plane", &NearPlane, 0.01f, 0.01f, FarPlane);
+	LABEL_LEFT(ImGui::DragFloat, "Far Plane", &FarPlane, 0.1f, NearPlane, 1000.0f);
+
+	int resolution = _resolution;
+	if (LABEL_LEFT(ImGui::SliderInt, "Resolution", &resolution, 16, 512)) {
+		SetResolution(resolution);
+	}
+	ImGui::Text("Next Face: %s", (~(CubeMapFace)_nextFace).c_str());
+	ImGui::Text("Ready: %s", _outputCube != nullptr ? "Yes" : "No");
+}
+
+nlohmann::json ReflectionProbe::ToJson() const {
+	return {
+		{ "radius", Radius },
+		{ "near_plane", NearPlane },
+		{ "far_plane", FarPlane },
+		{ "resolution", _resolution }
+	};
+}
+
+ReflectionProbe::Sptr ReflectionProbe::FromJson(const nlohmann::json& data) {
+	ReflectionProbe::Sptr result = std::make_shared<ReflectionProbe>();
+	result->Radius = JsonGet(data, "radius", result->Radius);
+	result->NearPlane = JsonGet(data, "near_plane", result->NearPlane);
+	result->FarPlane = JsonGet(data, "far_plane", result->FarPlane);
+	result->_resolution = glm::max(JsonGet(data, "resolution", result->_resolution), 1u);
+	return result;
+}
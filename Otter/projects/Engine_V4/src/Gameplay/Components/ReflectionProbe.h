@@ -0,0 +1,147 @@
+#pragma once
+#include "Gameplay/Components/IComponent.h"
+#include "Graphics/Textures/TextureCube.h"
+#include "Graphics/Renderbuffer.h"
+#include "Utils/SphericalHarmonics.h"
+
+/**
+ * A reflection probe captures the scene around it into a cubemap, which nearby objects will sample
+ * instead of the skybox, giving them reflections of the level around them.
+ *
+ * Probes are captured a single face at a time (see RenderLayer), so the cost of keeping them updated is
+ * fixed no matter how many probes there are. Faces are rendered into a capture cubemap, and once all
+ * six are done the capture is prefiltered into the cubemap that objects sample. This means that objects
+ * never see a half updated probe, and that the mips of the output hold increasingly rough reflections.
+ *
+ * Probes are captured in the same space as the skybox (ie. with the skybox rotation applied), so that shaders
+ * can sample them exactly like they sample the skybox
+ *
+ * Each finished capture is also projected into spherical harmonics for diffuse ambient lighting. A small mip
+ * of the capture is copied into a buffer when it's published, and read back a few frames later once
+ * the GPU is done with it, so we never stall waiting on the copy
+ */
+class ReflectionProbe final : public Gameplay::IComponent {
+public:
+	MAKE_PTRS(ReflectionProbe);
+
+	/// <summary>
+	/// Objects whose origin is within this distance of the probe will sample it
+	/// </summary>
+	float Radius;
+	/// <summary>
+	/// The near and far clip planes used when capturing the probe
+	/// </summary>
+	float NearPlane;
+	float FarPlane;
+
+	ReflectionProbe();
+	virtual ~ReflectionProbe();
+
+	/// <summary>
+	/// Sets the size of each face of the probe's cubemaps in pixels, will re-allocate the probe
+	/// and restart it's capture
+	/// </summary>
+	void SetResolution(uint32_t value);
+	/// <summary>
+	/// Gets the size of each face of the probe's cubemaps in pixels
+	/// </summary>
+	uint32_t GetResolution() const;
+
+	/// <summary>
+	/// Gets the prefiltered cubemap that objects should sample, mip 0 is a perfect mirror and each mip after
+	/// is rougher than the last. Will be nullptr until the first capture has finished
+	/// </summary>
+	const TextureCube::Sptr& GetCubemap() const;
+
+	/// <summary>
+	/// Gets the index of the face (see CubeMapFace) that will be rendered next
+	/// </summary>
+	int GetNextFace() const;
+	/// <summary>
+	/// Gets the view matrix for rendering one of the probe's faces
+	/// </summary>
+	/// <param name="face">The index of the face to render, see CubeMapFace</param>
+	/// <param name="environmentRotation">The rotation of the skybox, faces are captured in the same space as it</param>
+	glm::mat4 GetFaceView(int face, const glm::mat3& environmentRotation) const;
+	/// <summary>
+	/// Gets the projection matrix for rendering the probe's faces
+	/// </summary>
+	glm::mat4 GetProjection() const;
+
+	/// <summary>
+	/// Binds the framebuffer for rendering the next face into the capture cubemap, and sets the viewport
+	/// </summary>
+	void BeginFace();
+	/// <summary>
+	/// Moves on to the next face, returns true if that completed the capture and it is ready to be prefiltered
+	/// </summary>
+	bool EndFace();
+
+	/// <summary>
+	/// Gets the cubemap that faces are rendered into, with mips generated once the capture is complete.
+	/// This is the source for prefiltering
+	/// </summary>
+	const TextureCube::Sptr& GetCaptureCubemap() const;
+	/// <summary>
+	/// Gets the cubemap that the prefilter should render into, this becomes the probe's cubemap once
+	/// the prefilter is done
+	/// </summary>
+	const TextureCube::Sptr& GetPrefilterTarget() const;
+	/// <summary>
+	/// Binds the framebuffer for rendering a face and mip level of the prefilter target, and sets the viewport
+	/// </summary>
+	void BindPrefilterTarget(int face, int mip);
+	/// <summary>
+	/// Marks the prefilter target as complete, letting objects sample it
+	/// </summary>
+	void PublishPrefilterTarget();
+
+	/// <summary>
+	/// Checks if the GPU has finished copying the last capture for us, and if so projects it into
+	/// spherical harmonics. Should be called once per frame
+	/// </summary>
+	void PollAmbient();
+	/// <summary>
+	/// Returns true once at least one capture has been projected into spherical harmonics
+	/// </summary>
+	bool HasAmbient() const;
+	/// <summary>
+	/// Gets the diffuse lighting around the probe, see HasAmbient
+	/// </summary>
+	const SphericalHarmonics& GetAmbient() const;
+
+	// Inherited from IComponent
+
+	virtual void OnLoad() override;
+	virtual void RenderImGui() override;
+	virtual nlohmann::json ToJson() const override;
+	static ReflectionProbe::Sptr FromJson(const nlohmann::json& data);
+	MAKE_TYPENAME(ReflectionProbe);
+
+protected:
+	uint32_t          _resolution;
+
+	// The cubemap we render faces into over several frames
+	TextureCube::Sptr _captureCube;
+	// The prefiltered cubemap that objects sample, and the one we're building for the next capture
+	TextureCube::Sptr _outputCube;
+	TextureCube::Sptr _prefilterCube;
+	// Depth buffer that's shared between all the faces
+	Renderbuffer::Sptr _depthBuffer;
+	// Our framebuffer, we re-attach faces of the cubemaps to it as we go
+	uint32_t          _framebuffer;
+
+	int               _nextFace;
+
+	// A buffer that small mip of the capture is copied into for our ambient lighting, and the
+	// fence that tells us when the copy is done
+	uint32_t          _readbackBuffer;
+	GLsync            _readbackFence;
+	uint32_t          _readbackSize;
+	SphericalHarmonics _ambient;
+	bool              _hasAmbient;
+
+	void _Allocate();
+	TextureCube::Sptr _CreateCube(bool isCapture) const;
+	uint32_t _GetReadbackMip() const;
+};
@@ -2,22 +2,40 @@
 
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Gameplay/GameObject.h"
+
+// How far past a LOD threshold an object needs to go before we switch levels, as a fraction of the threshold
+const float LOD_HYSTERESIS = 0.1f;
 
 
 RenderComponent::RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material) :
+	IsOccluder(false),
+	IsStatic(false),
+	LightmapResolution(128),
 	_mesh(mesh), 
 	_material(material), 
-	_meshBuilderParams(std::vector<MeshBuilderParam>()) 
+	_lightmap(nullptr),
+	_meshBuilderParams(std::vector<MeshBuilderParam>()),
+	_currentLod(0),
+	_screenSize(0.0f)
 { }
 
 RenderComponent::RenderComponent() : 
+	IsOccluder(false),
+	IsStatic(false),
+	LightmapResolution(128),
 	_mesh(nullptr), 
 	_material(nullptr), 
-	_meshBuilderParams(std::vector<MeshBuilderParam>())
+	_lightmap(nullptr),
+	_meshBuilderParams(std::vector<MeshBuilderParam>()),
+	_currentLod(0),
+	_screenSize(0.0f)
 { }
 
 RenderComponent* RenderComponent::SetMesh(const Gameplay::MeshResource::Sptr& mesh) {
 	_mesh = mesh;
+	_currentLod = 0;
 	return this;
 }
 
@@ -29,6 +47,51 @@ VertexArrayObject::Sptr RenderComponent::GetMesh() const {
 	return _mesh ? _mesh->Mesh : nullptr;
 }
 
+VertexArrayObject::Sptr RenderComponent::GetMesh(int lod) const {
+	return _mesh ? _mesh->GetLod(lod) : nullptr;
+}
+
+int RenderComponent::UpdateLod(const glm::mat4& view, const glm::mat4& projection) {
+	// Nothing to pick from if we only have one level
+	if (_mesh == nullptr || _mesh->GetLodCount() <= 1) {
+		_currentLod = 0;
+		return _currentLod;
+	}
+
+	const Gameplay::MeshResource::CpuMeshData::Sptr& data = _mesh->GetCpuData();
+	if (data == nullptr) {
+		_currentLod = 0;
+		return _currentLod;
+	}
+
+	// Get a world space bounding sphere for the mesh, using the largest axis scale so that we're conservative
+	const glm::mat4& transform = GetGameObject()->GetTransform();
+	glm::vec3 center = transform * glm::vec4((data->BoundsMin + data->BoundsMax) * 0.5f, 1.0f);
+	float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+	float radius = glm::length(data->BoundsMax - data->BoundsMin) * 0.5f * scale;
+
+	// Project the sphere to get what fraction of the screen's height it covers, for orthographic
+	// projections w is always 1 so this just becomes the size relative to the view volume
+	glm::vec4 clipCenter = projection * view * glm::vec4(center, 1.0f);
+	_screenSize = radius * glm::abs(projection[1][1]) / glm::max(clipCenter.w, 0.0001f);
+
+	// Step towards coarser or finer levels, requiring that we pass the threshold by a margin to switch
+	int levels = _mesh->GetLodCount();
+	_currentLod = glm::clamp(_currentLod, 0, levels - 1);
+	while (_currentLod + 1 < levels && _screenSize < Gameplay::MeshResource::LOD_SCREEN_SIZES[_currentLod + 1] * (1.0f - LOD_HYSTERESIS)) {
+		_currentLod++;
+	}
+	while (_currentLod > 0 && _screenSize > Gameplay::MeshResource::LOD_SCREEN_SIZES[_currentLod] * (1.0f + LOD_HYSTERESIS)) {
+		_currentLod--;
+	}
+
+	return _currentLod;
+}
+
+int RenderComponent::GetCurrentLod() const {
+	return _currentLod;
+}
+
 RenderComponent* RenderComponent::SetMaterial(const Gameplay::Material::Sptr& mat) {
 	_material = mat;
 	return this;
@@ -38,10 +101,27 @@ const Gameplay::Material::Sptr& RenderComponent::GetMaterial() const {
 	return _material;
 }
 
+const Texture2D::Sptr& RenderComponent::GetLightmap() const {
+	return _lightmap;
+}
+
+RenderComponent* RenderComponent::SetLightmap(const Texture2D::Sptr& lightmap) {
+	_lightmap = lightmap;
+	// Lightmaps are sampled with the mesh's second set of UVs, which we only generate when they're needed
+	if (_lightmap != nullptr && _mesh != nullptr) {
+		_mesh->GenerateLightmapUvs();
+	}
+	return this;
+}
+
 nlohmann::json RenderComponent::ToJson() const {
 	nlohmann::json result;
 	result["mesh"] = _mesh ? _mesh->GetGUID().str() : "null";
 	result["material"] = _material ? _material->GetGUID().str() : "null";
+	result["occluder"] = IsOccluder;
+	result["static"] = IsStatic;
+	result["lightmap_resolution"] = LightmapResolution;
+	result["lightmap"] = _lightmap ? _lightmap->GetGUID().str() : "null";
 	return result;
 }
 
@@ -49,6 +129,10 @@ RenderComponent::Sptr RenderComponent::FromJson(const nlohmann::json& data) {
 	RenderComponent::Sptr result = std::make_shared<RenderComponent>();
 	result->_mesh = ResourceManager::Get<Gameplay::MeshResource>(Guid(data["mesh"].get<std::string>()));
 	result->_material = ResourceManager::Get<Gameplay::Material>(Guid(data["material"].get<std::string>()));
+	result->IsOccluder = JsonGet(data, "occluder", false);
+	result->IsStatic = JsonGet(data, "static", false);
+	result->LightmapResolution = JsonGet(data, "lightmap_resolution", result->LightmapResolution);
+	result->SetLightmap(ResourceManager::Get<Texture2D>(Guid(JsonGet<std::string>(data, "lightmap", "null"))));
 
 	return result;
 }
@@ -57,7 +141,18 @@ void RenderComponent::RenderImGui() {
 	ImGui::Text("Indexed:   %s", GetMesh() != nullptr ? (_mesh->Mesh->GetIndexBuffer() != nullptr ? "true" : "false") : "N/A");
 	ImGui::Text("Triangles: %d", GetMesh() != nullptr ? (_mesh->Mesh->GetElementCount() / 3) : 0);
 	ImGui::Text("Source:    %s", (_mesh == nullptr || _mesh->Filename.empty()) ? "Generated" : _mesh->Filename.c_str());
+	ImGui::Text("LOD:       %d / %d (%d triangles, %.3f screen)", _currentLod, _mesh != nullptr ? _mesh->GetLodCount() : 0, GetMesh(_currentLod) != nullptr ? (GetMesh(_currentLod)->GetElementCount() / 3) : 0, _screenSize);
 	ImGui::Separator();
 	ImGui::Text("Material:  %s", _material != nullptr ? _material->Name.c_str() : "NULL");
 	ImGuiHelper::ResourceDragTarget<Gameplay::Material>(_material);
+	ImGui::Separator();
+	LABEL_LEFT(ImGui::Checkbox, "Occluder", &IsOccluder);
+	LABEL_LEFT(ImGui::Checkbox, "Static", &IsStatic);
+	if (IsStatic) {
+		int resolution = static_cast<int>(LightmapResolution);
+		if (LABEL_LEFT(ImGui::DragInt, "Lightmap Res", &resolution, 1.0f, LightmapBaker::MIN_RESOLUTION, 2048)) {
+			LightmapResolution = static_cast<uint32_t>(resolution);
+		}
+		ImGui::Text("Lightmap:  %s", _lightmap != nullptr ? "Baked" : "None");
+	}
 }
@@ -2,6 +2,7 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/MeshResource.h"
 #include "Gameplay/Material.h"
+#include "Graphics/Textures/Texture2D.h"
 #include "Utils/MeshFactory.h"
 
 /// <summary>
@@ -13,6 +14,20 @@ class RenderComponent : public Gameplay::IComponent {
 public:
 	typedef std::shared_ptr<RenderComponent> Sptr;
 
+	/// <summary>
+	/// True if this object should be rasterized into the occlusion culler's depth buffers,
+	/// hiding objects behind it. Should only be set on large, low-poly objects like walls and terrain
+	/// </summary>
+	bool IsOccluder;
+	/// <summary>
+	/// True if this object never moves, static objects can have their lighting baked into a lightmap, see Gameplay::Lightmapper
+	/// </summary>
+	bool IsStatic;
+	/// <summary>
+	/// The width and height of the lightmap to bake for this object, in texels
+	/// </summary>
+	uint32_t LightmapResolution;
+
 	RenderComponent();
 	RenderComponent(const Gameplay::MeshResource::Sptr& mesh, const Gameplay::Material::Sptr& material);
 
@@ -26,6 +41,23 @@ public:
 	/// </summary>
 	VertexArrayObject::Sptr GetMesh() const;
 	/// <summary>
+	/// Gets the VAO for the given level of detail of the underlying mesh resource, clamped to the levels that exist
+	/// </summary>
+	VertexArrayObject::Sptr GetMesh(int lod) const;
+
+	/// <summary>
+	/// Selects this object's level of detail based on how large it appears on screen for the
+	/// given camera. Uses hysteresis so objects near a threshold don't flicker between levels
+	/// </summary>
+	/// <param name="view">The view matrix of the camera</param>
+	/// <param name="projection">The projection matrix of the camera</param>
+	/// <returns>The level of detail that was selected</returns>
+	int UpdateLod(const glm::mat4& view, const glm::mat4& projection);
+	/// <summary>
+	/// Gets the level of detail that was selected by the last call to UpdateLod
+	/// </summary>
+	int GetCurrentLod() const;
+	/// <summary>
 	/// Gets the material that this renderer is using
 	/// </summary>
 	const Gameplay::Material::Sptr& GetMaterial() const;
@@ -42,6 +74,17 @@ public:
 	/// <param name="mat">The material for this object</param>
 	RenderComponent* SetMaterial(const Gameplay::Material::Sptr& mat);
 
+	/// <summary>
+	/// Gets the baked lighting for this object, or nullptr if it has not been baked
+	/// </summary>
+	const Texture2D::Sptr& GetLightmap() const;
+	/// <summary>
+	/// Sets the baked lighting for this object, this will unwrap our mesh's lightmap UVs if it hasn't been already.
+	/// Must be called from the thread that owns the OpenGL context
+	/// </summary>
+	/// <param name="lightmap">The RGBM encoded lightmap, see LightmapBaker::SaveLightmap</param>
+	RenderComponent* SetLightmap(const Texture2D::Sptr& lightmap);
+
 	// Inherited from IComponent
 
 	virtual void RenderImGui() override;
@@ -54,7 +97,13 @@ protected:
 	Gameplay::MeshResource::Sptr _mesh;
 	// The object's material
 	Gameplay::Material::Sptr      _material;
+	// The baked lighting for the object, if any
+	Texture2D::Sptr               _lightmap;
 
 	// If we want to use MeshFactory, we can populate this list
 	std::vector<MeshBuilderParam> _meshBuilderParams;
+
+	// The level of detail we selected last, and how big we were on screen at the time
+	int   _currentLod;
+	float _screenSize;
 };
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "Gameplay/Lightmapper.h"
+
+#include <chrono>
+#include <filesystem>
+
+#include "Gameplay/Scene.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/Light.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+#include "Logging.h"
+
+namespace Gameplay {
+	int Lightmapper::BakeScene(const Scene::Sptr& scene, const std::string& outputDir, const LightmapBaker::Settings& settings) {
+		if (scene == nullptr) {
+			return 0;
+		}
+		auto start = std::chrono::high_resolution_clock::now();
+
+		// Gather up our static objects, making sure their meshes have been unwrapped
+		std::vector<RenderComponent::Sptr> renderers;
+		std::vector<LightmapBaker::Instance> instances;
+		scene->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+			const MeshResource::Sptr& mesh = renderable->GetMeshResource();
+			if (!renderable->IsStatic || mesh == nullptr) {
+				return;
+			}
+			mesh->GenerateLightmapUvs();
+			const MeshResource::CpuMeshData::Sptr& data = mesh->GetCpuData();
+			if (data == nullptr || !mesh->HasLightmapUvs()) {
+				return;
+			}
+
+			LightmapBaker::Instance instance;
+			instance.Positions  = &data->Positions;
+			instance.Uvs        = &mesh->GetLightmapUvs();
+			instance.Transform  = renderable->GetGameObject()->GetTransform();
+			instance.Resolution = glm::max(renderable->LightmapResolution, LightmapBaker::MIN_RESOLUTION);
+			instances.push_back(instance);
+			renderers.push_back(renderable);
+		});
+
+		// Baked lights use the same attenuation as RenderLayer::_AccumulateLighting
+		std::vector<LightmapBaker::Light> lights;
+		scene->Components().Each<Light>([&](const Light::Sptr& light) {
+			if (!light->IsBaked()) {
+				return;
+			}
+			LightmapBaker::Light baked;
+			baked.Position    = light->GetGameObject()->GetWorldPosition();
+			baked.Color       = light->GetColor();
+			baked.Intensity   = light->GetIntensity();
+			baked.Attenuation = 1.0f / (1.0f + light->GetRadius());
+			lights.push_back(baked);
+		});
+
+		if (instances.empty()) {
+			LOG_WARN("No static objects to bake lightmaps for");
+			return 0;
+		}
+
+		std::vector<LightmapBaker::Lightmap> lightmaps = LightmapBaker::Bake(instances, lights, settings);
+
+		// Save and load each lightmap, they're RGBM encoded so we keep them linear and skip the mips
+		std::filesystem::create_directories(outputDir);
+		int baked = 0;
+		for (size_t ix = 0; ix < lightmaps.size(); ix++) {
+			GameObject* object = renderers[ix]->GetGameObject();
+			std::string path = outputDir + "/" + object->Name + "_" + object->GetGUID().str() + ".png";
+			if (!LightmapBaker::SaveLightmap(path, lightmaps[ix])) {
+				LOG_WARN("Failed to save lightmap \"{}\"", path);
+				continue;
+			}
+
+			Texture2DDescription desc;
+			desc.Filename = path;
+			desc.Format = InternalFormat::RGBA8;
+			desc.HorizontalWrap = WrapMode::ClampToEdge;
+			desc.VerticalWrap = WrapMode::ClampToEdge;
+			desc.MinificationFilter = MinFilter::Linear;
+			desc.GenerateMipMaps = false;
+			renderers[ix]->SetLightmap(ResourceManager::CreateAsset<Texture2D>(desc));
+			baked++;
+		}
+
+		float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+		LOG_INFO("Baked {} lightmaps from {} lights in {:.2f}s", baked, lights.size(), seconds);
+		return baked;
+	}
+}
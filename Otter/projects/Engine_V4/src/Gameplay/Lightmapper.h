@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <memory>
+#include "Utils/LightmapBaker.h"
+
+namespace Gameplay {
+	class Scene;
+
+	/// <summary>
+	/// Bakes lighting for the static objects in a scene. This gathers the scene's static geometry and baked
+	/// lights for the LightmapBaker, then saves the results and hands them to the render components
+	/// </summary>
+	class Lightmapper {
+	public:
+		/// <summary>
+		/// Bakes a lightmap for every static render component in the scene, lit by every light marked as baked.
+		/// The lightmaps are saved as PNGs and assigned to their components as new texture assets. Must be called
+		/// from the thread that owns the OpenGL context, the tracing itself runs on worker threads
+		/// </summary>
+		/// <param name="scene">The scene to bake</param>
+		/// <param name="outputDir">The folder to save lightmaps to</param>
+		/// <param name="settings">The settings to bake with</param>
+		/// <returns>The number of lightmaps that were baked</returns>
+		static int BakeScene(const std::shared_ptr<Scene>& scene, const std::string& outputDir = "lightmaps", const LightmapBaker::Settings& settings = LightmapBaker::Settings());
+
+	protected:
+		Lightmapper() = default;
+		~Lightmapper() = default;
+	};
+}
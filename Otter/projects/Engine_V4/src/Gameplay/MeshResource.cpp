@@ -1,9 +1,41 @@
 #include "MeshResource.h"
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <memory>
 
 #include "Utils/ObjLoader.h"
+#include "Utils/OptimizedObjLoader.h"
+#include "Utils/MeshSimplifier.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshQuantizer.h"
+#include "Logging.h"
 
 namespace Gameplay {
+	const float MeshResource::LOD_SCREEN_SIZES[MeshResource::MAX_LODS] = { 1.0f, 0.25f, 0.12f, 0.05f };
+
+	// Reads an index buffer back from OpenGL, expanding the indices to 32 bit
+	inline std::vector<uint32_t> ReadBackIndices(const IndexBuffer::Sptr& indexBuff) {
+		std::vector<uint8_t> indexStore(indexBuff->GetTotalSize());
+		glGetNamedBufferSubData(indexBuff->GetHandle(), 0, indexBuff->GetTotalSize(), indexStore.data());
+		std::vector<uint32_t> result(indexBuff->GetElementCount());
+		for (size_t ix = 0; ix < result.size(); ix++) {
+			switch (indexBuff->GetElementType()) {
+				case IndexType::UByte:
+					result[ix] = indexStore[ix];
+					break;
+				case IndexType::UShort:
+					result[ix] = reinterpret_cast<uint16_t*>(indexStore.data())[ix];
+					break;
+				case IndexType::UInt:
+				default:
+					result[ix] = reinterpret_cast<uint32_t*>(indexStore.data())[ix];
+					break;
+			}
+		}
+		return result;
+	}
+
 	MeshResource::MeshResource() :
 		IResource(),
 		Filename(""),
@@ -20,6 +52,7 @@ namespace Gameplay {
 		BulletTriMesh(nullptr)
 	{
 		Mesh = ObjLoader::LoadFromFile(filename);
+		GenerateLods();
 	}
 
 	MeshResource::~MeshResource() = default;
@@ -51,14 +84,24 @@ namespace Gameplay {
 				MeshFactory::AddParameterized(mesh, p);
 			}
 			MeshFactory::CalculateTBN(mesh);
-			result->Mesh = mesh.Bake();
+			MeshOptimizer::Optimize(mesh, "generated mesh");
+			result->Mesh = MeshQuantizer::Bake(mesh);
+			result->GenerateLods();
 		} else {
 			result->Filename = JsonGet<std::string>(blob, "filename", "null");
 			if (result->Filename != "null" && std::filesystem::exists(result->Filename)) {
 				#ifdef OPTIMIZED_OBJ_LOADER
-				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename);
+				// Binary files carry their LODs with them, only generate if the file didn't have any
+				std::vector<IndexBuffer::Sptr> lods;
+				result->Mesh = OptimizedObjLoader::LoadFromFile(result->Filename, &lods);
+				if (!lods.empty()) {
+					result->SetLods(lods);
+				} else {
+					result->GenerateLods();
+				}
 				#else
 				result->Mesh = ObjLoader::LoadFromFile(result->Filename);
+				result->GenerateLods();
 				#endif
 
 			}
@@ -72,7 +115,262 @@ namespace Gameplay {
 			MeshFactory::AddParameterized(mesh, param);
 		}
 		MeshFactory::CalculateTBN(mesh);
-		Mesh = mesh.Bake();
+		MeshOptimizer::Optimize(mesh, "generated mesh");
+		Mesh = MeshQuantizer::Bake(mesh);
+
+		// Our geometry has changed, so any CPU copy, lightmap unwrap and our LODs are stale
+		std::atomic_store(&_cpuData, CpuMeshData::Sptr());
+		_lightmapUvs = LightmapUvs();
+		GenerateLods();
+	}
+
+	int MeshResource::GetLodCount() const {
+		return Lods.empty() ? (Mesh != nullptr ? 1 : 0) : static_cast<int>(Lods.size());
+	}
+
+	const VertexArrayObject::Sptr& MeshResource::GetLod(int level) const {
+		if (Lods.empty()) {
+			return Mesh;
+		}
+		return Lods[glm::clamp(level, 0, static_cast<int>(Lods.size()) - 1)];
+	}
+
+	void MeshResource::GenerateLods(int levels) {
+		Lods.clear();
+		Meshlets.clear();
+		if (Mesh == nullptr) {
+			return;
+		}
+		Lods.push_back(Mesh);
+
+		const CpuMeshData::Sptr& data = GetCpuData();
+		if (data == nullptr) {
+			return;
+		}
+
+		// Simplify our mesh, then upload each level as a new index buffer
+		std::vector<std::vector<uint32_t>> lodIndices = MeshSimplifier::GenerateLods(data->Positions, data->Indices, glm::min(levels, MAX_LODS - 1));
+		std::vector<IndexBuffer::Sptr> indexBuffers;
+		indexBuffers.reserve(lodIndices.size());
+		for (const auto& indices : lodIndices) {
+			IndexBuffer::Sptr ibo = IndexBuffer::Create(BufferUsage::StaticDraw);
+			ibo->LoadData(indices.data(), static_cast<uint32_t>(indices.size()));
+			indexBuffers.push_back(ibo);
+		}
+		SetLods(indexBuffers);
+
+		if (!lodIndices.empty()) {
+			LOG_TRACE("Generated {} LODs for \"{}\" ({} -> {} triangles)", lodIndices.size(), Filename.empty() ? "generated mesh" : Filename, data->Indices.size() / 3, lodIndices.back().size() / 3);
+		}
+	}
+
+	void MeshResource::SetLods(const std::vector<IndexBuffer::Sptr>& indexBuffers) {
+		Lods.clear();
+		if (Mesh == nullptr) {
+			return;
+		}
+		Lods.push_back(Mesh);
+
+		// Each LOD is a copy of our VAO that shares it's vertex buffers, but has it's own index buffer
+		for (const IndexBuffer::Sptr& ibo : indexBuffers) {
+			if (Lods.size() >= MAX_LODS) {
+				break;
+			}
+			VertexArrayObject::Sptr lod = Mesh->Clone();
+			lod->SetIndexBuffer(ibo);
+			Lods.push_back(lod);
+		}
+
+		GenerateMeshlets();
+	}
+
+	const std::vector<Meshlet>& MeshResource::GetMeshlets(int level) const {
+		static const std::vector<Meshlet> empty;
+		if (Meshlets.empty()) {
+			return empty;
+		}
+		return Meshlets[glm::clamp(level, 0, static_cast<int>(Meshlets.size()) - 1)];
+	}
+
+	void MeshResource::GenerateMeshlets() {
+		Meshlets.clear();
+		CpuMeshData::Sptr data = GetCpuData();
+		if (data == nullptr) {
+			return;
+		}
+
+		size_t meshletCount = 0;
+		Meshlets.resize(GetLodCount());
+		for (int level = 0; level < GetLodCount(); level++) {
+			// Meshlets are drawn straight out of the index buffer, so we can't do anything for non-indexed meshes
+			const VertexArrayObject::Sptr& lod = GetLod(level);
+			if (lod->GetIndexBuffer() == nullptr || lod->GetIndexCount() / 3 < MESHLET_MIN_TRIANGLES) {
+				continue;
+			}
+			// We already have the full detail indices on hand, but the other levels need to be read back
+			std::vector<uint32_t> indices = level == 0 ? data->Indices : ReadBackIndices(lod->GetIndexBuffer());
+			Meshlets[level] = MeshletBuilder::Build(data->Positions, indices);
+			meshletCount += Meshlets[level].size();
+
+			// Building meshlets groups their triangles together, so we need to upload the new triangle order
+			lod->GetIndexBuffer()->LoadData(indices.data(), static_cast<uint32_t>(indices.size()));
+			if (level == 0) {
+				// Background jobs (ex: occlusion culling) may be reading our current data, so we publish
+				// an updated copy instead of editing it in place
+				CpuMeshData::Sptr updated = std::make_shared<CpuMeshData>(*data);
+				updated->Indices = std::move(indices);
+				std::atomic_store(&_cpuData, updated);
+				data = updated;
+			}
+		}
+
+		if (meshletCount > 0) {
+			LOG_TRACE("Generated {} meshlets for \"{}\"", meshletCount, Filename.empty() ? "generated mesh" : Filename);
+		}
+	}
+
+	void MeshResource::GenerateLightmapUvs() {
+		if (HasLightmapUvs() || Mesh == nullptr) {
+			return;
+		}
+		CpuMeshData::Sptr data = GetCpuData();
+		if (data == nullptr) {
+			return;
+		}
+
+		size_t originalCount = data->Positions.size();
+		_lightmapUvs = LightmapBaker::GenerateUvs(data->Positions, data->Indices);
+		const std::vector<uint32_t>& remap = _lightmapUvs.VertexRemap;
+
+		// Our lower LODs only use the original vertices, so their index buffers are still valid
+		std::vector<IndexBuffer::Sptr> lodIndices;
+		for (size_t ix = 1; ix < Lods.size(); ix++) {
+			lodIndices.push_back(Lods[ix]->GetIndexBuffer());
+		}
+
+		// Charts that share a vertex each need their own copy of it, so we read back every vertex buffer
+		// and append the copies to the end
+		VertexArrayObject::Sptr result = VertexArrayObject::Create();
+		result->SetDebugName(Mesh->GetDebugName());
+		IndexBuffer::Sptr indexBuff = IndexBuffer::Create(BufferUsage::StaticDraw);
+		indexBuff->LoadData(_lightmapUvs.Indices.data(), static_cast<uint32_t>(_lightmapUvs.Indices.size()));
+		result->SetIndexBuffer(indexBuff);
+		for (const VertexArrayObject::VertexBufferBinding* binding : Mesh->GetVertexBuffers()) {
+			const VertexBuffer::Sptr& source = binding->GetBuffer();
+			if (binding->IsInstanced()) {
+				result->AddVertexBuffer(source, binding->GetAttributes(), true);
+				continue;
+			}
+
+			uint32_t elementSize = source->GetElementSize();
+			std::vector<uint8_t> vertexStore((size_t)remap.size() * elementSize);
+			glGetNamedBufferSubData(source->GetHandle(), 0, originalCount * elementSize, vertexStore.data());
+			for (size_t ix = originalCount; ix < remap.size(); ix++) {
+				memcpy(vertexStore.data() + ix * elementSize, vertexStore.data() + (size_t)remap[ix] * elementSize, elementSize);
+			}
+
+			VertexBuffer::Sptr buffer = VertexBuffer::Create(BufferUsage::StaticDraw);
+			buffer->LoadData(vertexStore.data(), elementSize, static_cast<uint32_t>(remap.size()));
+			result->AddVertexBuffer(buffer, binding->GetAttributes());
+		}
+
+		VertexBuffer::Sptr uvBuffer = VertexBuffer::Create(BufferUsage::StaticDraw);
+		uvBuffer->LoadData(_lightmapUvs.Uvs.data(), static_cast<uint32_t>(_lightmapUvs.Uvs.size()));
+		result->AddVertexBuffer(uvBuffer, {
+			BufferAttribute(LIGHTMAP_UV_SLOT, 2, AttributeType::Float, sizeof(glm::vec2), 0, AttribUsage::Texture1)
+		});
+		result->SetVDecl(Mesh->GetVDecl());
+		result->SetPositionDequantization(Mesh->GetPositionScale(), Mesh->GetPositionOffset());
+
+		// Keep our CPU copy in sync, the bounds don't change since we only added copies. The occlusion culling
+		// job may be reading the current data right now, so we build a new copy and swap it in, the job keeps
+		// it's own reference to the old one until it's done
+		CpuMeshData::Sptr updated = std::make_shared<CpuMeshData>();
+		updated->Positions.reserve(remap.size());
+		updated->Positions = data->Positions;
+		for (size_t ix = originalCount; ix < remap.size(); ix++) {
+			updated->Positions.push_back(data->Positions[remap[ix]]);
+		}
+		updated->Indices = _lightmapUvs.Indices;
+		updated->BoundsMin = data->BoundsMin;
+		updated->BoundsMax = data->BoundsMax;
+		std::atomic_store(&_cpuData, updated);
+
+		// Swapping in the new VAO re-creates our LODs and meshlets from it
+		Mesh = result;
+		SetLods(lodIndices);
+
+		LOG_TRACE("Generated lightmap UVs for \"{}\" ({} -> {} vertices)", Filename.empty() ? "generated mesh" : Filename, originalCount, remap.size());
+	}
+
+	bool MeshResource::HasLightmapUvs() const {
+		return !_lightmapUvs.Uvs.empty();
+	}
+
+	const LightmapUvs& MeshResource::GetLightmapUvs() const {
+		return _lightmapUvs;
+	}
+
+	const MeshResource::CpuMeshData::Sptr& MeshResource::GetCpuData() {
+		// We've already read back the data, or have nothing to read it from
+		if (_cpuData != nullptr || Mesh == nullptr) {
+			return _cpuData;
+		}
+
+		// Find the attribute and buffer that our positions live in
+		const VertexArrayObject::VertexDeclaration& vDecl = Mesh->GetVDecl();
+		auto it = std::find_if(vDecl.begin(), vDecl.end(), [](const BufferAttribute& attrib) {
+			return attrib.Usage == AttribUsage::Position;
+		});
+		const VertexArrayObject::VertexBufferBinding* binding = Mesh->GetBufferBinding(AttribUsage::Position);
+		bool isFloat = it != vDecl.end() && it->Type == AttributeType::Float;
+		bool isQuantized = it != vDecl.end() && it->Type == AttributeType::UShort && it->Normalized;
+		if (it == vDecl.end() || binding == nullptr || !(isFloat || isQuantized) || it->Size < 3) {
+			LOG_WARN("Mesh does not have float or quantized positions, cannot create CPU mesh data");
+			return _cpuData;
+		}
+		BufferAttribute posAttrib = *it;
+		const VertexBuffer::Sptr& vertexBuff = binding->GetBuffer();
+
+		CpuMeshData::Sptr result = std::make_shared<CpuMeshData>();
+
+		// Read back the vertex buffer and pull out the positions
+		std::vector<uint8_t> vertexStore(vertexBuff->GetTotalSize());
+		glGetNamedBufferSubData(vertexBuff->GetHandle(), 0, vertexBuff->GetTotalSize(), vertexStore.data());
+		result->Positions.resize(vertexBuff->GetElementCount());
+		for (size_t ix = 0; ix < result->Positions.size(); ix++) {
+			const uint8_t* element = vertexStore.data() + (posAttrib.Stride * ix) + posAttrib.Offset;
+			if (isQuantized) {
+				// Decode the position out of the mesh's bounding box
+				glm::vec3 normalized = glm::vec3(*reinterpret_cast<const glm::u16vec3*>(element)) / 65535.0f;
+				result->Positions[ix] = normalized * Mesh->GetPositionScale() + Mesh->GetPositionOffset();
+			} else {
+				result->Positions[ix] = *reinterpret_cast<const glm::vec3*>(element);
+			}
+		}
+
+		// Read back the indices, or generate a sequential list if not indexed
+		IndexBuffer::Sptr indexBuff = Mesh->GetIndexBuffer();
+		if (indexBuff != nullptr) {
+			result->Indices = ReadBackIndices(indexBuff);
+		} else {
+			result->Indices.resize(result->Positions.size());
+			for (size_t ix = 0; ix < result->Indices.size(); ix++) {
+				result->Indices[ix] = static_cast<uint32_t>(ix);
+			}
+		}
+
+		// Calculate our local space bounds
+		if (!result->Positions.empty()) {
+			result->BoundsMin = result->BoundsMax = result->Positions[0];
+			for (const glm::vec3& pos : result->Positions) {
+				result->BoundsMin = glm::min(result->BoundsMin, pos);
+				result->BoundsMax = glm::max(result->BoundsMax, pos);
+			}
+		}
+
+		std::atomic_store(&_cpuData, result);
+		return _cpuData;
 	}
 
 	void MeshResource::AddParam(const MeshBuilderParam & param) {
@@ -2,6 +2,8 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/VertexArrayObject.h"
 #include "Utils/MeshFactory.h"
+#include "Utils/MeshletBuilder.h"
+#include "Utils/LightmapBaker.h"
 
 // bullet triangle mesh pre-declaration
 class btTriangleMesh;
@@ -16,6 +18,40 @@ namespace Gameplay {
 	public:
 		typedef std::shared_ptr<MeshResource> Sptr;
 
+		/// <summary>
+		/// The maximum number of levels of detail a mesh can have, including the full detail mesh
+		/// </summary>
+		static const int MAX_LODS = 4;
+		/// <summary>
+		/// The projected screen size (fraction of the screen's height) below which each LOD level
+		/// will be used. LOD 0 is used for anything larger than LOD 1's threshold
+		/// </summary>
+		static const float LOD_SCREEN_SIZES[MAX_LODS];
+		/// <summary>
+		/// Levels of detail with fewer triangles than this are always drawn whole, since culling
+		/// their meshlets would cost more than it saves
+		/// </summary>
+		static const uint32_t MESHLET_MIN_TRIANGLES = 1024;
+		/// <summary>
+		/// The vertex attribute slot that lightmap coordinates are bound to, see GenerateLightmapUvs
+		/// </summary>
+		static const GLuint LIGHTMAP_UV_SLOT = 7;
+
+		/// <summary>
+		/// A CPU side copy of a mesh's positions and triangle list, along with it's local space
+		/// bounds. Lets systems reason about geometry without touching OpenGL (ex: occlusion culling)
+		/// Once published the data is never modified, changes to the mesh swap in a new copy, so
+		/// background jobs can safely hold on to a reference while the main thread edits the mesh
+		/// </summary>
+		struct CpuMeshData {
+			MAKE_PTRS(CpuMeshData);
+
+			std::vector<glm::vec3> Positions;
+			std::vector<uint32_t>  Indices;
+			glm::vec3              BoundsMin = glm::vec3(0.0f);
+			glm::vec3              BoundsMax = glm::vec3(0.0f);
+		};
+
 		// Default constructor
 		MeshResource();
 		/// <summary>
@@ -40,6 +76,16 @@ namespace Gameplay {
 		/// The VAO for rendering this mesh in OpenGL
 		/// </summary>
 		VertexArrayObject::Sptr         Mesh;
+		/// <summary>
+		/// The levels of detail for this mesh, where Lods[0] is the full detail mesh. All levels share
+		/// the vertex buffers of Mesh and only differ by their index buffer
+		/// </summary>
+		std::vector<VertexArrayObject::Sptr> Lods;
+		/// <summary>
+		/// The meshlets for each level of detail, indexing into that level's index buffer. Levels
+		/// that are too small to be worth splitting will have an empty list
+		/// </summary>
+		std::vector<std::vector<Meshlet>> Meshlets;
 
 
 		/// <summary>
@@ -51,6 +97,61 @@ namespace Gameplay {
 		/// </summary>
 		std::shared_ptr<btTriangleMesh> BulletTriMesh;
 
+		/// <summary>
+		/// Gets the CPU side copy of this mesh's geometry, reading it back from OpenGL the
+		/// first time it is requested. Returns nullptr if the mesh has no VAO or positions.
+		/// Must be called from the thread that owns the OpenGL context
+		/// </summary>
+		const CpuMeshData::Sptr& GetCpuData();
+
+		/// <summary>
+		/// Gets the number of levels of detail this mesh has, will be at least 1 if Mesh is set
+		/// </summary>
+		int GetLodCount() const;
+		/// <summary>
+		/// Gets the VAO for the given level of detail, clamped to the levels that exist
+		/// </summary>
+		const VertexArrayObject::Sptr& GetLod(int level) const;
+		/// <summary>
+		/// Generates lower levels of detail for this mesh using quadric error simplification
+		/// Must be called from the thread that owns the OpenGL context
+		/// </summary>
+		/// <param name="levels">The maximum number of levels to generate, not including the full detail mesh</param>
+		void GenerateLods(int levels = MAX_LODS - 1);
+		/// <summary>
+		/// Sets the lower levels of detail for this mesh from pre-built index buffers (ex: loaded from a BOBJ file)
+		/// </summary>
+		/// <param name="indexBuffers">The index buffers for LODs 1 and up</param>
+		void SetLods(const std::vector<IndexBuffer::Sptr>& indexBuffers);
+
+		/// <summary>
+		/// Gets the meshlets for the given level of detail, clamped to the levels that exist. Will
+		/// be empty if the level should be drawn whole
+		/// </summary>
+		const std::vector<Meshlet>& GetMeshlets(int level) const;
+		/// <summary>
+		/// Splits each of our levels of detail into meshlets for sub-object culling, re-uploading their index
+		/// buffers so each meshlet is a contiguous range. This is called automatically whenever our LODs change.
+		/// Must be called from the thread that owns the OpenGL context
+		/// </summary>
+		void GenerateMeshlets();
+
+		/// <summary>
+		/// Unwraps this mesh into a second set of UVs for lightmapping, and rebuilds our VAO with the extra vertices
+		/// the unwrap needs and the lightmap UVs bound to LIGHTMAP_UV_SLOT. The unwrap is deterministic, so we don't
+		/// store it with the mesh, anything with a baked lightmap calls this when it loads.
+		/// Does nothing if we already have lightmap UVs. Must be called from the thread that owns the OpenGL context
+		/// </summary>
+		void GenerateLightmapUvs();
+		/// <summary>
+		/// True if GenerateLightmapUvs has been called on this mesh
+		/// </summary>
+		bool HasLightmapUvs() const;
+		/// <summary>
+		/// Gets the lightmap unwrap of this mesh, the extra vertices it adds are also in our CPU data
+		/// </summary>
+		const LightmapUvs& GetLightmapUvs() const;
+
 		/// <summary>
 		/// Generates a new mesh from the mesh builder parameters
 		/// </summary>
@@ -65,5 +166,10 @@ namespace Gameplay {
 
 		virtual nlohmann::json ToJson() const override;
 		static MeshResource::Sptr FromJson(const nlohmann::json& blob);
+
+	protected:
+		// Only replaced with std::atomic_store, never edited in place. See CpuMeshData
+		CpuMeshData::Sptr _cpuData;
+		LightmapUvs       _lightmapUvs;
 	};
 }
\ No newline at end of file
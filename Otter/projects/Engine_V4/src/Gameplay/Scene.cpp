@@ -63,6 +63,12 @@ namespace Gameplay {
 
 	void Scene::SetSkyboxShader(const std::shared_ptr<ShaderProgram>& shader) {
 		_skyboxShader = shader;
+		if (_skyboxShader != nullptr) {
+			_skyboxClippedViewUniform    = _skyboxShader->GetUniformHandle<glm::mat4>("u_ClippedView");
+			_skyboxRotationUniform       = _skyboxShader->GetUniformHandle<glm::mat3>("u_EnvironmentRotation");
+			_skyboxPositionScaleUniform  = _skyboxShader->GetUniformHandle<glm::vec3>("u_PositionScale");
+			_skyboxPositionOffsetUniform = _skyboxShader->GetUniformHandle<glm::vec3>("u_PositionOffset");
+		}
 	}
 
 	std::shared_ptr<ShaderProgram> Scene::GetSkyboxShader() const {
@@ -361,20 +367,28 @@ namespace Gameplay {
 	}
 
 	void Scene::DrawSkybox()
+	{
+		if (MainCamera != nullptr) {
+			DrawSkybox(MainCamera->GetView(), MainCamera->GetProjection());
+		}
+	}
+
+	void Scene::DrawSkybox(const glm::mat4& view, const glm::mat4& projection)
 	{
 		if (_skyboxShader != nullptr &&
 			_skyboxMesh != nullptr &&
 			_skyboxMesh->Mesh != nullptr &&
-			_skyboxTexture != nullptr &&
-			MainCamera != nullptr) {
+			_skyboxTexture != nullptr) {
 			
 			glDepthMask(false);
 			glDisable(GL_CULL_FACE);
 			glDepthFunc(GL_LEQUAL); 
 
 			_skyboxShader->Bind();
-			_skyboxShader->SetUniformMatrix("u_ClippedView", MainCamera->GetProjection());
-			_skyboxShader->SetUniformMatrix("u_EnvironmentRotation", _skyboxRotation * glm::inverse(glm::mat3(MainCamera->GetView())));
+			_skyboxClippedViewUniform.Set(projection);
+			_skyboxRotationUniform.Set(_skyboxRotation * glm::inverse(glm::mat3(view)));
+			_skyboxPositionScaleUniform.Set(_skyboxMesh->Mesh->GetPositionScale());
+			_skyboxPositionOffsetUniform.Set(_skyboxMesh->Mesh->GetPositionOffset());
 			_skyboxTexture->Bind(0);
 			_skyboxMesh->Mesh->Draw();
 
@@ -9,6 +9,7 @@
 
 #include "Graphics/Buffers/UniformBuffer.h"
 #include "Graphics/Textures/Texture3D.h"
+#include "Graphics/ShaderProgram.h"
 
 struct GLFWwindow;
 
@@ -152,7 +153,14 @@ namespace Gameplay {
 		/// </summary>
 		void DrawAllGameObjectGUIs();
 
+		/// <summary>
+		/// Draws the skybox from the point of view of the main camera
+		/// </summary>
 		void DrawSkybox();
+		/// <summary>
+		/// Draws the skybox from an arbitrary point of view, ex: the face of a reflection probe
+		/// </summary>
+		void DrawSkybox(const glm::mat4& view, const glm::mat4& projection);
 
 		/// <summary>
 		/// Gets the scene's Bullet physics world
@@ -221,6 +229,10 @@ namespace Gameplay {
 
 		// Info for rendering our skybox will be stored in the scene itself
 		std::shared_ptr<ShaderProgram>       _skyboxShader;
+		UniformHandle<glm::mat4>      _skyboxClippedViewUniform;
+		UniformHandle<glm::mat3>      _skyboxRotationUniform;
+		UniformHandle<glm::vec3>      _skyboxPositionScaleUniform;
+		UniformHandle<glm::vec3>      _skyboxPositionOffsetUniform;
 		std::shared_ptr<MeshResource> _skyboxMesh;
 		std::shared_ptr<TextureCube>  _skyboxTexture;
 		glm::mat3                     _skyboxRotation;
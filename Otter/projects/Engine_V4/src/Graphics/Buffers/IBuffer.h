@@ -52,6 +52,16 @@ public:
 	/// <param name="allowResize">True if resizing the buffer is allowed, otherwise an assertion is thrown for oversized writes</param>
 	virtual void UpdateData(const void* data, uint32_t elementSize, uint32_t elementCount, bool allowResize = true);
 
+	/// <summary>
+	/// Allocates immutable storage for this buffer using glNamedBufferStorage. The buffer can not be resized
+	/// afterwards, but can be mapped with any of the given flags (ex: kept persistently mapped)
+	/// </summary>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to allocate room for</param>
+	/// <param name="flags">The ways that the buffer will be mapped</param>
+	/// <param name="data">The initial contents of the buffer, or nullptr to leave it uninitialized</param>
+	void AllocateStorage(uint32_t elementSize, uint32_t elementCount, BufferMapMode flags, const void* data = nullptr);
+
 	/// <summary>
 	/// Loads an array of data into this buffer, using the bindless method glNamedBufferData
 	/// </summary>
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <memory>
+#include <vector>
 #include <EnumToString.h>
 
 #include "Graphics/GlEnums.h"
@@ -49,6 +50,7 @@ public:
 	/// <typeparam name="T">The type of data to load, must be uint8_t, uint16_t or uint32_t</typeparam>
 	/// <param name="data">A pointer to the start of the array</param>
 	/// <param name="count">The number of elements in the array to upload</param>
+	/// <remarks>uint32_t indices are automatically stored as uint16_t if they all fit, check GetElementType before updating the buffer</remarks>
 	template <typename T>
 	void LoadData(const T* data, uint32_t count) { throw std::runtime_error("Must be one of uint8_t, uint16_t or uint32_t"); } // Note, see template specializations below
 
@@ -82,6 +84,21 @@ inline void IndexBuffer::LoadData<uint16_t>(const uint16_t* data, uint32_t count
 }
 template<>
 inline void IndexBuffer::LoadData<uint32_t>(const uint32_t* data, uint32_t count) {
+	// If all our indices fit in 16 bits, we store them as shorts to halve the memory and bandwidth
+	// (0xFFFF is left free so it can still be used for primitive restart)
+	uint32_t maxIndex = 0;
+	for (uint32_t ix = 0; ix < count; ix++) {
+		maxIndex = data[ix] > maxIndex ? data[ix] : maxIndex;
+	}
+	if (count > 0 && maxIndex < 0xFFFF) {
+		std::vector<uint16_t> compact(count);
+		for (uint32_t ix = 0; ix < count; ix++) {
+			compact[ix] = static_cast<uint16_t>(data[ix]);
+		}
+		LoadData<uint16_t>(compact.data(), count);
+		return;
+	}
+
 	IBuffer::LoadData<uint32_t>(data, count);
 	_elementType = IndexType::UInt;
 }
@@ -0,0 +1,40 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// Matches the layout that OpenGL expects for a single command in glMultiDrawElementsIndirect
+/// </summary>
+/// <see>https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glDrawElementsIndirect.xhtml</see>
+struct DrawElementsIndirectCommand {
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t  BaseVertex;
+	uint32_t BaseInstance;
+};
+
+/// <summary>
+/// The indirect buffer stores draw commands that OpenGL reads from GPU memory, letting us
+/// submit many draws (ex: all the visible meshlets of a mesh) with a single call
+/// </summary>
+class IndirectBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<IndirectBuffer> Sptr;
+
+	static inline Sptr Create(BufferUsage usage = BufferUsage::StreamDraw) {
+		return std::make_shared<IndirectBuffer>(usage);
+	}
+
+	/// <summary>
+	/// Creates a new indirect buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_STREAM_DRAW since commands are usually rebuilt every frame</param>
+	IndirectBuffer(BufferUsage usage = BufferUsage::StreamDraw) : IBuffer(BufferType::DrawIndirect, usage) { }
+
+	/// <summary>
+	/// Unbinds the current indirect buffer
+	/// </summary>
+	static void UnBind() { IBuffer::UnBind(BufferType::DrawIndirect); }
+};
@@ -0,0 +1,157 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Buffers/IBuffer.h"
+#include "Utils/Macros.h"
+#include "Logging.h"
+
+/// <summary>
+/// A buffer that stays mapped for it's whole lifetime, for data that the CPU rewrites every frame (ex: GUI
+/// instances, debug lines). The buffer is split into regions that we cycle through each frame, with a fence
+/// on each one so that we never write to a region that the GPU may still be reading from
+///
+/// Nothing touches OpenGL until the first Reserve, so these can be created before there is a context
+/// </summary>
+/// <typeparam name="TBuffer">The type of buffer to create (ex: VertexBuffer, StorageBuffer)</typeparam>
+/// <typeparam name="TElement">The type of element stored in the buffer</typeparam>
+template <typename TBuffer, typename TElement>
+class PersistentStreamBuffer {
+public:
+	NO_COPY(PersistentStreamBuffer);
+	NO_MOVE(PersistentStreamBuffer);
+
+	// The number of frames that we cycle through, the GPU is normally at most a couple frames behind
+	inline static const uint32_t REGIONS = 3;
+
+	/// <summary>
+	/// Creates a new stream buffer, storage is not allocated until the first call to Reserve
+	/// </summary>
+	/// <param name="name">The name to use when logging that the buffer was resized</param>
+	/// <param name="initialCapacity">The number of elements per region to start with, the buffer grows as needed</param>
+	PersistentStreamBuffer(const std::string& name, uint32_t initialCapacity) :
+		_name(name),
+		_initialCapacity(initialCapacity),
+		_buffer(nullptr),
+		_mapped(nullptr),
+		_regionCapacity(0),
+		_regionIndex(0),
+		_regionUsed(0),
+		_regionWaited(false),
+		_fences{ nullptr }
+	{ }
+
+	~PersistentStreamBuffer() {
+		_DeleteFences();
+		if (_buffer != nullptr) {
+			_buffer->Unmap();
+		}
+	}
+
+	/// <summary>
+	/// Makes sure that the current region has room for count more elements, replacing the buffer with a larger
+	/// one if it doesn't. Anything allocated earlier in the frame is dropped when that happens
+	/// </summary>
+	/// <param name="count">The number of elements that are about to be allocated</param>
+	/// <returns>True if the buffer was replaced, and anything referencing it (ex: VAOs) needs to be updated</returns>
+	bool Reserve(uint32_t count) {
+		if (_buffer != nullptr && _regionUsed + count <= _regionCapacity) {
+			return false;
+		}
+
+		// Size for everything used this frame so far, so that the next frame fits in one region.
+		// Grow to the next power of two so we don't reallocate every time a few elements are added
+		uint32_t newCapacity = glm::max(_regionCapacity, _initialCapacity);
+		while (newCapacity < _regionUsed + count) {
+			newCapacity *= 2;
+		}
+
+		// The old buffer may still be in use by the GPU, OpenGL will keep it alive until it's done
+		_DeleteFences();
+		if (_buffer != nullptr) {
+			_buffer->Unmap();
+		}
+
+		// Storage is immutable so that we can keep it mapped, we write through the pointer every frame
+		BufferMapMode flags = BufferMapMode::Write | BufferMapMode::Persistent | BufferMapMode::Coherent;
+		_buffer = TBuffer::Create(BufferUsage::StreamDraw);
+		_buffer->AllocateStorage(sizeof(TElement), newCapacity * REGIONS, flags);
+		_mapped = reinterpret_cast<TElement*>(_buffer->Map(flags));
+
+		_regionCapacity = newCapacity;
+		_regionIndex = 0;
+		_regionUsed = 0;
+		_regionWaited = false;
+
+		LOG_INFO("Resized {} to {} elements per frame", _name, newCapacity);
+		return true;
+	}
+
+	/// <summary>
+	/// Hands out room for count elements in the current region, Reserve must have been called first. The first
+	/// allocation each frame waits for the GPU to finish with the region, this is normally a few frames ago so we
+	/// should never actually end up waiting
+	/// </summary>
+	/// <param name="count">The number of elements to allocate</param>
+	/// <param name="first">Set to the index of the first element in the whole buffer, for use in draw calls</param>
+	/// <returns>A pointer to write the elements to</returns>
+	TElement* Allocate(uint32_t count, uint32_t& first) {
+		LOG_ASSERT(_regionUsed + count <= _regionCapacity, "Call Reserve before allocating from a stream buffer!");
+		if (!_regionWaited) {
+			GLsync& fence = _fences[_regionIndex];
+			if (fence != nullptr) {
+				while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) { }
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+			_regionWaited = true;
+		}
+
+		first = _regionIndex * _regionCapacity + _regionUsed;
+		_regionUsed += count;
+		return _mapped + first;
+	}
+
+	/// <summary>
+	/// Fences off the current region and moves on to the next one. Does nothing if nothing was allocated from
+	/// the current region. Should be called once all draws that read from the region have been issued
+	/// </summary>
+	void Advance() {
+		if (_regionUsed > 0) {
+			_fences[_regionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			_regionIndex = (_regionIndex + 1) % REGIONS;
+			_regionUsed = 0;
+			_regionWaited = false;
+		}
+	}
+
+	/// <summary>
+	/// Gets the underlying buffer, or nullptr if Reserve has not been called yet. Note that this changes
+	/// whenever Reserve returns true
+	/// </summary>
+	const typename TBuffer::Sptr& GetBuffer() const { return _buffer; }
+
+protected:
+	std::string          _name;
+	uint32_t             _initialCapacity;
+	typename TBuffer::Sptr _buffer;
+	TElement*            _mapped;
+	uint32_t             _regionCapacity;
+	uint32_t             _regionIndex;
+	// The number of elements allocated from the current region
+	uint32_t             _regionUsed;
+	// Whether we've already waited on the current region's fence
+	bool                 _regionWaited;
+	GLsync               _fences[REGIONS];
+
+	void _DeleteFences() {
+		for (GLsync& fence : _fences) {
+			if (fence != nullptr) {
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+		}
+	}
+};
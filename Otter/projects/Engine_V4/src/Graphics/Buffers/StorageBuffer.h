@@ -0,0 +1,39 @@
+#pragma once
+#include "IBuffer.h"
+#include <memory>
+
+/// <summary>
+/// A shader storage buffer (SSBO) is a block of GPU memory that shaders can both read and write,
+/// which lets compute shaders build data (ex: particles, draw commands) without a round trip to the CPU
+/// </summary>
+/// <see>https://www.khronos.org/opengl/wiki/Shader_Storage_Buffer_Object</see>
+class StorageBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<StorageBuffer> Sptr;
+
+	static inline Sptr Create(BufferUsage usage = BufferUsage::DynamicCopy) {
+		return std::make_shared<StorageBuffer>(usage);
+	}
+
+	/// <summary>
+	/// Creates a new storage buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_COPY since the GPU usually writes the contents</param>
+	StorageBuffer(BufferUsage usage = BufferUsage::DynamicCopy) : IBuffer(BufferType::ShaderStorage, usage) { }
+
+	/// <summary>
+	/// Binds part of this buffer to an indexed storage slot, so that a shader sees the range as the whole block
+	/// </summary>
+	/// <param name="slot">The binding point to attach the range to</param>
+	/// <param name="offset">The offset of the range in bytes, must be a multiple of GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT</param>
+	/// <param name="size">The size of the range in bytes</param>
+	void BindRange(uint32_t slot, uint32_t offset, uint32_t size) const {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, slot, _rendererId, offset, size);
+	}
+
+	/// <summary>
+	/// Unbinds the storage buffer at the given slot
+	/// </summary>
+	static void UnBind(uint32_t slot) { IBuffer::UnBind(BufferType::ShaderStorage, slot); }
+};
@@ -0,0 +1,367 @@
+#include "Graphics/CpuParticlePool.h"
+#include "Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <immintrin.h>
+#include <GLM/gtc/constants.hpp>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC lets us use AVX2 intrinsics anywhere, we check that the CPU supports them before calling any
+#define PARTICLE_AVX2
+#else
+#define PARTICLE_AVX2 __attribute__((target("avx2")))
+#endif
+
+static_assert(CpuParticlePool::CHUNK_SIZE % 8 == 0, "Chunks must be made of whole groups of 8 particles");
+
+// The streams that the simulation doesn't change, but that still need to be compacted
+static const CpuParticlePool::Stream PARTICLE_PASSTHROUGH_STREAMS[] = {
+	CpuParticlePool::GravityX, CpuParticlePool::GravityY, CpuParticlePool::GravityZ,
+	CpuParticlePool::ColorR, CpuParticlePool::ColorG, CpuParticlePool::ColorB, CpuParticlePool::ColorA,
+	CpuParticlePool::MaxLife
+};
+
+/// <summary>
+/// For each 8 bit mask of live lanes, the lanes to move to the front so that the live particles are packed together
+/// </summary>
+struct ParticleCompactTable {
+	alignas(32) int32_t Permutes[256][8];
+	uint32_t            Counts[256];
+
+	ParticleCompactTable() {
+		for (int mask = 0; mask < 256; mask++) {
+			int count = 0;
+			for (int lane = 0; lane < 8; lane++) {
+				if (mask & (1 << lane)) {
+					Permutes[mask][count++] = lane;
+				}
+			}
+			Counts[mask] = count;
+			// The lanes past the live ones get overwritten by the next group, so it doesn't matter what goes there
+			for (int lane = count; lane < 8; lane++) {
+				Permutes[mask][lane] = lane;
+			}
+		}
+	}
+};
+static const ParticleCompactTable s_CompactTable;
+
+static bool CpuSupportsAvx2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	// The OS also needs to be saving the AVX registers for us
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	return avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+/// <summary>
+/// A small PCG hash, matches Hash in particle_pool.glsl
+/// </summary>
+static uint32_t ParticleHash(uint32_t value) {
+	uint32_t state = value * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+static float ParticleRandom(uint32_t& seed) {
+	seed = ParticleHash(seed);
+	return static_cast<float>(seed) / 4294967295.0f;
+}
+
+/// <summary>
+/// Simulates the particles in [begin, end) one at a time, packing the survivors at the start of the range
+/// </summary>
+/// <returns>The number of particles that survived</returns>
+static uint32_t SimulateChunkScalar(float* const* s, uint32_t begin, uint32_t end, float dt) {
+	typedef CpuParticlePool P;
+	uint32_t write = begin;
+	for (uint32_t ix = begin; ix < end; ix++) {
+		float life = s[P::Life][ix] - dt;
+		if (life <= 0.0f) {
+			continue;
+		}
+
+		// Update position and apply forces
+		s[P::PositionX][write] = s[P::PositionX][ix] + s[P::VelocityX][ix] * dt;
+		s[P::PositionY][write] = s[P::PositionY][ix] + s[P::VelocityY][ix] * dt;
+		s[P::PositionZ][write] = s[P::PositionZ][ix] + s[P::VelocityZ][ix] * dt;
+		s[P::VelocityX][write] = s[P::VelocityX][ix] + s[P::GravityX][ix] * dt;
+		s[P::VelocityY][write] = s[P::VelocityY][ix] + s[P::GravityY][ix] * dt;
+		s[P::VelocityZ][write] = s[P::VelocityZ][ix] + s[P::GravityZ][ix] * dt;
+		s[P::Life][write] = life;
+		for (P::Stream stream : PARTICLE_PASSTHROUGH_STREAMS) {
+			s[stream][write] = s[stream][ix];
+		}
+		write++;
+	}
+	return write - begin;
+}
+
+/// <summary>
+/// Stores the live lanes of value packed together at dest
+/// </summary>
+PARTICLE_AVX2 static inline void CompactStore(float* dest, __m256 value, __m256i permute) {
+	_mm256_storeu_ps(dest, _mm256_permutevar8x32_ps(value, permute));
+}
+
+/// <summary>
+/// Simulates the particles in [begin, end) 8 at a time, packing the survivors at the start of the range. Since we
+/// only ever write at or behind where we are reading, compacting in place is safe. This can read and write up to 7
+/// floats past end, so end must either be a multiple of 8 or be the last chunk (which has padding after it)
+/// </summary>
+/// <returns>The number of particles that survived</returns>
+PARTICLE_AVX2 static uint32_t SimulateChunkAvx2(float* const* s, uint32_t begin, uint32_t end, float dt) {
+	typedef CpuParticlePool P;
+	const __m256  vdt = _mm256_set1_ps(dt);
+	const __m256  zero = _mm256_setzero_ps();
+	const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	uint32_t write = begin;
+	for (uint32_t ix = begin; ix < end; ix += 8) {
+		__m256 life = _mm256_sub_ps(_mm256_loadu_ps(s[P::Life] + ix), vdt);
+
+		// A lane is alive if it has life left, and isn't past the end of the chunk
+		__m256i remaining = _mm256_set1_epi32(static_cast<int>(end - ix));
+		__m256 inRange = _mm256_castsi256_ps(_mm256_cmpgt_epi32(remaining, laneIndex));
+		__m256 alive = _mm256_and_ps(_mm256_cmp_ps(life, zero, _CMP_GT_OQ), inRange);
+		int mask = _mm256_movemask_ps(alive);
+		if (mask == 0) {
+			continue;
+		}
+
+		// Update position and apply forces
+		__m256 vx = _mm256_loadu_ps(s[P::VelocityX] + ix);
+		__m256 vy = _mm256_loadu_ps(s[P::VelocityY] + ix);
+		__m256 vz = _mm256_loadu_ps(s[P::VelocityZ] + ix);
+		__m256 px = _mm256_add_ps(_mm256_loadu_ps(s[P::PositionX] + ix), _mm256_mul_ps(vx, vdt));
+		__m256 py = _mm256_add_ps(_mm256_loadu_ps(s[P::PositionY] + ix), _mm256_mul_ps(vy, vdt));
+		__m256 pz = _mm256_add_ps(_mm256_loadu_ps(s[P::PositionZ] + ix), _mm256_mul_ps(vz, vdt));
+		vx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_loadu_ps(s[P::GravityX] + ix), vdt));
+		vy = _mm256_add_ps(vy, _mm256_mul_ps(_mm256_loadu_ps(s[P::GravityY] + ix), vdt));
+		vz = _mm256_add_ps(vz, _mm256_mul_ps(_mm256_loadu_ps(s[P::GravityZ] + ix), vdt));
+
+		// Pack the survivors down to our write position
+		__m256i permute = _mm256_load_si256(reinterpret_cast<const __m256i*>(s_CompactTable.Permutes[mask]));
+		for (P::Stream stream : PARTICLE_PASSTHROUGH_STREAMS) {
+			CompactStore(s[stream] + write, _mm256_loadu_ps(s[stream] + ix), permute);
+		}
+		CompactStore(s[P::PositionX] + write, px, permute);
+		CompactStore(s[P::PositionY] + write, py, permute);
+		CompactStore(s[P::PositionZ] + write, pz, permute);
+		CompactStore(s[P::VelocityX] + write, vx, permute);
+		CompactStore(s[P::VelocityY] + write, vy, permute);
+		CompactStore(s[P::VelocityZ] + write, vz, permute);
+		CompactStore(s[P::Life] + write, life, permute);
+		write += s_CompactTable.Counts[mask];
+	}
+	return write - begin;
+}
+
+CpuParticlePool::CpuParticlePool(uint32_t capacity, uint32_t threadCount, bool streamToGpu) :
+	_capacity(0),
+	_count(0),
+	_threadCount(threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u)),
+	_streamToGpu(streamToGpu),
+	_useAvx2(CpuSupportsAvx2()),
+	_seed(0x9E3779B9u),
+	_simulateTimeMs(0.0f),
+	_streams(),
+	_pendingEmits(),
+	_chunkSurvivors(),
+	_vertices(),
+	_vbo(nullptr),
+	_vao(nullptr),
+	_renderShader(nullptr)
+{
+	Reserve(capacity);
+
+	if (_streamToGpu) {
+		_vbo = VertexBuffer::Create(BufferUsage::StreamDraw);
+		_vbo->LoadData<VertexPosCol>(nullptr, 1);
+		_vao = VertexArrayObject::Create();
+		_vao->AddVertexBuffer(_vbo, VertexPosCol::V_DECL);
+
+		_renderShader = ShaderProgram::Create();
+		_renderShader->LoadShaderPartFromFile("shaders/vertex_shaders/particles_stream_vs.glsl", ShaderPartType::Vertex);
+		_renderShader->LoadShaderPartFromFile("shaders/fragment_shaders/particles_render_fs.glsl", ShaderPartType::Fragment);
+		_renderShader->Link();
+	}
+
+	LOG_INFO("CPU particle pool using {} threads, AVX2 {}", _threadCount, _useAvx2 ? "enabled" : "not supported");
+}
+
+CpuParticlePool::~CpuParticlePool() = default;
+
+void CpuParticlePool::Reserve(uint32_t capacity) {
+	// Unlike the GPU pool we can grow without losing anything
+	if (capacity > _capacity) {
+		_capacity = capacity;
+		for (auto& stream : _streams) {
+			stream.resize((size_t)_capacity + 8, 0.0f);
+		}
+	}
+}
+
+void CpuParticlePool::Clear() {
+	_count = 0;
+	_pendingEmits.clear();
+}
+
+void CpuParticlePool::Emit(const EmitRequest& request) {
+	if (request.Count > 0) {
+		_pendingEmits.push_back(request);
+	}
+}
+
+CpuParticlePool::Particle CpuParticlePool::GetParticle(uint32_t index) const {
+	LOG_ASSERT(index < _count, "Particle index out of range");
+	Particle result;
+	result.Position = { _streams[PositionX][index], _streams[PositionY][index], _streams[PositionZ][index] };
+	result.Velocity = { _streams[VelocityX][index], _streams[VelocityY][index], _streams[VelocityZ][index] };
+	result.Gravity  = { _streams[GravityX][index], _streams[GravityY][index], _streams[GravityZ][index] };
+	result.Color    = { _streams[ColorR][index], _streams[ColorG][index], _streams[ColorB][index], _streams[ColorA][index] };
+	result.Life     = _streams[Life][index];
+	result.MaxLife  = _streams[MaxLife][index];
+	return result;
+}
+
+void CpuParticlePool::_Spawn(float deltaTime) {
+	for (const EmitRequest& request : _pendingEmits) {
+		// Each request gets it's own seed, so that emitters in the same place don't spawn the same particles
+		_seed = _seed * 1664525u + 1013904223u;
+
+		float speed = glm::length(request.Velocity);
+		glm::vec3 axis = speed > 0.0f ? request.Velocity / speed : glm::vec3(0.0f, 0.0f, 1.0f);
+		// Build a basis around the velocity for picking directions in the cone, see Duff et al. "Building an Orthonormal Basis, Revisited"
+		float sign = axis.z >= 0.0f ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + axis.z);
+		float b = axis.x * axis.y * a;
+		glm::vec3 tangent = glm::vec3(1.0f + sign * axis.x * axis.x * a, sign * b, -sign * axis.x);
+		glm::vec3 bitangent = glm::vec3(b, sign + axis.y * axis.y * a, -axis.y);
+		float cosCone = glm::cos(request.ConeAngle);
+
+		uint32_t count = std::min(request.Count, _capacity - _count);
+		for (uint32_t ix = 0; ix < count; ix++) {
+			uint32_t seed = _seed ^ ParticleHash(ix);
+
+			glm::vec3 velocity = request.Velocity;
+			if (speed > 0.0f && request.ConeAngle > 0.0f) {
+				float cosTheta = glm::mix(1.0f, cosCone, ParticleRandom(seed));
+				float sinTheta = glm::sqrt(glm::max(1.0f - cosTheta * cosTheta, 0.0f));
+				float phi = glm::two_pi<float>() * ParticleRandom(seed);
+				velocity = ((tangent * glm::cos(phi) + bitangent * glm::sin(phi)) * sinTheta + axis * cosTheta) * speed;
+			}
+			float lifetime = glm::mix(request.LifetimeRange.x, request.LifetimeRange.y, ParticleRandom(seed));
+
+			// Spread particles over the update so that they don't all spawn in a clump
+			glm::vec3 position = request.Position + velocity * (deltaTime * ParticleRandom(seed));
+
+			uint32_t index = _count++;
+			_streams[PositionX][index] = position.x;
+			_streams[PositionY][index] = position.y;
+			_streams[PositionZ][index] = position.z;
+			_streams[VelocityX][index] = velocity.x;
+			_streams[VelocityY][index] = velocity.y;
+			_streams[VelocityZ][index] = velocity.z;
+			_streams[GravityX][index]  = request.Gravity.x;
+			_streams[GravityY][index]  = request.Gravity.y;
+			_streams[GravityZ][index]  = request.Gravity.z;
+			_streams[ColorR][index]    = request.Color.r;
+			_streams[ColorG][index]    = request.Color.g;
+			_streams[ColorB][index]    = request.Color.b;
+			_streams[ColorA][index]    = request.Color.a;
+			_streams[Life][index]      = lifetime;
+			_streams[MaxLife][index]   = lifetime;
+		}
+	}
+	_pendingEmits.clear();
+}
+
+void CpuParticlePool::Simulate(float deltaTime) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// New particles get simulated along with the rest this update, same as on the GPU
+	_Spawn(deltaTime);
+
+	float* streams[StreamCount];
+	for (int ix = 0; ix < StreamCount; ix++) {
+		streams[ix] = _streams[ix].data();
+	}
+
+	// Every chunk compacts it's own survivors in place
+	uint32_t chunkCount = (_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	_chunkSurvivors.resize(chunkCount);
+	bool useAvx2 = _useAvx2;
+	uint32_t count = _count;
+	ThreadPool::Get().ParallelFor(chunkCount, 1, _threadCount, [&](size_t chunk) {
+		uint32_t begin = static_cast<uint32_t>(chunk) * CHUNK_SIZE;
+		uint32_t end = std::min(begin + CHUNK_SIZE, count);
+		_chunkSurvivors[chunk] = useAvx2 ?
+			SimulateChunkAvx2(streams, begin, end, deltaTime) :
+			SimulateChunkScalar(streams, begin, end, deltaTime);
+	});
+
+	// Then we pack the chunks back together
+	uint32_t write = chunkCount > 0 ? _chunkSurvivors[0] : 0;
+	for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+		uint32_t begin = static_cast<uint32_t>(chunk) * CHUNK_SIZE;
+		uint32_t survivors = _chunkSurvivors[chunk];
+		if (write != begin && survivors > 0) {
+			for (int ix = 0; ix < StreamCount; ix++) {
+				memmove(streams[ix] + write, streams[ix] + begin, survivors * sizeof(float));
+			}
+		}
+		write += survivors;
+	}
+	_count = write;
+
+	auto end = std::chrono::high_resolution_clock::now();
+	_simulateTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void CpuParticlePool::Render() {
+	if (!_streamToGpu || _count == 0) {
+		return;
+	}
+
+	// Pack our particles into vertices, fading them out over their life like the GPU pool does
+	_vertices.resize(_count);
+	uint32_t chunkCount = (_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	ThreadPool::Get().ParallelFor(chunkCount, 1, _threadCount, [&](size_t chunk) {
+		uint32_t begin = static_cast<uint32_t>(chunk) * CHUNK_SIZE;
+		uint32_t end = std::min(begin + CHUNK_SIZE, _count);
+		for (uint32_t ix = begin; ix < end; ix++) {
+			VertexPosCol& vertex = _vertices[ix];
+			vertex.Position = { _streams[PositionX][ix], _streams[PositionY][ix], _streams[PositionZ][ix] };
+			vertex.Color = {
+				_streams[ColorR][ix], _streams[ColorG][ix], _streams[ColorB][ix],
+				_streams[ColorA][ix] * (_streams[Life][ix] / _streams[MaxLife][ix])
+			};
+		}
+	});
+	_vbo->UpdateData(_vertices.data(), sizeof(VertexPosCol), _count);
+
+	_renderShader->Bind();
+	_vao->Bind();
+
+	glEnablei(GL_BLEND, 0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glDrawArrays(GL_POINTS, 0, _count);
+
+	VertexArrayObject::Unbind();
+}
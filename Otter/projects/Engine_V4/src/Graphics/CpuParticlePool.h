@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/IParticlePool.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/VertexTypes.h"
+
+/// <summary>
+/// A particle pool that simulates on the CPU, for headless runs (ex: benchmarks on a build server) and
+/// for inspecting particle behaviour without a GPU. Particles follow the same rules as GpuParticlePool.
+///
+/// Particles are stored as a structure of arrays and kept packed at the start of the arrays. Each update
+/// splits them into chunks that are simulated on worker threads, 8 particles at a time with AVX2 when the
+/// CPU supports it. Each chunk compacts it's own survivors, then the chunks are packed back together.
+///
+/// Simulation never touches OpenGL. Streaming to the GPU is optional, when enabled Render uploads the
+/// particles to a vertex buffer and draws them as points. Streamed particles are not sorted
+/// </summary>
+class CpuParticlePool final : public IParticlePool {
+public:
+	MAKE_PTRS(CpuParticlePool);
+
+	// The number of particles in each chunk that gets handed to a worker, must be a multiple of 8
+	static const uint32_t CHUNK_SIZE = 16384;
+
+	/// <summary>
+	/// A copy of a single particle, for inspecting the simulation
+	/// </summary>
+	struct Particle {
+		glm::vec3 Position;
+		glm::vec3 Velocity;
+		glm::vec3 Gravity;
+		glm::vec4 Color;
+		float     Life;
+		float     MaxLife;
+	};
+
+	/// <summary>
+	/// Creates a new CPU particle pool
+	/// </summary>
+	/// <param name="capacity">The maximum number of particles that can be alive at once</param>
+	/// <param name="threadCount">The number of threads to simulate with, 0 to use one per hardware thread</param>
+	/// <param name="streamToGpu">True to upload particles for drawing in Render, this requires an OpenGL context</param>
+	CpuParticlePool(uint32_t capacity = 65536, uint32_t threadCount = 0, bool streamToGpu = true);
+	virtual ~CpuParticlePool();
+
+	/// <summary>
+	/// Gets a copy of the particle at the given index, indices are between 0 and GetAliveCount()
+	/// and are re-ordered as particles die
+	/// </summary>
+	Particle GetParticle(uint32_t index) const;
+
+	/// <summary>
+	/// Returns true if the simulation is using the AVX2 kernel, false if the CPU doesn't support it
+	/// </summary>
+	bool IsUsingAvx2() const { return _useAvx2; }
+	/// <summary>
+	/// Gets how long the last call to Simulate took, in milliseconds
+	/// </summary>
+	float GetSimulateTimeMs() const { return _simulateTimeMs; }
+
+	// Inherited from IParticlePool
+
+	virtual void Reserve(uint32_t capacity) override;
+	virtual void Clear() override;
+	virtual void Emit(const EmitRequest& request) override;
+	virtual void Simulate(float deltaTime) override;
+	virtual void Render() override;
+	virtual uint32_t GetCapacity() const override { return _capacity; }
+	virtual uint32_t GetAliveCount() const override { return _count; }
+	virtual bool IsEmpty() const override { return _count == 0 || !_streamToGpu; }
+
+	// The arrays that make up our particles, each holds one float per particle
+	enum Stream {
+		PositionX, PositionY, PositionZ,
+		VelocityX, VelocityY, VelocityZ,
+		GravityX, GravityY, GravityZ,
+		ColorR, ColorG, ColorB, ColorA,
+		Life, MaxLife,
+		StreamCount
+	};
+
+protected:
+	uint32_t _capacity;
+	uint32_t _count;
+	uint32_t _threadCount;
+	bool     _streamToGpu;
+	bool     _useAvx2;
+	uint32_t _seed;
+	float    _simulateTimeMs;
+
+	// Each stream has 8 floats of padding on the end, so that the last group of 8 particles can always
+	// be loaded and stored whole
+	std::vector<float> _streams[StreamCount];
+	std::vector<EmitRequest> _pendingEmits;
+	// The number of particles that survived in each chunk during the last update
+	std::vector<uint32_t> _chunkSurvivors;
+
+	std::vector<VertexPosCol>  _vertices;
+	VertexBuffer::Sptr         _vbo;
+	VertexArrayObject::Sptr    _vao;
+	ShaderProgram::Sptr        _renderShader;
+
+	void _Spawn(float deltaTime);
+};
@@ -1,51 +1,57 @@
 #include "Graphics/DebugDraw.h"
+#include <algorithm>
 
 DebugDrawer::DebugDrawer() :
-	_colorStack(std::stack<glm::vec3>()),
-	_transformStack(std::stack<glm::mat4>()),
+	_instanceId(__NextInstanceId++),
 	_viewProjection(glm::mat4(1.0f)),
-	_lineOffset(0),
-	_triangleOffset(0)
+	_batchListLock(),
+	_threadBatches(std::vector<std::shared_ptr<ThreadBatch>>()),
+	_stream("debug draw stream buffer", static_cast<uint32_t>(INITIAL_STREAM_SIZE)),
+	_streamVao(nullptr)
 {
-	_linesVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_linesVBO->LoadData<VertexPosCol>(nullptr, LINE_BATCH_SIZE * 2);
-	_linesVAO = VertexArrayObject::Create();
-	_linesVAO->AddVertexBuffer(_linesVBO, VertexPosCol::V_DECL);
-
-	_trisVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_trisVBO->LoadData<VertexPosCol>(nullptr, TRI_BATCH_SIZE * 3);
-	_trisVAO = VertexArrayObject::Create();
-	_trisVAO->AddVertexBuffer(_trisVBO, VertexPosCol::V_DECL);
-
-	_colorStack.push(glm::vec3(1.0f));
-	_transformStack.push(glm::mat4(1.0f));
+	// Note that we don't touch OpenGL here, since the first call to Get may come from a worker thread.
+	// The stream buffer and shader are created by the first flush
 }
 
+DebugDrawer::~DebugDrawer() = default;
+
 void DebugDrawer::PushColor(const glm::vec3& color) {
-	_colorStack.push(color);
+	_GetThreadBatch().ColorStack.push_back(color);
 }
 
 glm::vec3 DebugDrawer::PopColor() {
-	LOG_ASSERT(_colorStack.size() > 1, "Attempting to pop more colors than you are pushing! Check your code!");
-	glm::vec3 result = _colorStack.top();
-	_colorStack.pop();
+	ThreadBatch& batch = _GetThreadBatch();
+	LOG_ASSERT(batch.ColorStack.size() > 1, "Attempting to pop more colors than you are pushing! Check your code!");
+	glm::vec3 result = batch.ColorStack.back();
+	batch.ColorStack.pop_back();
 	return result;
 }
 
 void DebugDrawer::PushWorldMatrix(const glm::mat4& value) {
-	FlushAll();
-	_transformStack.push(value);
+	_GetThreadBatch().TransformStack.push_back(value);
 }
 
 void DebugDrawer::PopWorldMatrix() {
-	LOG_ASSERT(_transformStack.size() > 1, "Attempting to pop more transforms than you are pushing! Check your code!");
-	FlushAll();
-	_transformStack.pop();
+	ThreadBatch& batch = _GetThreadBatch();
+	LOG_ASSERT(batch.TransformStack.size() > 1, "Attempting to pop more transforms than you are pushing! Check your code!");
+	batch.TransformStack.pop_back();
+}
+
+void DebugDrawer::PushOptions(const DebugDrawOptions& options) {
+	_GetThreadBatch().OptionsStack.push_back(options);
+}
 
+DebugDrawOptions DebugDrawer::PopOptions() {
+	ThreadBatch& batch = _GetThreadBatch();
+	LOG_ASSERT(batch.OptionsStack.size() > 1, "Attempting to pop more options than you are pushing! Check your code!");
+	DebugDrawOptions result = batch.OptionsStack.back();
+	batch.OptionsStack.pop_back();
+	return result;
 }
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2) {
-	DrawLine(p1, p2, _colorStack.top(), _colorStack.top());
+	glm::vec3 c = _GetThreadBatch().ColorStack.back();
+	DrawLine(p1, p2, c, c);
 }
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& color) {
@@ -54,39 +60,18 @@ void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& color1, const glm::vec3& color2)
 {
-	_lineBuffer[_lineOffset + 0].Color = glm::vec4(color1, 1.0f);
-	_lineBuffer[_lineOffset + 0].Position = p1;
-	_lineBuffer[_lineOffset + 1].Color = glm::vec4(color2, 1.0f);
-	_lineBuffer[_lineOffset + 1].Position = p2;
-
-	_lineOffset += 2;
-	if (_lineOffset >= LINE_BATCH_SIZE) {
-		FlushLines();
-	}
+	glm::vec3 points[2] = { p1, p2 };
+	glm::vec3 colors[2] = { color1, color2 };
+	_PushPrimitive(Lines, points, colors);
 }
 
 void DebugDrawer::FlushLines()
 {
-	if (_lineOffset > 0) {
-		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glLineWidth(2.0f);
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_linesVBO->LoadData<VertexPosCol>(_lineBuffer, LINE_BATCH_SIZE * 2);
-		_linesVAO->Bind();
-		_linesVAO->Draw(DrawMode::LineList);
-		_linesVAO->Unbind();
-		_lineOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
-	}
+	_Flush(true, false);
 }
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
-	glm::vec3 c = _colorStack.top();
+	glm::vec3 c = _GetThreadBatch().ColorStack.back();
 	DrawTri(p1, p2, p3, c, c, c);
 }
 
@@ -96,42 +81,19 @@ void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::v
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3)
 {
-	_triBuffer[_triangleOffset + 0].Color = glm::vec4(c1, 1.0f);
-	_triBuffer[_triangleOffset + 0].Position = p1;
-	_triBuffer[_triangleOffset + 1].Color = glm::vec4(c2, 1.0f);
-	_triBuffer[_triangleOffset + 1].Position = p2;
-	_triBuffer[_triangleOffset + 2].Color = glm::vec4(c3, 1.0f);
-	_triBuffer[_triangleOffset + 2].Position = p3;
-
-	_triangleOffset += 3;
-	if (_triangleOffset >= TRI_BATCH_SIZE) {
-		FlushTris();
-	}
+	glm::vec3 points[3] = { p1, p2, p3 };
+	glm::vec3 colors[3] = { c1, c2, c3 };
+	_PushPrimitive(Triangles, points, colors);
 }
 
 void DebugDrawer::FlushTris()
 {
-	if (_triangleOffset > 0) {
-		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_trisVBO->LoadData<VertexPosCol>(_triBuffer, TRI_BATCH_SIZE * 3);
-		_trisVAO->Bind();
-		_trisVAO->Draw(DrawMode::LineList);
-		_trisVAO->Unbind();
-		_triangleOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
-	}
+	_Flush(false, true);
 }
 
 void DebugDrawer::FlushAll()
 {
-	FlushLines();
-	FlushTris();
+	_Flush(true, true);
 }
 
 void DebugDrawer::SetViewProjection(const glm::mat4& viewProjection)
@@ -139,45 +101,265 @@ void DebugDrawer::SetViewProjection(const glm::mat4& viewProjection)
 	_viewProjection = viewProjection;
 }
 
-DebugDrawer& DebugDrawer::Get() {
-	if (__Instance == nullptr) {
-		__Instance = new DebugDrawer();
+bool DebugDrawer::ThreadBatch::IsEmpty() const {
+	for (int type = 0; type < PrimitiveTypeCount; type++) {
+		for (int depth = 0; depth < DEPTH_MODE_COUNT; depth++) {
+			if (!Frame[type][depth].Vertices.empty() || !Timed[type][depth].Vertices.empty()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+DebugDrawer::ThreadBatchOwner::~ThreadBatchOwner() {
+	// The drawer may still have primitives from this thread to draw, so we let it free the batch
+	if (Batch != nullptr) {
+		Batch->Orphaned.store(true, std::memory_order_release);
+	}
+}
+
+DebugDrawer::ThreadBatch& DebugDrawer::_GetThreadBatch() {
+	// Each thread remembers it's batch, along with which drawer it belongs to in case we were uninitialized
+	thread_local ThreadBatchOwner owner;
+
+	if (owner.Batch == nullptr || owner.Owner != _instanceId) {
+		std::shared_ptr<ThreadBatch> newBatch = std::make_shared<ThreadBatch>();
+		newBatch->ColorStack.push_back(glm::vec3(1.0f));
+		newBatch->TransformStack.push_back(glm::mat4(1.0f));
+		newBatch->OptionsStack.push_back(DebugDrawOptions());
+
+		owner.Batch = newBatch;
+		owner.Owner = _instanceId;
+
+		std::lock_guard<std::mutex> lock(_batchListLock);
+		_threadBatches.push_back(std::move(newBatch));
+	}
+	return *owner.Batch;
+}
 
-		const char* vs_source = R"LIT(#version 450
-				layout (location = 0) in vec3 inPosition;
-				layout (location = 1) in vec4 inColor;
+void DebugDrawer::_PushPrimitive(PrimitiveType type, const glm::vec3* points, const glm::vec3* colors) {
+	ThreadBatch& batch = _GetThreadBatch();
+	const DebugDrawOptions& options = batch.OptionsStack.back();
+	const glm::mat4& world = batch.TransformStack.back();
+	// The bottom of the stack is always identity, so we can skip the transform most of the time
+	bool transform = batch.TransformStack.size() > 1;
+	bool timed = options.Duration > 0.0f;
 
-				layout (location = 0) out vec4 outColor;
+	// Only the flush will ever contend for this lock, and only for as long as it takes to copy the batch
+	std::lock_guard<std::mutex> lock(batch.Lock);
+	PrimitiveList& list = timed ? batch.Timed[type][(int)options.DepthMode] : batch.Frame[type][(int)options.DepthMode];
+	for (uint32_t ix = 0; ix < VERTICES_PER_PRIMITIVE[type]; ix++) {
+		glm::vec3 pos = transform ? glm::vec3(world * glm::vec4(points[ix], 1.0f)) : points[ix];
+		list.Vertices.emplace_back(pos, glm::vec4(colors[ix], 1.0f));
+	}
+	if (timed) {
+		list.Lifetimes.push_back(options.Duration);
+	}
+}
 
-				layout (location = 0) uniform mat4 u_MVP;
+void DebugDrawer::_Flush(bool lines, bool tris) {
+	bool types[PrimitiveTypeCount] = { lines, tris };
 
-				void main() {
-					gl_Position = u_MVP * vec4(inPosition, 1.0);
-					outColor = inColor;
+	uint32_t first[PrimitiveTypeCount][DEPTH_MODE_COUNT] = { };
+	uint32_t counts[PrimitiveTypeCount][DEPTH_MODE_COUNT] = { };
+	uint32_t total = 0;
+
+	{
+		// Hold every batch lock while we copy out of them. Workers only ever take their own batch's lock,
+		// so this can't deadlock
+		std::lock_guard<std::mutex> listLock(_batchListLock);
+		std::vector<std::unique_lock<std::mutex>> locks;
+		locks.reserve(_threadBatches.size());
+		for (const auto& batch : _threadBatches) {
+			locks.emplace_back(batch->Lock);
+		}
+
+		// Move primitives with a duration into our own lists, and figure out how much we need to draw
+		for (int type = 0; type < PrimitiveTypeCount; type++) {
+			if (!types[type]) {
+				continue;
+			}
+			for (int depth = 0; depth < DEPTH_MODE_COUNT; depth++) {
+				PrimitiveList& timed = _timed[type][depth];
+				for (const auto& batch : _threadBatches) {
+					PrimitiveList& source = batch->Timed[type][depth];
+					timed.Vertices.insert(timed.Vertices.end(), source.Vertices.begin(), source.Vertices.end());
+					timed.Lifetimes.insert(timed.Lifetimes.end(), source.Lifetimes.begin(), source.Lifetimes.end());
+					source.Vertices.clear();
+					source.Lifetimes.clear();
+
+					counts[type][depth] += static_cast<uint32_t>(batch->Frame[type][depth].Vertices.size());
 				}
-			)LIT";
-		const char* fs_source = R"LIT(#version 450
-				layout (location=0) in  vec4 inColor;
-				layout (location=0) out vec4 outColor;
+				// Every flush draws the timed primitives, we can't tell which flush will end up on screen
+				// (ex: physics debug flushes before the render graph runs, ImGui flushes after)
+				counts[type][depth] += static_cast<uint32_t>(timed.Vertices.size());
+				total += counts[type][depth];
+			}
+		}
 
-				void main() {
-					outColor = inColor;
+		if (total > 0) {
+			// The VAO needs to point at the new buffer whenever the stream grows
+			if (_stream.Reserve(total) || _streamVao == nullptr) {
+				_streamVao = VertexArrayObject::Create();
+				_streamVao->AddVertexBuffer(_stream.GetBuffer(), VertexPosCol::V_DECL);
+			}
+
+			// Copy everything straight into the mapped buffer, grouped so each type and depth mode is one range
+			for (int type = 0; type < PrimitiveTypeCount; type++) {
+				if (!types[type]) {
+					continue;
+				}
+				for (int depth = 0; depth < DEPTH_MODE_COUNT; depth++) {
+					VertexPosCol* dest = _stream.Allocate(counts[type][depth], first[type][depth]);
+
+					const PrimitiveList& timed = _timed[type][depth];
+					dest = std::copy(timed.Vertices.begin(), timed.Vertices.end(), dest);
+					for (const auto& batch : _threadBatches) {
+						std::vector<VertexPosCol>& source = batch->Frame[type][depth].Vertices;
+						dest = std::copy(source.begin(), source.end(), dest);
+						source.clear();
+					}
 				}
-			)LIT";
+			}
+		}
 
-		__Shader = ShaderProgram::Create();
-		__Shader->LoadShaderPart(vs_source, ShaderPartType::Vertex);
-		__Shader->LoadShaderPart(fs_source, ShaderPartType::Fragment);
-		__Shader->Link();
+		// Threads that have exited can't draw anything else, so once everything they drew has been drained
+		// their batches can be freed. The batch locks need to be released before the batches are destroyed
+		locks.clear();
+		_threadBatches.erase(std::remove_if(_threadBatches.begin(), _threadBatches.end(), [](const std::shared_ptr<ThreadBatch>& batch) {
+			return batch->Orphaned.load(std::memory_order_acquire) && batch->IsEmpty();
+		}), _threadBatches.end());
+	}
+
+	if (total == 0) {
+		return;
+	}
+
+	if (__Shader == nullptr) {
+		__InitShader();
+	}
+	__Shader->Bind();
+	// Points are already in world space, so we only need the view projection
+	__MvpUniform.Set(_viewProjection);
+
+	int restorePoint = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glLineWidth(2.0f);
+
+	// Overlay primitives go last with depth testing off, so they end up on top of everything
+	_streamVao->Bind();
+	for (int depth = 0; depth < DEPTH_MODE_COUNT; depth++) {
+		if (depth == (int)DebugDepthMode::Overlay) {
+			glDisable(GL_DEPTH_TEST);
+		} else {
+			glEnable(GL_DEPTH_TEST);
+		}
+
+		if (counts[Triangles][depth] > 0) {
+			glDrawArrays(GL_TRIANGLES, first[Triangles][depth], counts[Triangles][depth]);
+		}
+		if (counts[Lines][depth] > 0) {
+			glDrawArrays(GL_LINES, first[Lines][depth], counts[Lines][depth]);
+		}
+	}
+	VertexArrayObject::Unbind();
+
+	if (depthTest) {
+		glEnable(GL_DEPTH_TEST);
+	} else {
+		glDisable(GL_DEPTH_TEST);
+	}
+	if (restorePoint != 0) {
+		glBindVertexArray(restorePoint);
 	}
-	return *__Instance;
+}
+
+void DebugDrawer::_EndFrame(float deltaTime) {
+	// Fence off the region we wrote to this frame, and move on to the next one
+	_stream.Advance();
+
+	// Age our timed primitives, compacting the survivors to the front of each list
+	for (int type = 0; type < PrimitiveTypeCount; type++) {
+		uint32_t stride = VERTICES_PER_PRIMITIVE[type];
+		for (int depth = 0; depth < DEPTH_MODE_COUNT; depth++) {
+			PrimitiveList& list = _timed[type][depth];
+			size_t kept = 0;
+			for (size_t ix = 0; ix < list.Lifetimes.size(); ix++) {
+				float remaining = list.Lifetimes[ix] - deltaTime;
+				if (remaining > 0.0f) {
+					if (kept != ix) {
+						std::copy_n(list.Vertices.begin() + ix * stride, stride, list.Vertices.begin() + kept * stride);
+					}
+					list.Lifetimes[kept++] = remaining;
+				}
+			}
+			list.Lifetimes.resize(kept);
+			list.Vertices.resize(kept * stride);
+		}
+	}
+}
+
+void DebugDrawer::__InitShader() {
+	const char* vs_source = R"LIT(#version 450
+			layout (location = 0) in vec3 inPosition;
+			layout (location = 1) in vec4 inColor;
+
+			layout (location = 0) out vec4 outColor;
+
+			layout (location = 0) uniform mat4 u_MVP;
+
+			void main() {
+				gl_Position = u_MVP * vec4(inPosition, 1.0);
+				outColor = inColor;
+			}
+		)LIT";
+	const char* fs_source = R"LIT(#version 450
+			layout (location=0) in  vec4 inColor;
+			layout (location=0) out vec4 outColor;
+
+			void main() {
+				outColor = inColor;
+			}
+		)LIT";
+
+	__Shader = ShaderProgram::Create();
+	__Shader->LoadShaderPart(vs_source, ShaderPartType::Vertex);
+	__Shader->LoadShaderPart(fs_source, ShaderPartType::Fragment);
+	__Shader->Link();
+	__MvpUniform = __Shader->GetUniformHandle<glm::mat4>("u_MVP");
+}
+
+DebugDrawer& DebugDrawer::Get() {
+	DebugDrawer* instance = __Instance.load(std::memory_order_acquire);
+	if (instance == nullptr) {
+		// Worker threads may be the first to draw something, so creation needs to be locked
+		std::lock_guard<std::mutex> lock(__InstanceLock);
+		instance = __Instance.load(std::memory_order_relaxed);
+		if (instance == nullptr) {
+			instance = new DebugDrawer();
+			__Instance.store(instance, std::memory_order_release);
+		}
+	}
+	return *instance;
 }
 
 void DebugDrawer::Uninitialize()
 {
-	if (__Instance != nullptr) {
-		delete __Instance;
-		__Instance = nullptr;
+	std::lock_guard<std::mutex> lock(__InstanceLock);
+	DebugDrawer* instance = __Instance.exchange(nullptr);
+	if (instance != nullptr) {
+		delete instance;
 		__Shader = nullptr;
+		__MvpUniform = UniformHandle<glm::mat4>();
 	}
-}
\ No newline at end of file
+}
+
+void DebugDrawer::EndFrame(float deltaTime)
+{
+	DebugDrawer* instance = __Instance.load(std::memory_order_acquire);
+	if (instance != nullptr) {
+		instance->_EndFrame(deltaTime);
+	}
+}
@@ -1,20 +1,48 @@
 #pragma once
 #include <GLM/glm.hpp>
-#include <stack>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include "Graphics/VertexTypes.h"
 #include "Graphics/ShaderProgram.h"
+#include "Graphics/Buffers/PersistentStreamBuffer.h"
+
+/// <summary>
+/// Determines how debug primitives interact with the depth buffer
+/// </summary>
+enum class DebugDepthMode {
+	// Primitives are hidden behind scene geometry
+	DepthTested = 0,
+	// Primitives are drawn on top of everything
+	Overlay     = 1
+};
+
+/// <summary>
+/// Options for debug primitives, see DebugDrawer::PushOptions
+/// </summary>
+struct DebugDrawOptions {
+	DebugDepthMode DepthMode = DebugDepthMode::DepthTested;
+	// How long primitives should be drawn for in seconds, 0 will draw them for a single frame
+	float          Duration = 0.0f;
+};
 
 /// <summary>
 /// Utility class for drawing lines and triangles in an immediate mode style
-/// 
-/// Includes a stack for transformations and color, to ease implementation of complex
+///
+/// Includes a stack for transformations, color and options, to ease implementation of complex
 /// debuggers
+///
+/// Primitives can be drawn from any thread, each thread gets it's own batch (and it's own stacks)
+/// so threads never fight over a buffer. Batches are merged into a persistently mapped stream buffer
+/// when the drawer is flushed, and drawn with one draw call per primitive type and depth mode.
+/// Flushing and SetViewProjection must happen on the thread that owns the OpenGL context
 /// </summary>
 class DebugDrawer
 {
 public:
-	inline static const size_t LINE_BATCH_SIZE = 8192;
-	inline static const size_t TRI_BATCH_SIZE = 4096;
+	// The number of vertices per frame the stream buffer starts with, it grows as needed
+	inline static const size_t INITIAL_STREAM_SIZE = 16384;
 
 	// Delete copy and mode
 
@@ -23,39 +51,57 @@ public:
 	DebugDrawer& operator =(const DebugDrawer& other) = delete;
 	DebugDrawer& operator =(DebugDrawer&& other) = delete;
 
-	virtual ~DebugDrawer() = default;
+	virtual ~DebugDrawer();
 
 	/// <summary>
-	/// Gets the singleton instance of the debug drawer
+	/// Gets the singleton instance of the debug drawer, safe to call from any thread
 	/// </summary>
 	static DebugDrawer& Get();
 	/// <summary>
 	/// Disposes of all resources used by the debug drawer
 	/// </summary>
 	static void Uninitialize();
+	/// <summary>
+	/// Ages primitives that were drawn with a duration and moves to the next region of the stream buffer,
+	/// should be called once at the end of every frame. Does nothing if the drawer hasn't been created
+	/// </summary>
+	/// <param name="deltaTime">The unscaled time since the last frame, in seconds</param>
+	static void EndFrame(float deltaTime);
 
 	/// <summary>
-	/// Pushes a new color to the stack, replacing the existing value
+	/// Pushes a new color to the calling thread's stack, replacing the existing value
 	/// Will be used by commands that do not specify a color
 	/// </summary>
 	/// <param name="color">The new color for elements</param>
 	void PushColor(const glm::vec3& color);
 	/// <summary>
-	/// Pops a color from the stack, replacing the existing value
+	/// Pops a color from the calling thread's stack, replacing the existing value
 	/// Will be used by commands that do not specify a color
 	/// </summary>
 	glm::vec3 PopColor();
 
 	/// <summary>
-	/// Pushes a new transform to the stack, replacing the existing value and flushing all lines and tris
+	/// Pushes a new transform to the calling thread's stack, replacing the existing value. Points are
+	/// transformed as they are added, so this no longer needs to flush
 	/// </summary>
 	/// <param name="world">The new world transform to use for drawing</param>
 	void PushWorldMatrix(const glm::mat4& world);
 	/// <summary>
-	/// Pops a transform from the stack, replacing the existing value and flushing all lines and tris
+	/// Pops a transform from the calling thread's stack, replacing the existing value
 	/// </summary>
 	void PopWorldMatrix();
 
+	/// <summary>
+	/// Pushes new options to the calling thread's stack, they will be used by all primitives drawn
+	/// until they are popped
+	/// </summary>
+	/// <param name="options">The depth mode and duration for new primitives</param>
+	void PushOptions(const DebugDrawOptions& options);
+	/// <summary>
+	/// Pops options from the calling thread's stack, replacing the existing value
+	/// </summary>
+	DebugDrawOptions PopOptions();
+
 	/// <summary>
 	/// Draws a line between 2 points using the current debug color
 	/// </summary>
@@ -78,7 +124,7 @@ public:
 	/// <param name="c2">Color for second point</param>
 	void DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& color1, const glm::vec3& color2);
 	/// <summary>
-	/// Flushes all lines to the screen, resetting our line count to 0s
+	/// Flushes all lines to the screen
 	/// </summary>
 	void FlushLines();
 
@@ -111,12 +157,14 @@ public:
 	/// <param name="c3">Color for third point</param>
 	void DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3);
 	/// <summary>
-	/// Flushes all triangles to the screen, resetting our triangle count to 0s
+	/// Flushes all triangles to the screen
 	/// </summary>
 	void FlushTris();
 
 	/// <summary>
-	/// Flushes any remaining triangles and lines, drawing them to the screen and resetting their counters
+	/// Merges the batches from every thread and draws them to the screen. Primitives with a duration
+	/// are drawn by every flush until they expire, since earlier flushes may draw to a target that
+	/// never makes it to the screen
 	/// </summary>
 	void FlushAll();
 
@@ -128,21 +176,69 @@ public:
 protected:
 	DebugDrawer();
 
-	std::stack<glm::vec3> _colorStack;
-	std::stack<glm::mat4> _transformStack;
-	glm::mat4    _viewProjection;
-	glm::mat4    _worldMatrix;
-
-	size_t       _lineOffset;
-	VertexPosCol _lineBuffer[LINE_BATCH_SIZE * 2];
-	size_t       _triangleOffset;
-	VertexPosCol _triBuffer[TRI_BATCH_SIZE * 3];
-
-	VertexBuffer::Sptr _linesVBO;
-	VertexArrayObject::Sptr _linesVAO;
-	VertexBuffer::Sptr _trisVBO;
-	VertexArrayObject::Sptr _trisVAO;
-
-	inline static DebugDrawer* __Instance = nullptr;
+	enum PrimitiveType {
+		Lines     = 0,
+		Triangles = 1,
+		PrimitiveTypeCount
+	};
+	inline static const int DEPTH_MODE_COUNT = 2;
+	inline static const uint32_t VERTICES_PER_PRIMITIVE[PrimitiveTypeCount] = { 2, 3 };
+
+	// The vertices for one primitive type and depth mode
+	struct PrimitiveList {
+		std::vector<VertexPosCol> Vertices;
+		// Only used for primitives with a duration, the seconds remaining for each primitive
+		std::vector<float>        Lifetimes;
+	};
+
+	// Everything drawn by one thread since the last flush
+	struct ThreadBatch {
+		// Guards the primitive lists, the stacks are only ever touched by the owning thread
+		std::mutex                    Lock;
+		std::vector<glm::vec3>        ColorStack;
+		std::vector<glm::mat4>        TransformStack;
+		std::vector<DebugDrawOptions> OptionsStack;
+		PrimitiveList                 Frame[PrimitiveTypeCount][DEPTH_MODE_COUNT];
+		PrimitiveList                 Timed[PrimitiveTypeCount][DEPTH_MODE_COUNT];
+		// Set once the owning thread has exited, the batch is freed by the next flush that drains it
+		std::atomic<bool>             Orphaned{ false };
+
+		bool IsEmpty() const;
+	};
+
+	// Lives in thread local storage, so that a thread's batch is orphaned when the thread exits
+	struct ThreadBatchOwner {
+		// Shared with the drawer's list, so that either side can go away first
+		std::shared_ptr<ThreadBatch> Batch;
+		// The drawer that the batch belongs to, in case we were uninitialized and recreated
+		uint32_t                     Owner = 0;
+
+		~ThreadBatchOwner();
+	};
+
+	uint32_t  _instanceId;
+	glm::mat4 _viewProjection;
+
+	std::mutex                                _batchListLock;
+	std::vector<std::shared_ptr<ThreadBatch>> _threadBatches;
+
+	// Primitives with a duration that have been merged out of the thread batches, only touched on the main thread
+	PrimitiveList _timed[PrimitiveTypeCount][DEPTH_MODE_COUNT];
+
+	// Every flush in a frame writes to the same region of the stream buffer, we move on to the next region at the end of the frame
+	PersistentStreamBuffer<VertexBuffer, VertexPosCol> _stream;
+	VertexArrayObject::Sptr                            _streamVao;
+
+	ThreadBatch& _GetThreadBatch();
+	void _PushPrimitive(PrimitiveType type, const glm::vec3* points, const glm::vec3* colors);
+	void _Flush(bool lines, bool tris);
+	void _EndFrame(float deltaTime);
+
+	static void __InitShader();
+
+	inline static std::atomic<DebugDrawer*> __Instance{ nullptr };
+	inline static std::mutex __InstanceLock;
+	inline static uint32_t __NextInstanceId = 1;
 	inline static ShaderProgram::Sptr __Shader = nullptr;
-};
\ No newline at end of file
+	inline static UniformHandle<glm::mat4> __MvpUniform;
+};
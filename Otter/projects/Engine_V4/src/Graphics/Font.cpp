@@ -1,16 +1,41 @@
 #include "Graphics/Font.h"
 #include "Utils/FileHelpers.h"
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/HashUtils.h"
+#include "Utils/StringUtils.h"
 #include <set>
-#include <codecvt>
-#include <locale>
 #include <cstdint>
+#include <fstream>
+#include <filesystem>
 #include <stb_rect_pack.h>
-#include "Utils/JsonGlmHelpers.h"
 
 #define OVERSAMPLE_X 1
 #define OVERSAMPLE_Y 1
 #define PADDING 1
+// The number of pixels of distance field around each glyph, this limits how far outlines and glows can extend
+#define SDF_PADDING 6
+// The value in the distance field at the edge of a glyph
+#define SDF_ON_EDGE 128
+// How much the distance field value changes per pixel
+#define SDF_PIXEL_DIST_SCALE (128.0f / SDF_PADDING)
+// Distance field atlases grow until everything fits, up to this size
+#define MAX_ATLAS_SIZE 4096u
+
+// Written at the start of font cache files, bump when the layout of the file changes
+static const uint32_t FONT_CACHE_MAGIC = 0x31544E46; // FNT1
+
+struct FontCacheHeader {
+	uint32_t Magic;
+	uint32_t GlyphSize;
+	uint32_t GlyphCount;
+	uint32_t AtlasWidth;
+	uint32_t AtlasHeight;
+};
+
+bool        Font::_bakeCacheEnabled = true;
+std::string Font::_bakeCachePath = "cache/fonts/";
+// Glyphs for codepoints below this go in the direct lookup table, which is at most this many entries
+#define DIRECT_GLYPH_LIMIT 0x800u
 
 Font::Font() : Font("", 0.0f) { }
 
@@ -28,7 +53,11 @@ Font::Font(const std::string& fontPath, float size) :
 	_fontInfo(stbtt_fontinfo()),
 	_defaultGlyph(GlyphInfo()),
 	_atlasWidth(256),
-	_atlasHeight(256)
+	_atlasHeight(256),
+	_signedDistanceField(false),
+	_glyphCache(nullptr),
+	_dynamicGlyphs(std::unordered_map<uint32_t, GlyphInfo>()),
+	_glyphGeneration(0)
 {
 	// For the box character
 	_glyphRanges.push_back({ 0xE000u, 0xE000u });
@@ -54,6 +83,7 @@ void Font::Load(const std::string& fontPath, float size /*= 16.0f*/)
 	if (!data.empty()) {
 		_fontPath = fontPath;
 		_fontData = data;
+		_fontSize = size;
 
 		if (_glyphs != nullptr) {
 			delete[] _glyphs;
@@ -83,26 +113,80 @@ void Font::AddGlyphRange(uint32_t min, uint32_t max) {
 	_glyphRanges.push_back({ min, max });
 }
 
+void Font::SetSignedDistanceField(bool value) {
+	LOG_ASSERT(_atlas == nullptr, "Cannot change the font type after the font has been baked!");
+	_signedDistanceField = value;
+}
+
 void Font::Bake() {
 	LOG_ASSERT(_atlas == nullptr, "Bake has already been called!");
 	LOG_ASSERT(_fontInfo.data != nullptr, "Have not loaded a font asset!");
 
-	uint8_t* rawFontData = reinterpret_cast<uint8_t*>(_fontData.data());
-
 	// Collect all codepoint ranges into a set, so we have a list of unique codepoints
-	std::set<int> codePoints;
-	uint32_t numCodepoints = 0;
+	std::set<int> uniqueCodePoints;
 	for (const auto& range : _glyphRanges) {
 		for (uint32_t ix = range.x; ix <= range.y; ix++) {
 			// skip if the font doesn't have that glyph
 			if (!stbtt_FindGlyphIndex(&_fontInfo, ix)) {
 				continue;
 			}
-			numCodepoints += codePoints.emplace(ix).second ? 1 : 0;
+			uniqueCodePoints.emplace(ix);
 		}
 	}
+	// stb expects the codepoints to be contiguous in memory
+	std::vector<int> codePoints(uniqueCodePoints.begin(), uniqueCodePoints.end());
+	if (codePoints.empty()) {
+		LOG_ERROR("Font \"{}\" has none of the requested glyphs", _fontPath);
+		return;
+	}
+
+	// Only make the direct table as large as the highest codepoint that will go into it
+	uint32_t tableSize = 0;
+	for (uint32_t codepoint : codePoints) {
+		if (codepoint < DIRECT_GLYPH_LIMIT) {
+			tableSize = codepoint + 1;
+		}
+	}
+	_glyphTable.clear();
+	_glyphTable.resize(tableSize, GlyphInfo());
+	_glyphMap.clear();
+
+	// Rasterizing is the slow part of loading a font, so try to grab the results from an earlier run first
+	std::vector<uint8_t> atlasData;
+	std::string cacheFile = _bakeCacheEnabled ? _GetBakeCacheFile() : "";
+	if (cacheFile.empty() || !_LoadBakeCache(cacheFile, atlasData)) {
+		bool baked = _signedDistanceField ? _BakeSdf(codePoints, atlasData) : _BakeBitmap(codePoints, atlasData);
+		if (!baked) {
+			return;
+		}
+		if (!cacheFile.empty()) {
+			_SaveBakeCache(cacheFile, atlasData);
+		}
+	}
+
+	// Create a texture to store the atlas
+	Texture2DDescription desc;
+	desc.Width = _atlasWidth;
+	desc.Height = _atlasHeight;
+	desc.Format = InternalFormat::R8;
+	// Distance fields need to be interpolated between texels, and mip maps would blur the edges
+	if (_signedDistanceField) {
+		desc.MinificationFilter = MinFilter::Linear;
+		desc.GenerateMipMaps = false;
+	}
+	_atlas = std::make_shared<Texture2D>(desc);
+
+	// Upload data into the image
+	_atlas->LoadData(desc.Width, desc.Height, PixelFormat::Red, PixelType::UByte, atlasData.data());
+
+	_defaultGlyph = FindGlyph(0xE000u);
+}
+
+bool Font::_BakeBitmap(const std::vector<int>& codePoints, std::vector<uint8_t>& atlasData) {
+	uint8_t* rawFontData = reinterpret_cast<uint8_t*>(_fontData.data());
 
 	// Allocate our glyph data for the number of unicode character's we're supporting
+	uint32_t numCodepoints = static_cast<uint32_t>(codePoints.size());
 	_glyphs = new stbtt_packedchar[numCodepoints];
 	memset(_glyphs, 0, sizeof(stbtt_packedchar) * numCodepoints);
 
@@ -112,21 +196,19 @@ void Font::Bake() {
 	// Create the initial data structure, we'll store copies of this as we go
 	stbtt_pack_range current;
 	current.font_size = _fontSize;
-	current.first_unicode_codepoint_in_range = *codePoints.begin();
+	current.first_unicode_codepoint_in_range = codePoints[0];
 	current.num_chars = 0;
 	current.chardata_for_range = _glyphs;
 	current.h_oversample = OVERSAMPLE_X;
 	current.v_oversample = OVERSAMPLE_Y;
-	current.array_of_unicode_codepoints = (int*)(&*codePoints.begin());
+	current.array_of_unicode_codepoints = const_cast<int*>(codePoints.data());
 
-	// Calculate surface area of glyphs as we go
-	int totalSurface = 0;
 	// We track number of encoded characters, as well as the previous processed codepoint
 	// to check for jumps in the range
-	uint32_t prevCodePoint = *codePoints.begin() - 1;
+	uint32_t prevCodePoint = codePoints[0] - 1;
 	uint32_t encodedChars = 0;
 
-	// Iterate over the unique codepoint set (which is sorted!)
+	// Iterate over the unique codepoints (which are sorted!)
 	for (uint32_t codepoint : codePoints) {
 
 		// We have a break in the codepoints, start a new range!
@@ -138,7 +220,7 @@ void Font::Bake() {
 			// Start the next range
 			current.first_unicode_codepoint_in_range = codepoint;
 			current.chardata_for_range = _glyphs + encodedChars;
-			current.array_of_unicode_codepoints = (int*)(&*codePoints.begin()) + encodedChars;
+			current.array_of_unicode_codepoints = const_cast<int*>(codePoints.data()) + encodedChars;
 		}
 
 		// We have another character
@@ -152,62 +234,336 @@ void Font::Bake() {
 	current.num_chars = prevCodePoint - current.first_unicode_codepoint_in_range + 1;
 	ranges.push_back(current);
 
-	_CrtCheckMemory();
-
-	// Create a texture to store the atlas
-	Texture2DDescription desc;
-	desc.Width = _atlasWidth;
-	desc.Height = _atlasHeight;
-	desc.Format = InternalFormat::R8;
-	_atlas = std::make_shared<Texture2D>(desc);
-
 	// Allocate memory for the image, and point rect pack at it
-	uint8_t* atlasData = new uint8_t[desc.Width * (size_t)desc.Height];
-	memset(atlasData, 0, desc.Width * desc.Height);
+	atlasData.assign(_atlasWidth * (size_t)_atlasHeight, 0);
 
 	stbtt_pack_context context;
-	if (!stbtt_PackBegin(&context, atlasData, _atlasWidth, _atlasHeight, 0, 1, nullptr)) {
+	if (!stbtt_PackBegin(&context, atlasData.data(), _atlasWidth, _atlasHeight, 0, 1, nullptr)) {
 		LOG_ERROR("Failed to pack font texture");
-		delete[] atlasData;
-		return;
+		return false;
 	}
-	_CrtCheckMemory();
 
 	stbtt_PackSetOversampling(&context, OVERSAMPLE_X, OVERSAMPLE_Y);
 	for (auto& range : ranges) {
 		if (!stbtt_PackFontRange(&context, rawFontData, 0, range.font_size, range.first_unicode_codepoint_in_range, range.num_chars, range.chardata_for_range)) {
 			LOG_ERROR("Failed to pack font range");
-			delete[] atlasData;
-			return;
+			stbtt_PackEnd(&context);
+			return false;
 		}
-		_CrtCheckMemory();
 	}
 	stbtt_PackEnd(&context);
 
-	_CrtCheckMemory();
-
-	// Upload data into the image
-	_atlas->LoadData(desc.Width, desc.Height, PixelFormat::Red, PixelType::UByte, atlasData);
-	delete[] atlasData;
-
 	uint32_t index = 0;
 	for (uint32_t codepoint : codePoints) {
-		_glyphMap[codepoint] = __CreateGlyph(index);
+		GlyphInfo glyph = __CreateGlyph(index);
+		glyph.FontIndex = stbtt_FindGlyphIndex(&_fontInfo, codepoint);
+		_StoreGlyph(codepoint, glyph);
 		index++;
+	}
+	return true;
+}
 
-		if (codepoint == 0xE000u)
-			_defaultGlyph = _glyphMap[codepoint];
+bool Font::_BakeSdf(const std::vector<int>& codePoints, std::vector<uint8_t>& atlasData) {
+	// Generate the distance field for every glyph up front, so we know how much room they need
+	struct SdfBitmap {
+		uint8_t* Data;
+		int Width, Height, OffsetX, OffsetY;
+	};
+	std::vector<SdfBitmap> bitmaps(codePoints.size());
+	std::vector<stbrp_rect> rects(codePoints.size());
+	for (size_t ix = 0; ix < codePoints.size(); ix++) {
+		SdfBitmap& bitmap = bitmaps[ix];
+		// Glyphs with nothing to draw (ex: space) give us a null bitmap with no size
+		bitmap.Data = stbtt_GetCodepointSDF(&_fontInfo, _pixelHeightScale, codePoints[ix], SDF_PADDING, SDF_ON_EDGE, SDF_PIXEL_DIST_SCALE,
+			&bitmap.Width, &bitmap.Height, &bitmap.OffsetX, &bitmap.OffsetY);
+		if (bitmap.Data == nullptr) {
+			bitmap.Width = bitmap.Height = bitmap.OffsetX = bitmap.OffsetY = 0;
+		}
+
+		rects[ix].id = static_cast<int>(ix);
+		rects[ix].w = bitmap.Width + PADDING;
+		rects[ix].h = bitmap.Height + PADDING;
 	}
+
+	// Pack the glyphs, growing the atlas until they all fit
+	std::vector<stbrp_node> nodes;
+	bool packed = false;
+	while (!packed && _atlasWidth <= MAX_ATLAS_SIZE && _atlasHeight <= MAX_ATLAS_SIZE) {
+		nodes.resize(_atlasWidth);
+		stbrp_context context;
+		stbrp_init_target(&context, _atlasWidth, _atlasHeight, nodes.data(), static_cast<int>(nodes.size()));
+		packed = stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size())) != 0;
+		if (!packed) {
+			if (_atlasWidth <= _atlasHeight) {
+				_atlasWidth *= 2;
+			} else {
+				_atlasHeight *= 2;
+			}
+		}
+	}
+
+	if (packed) {
+		atlasData.assign(_atlasWidth * (size_t)_atlasHeight, 0);
+
+		for (size_t ix = 0; ix < codePoints.size(); ix++) {
+			const SdfBitmap& bitmap = bitmaps[ix];
+			const stbrp_rect& rect = rects[ix];
+
+			for (int row = 0; row < bitmap.Height; row++) {
+				memcpy(&atlasData[(rect.y + row) * (size_t)_atlasWidth + rect.x], bitmap.Data + row * bitmap.Width, bitmap.Width);
+			}
+
+			_StoreGlyph(codePoints[ix], _MakeGlyph(stbtt_FindGlyphIndex(&_fontInfo, codePoints[ix]),
+				glm::ivec2(bitmap.Width, bitmap.Height), glm::ivec2(bitmap.OffsetX, bitmap.OffsetY),
+				glm::uvec2(rect.x, rect.y), glm::uvec2(_atlasWidth, _atlasHeight)));
+		}
+	} else {
+		LOG_ERROR("Failed to pack distance field glyphs for \"{}\" into a {}x{} atlas", _fontPath, MAX_ATLAS_SIZE, MAX_ATLAS_SIZE);
+	}
+
+	for (SdfBitmap& bitmap : bitmaps) {
+		if (bitmap.Data != nullptr) {
+			stbtt_FreeSDF(bitmap.Data, nullptr);
+		}
+	}
+	return packed;
+}
+
+GlyphInfo Font::_MakeGlyph(int fontIndex, const glm::ivec2& size, const glm::ivec2& offset, const glm::uvec2& position, const glm::uvec2& textureSize) const {
+	int advance, leftBearing;
+	stbtt_GetGlyphHMetrics(&_fontInfo, fontIndex, &advance, &leftBearing);
+
+	// Same layout as __CreateGlyph, for distance fields the quad includes the padding around the field
+	float xmin = (float)offset.x;
+	float xmax = (float)(offset.x + size.x);
+	float ymin = (float)(offset.y + size.y);
+	float ymax = (float)offset.y;
+	float s0 = position.x / (float)textureSize.x;
+	float s1 = (position.x + size.x) / (float)textureSize.x;
+	float t0 = position.y / (float)textureSize.y;
+	float t1 = (position.y + size.y) / (float)textureSize.y;
+
+	GlyphInfo info = GlyphInfo();
+	info.OffsetX      = advance * _pixelHeightScale;
+	info.OffsetY      = 0.0f;
+	info.Positions[0] = { xmax, ymin };
+	info.Positions[1] = { xmax, ymax };
+	info.Positions[2] = { xmin, ymax };
+	info.Positions[3] = { xmin, ymin };
+	info.UVs[0]       = { s1, t1 };
+	info.UVs[1]       = { s1, t0 };
+	info.UVs[2]       = { s0, t0 };
+	info.UVs[3]       = { s0, t1 };
+	info.FontIndex    = fontIndex;
+	info.Page         = 0;
+	info.IsPacked     = true;
+	return info;
+}
+
+void Font::_StoreGlyph(uint32_t codePoint, const GlyphInfo& glyph) {
+	if (codePoint < _glyphTable.size()) {
+		_glyphTable[codePoint] = glyph;
+	} else {
+		_glyphMap[codePoint] = glyph;
+	}
+}
+
+void Font::SetBakeCacheEnabled(bool enabled) {
+	_bakeCacheEnabled = enabled;
+}
+
+void Font::SetBakeCachePath(const std::string& path) {
+	_bakeCachePath = path;
+}
+
+std::string Font::_GetBakeCacheFile() const {
+	// Hash the font file itself rather than the path, so replacing the font invalidates the cache
+	uint64_t hash = HashUtils::FNV_OFFSET_BASIS;
+	HashUtils::HashBytes(hash, _fontData.data(), _fontData.size());
+	HashUtils::HashBytes(hash, &_fontSize, sizeof(float));
+	HashUtils::HashBytes(hash, &_signedDistanceField, sizeof(bool));
+	HashUtils::HashBytes(hash, _glyphRanges.data(), _glyphRanges.size() * sizeof(glm::uvec2));
+	uint32_t settings[] = { OVERSAMPLE_X, OVERSAMPLE_Y, PADDING, SDF_PADDING, SDF_ON_EDGE, (uint32_t)(SDF_PIXEL_DIST_SCALE * 1000.0f) };
+	HashUtils::HashBytes(hash, settings, sizeof(settings));
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.font", static_cast<unsigned long long>(hash));
+	return _bakeCachePath + name;
+}
+
+bool Font::_LoadBakeCache(const std::string& file, std::vector<uint8_t>& atlasData) {
+	std::ifstream in(file, std::ios::in | std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	FontCacheHeader header;
+	in.read(reinterpret_cast<char*>(&header), sizeof(FontCacheHeader));
+	if (!in || header.Magic != FONT_CACHE_MAGIC || header.GlyphSize != sizeof(GlyphInfo)) {
+		LOG_TRACE("Ignoring stale font cache \"{}\"", file);
+		return false;
+	}
+
+	std::vector<uint32_t> codePoints(header.GlyphCount);
+	std::vector<GlyphInfo> glyphs(header.GlyphCount);
+	atlasData.resize(header.AtlasWidth * (size_t)header.AtlasHeight);
+	in.read(reinterpret_cast<char*>(codePoints.data()), codePoints.size() * sizeof(uint32_t));
+	in.read(reinterpret_cast<char*>(glyphs.data()), glyphs.size() * sizeof(GlyphInfo));
+	in.read(reinterpret_cast<char*>(atlasData.data()), atlasData.size());
+	if (!in) {
+		LOG_WARN("Font cache \"{}\" is truncated, rebaking", file);
+		return false;
+	}
+
+	_atlasWidth = header.AtlasWidth;
+	_atlasHeight = header.AtlasHeight;
+	for (size_t ix = 0; ix < codePoints.size(); ix++) {
+		_StoreGlyph(codePoints[ix], glyphs[ix]);
+	}
+	return true;
+}
+
+void Font::_SaveBakeCache(const std::string& file, const std::vector<uint8_t>& atlasData) const {
+	// Flatten the glyph table and map into a single list
+	std::vector<uint32_t> codePoints;
+	std::vector<GlyphInfo> glyphs;
+	for (uint32_t ix = 0; ix < _glyphTable.size(); ix++) {
+		if (_glyphTable[ix].IsPacked) {
+			codePoints.push_back(ix);
+			glyphs.push_back(_glyphTable[ix]);
+		}
+	}
+	for (const auto& [codePoint, glyph] : _glyphMap) {
+		codePoints.push_back(codePoint);
+		glyphs.push_back(glyph);
+	}
+
+	FontCacheHeader header;
+	header.Magic = FONT_CACHE_MAGIC;
+	header.GlyphSize = sizeof(GlyphInfo);
+	header.GlyphCount = static_cast<uint32_t>(glyphs.size());
+	header.AtlasWidth = _atlasWidth;
+	header.AtlasHeight = _atlasHeight;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+	std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out) {
+		LOG_WARN("Failed to write font cache file \"{}\"", file);
+		return;
+	}
+	out.write(reinterpret_cast<const char*>(&header), sizeof(FontCacheHeader));
+	out.write(reinterpret_cast<const char*>(codePoints.data()), codePoints.size() * sizeof(uint32_t));
+	out.write(reinterpret_cast<const char*>(glyphs.data()), glyphs.size() * sizeof(GlyphInfo));
+	out.write(reinterpret_cast<const char*>(atlasData.data()), atlasData.size());
 }
 
 const Texture2D::Sptr& Font::GetAtlas() {
 	return _atlas;
 }
 
+const GlyphInfo& Font::FindGlyph(uint32_t codePoint) const {
+	// Most text only uses the direct table, entries that weren't baked aren't marked as packed
+	if (codePoint < _glyphTable.size()) {
+		const GlyphInfo& glyph = _glyphTable[codePoint];
+		return glyph.IsPacked ? glyph : _defaultGlyph;
+	}
+	auto it = _glyphMap.find(codePoint);
+	if (it != _glyphMap.end()) {
+		return it->second;
+	}
+	auto dynamic = _dynamicGlyphs.find(codePoint);
+	return dynamic == _dynamicGlyphs.end() ? _defaultGlyph : dynamic->second;
+}
+
+const GlyphInfo& Font::RequestGlyph(uint32_t codePoint) {
+	if (_glyphCache == nullptr) {
+		return FindGlyph(codePoint);
+	}
+
+	// Baked glyphs are always available
+	if (codePoint < _glyphTable.size() && _glyphTable[codePoint].IsPacked) {
+		return _glyphTable[codePoint];
+	}
+	auto it = _glyphMap.find(codePoint);
+	if (it != _glyphMap.end()) {
+		return it->second;
+	}
+
+	// Keep the page for a cached glyph alive, or rasterize it if we haven't seen it before
+	auto dynamic = _dynamicGlyphs.find(codePoint);
+	if (dynamic != _dynamicGlyphs.end()) {
+		_glyphCache->Touch(dynamic->second.Page - 1);
+		return dynamic->second;
+	}
+	return _RasterizeGlyph(codePoint);
+}
+
+const GlyphInfo& Font::_RasterizeGlyph(uint32_t codePoint) {
+	int fontIndex = stbtt_FindGlyphIndex(&_fontInfo, codePoint);
+	if (fontIndex == 0) {
+		return _defaultGlyph;
+	}
+
+	// Glyphs with nothing to draw (ex: space) give us a null bitmap with no size
+	glm::ivec2 size, offset;
+	uint8_t* bitmap = _signedDistanceField ?
+		stbtt_GetGlyphSDF(&_fontInfo, _pixelHeightScale, fontIndex, SDF_PADDING, SDF_ON_EDGE, SDF_PIXEL_DIST_SCALE, &size.x, &size.y, &offset.x, &offset.y) :
+		stbtt_GetGlyphBitmap(&_fontInfo, _pixelHeightScale, _pixelHeightScale, fontIndex, &size.x, &size.y, &offset.x, &offset.y);
+	if (bitmap == nullptr) {
+		size = offset = glm::ivec2(0);
+	}
+
+	GlyphCache::Slot slot;
+	uint32_t evictedPage;
+	bool allocated = _glyphCache->Allocate(size.x + PADDING, size.y + PADDING, slot, evictedPage);
+
+	// Forget every glyph that was on an evicted page, layouts that used them will be rebuilt
+	if (evictedPage != GlyphCache::NO_PAGE) {
+		for (auto it = _dynamicGlyphs.begin(); it != _dynamicGlyphs.end();) {
+			it = it->second.Page == evictedPage + 1 ? _dynamicGlyphs.erase(it) : std::next(it);
+		}
+		_glyphGeneration++;
+	}
+
+	if (allocated && bitmap != nullptr) {
+		_glyphCache->Write(slot, size.x, size.y, bitmap);
+	}
+	if (bitmap != nullptr) {
+		if (_signedDistanceField) {
+			stbtt_FreeSDF(bitmap, nullptr);
+		} else {
+			stbtt_FreeBitmap(bitmap, nullptr);
+		}
+	}
+
+	if (!allocated) {
+		LOG_WARN("No room in the glyph cache for U+{:04X} in \"{}\", every page is in use", codePoint, _fontPath);
+		return _defaultGlyph;
+	}
+
+	uint32_t pageSize = _glyphCache->GetPageSize();
+	GlyphInfo glyph = _MakeGlyph(fontIndex, size, offset, slot.Offset, glm::uvec2(pageSize));
+	glyph.Page = slot.Page + 1;
+	return _dynamicGlyphs[codePoint] = glyph;
+}
+
+void Font::EnableDynamicGlyphs(uint32_t pageSize /*= 512*/, uint32_t maxPages /*= 4*/) {
+	// Anything in the old cache is gone, so layouts that used it need rebuilding
+	if (!_dynamicGlyphs.empty()) {
+		_dynamicGlyphs.clear();
+		_glyphGeneration++;
+	}
+	_glyphCache = maxPages > 0 ? std::make_shared<GlyphCache>(pageSize, maxPages) : nullptr;
+}
+
+const Texture2D::Sptr& Font::GetPageTexture(uint32_t page) const {
+	return page == 0 ? _atlas : _glyphCache->GetPageTexture(page - 1);
+}
+
 GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const {
 	// Try and get glyph info from the codepoint, otherwise grab the default glyph
-	auto it = _glyphMap.find(codePoint);		
-	GlyphInfo result = it == _glyphMap.end() ? _defaultGlyph : it->second;
+	GlyphInfo result = FindGlyph(codePoint);
 
 	result.OffsetX += offsetX;
 	result.OffsetY += offsetY;
@@ -216,7 +572,8 @@ GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const
 }
 
 float Font::GetKerning(int char1, int char2) const {
-	return stbtt_GetCodepointKernAdvance(&_fontInfo, char1, char2) * _pixelHeightScale;
+	// Using the glyph indices we found when baking saves stb from searching the font's cmap for both characters
+	return stbtt_GetGlyphKernAdvance(&_fontInfo, FindGlyph(char1).FontIndex, FindGlyph(char2).FontIndex) * _pixelHeightScale;
 }
 
 float Font::GetLineHeight() const {
@@ -225,8 +582,7 @@ float Font::GetLineHeight() const {
 
 glm::vec2 Font::MeausureString(const std::string& text, const float scale /*= 1.0f*/) {
 	// We can convert an ASCII string to unicode!
-	std::wstring unicode = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(text);
-	return MeausureString(unicode, scale);
+	return MeausureString(StringTools::ToUnicode(text), scale);
 }
 
 glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1.0f*/) {
@@ -241,9 +597,9 @@ glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1
 
 	// Iterate over all characters, ascii and unicode overlap in the 0-255 range!
 	for (size_t i = 0; i < text.size(); i++) {
-		glyph = GetGlyph(text[i], xOff, yOff);
-		xOff = glyph.OffsetX;
-		yOff = glyph.OffsetY;
+		glyph = RequestGlyph(text[i]);
+		xOff += glyph.OffsetX;
+		yOff += glyph.OffsetY;
 
 		lineHeight = glm::max(lineHeight, -glyph.Positions[1].y);
 		maxWidth = glm::max(maxWidth, xOff);
@@ -266,6 +622,59 @@ glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1
 	return glm::vec2(maxWidth, totalHeight) * scale;
 }
 
+void Font::LayoutText(const std::wstring& text, float scale, TextLayout& result) {
+	result.Glyphs.clear();
+	result.Glyphs.reserve(text.size());
+
+	// Tracks the offset of the next character, before scaling
+	glm::vec2 offset = glm::vec2(0.0f);
+	float lineHeight = 0.0f;
+	float maxWidth = 0.0f;
+	float totalHeight = 0.0f;
+
+	for (size_t i = 0; i < text.size(); i++) {
+		// A newline will advance to the next line and return to the start of the line
+		if (text[i] == '\n') {
+			offset.y += GetLineHeight();
+			offset.x = 0.0f;
+			totalHeight += lineHeight;
+			lineHeight = 0.0f;
+		}
+		// A return character simply returns to the start of the line
+		else if (text[i] == '\r') {
+			offset.x = 0.0f;
+		}
+		// A tab character is 4 spaces
+		else if (text[i] == '\t') {
+			offset.x += RequestGlyph(' ').OffsetX * 4;
+		}
+		// All other characters get a glyph
+		else {
+			const GlyphInfo& glyph = RequestGlyph(text[i]);
+
+			// Corners 2 and 0 of the glyph are it's min and max
+			TextLayout::Glyph& quad = result.Glyphs.emplace_back();
+			quad.Min   = (offset + glyph.Positions[2]) * scale;
+			quad.Max   = (offset + glyph.Positions[0]) * scale;
+			quad.UVMin = glyph.UVs[2];
+			quad.UVMax = glyph.UVs[0];
+			quad.Page  = glyph.Page;
+
+			lineHeight = glm::max(lineHeight, -glyph.Positions[1].y);
+
+			// Advance the offset based on the size of the glyph, plus any kerning with the next character
+			offset += glm::vec2(glyph.OffsetX, glyph.OffsetY);
+			if (i < text.size() - 1) {
+				// Request the next glyph so that dynamic glyphs have their font index for kerning
+				offset.x += stbtt_GetGlyphKernAdvance(&_fontInfo, glyph.FontIndex, RequestGlyph(text[i + 1]).FontIndex) * _pixelHeightScale;
+			}
+		}
+		maxWidth = glm::max(maxWidth, offset.x);
+	}
+	totalHeight += lineHeight;
+	result.Size = glm::vec2(maxWidth, totalHeight) * scale;
+	result.Generation = _glyphGeneration;
+}
 
 GlyphInfo Font::__CreateGlyph(uint32_t index)
 {
@@ -299,7 +708,10 @@ nlohmann::json Font::ToJson() const
 {
 	nlohmann::json blob = {
 		{ "filename", _fontPath },
-		{ "font_size", _fontSize }
+		{ "font_size", _fontSize },
+		{ "sdf",       _signedDistanceField },
+		{ "dynamic_page_size", _glyphCache != nullptr ? _glyphCache->GetPageSize() : 0 },
+		{ "dynamic_pages",     _glyphCache != nullptr ? _glyphCache->GetMaxPages() : 0 }
 	};
 
 	nlohmann::json ranges = std::vector<nlohmann::json>();
@@ -317,6 +729,11 @@ Font::Sptr Font::FromJson(const nlohmann::json& data) {
 	std::string path = JsonGet<std::string>(data, "filename", "");
 	float size = JsonGet(data, "font_size", 16.0f);
 	result->Load(path, size);
+	result->_signedDistanceField = JsonGet(data, "sdf", false);
+	uint32_t dynamicPages = JsonGet(data, "dynamic_pages", 0u);
+	if (dynamicPages > 0) {
+		result->EnableDynamicGlyphs(JsonGet(data, "dynamic_page_size", 512u), dynamicPages);
+	}
 		
 	// Iterate over the ranges and add them to the font
 	if (data.contains("ranges") && data["ranges"].is_array()) {
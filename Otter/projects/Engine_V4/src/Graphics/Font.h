@@ -2,16 +2,48 @@
 
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/Textures/Texture2D.h"
+#include "Graphics/GlyphCache.h"
 
 #include <stb_truetype.h>
+#include <unordered_map>
 
 	struct GlyphInfo {
 		glm::vec2 Positions[4];
 		glm::vec2 UVs[4];
 		float OffsetX, OffsetY;
+		// The index of the glyph within the font file, used to look up kerning
+		int FontIndex;
+		// 0 if the glyph is in the baked atlas, otherwise 1 + it's page in the dynamic glyph cache
+		uint32_t Page;
 		bool IsPacked;
 	};
 
+	/// <summary>
+	/// The result of laying out a string of text with a font, see Font::LayoutText.
+	/// GUI elements can keep one of these around so that text that isn't changing doesn't
+	/// need to look up glyphs and kerning every time it is drawn
+	/// </summary>
+	struct TextLayout {
+		struct Glyph {
+			// The min and max corners of the glyph, relative to the start of the text
+			glm::vec2 Min;
+			glm::vec2 Max;
+			// The UV coords within the font's atlas at the Min and Max corners
+			glm::vec2 UVMin;
+			glm::vec2 UVMax;
+			// The texture page the glyph is on, see Font::GetPageTexture
+			uint32_t  Page;
+		};
+
+		// One entry for every visible character, whitespace and control characters are skipped
+		std::vector<Glyph> Glyphs;
+		// The size of the text, the same as Font::MeausureString would return
+		glm::vec2 Size;
+		// The font's glyph generation when the layout was made, if they no longer match glyphs that
+		// the layout uses were evicted from the font's glyph cache and it needs to be rebuilt
+		uint32_t  Generation;
+	};
+
 	/// <summary>
 	/// The font resource wraps around stb_truetype to allow us to render text to the screen
 	/// A Font class contains the texture atlas and data needed to render glyphs using said atlas
@@ -43,11 +75,55 @@
 		/// <param name="max">The maximum unicode character (inclusive)</param>
 		void AddGlyphRange(uint32_t min, uint32_t max);
 
+		/// <summary>
+		/// Sets whether the font should be baked as a signed distance field instead of a regular bitmap.
+		/// Distance field fonts stay sharp at any scale, so one font can be used for every text size.
+		/// Must be called before Bake
+		/// </summary>
+		void SetSignedDistanceField(bool value);
+		/// <summary>
+		/// Returns true if the font's atlas stores distance fields, the GUI shader needs to know
+		/// so that it can find the edges of glyphs
+		/// </summary>
+		bool IsSignedDistanceField() const { return _signedDistanceField; }
+
+		/// <summary>
+		/// Lets the font rasterize glyphs outside of it's baked ranges the first time they are used, into a
+		/// cache of texture pages. This is how large character sets (ex: CJK) should be supported, instead of
+		/// baking every glyph up front. When the pages are full, the least recently used page is evicted
+		/// </summary>
+		/// <param name="pageSize">The width and height of each page in pixels</param>
+		/// <param name="maxPages">The most pages to create before evicting</param>
+		void EnableDynamicGlyphs(uint32_t pageSize = 512, uint32_t maxPages = 4);
+		/// <summary>
+		/// Returns true if glyphs outside the baked ranges are rasterized as they are needed
+		/// </summary>
+		bool HasDynamicGlyphs() const { return _glyphCache != nullptr; }
+		/// <summary>
+		/// Gets the texture for a glyph page, page 0 is the baked atlas and the rest are
+		/// pages in the dynamic glyph cache
+		/// </summary>
+		const Texture2D::Sptr& GetPageTexture(uint32_t page) const;
+		/// <summary>
+		/// Gets a counter that increases every time glyphs are evicted from the dynamic glyph cache, see TextLayout::Generation
+		/// </summary>
+		uint32_t GetGlyphGeneration() const { return _glyphGeneration; }
+
 		/// <summary>
 		/// Generates the texture to use when rendering with this font, must be called
-		/// before the font is used
+		/// before the font is used. The results are cached on disk, keyed on the contents of the font
+		/// file, size and glyph ranges, so later runs can skip rasterizing the glyphs
 		/// </summary>
 		void Bake();
+
+		/// <summary>
+		/// Enables or disables the on-disk cache of baked font atlases, enabled by default
+		/// </summary>
+		static void SetBakeCacheEnabled(bool enabled);
+		/// <summary>
+		/// Sets the folder that baked fonts will be cached in, defaults to cache/fonts/
+		/// </summary>
+		static void SetBakeCachePath(const std::string& path);
 		/// <summary>
 		/// Gets the texture atlas for this font
 		/// </summary>
@@ -62,6 +138,18 @@
 		/// <param name="offsetY">The y position of the glyph</param>
 		GlyphInfo GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const;
 		/// <summary>
+		/// Gets the glyph for a codepoint without copying it, or the default glyph if
+		/// the codepoint was not baked into the font
+		/// </summary>
+		/// <param name="codePoint">The unicode codepoint to lookup</param>
+		const GlyphInfo& FindGlyph(uint32_t codePoint) const;
+		/// <summary>
+		/// Gets the glyph for a codepoint, rasterizing it into the dynamic glyph cache if it
+		/// is not baked and dynamic glyphs are enabled
+		/// </summary>
+		/// <param name="codePoint">The unicode codepoint to lookup</param>
+		const GlyphInfo& RequestGlyph(uint32_t codePoint);
+		/// <summary>
 		/// Gets the kerning (horizontal space) between 2 unicode characters
 		/// </summary>
 		/// <param name="char1">The left character</param>
@@ -89,12 +177,23 @@
 		/// <returns>The dimension of the string as rendered with this font</returns>
 		virtual glm::vec2 MeausureString(const std::wstring& text, const float scale = 1.0f);
 
+		/// <summary>
+		/// Calculates the position of every glyph in a string, including kerning and line breaks
+		/// </summary>
+		/// <param name="text">The unicode text to lay out</param>
+		/// <param name="scale">The scaling to apply to the text, default is 1.0f</param>
+		/// <param name="result">The layout to store the results in, it's memory is reused</param>
+		void LayoutText(const std::wstring& text, float scale, TextLayout& result);
+
 		virtual nlohmann::json ToJson() const override;
 		static Font::Sptr FromJson(const nlohmann::json& data);
 
 	protected:
 		std::vector<glm::uvec2> _glyphRanges;
-		std::map<uint32_t, GlyphInfo> _glyphMap;
+		// Glyphs for low codepoints (ASCII, latin, greek, cyrillic, etc) are indexed directly by their codepoint,
+		// anything else is looked up in the map
+		std::vector<GlyphInfo>        _glyphTable;
+		std::unordered_map<uint32_t, GlyphInfo> _glyphMap;
 		GlyphInfo                     _defaultGlyph;
 		Texture2D::Sptr   _atlas;
 		std::string       _fontPath;
@@ -113,5 +212,38 @@
 		stbtt_packedchar* _glyphs;
 		stbtt_fontinfo    _fontInfo;
 
+		bool              _signedDistanceField;
+
+		// Glyphs outside the baked ranges, which get rasterized as they are requested
+		GlyphCache::Sptr  _glyphCache;
+		std::unordered_map<uint32_t, GlyphInfo> _dynamicGlyphs;
+		uint32_t          _glyphGeneration;
+
+		static bool        _bakeCacheEnabled;
+		static std::string _bakeCachePath;
+
 		GlyphInfo __CreateGlyph(uint32_t index);
+		// Puts a glyph in the direct table or the map, depending on it's codepoint
+		void _StoreGlyph(uint32_t codePoint, const GlyphInfo& glyph);
+		// Rasterizes the glyphs at the font size with stb's packer
+		bool _BakeBitmap(const std::vector<int>& codePoints, std::vector<uint8_t>& atlasData);
+		// Generates a distance field for each glyph and packs them into an atlas
+		bool _BakeSdf(const std::vector<int>& codePoints, std::vector<uint8_t>& atlasData);
+		// Builds the glyph info for a bitmap or distance field that was placed in a texture
+		GlyphInfo _MakeGlyph(int fontIndex, const glm::ivec2& size, const glm::ivec2& offset, const glm::uvec2& position, const glm::uvec2& textureSize) const;
+		// Rasterizes a glyph into the dynamic glyph cache
+		const GlyphInfo& _RasterizeGlyph(uint32_t codePoint);
+
+		/// <summary>
+		/// Gets the name of the file that this font's baked atlas would be cached in
+		/// </summary>
+		std::string _GetBakeCacheFile() const;
+		/// <summary>
+		/// Tries to load the glyphs and atlas from the cache, returns true if they were loaded
+		/// </summary>
+		bool _LoadBakeCache(const std::string& file, std::vector<uint8_t>& atlasData);
+		/// <summary>
+		/// Stores the glyphs and atlas in the cache
+		/// </summary>
+		void _SaveBakeCache(const std::string& file, const std::vector<uint8_t>& atlasData) const;
 	};
\ No newline at end of file
@@ -64,8 +64,11 @@ void Framebuffer::Resize(uint32_t width, uint32_t height) {
 		_description.Height = height;
 
 		// Re-attach all our rendertargets (releasing our references and re-creating them)
+		// External textures are left for their owner to resize
 		for (const auto& kvp : _targets) {
-			_AddAttachment(kvp.first, kvp.second.Description);
+			if (!kvp.second.IsExternal) {
+				_AddAttachment(kvp.first, kvp.second.Description);
+			}
 		}
 
 		// Make sure we're good for rendering
@@ -77,6 +80,25 @@ void Framebuffer::Resize(const glm::ivec2& size) {
 	Resize(size.x, size.y);
 }
 
+void Framebuffer::AttachTexture(RenderTargetAttachment attachment, const Texture2D::Sptr& texture)
+{
+	LOG_ASSERT(texture != nullptr, "Cannot attach a null texture");
+
+	// If this is a new color attachment, add it to the draw buffers so OpenGL knows to render to it
+	if (_targets.find(attachment) == _targets.end() && IsColorAttachment(attachment)) {
+		_drawBuffers.push_back(attachment);
+		glNamedFramebufferDrawBuffers(_rendererId, _drawBuffers.size(), reinterpret_cast<GLenum*>(_drawBuffers.data()));
+	}
+
+	RenderTarget& buffer = _targets[attachment];
+	buffer.Description = RenderTargetDescriptor((RenderTargetType)texture->GetFormat());
+	buffer.IsRenderBuffer = false;
+	buffer.IsExternal = true;
+	buffer.Resource = texture;
+
+	glNamedFramebufferTexture(_rendererId, *attachment, texture->GetHandle(), 0);
+}
+
 // meat and potatoes
 void Framebuffer::_AddAttachment(RenderTargetAttachment attachment, const RenderTargetDescriptor& target)
 {
@@ -95,6 +117,7 @@ void Framebuffer::_AddAttachment(RenderTargetAttachment attachment, const Render
 	RenderTarget& buffer = _targets[attachment];
 	buffer.Description = target;
 	buffer.IsRenderBuffer = !target.UseTexture;
+	buffer.IsExternal = false;
 
 	// Handle creating render buffers 
 	if (buffer.IsRenderBuffer) {
@@ -313,5 +336,6 @@ Framebuffer::Sptr Framebuffer::FromJson(const nlohmann::json& blob) {
 Framebuffer::RenderTarget::RenderTarget() :
 	Resource(nullptr),
 	IsRenderBuffer(false),
+	IsExternal(false),
 	Description(RenderTargetDescriptor())
 { }
@@ -97,6 +97,15 @@ public:
 	 */
 	void Resize(const glm::ivec2& size);
 
+	/**
+	 * Attaches a texture that is owned elsewhere (ex: by a render graph) to this framebuffer. The texture
+	 * must be the same size as the framebuffer, and will not be re-created when the framebuffer is resized
+	 *
+	 * @param attachment The render target attachment slot to attach the texture to
+	 * @param texture    The texture to attach
+	 */
+	void AttachTexture(RenderTargetAttachment attachment, const Texture2D::Sptr& texture);
+
 	/**
 	 * Validates the framebuffer and returns true if it is ready for use in rendering
 	 */
@@ -176,6 +185,8 @@ protected:
 		IGraphicsResource::Sptr Resource;
 		// True if the resource is a renderbuffer, false for textures
 		bool                    IsRenderBuffer;
+		// True if the resource was attached with AttachTexture, and is not owned by this framebuffer
+		bool                    IsExternal;
 		// The descriptor for this render target
 		RenderTargetDescriptor  Description;
 
@@ -17,6 +17,7 @@ ENUM(ShaderPartType, GLint,
 	 TessControl  = GL_TESS_CONTROL_SHADER,
 	 TessEval     = GL_TESS_EVALUATION_SHADER,
 	 Geometry     = GL_GEOMETRY_SHADER,
+	 Compute      = GL_COMPUTE_SHADER,
 	 Unknown      = GL_NONE // Usually good practice to have an "unknown" or "none" state for enums
 )
 
@@ -28,6 +29,7 @@ ENUM(TextureType, GLenum,
 	_1D            = GL_TEXTURE_1D,
 	_2D            = GL_TEXTURE_2D,
 	_3D            = GL_TEXTURE_3D,
+	_2DArray       = GL_TEXTURE_2D_ARRAY,
 	Cubemap        = GL_TEXTURE_CUBE_MAP,
 	_2DMultisample = GL_TEXTURE_2D_MULTISAMPLE
 )
@@ -748,7 +750,9 @@ ENUM(BlendEquation, uint32_t,
 ENUM(BufferType, GLenum,
 	Vertex  = GL_ARRAY_BUFFER,
 	Index   = GL_ELEMENT_ARRAY_BUFFER,
-	Uniform = GL_UNIFORM_BUFFER
+	Uniform = GL_UNIFORM_BUFFER,
+	DrawIndirect = GL_DRAW_INDIRECT_BUFFER,
+	ShaderStorage = GL_SHADER_STORAGE_BUFFER
 )
 
 /// <summary>
@@ -810,8 +814,12 @@ ENUM(AttributeType, GLenum,
 	 UShort  = GL_UNSIGNED_SHORT,
 	 Int     = GL_INT,
 	 UInt    = GL_UNSIGNED_INT,
+	 HalfFloat = GL_HALF_FLOAT,
 	 Float   = GL_FLOAT,
 	 Double  = GL_DOUBLE,
+	 // Packed formats, 3 10 bit components and one 2 bit component in a single 32 bit value
+	 Int2_10_10_10  = GL_INT_2_10_10_10_REV,
+	 UInt2_10_10_10 = GL_UNSIGNED_INT_2_10_10_10_REV,
 	 Unknown = GL_NONE
 )
 
@@ -0,0 +1,222 @@
+#include "Graphics/GlyphCache.h"
+#include <algorithm>
+#include <Logging.h>
+
+// Start a few frames in so that new pages aren't immediately old enough to evict
+uint64_t GlyphCache::_frame = 2;
+bool GlyphCache::_evicted = false;
+std::vector<GlyphCache*> GlyphCache::_instances;
+std::unordered_map<const Texture2D*, std::pair<GlyphCache*, uint32_t>> GlyphCache::_pageLookup;
+
+GlyphCache::GlyphCache(uint32_t pageSize /*= 512*/, uint32_t maxPages /*= 4*/) :
+	_pageSize(pageSize),
+	_maxPages(glm::max(maxPages, 1u)),
+	_pages(std::vector<Page>())
+{
+	_instances.push_back(this);
+}
+
+GlyphCache::~GlyphCache() {
+	_instances.erase(std::remove(_instances.begin(), _instances.end(), this), _instances.end());
+	for (const Page& page : _pages) {
+		_pageLookup.erase(page.Texture.get());
+	}
+}
+
+bool GlyphCache::Allocate(uint32_t width, uint32_t height, Slot& result, uint32_t& evictedPage) {
+	evictedPage = NO_PAGE;
+	if (width > _pageSize || height > _pageSize) {
+		return false;
+	}
+
+	for (uint32_t ix = 0; ix < _pages.size(); ix++) {
+		if (_TryPack(_pages[ix], width, height, result.Offset)) {
+			result.Page = ix;
+			Touch(ix);
+			return true;
+		}
+	}
+
+	// Nothing has room, make a new page if we can
+	if (_pages.size() < _maxPages) {
+		_CreatePage();
+		result.Page = static_cast<uint32_t>(_pages.size() - 1);
+	}
+	// Otherwise clear out the page that was used the longest time ago
+	else {
+		uint32_t oldest = NO_PAGE;
+		for (uint32_t ix = 0; ix < _pages.size(); ix++) {
+			// Geometry from last frame may be replayed this frame, so those pages are off limits
+			if (_pages[ix].LastUsed + 1 < _frame && (oldest == NO_PAGE || _pages[ix].LastUsed < _pages[oldest].LastUsed)) {
+				oldest = ix;
+			}
+		}
+		if (oldest == NO_PAGE) {
+			return false;
+		}
+
+		_ClearPage(_pages[oldest]);
+		evictedPage = oldest;
+		_evicted = true;
+		result.Page = oldest;
+	}
+
+	// The page is empty, so this can only fail if the image is larger than a page which we checked above
+	_TryPack(_pages[result.Page], width, height, result.Offset);
+	Touch(result.Page);
+	return true;
+}
+
+void GlyphCache::Write(const Slot& slot, uint32_t width, uint32_t height, const uint8_t* data) {
+	Page& page = _pages[slot.Page];
+	for (uint32_t row = 0; row < height; row++) {
+		memcpy(&page.Pixels[(slot.Offset.y + row) * (size_t)_pageSize + slot.Offset.x], data + row * (size_t)width, width);
+	}
+	_MarkDirty(page, slot.Offset, slot.Offset + glm::uvec2(width, height));
+}
+
+void GlyphCache::Touch(uint32_t page) {
+	_pages[page].LastUsed = _frame;
+}
+
+void GlyphCache::Upload() {
+	for (Page& page : _pages) {
+		if (!page.Dirty) {
+			continue;
+		}
+
+		// Upload only the area that changed, straight out of our copy of the page
+		glm::uvec2 min = glm::uvec2(page.DirtyRect);
+		glm::uvec2 size = glm::uvec2(page.DirtyRect.z, page.DirtyRect.w) - min;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, _pageSize);
+		glTextureSubImage2D(page.Texture->GetHandle(), 0, min.x, min.y, size.x, size.y, GL_RED, GL_UNSIGNED_BYTE,
+			page.Pixels.data() + min.y * (size_t)_pageSize + min.x);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+		page.Dirty = false;
+	}
+}
+
+bool GlyphCache::UploadAll() {
+	for (GlyphCache* cache : _instances) {
+		cache->Upload();
+	}
+	_frame++;
+
+	bool result = _evicted;
+	_evicted = false;
+	return result;
+}
+
+void GlyphCache::MarkUsed(const Texture2D* texture) {
+	auto it = _pageLookup.find(texture);
+	if (it != _pageLookup.end()) {
+		it->second.first->Touch(it->second.second);
+	}
+}
+
+void GlyphCache::_CreatePage() {
+	Texture2DDescription desc;
+	desc.Width  = _pageSize;
+	desc.Height = _pageSize;
+	desc.Format = InternalFormat::R8;
+	desc.HorizontalWrap = WrapMode::ClampToEdge;
+	desc.VerticalWrap   = WrapMode::ClampToEdge;
+	desc.MinificationFilter = MinFilter::Linear;
+	desc.GenerateMipMaps = false;
+
+	Page page;
+	page.Texture = std::make_shared<Texture2D>(desc);
+	page.Pixels.resize(_pageSize * (size_t)_pageSize);
+	_ClearPage(page);
+	page.LastUsed = _frame;
+
+	_pageLookup[page.Texture.get()] = { this, static_cast<uint32_t>(_pages.size()) };
+	_pages.push_back(std::move(page));
+}
+
+void GlyphCache::_ClearPage(Page& page) {
+	std::fill(page.Pixels.begin(), page.Pixels.end(), (uint8_t)0);
+	page.Skyline.clear();
+	page.Skyline.push_back({ 0, 0, _pageSize });
+	// The whole page needs to be uploaded to clear out the old glyphs
+	page.Dirty = false;
+	_MarkDirty(page, glm::uvec2(0), glm::uvec2(_pageSize));
+}
+
+bool GlyphCache::_TryPack(Page& page, uint32_t width, uint32_t height, glm::uvec2& offset) {
+	std::vector<SkylineNode>& skyline = page.Skyline;
+
+	// Find the spot where the image would sit lowest (bottom-left heuristic), preferring narrower spans on ties
+	size_t   bestIx = skyline.size();
+	uint32_t bestY = 0;
+	uint32_t bestWidth = 0;
+	for (size_t ix = 0; ix < skyline.size(); ix++) {
+		uint32_t x = skyline[ix].X;
+		if (x + width > _pageSize) {
+			break;
+		}
+
+		// The image rests on the highest node that it spans
+		uint32_t y = 0;
+		uint32_t covered = 0;
+		for (size_t span = ix; covered < width; span++) {
+			y = glm::max(y, skyline[span].Y);
+			covered += skyline[span].Width;
+		}
+		if (y + height > _pageSize) {
+			continue;
+		}
+
+		if (bestIx == skyline.size() || y < bestY || (y == bestY && skyline[ix].Width < bestWidth)) {
+			bestIx = ix;
+			bestY = y;
+			bestWidth = skyline[ix].Width;
+		}
+	}
+
+	if (bestIx == skyline.size()) {
+		return false;
+	}
+
+	offset = glm::uvec2(skyline[bestIx].X, bestY);
+
+	// Add a node for the top of the image, and shrink or remove the nodes that are now underneath it
+	skyline.insert(skyline.begin() + bestIx, { offset.x, bestY + height, width });
+	for (size_t ix = bestIx + 1; ix < skyline.size();) {
+		uint32_t prevEnd = skyline[ix - 1].X + skyline[ix - 1].Width;
+		if (skyline[ix].X >= prevEnd) {
+			break;
+		}
+		uint32_t overlap = prevEnd - skyline[ix].X;
+		if (skyline[ix].Width <= overlap) {
+			skyline.erase(skyline.begin() + ix);
+		} else {
+			skyline[ix].X += overlap;
+			skyline[ix].Width -= overlap;
+			break;
+		}
+	}
+
+	// Merge neighbours at the same height so the skyline doesn't keep growing
+	for (size_t ix = 0; ix + 1 < skyline.size();) {
+		if (skyline[ix].Y == skyline[ix + 1].Y) {
+			skyline[ix].Width += skyline[ix + 1].Width;
+			skyline.erase(skyline.begin() + ix + 1);
+		} else {
+			ix++;
+		}
+	}
+
+	return true;
+}
+
+void GlyphCache::_MarkDirty(Page& page, const glm::uvec2& min, const glm::uvec2& max) {
+	if (page.Dirty) {
+		page.DirtyRect = glm::uvec4(glm::min(glm::uvec2(page.DirtyRect), min), glm::max(glm::uvec2(page.DirtyRect.z, page.DirtyRect.w), max));
+	} else {
+		page.DirtyRect = glm::uvec4(min, max);
+		page.Dirty = true;
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Textures/Texture2D.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// A set of fixed size, single channel texture pages that fonts rasterize glyphs into the first time
+/// they are needed, so that fonts with huge character sets (ex: CJK) only use memory for the text
+/// that is actually displayed.
+///
+/// Glyphs are packed into pages with a skyline packer. When every page is full, the least recently
+/// used page is cleared and reused, the owner of the cache is told which page was cleared so it can
+/// forget the glyphs that were on it. Writes are kept in a CPU copy of each page and uploaded once per
+/// frame by UploadAll
+/// </summary>
+class GlyphCache {
+public:
+	MAKE_PTRS(GlyphCache);
+	NO_COPY(GlyphCache);
+	NO_MOVE(GlyphCache);
+
+	// Used for evicted pages when nothing was evicted
+	static const uint32_t NO_PAGE = ~0u;
+
+	/// <summary>
+	/// The location of an image within the cache
+	/// </summary>
+	struct Slot {
+		uint32_t   Page;
+		// The bottom left corner of the image in pixels
+		glm::uvec2 Offset;
+	};
+
+	/// <summary>
+	/// Creates a new glyph cache, pages are only created as they are needed
+	/// </summary>
+	/// <param name="pageSize">The width and height of each page in pixels</param>
+	/// <param name="maxPages">The number of pages we can create before we start evicting</param>
+	GlyphCache(uint32_t pageSize = 512, uint32_t maxPages = 4);
+	~GlyphCache();
+
+	/// <summary>
+	/// Finds room for an image in the cache. If every page is full and we can't create any more,
+	/// the least recently used page is cleared. Pages that were used this frame or the last one are
+	/// never evicted, since geometry that is about to be drawn may still be using them
+	/// </summary>
+	/// <param name="width">The width of the image in pixels</param>
+	/// <param name="height">The height of the image in pixels</param>
+	/// <param name="result">Receives the location of the image</param>
+	/// <param name="evictedPage">Receives the page that was cleared to make room, or NO_PAGE</param>
+	/// <returns>True if room was found, false if the image is too large or every page is in use</returns>
+	bool Allocate(uint32_t width, uint32_t height, Slot& result, uint32_t& evictedPage);
+	/// <summary>
+	/// Copies single channel image data into a slot returned from Allocate, the data will be uploaded
+	/// in the next call to UploadAll
+	/// </summary>
+	/// <param name="slot">The slot to write to</param>
+	/// <param name="width">The width of the image in pixels</param>
+	/// <param name="height">The height of the image in pixels</param>
+	/// <param name="data">The pixel data, 1 byte per pixel with no row padding</param>
+	void Write(const Slot& slot, uint32_t width, uint32_t height, const uint8_t* data);
+	/// <summary>
+	/// Marks a page as used this frame, so it won't be evicted
+	/// </summary>
+	void Touch(uint32_t page);
+
+	/// <summary>
+	/// Gets the texture for one of the pages in the cache
+	/// </summary>
+	const Texture2D::Sptr& GetPageTexture(uint32_t page) const { return _pages[page].Texture; }
+	/// <summary>
+	/// Gets the width and height of each page in pixels
+	/// </summary>
+	uint32_t GetPageSize() const { return _pageSize; }
+	/// <summary>
+	/// Gets the number of pages that have been created
+	/// </summary>
+	uint32_t GetPageCount() const { return static_cast<uint32_t>(_pages.size()); }
+	/// <summary>
+	/// Gets the number of pages that can be created before pages start being evicted
+	/// </summary>
+	uint32_t GetMaxPages() const { return _maxPages; }
+
+	/// <summary>
+	/// Uploads the regions of each page that were written since the last upload
+	/// </summary>
+	void Upload();
+
+	/// <summary>
+	/// Uploads every glyph cache and advances to the next frame, should be called once per frame before
+	/// text is drawn (GuiBatcher does this in Flush)
+	/// </summary>
+	/// <returns>True if any page was evicted since the last call</returns>
+	static bool UploadAll();
+	/// <summary>
+	/// Marks the page that uses the given texture as used this frame, does nothing if the texture
+	/// isn't a glyph cache page. This lets geometry that was cached elsewhere keep it's pages alive
+	/// </summary>
+	static void MarkUsed(const Texture2D* texture);
+
+protected:
+	// The top edge of the packed area, each node covers a span of the page
+	struct SkylineNode {
+		uint32_t X;
+		uint32_t Y;
+		uint32_t Width;
+	};
+
+	struct Page {
+		Texture2D::Sptr          Texture;
+		std::vector<uint8_t>     Pixels;
+		std::vector<SkylineNode> Skyline;
+		uint64_t                 LastUsed;
+		// The area that was written since the last upload, xy is the min and zw is the max
+		glm::uvec4               DirtyRect;
+		bool                     Dirty;
+	};
+
+	uint32_t          _pageSize;
+	uint32_t          _maxPages;
+	std::vector<Page> _pages;
+
+	void _CreatePage();
+	void _ClearPage(Page& page);
+	bool _TryPack(Page& page, uint32_t width, uint32_t height, glm::uvec2& offset);
+	void _MarkDirty(Page& page, const glm::uvec2& min, const glm::uvec2& max);
+
+	static uint64_t _frame;
+	static bool     _evicted;
+	static std::vector<GlyphCache*> _instances;
+	// Lets MarkUsed find the page for a texture
+	static std::unordered_map<const Texture2D*, std::pair<GlyphCache*, uint32_t>> _pageLookup;
+};
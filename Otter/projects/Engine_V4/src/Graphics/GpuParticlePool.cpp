@@ -0,0 +1,315 @@
+#include "Graphics/GpuParticlePool.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// The number of threads in the sort key and sort shaders
+#define PARTICLE_SORT_GROUP_SIZE 256
+
+// Alive lists are bound by range, and the offsets need to meet GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+// (at most 256 bytes), which any power of two capacity of at least MIN_CAPACITY will
+static_assert(GpuParticlePool::MIN_CAPACITY * sizeof(uint32_t) % 256 == 0, "Alive list offsets must be aligned");
+
+static uint32_t NextPowerOfTwo(uint32_t value) {
+	uint32_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+GpuParticlePool::GpuParticlePool(uint32_t capacity) :
+	_capacity(NextPowerOfTwo(std::max(capacity, MIN_CAPACITY))),
+	_currentList(0),
+	_seed(0x9E3779B9u),
+	_particles(nullptr),
+	_deadList(nullptr),
+	_aliveLists(nullptr),
+	_emitters(nullptr),
+	_counters(nullptr),
+	_sortEntries(nullptr),
+	_pendingEmitters(),
+	_emptyVao(0),
+	_readbackBuffers(),
+	_readbackFences(),
+	_readbackSpawned(),
+	_readbackIndex(0),
+	_aliveCount(0),
+	_aliveUpperBound(0)
+{
+	_emitShader = ShaderProgram::Create();
+	_emitShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_emit.glsl", ShaderPartType::Compute);
+	_emitShader->Link();
+	_emitCurrentUniform  = _emitShader->GetUniformHandle<uint32_t>("u_CurrentList");
+	_emitTimeStepUniform = _emitShader->GetUniformHandle<float>("u_TimeStep");
+
+	// Preparing the simulation and finalizing the draw share a shader
+	_prepareShader = ShaderProgram::Create();
+	_prepareShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_args.glsl", ShaderPartType::Compute);
+	_prepareShader->Link();
+	_prepareCurrentUniform = _prepareShader->GetUniformHandle<uint32_t>("u_CurrentList");
+	_finalizeShader = _prepareShader->GetVariant({ { "DRAW_ARGS", "1" } });
+	_finalizeCurrentUniform = _finalizeShader->GetUniformHandle<uint32_t>("u_CurrentList");
+
+	_simulateShader = ShaderProgram::Create();
+	_simulateShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_simulate.glsl", ShaderPartType::Compute);
+	_simulateShader->Link();
+	_simulateCurrentUniform  = _simulateShader->GetUniformHandle<uint32_t>("u_CurrentList");
+	_simulateTimeStepUniform = _simulateShader->GetUniformHandle<float>("u_TimeStep");
+
+	_sortKeysShader = ShaderProgram::Create();
+	_sortKeysShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_sort_keys.glsl", ShaderPartType::Compute);
+	_sortKeysShader->Link();
+	_sortKeysCurrentUniform = _sortKeysShader->GetUniformHandle<uint32_t>("u_CurrentList");
+	_sortKeysSizeUniform    = _sortKeysShader->GetUniformHandle<uint32_t>("u_SortSize");
+
+	// The sort steps that fit in shared memory are separate variants, see particle_sort.glsl
+	_sortStepShader = ShaderProgram::Create();
+	_sortStepShader->LoadShaderPartFromFile("shaders/compute_shaders/particle_sort.glsl", ShaderPartType::Compute);
+	_sortStepShader->Link();
+	_sortStepKUniform = _sortStepShader->GetUniformHandle<uint32_t>("u_K");
+	_sortStepJUniform = _sortStepShader->GetUniformHandle<uint32_t>("u_J");
+	_sortPresortShader = _sortStepShader->GetVariant({ { "PRESORT", "1" } });
+	_sortMergeShader   = _sortStepShader->GetVariant({ { "MERGE", "1" } });
+	_sortMergeKUniform = _sortMergeShader->GetUniformHandle<uint32_t>("u_K");
+
+	_renderShader = ShaderProgram::Create();
+	_renderShader->LoadShaderPartFromFile("shaders/vertex_shaders/particles_pool_vs.glsl", ShaderPartType::Vertex);
+	_renderShader->LoadShaderPartFromFile("shaders/fragment_shaders/particles_render_fs.glsl", ShaderPartType::Fragment);
+	_renderShader->Link();
+
+	glCreateVertexArrays(1, &_emptyVao);
+
+	glCreateBuffers(READBACK_COUNT, _readbackBuffers);
+	for (int ix = 0; ix < READBACK_COUNT; ix++) {
+		glNamedBufferStorage(_readbackBuffers[ix], sizeof(int32_t), nullptr, 0);
+	}
+
+	_CreateBuffers();
+}
+
+GpuParticlePool::~GpuParticlePool() {
+	for (int ix = 0; ix < READBACK_COUNT; ix++) {
+		if (_readbackFences[ix] != nullptr) {
+			glDeleteSync(_readbackFences[ix]);
+		}
+	}
+	glDeleteBuffers(READBACK_COUNT, _readbackBuffers);
+	glDeleteVertexArrays(1, &_emptyVao);
+}
+
+void GpuParticlePool::Reserve(uint32_t capacity) {
+	uint32_t required = NextPowerOfTwo(std::max(capacity, MIN_CAPACITY));
+	if (required > _capacity) {
+		LOG_INFO("Growing particle pool from {} to {} particles", _capacity, required);
+		_capacity = required;
+		_CreateBuffers();
+	}
+}
+
+void GpuParticlePool::Clear() {
+	_CreateBuffers();
+}
+
+void GpuParticlePool::_CreateBuffers() {
+	_particles = StorageBuffer::Create();
+	_particles->LoadData(nullptr, sizeof(glm::vec4) * 4, _capacity);
+
+	// Every particle starts out dead
+	std::vector<uint32_t> deadList(_capacity);
+	for (uint32_t ix = 0; ix < _capacity; ix++) {
+		deadList[ix] = ix;
+	}
+	_deadList = StorageBuffer::Create();
+	_deadList->LoadData(deadList.data(), _capacity);
+
+	// Both alive lists live in one buffer, and get bound by range
+	_aliveLists = StorageBuffer::Create();
+	_aliveLists->LoadData(nullptr, sizeof(uint32_t), _capacity * 2);
+
+	// Each sort entry is a float key and a particle index
+	_sortEntries = StorageBuffer::Create();
+	_sortEntries->LoadData(nullptr, sizeof(uint32_t) * 2, _capacity);
+
+	_emitters = StorageBuffer::Create(BufferUsage::StreamDraw);
+
+	GpuCounters counters = { };
+	counters.DeadCount = static_cast<int32_t>(_capacity);
+	_counters = StorageBuffer::Create();
+	_counters->LoadData(&counters, 1);
+
+	_pendingEmitters.clear();
+	_currentList = 0;
+
+	// Anything we were reading back was for the old buffers
+	for (int ix = 0; ix < READBACK_COUNT; ix++) {
+		if (_readbackFences[ix] != nullptr) {
+			glDeleteSync(_readbackFences[ix]);
+			_readbackFences[ix] = nullptr;
+		}
+	}
+	_aliveCount = 0;
+	_aliveUpperBound = 0;
+}
+
+void GpuParticlePool::Emit(const EmitRequest& request) {
+	if (request.Count == 0) {
+		return;
+	}
+
+	// Each request gets it's own seed, so that emitters in the same place don't spawn the same particles
+	_seed = _seed * 1664525u + 1013904223u;
+
+	GpuEmitter emitter;
+	emitter.PositionCone  = glm::vec4(request.Position, request.ConeAngle);
+	emitter.Velocity      = glm::vec4(request.Velocity, 0.0f);
+	emitter.Color         = request.Color;
+	emitter.Gravity       = glm::vec4(request.Gravity, 0.0f);
+	emitter.LifetimeRange = request.LifetimeRange;
+	emitter.SpawnCount    = std::min(request.Count, _capacity);
+	emitter.Seed          = _seed;
+	_pendingEmitters.push_back(emitter);
+}
+
+void GpuParticlePool::_BindBuffers() const {
+	uint32_t listSize = _capacity * sizeof(uint32_t);
+	_particles->Bind(0);
+	_deadList->Bind(1);
+	_aliveLists->BindRange(2, _currentList * listSize, listSize);
+	_aliveLists->BindRange(3, (1 - _currentList) * listSize, listSize);
+	_counters->Bind(5);
+	_sortEntries->Bind(6);
+}
+
+void GpuParticlePool::Simulate(float deltaTime) {
+	// Everything we spawn raises the most particles that could be alive
+	uint32_t spawned = 0;
+	for (const GpuEmitter& emitter : _pendingEmitters) {
+		spawned += emitter.SpawnCount;
+	}
+	_aliveUpperBound = std::min(_aliveUpperBound + spawned, _capacity);
+	for (int ix = 0; ix < READBACK_COUNT; ix++) {
+		_readbackSpawned[ix] += spawned;
+	}
+
+	_BindBuffers();
+
+	// Spawn new particles into the current alive list, one workgroup per emitter
+	if (!_pendingEmitters.empty()) {
+		_emitters->UpdateData(_pendingEmitters.data(), sizeof(GpuEmitter), static_cast<uint32_t>(_pendingEmitters.size()));
+		_emitters->Bind(4);
+
+		_emitShader->Bind();
+		_emitCurrentUniform.Set(_currentList);
+		_emitTimeStepUniform.Set(deltaTime);
+		glDispatchCompute(static_cast<GLuint>(_pendingEmitters.size()), 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		_pendingEmitters.clear();
+	}
+
+	// Work out how many groups the simulation needs
+	_prepareShader->Bind();
+	_prepareCurrentUniform.Set(_currentList);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	// Update every particle, compacting the survivors into the other list
+	_simulateShader->Bind();
+	_simulateCurrentUniform.Set(_currentList);
+	_simulateTimeStepUniform.Set(deltaTime);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _counters->GetHandle());
+	glDispatchComputeIndirect(offsetof(GpuCounters, SimulateArgs));
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Write the draw for the survivors
+	_finalizeShader->Bind();
+	_finalizeCurrentUniform.Set(_currentList);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// The survivors are now the current particles
+	_currentList = 1 - _currentList;
+
+	_PollReadback();
+}
+
+void GpuParticlePool::_PollReadback() {
+	// Read back the oldest count in our ring if the GPU has finished with it. If it hasn't we keep our old
+	// values, and skip reading back this update so the copy is free to finish
+	GLsync& fence = _readbackFences[_readbackIndex];
+	if (fence != nullptr) {
+		// A timeout of 0 just checks the fence without waiting on it
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			glDeleteSync(fence);
+			fence = nullptr;
+
+			int32_t alive = 0;
+			glGetNamedBufferSubData(_readbackBuffers[_readbackIndex], 0, sizeof(int32_t), &alive);
+			_aliveCount = static_cast<uint32_t>(std::max(alive, 0));
+			_aliveUpperBound = std::min(_aliveCount + _readbackSpawned[_readbackIndex], _capacity);
+		}
+	}
+
+	if (fence == nullptr) {
+		GLintptr offset = offsetof(GpuCounters, AliveCount) + _currentList * sizeof(int32_t);
+		glCopyNamedBufferSubData(_counters->GetHandle(), _readbackBuffers[_readbackIndex], offset, 0, sizeof(int32_t));
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_readbackSpawned[_readbackIndex] = 0;
+		_readbackIndex = (_readbackIndex + 1) % READBACK_COUNT;
+	}
+}
+
+void GpuParticlePool::Render() {
+	if (_aliveUpperBound == 0) {
+		return;
+	}
+
+	// We only need to sort enough keys to cover every particle that could be alive, but always at least a full block
+	uint32_t sortSize = std::min(NextPowerOfTwo(std::max(_aliveUpperBound, SORT_BLOCK_SIZE)), _capacity);
+	uint32_t sortGroups = sortSize / SORT_BLOCK_SIZE;
+
+	_BindBuffers();
+
+	// Build the keys from the distance to the camera
+	_sortKeysShader->Bind();
+	_sortKeysCurrentUniform.Set(_currentList);
+	_sortKeysSizeUniform.Set(sortSize);
+	glDispatchCompute(sortSize / PARTICLE_SORT_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Sort each block in shared memory, then merge the blocks together. Steps that compare keys
+	// further apart than a block each need their own dispatch, the rest of each merge is done in shared memory
+	_sortPresortShader->Bind();
+	glDispatchCompute(sortGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	for (uint32_t k = SORT_BLOCK_SIZE * 2; k <= sortSize; k <<= 1) {
+		_sortStepShader->Bind();
+		_sortStepKUniform.Set(k);
+		for (uint32_t j = k >> 1; j >= SORT_BLOCK_SIZE; j >>= 1) {
+			_sortStepJUniform.Set(j);
+			glDispatchCompute(sortGroups, 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+
+		_sortMergeShader->Bind();
+		_sortMergeKUniform.Set(k);
+		glDispatchCompute(sortGroups, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// Draw every particle with a single indirect draw, using the count the simulation left us
+	_renderShader->Bind();
+	glBindVertexArray(_emptyVao);
+
+	glEnablei(GL_BLEND, 0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _counters->GetHandle());
+	glDrawArraysIndirect(GL_POINTS, (const void*)offsetof(GpuCounters, DrawArgs));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindVertexArray(0);
+}
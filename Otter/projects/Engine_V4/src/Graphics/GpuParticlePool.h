@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Graphics/IParticlePool.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Buffers/StorageBuffer.h"
+
+/// <summary>
+/// A single engine-wide pool of GPU particles. Every particle system in the scene spawns into the same
+/// storage buffers, so all of them are simulated with one dispatch and drawn with one indirect draw.
+///
+/// Free particles are tracked in a dead list that emission pops from and simulation pushes back onto,
+/// and live particles are compacted into one of two alive lists that we ping-pong between each update.
+/// The CPU never needs to know how many particles are alive, all the counts stay on the GPU and the
+/// dispatch and draw arguments are written by compute shaders
+/// </summary>
+class GpuParticlePool final : public IParticlePool {
+public:
+	MAKE_PTRS(GpuParticlePool);
+
+	// The number of threads in each of our compute workgroups, must match the local size in the shaders
+	static const uint32_t GROUP_SIZE = 64;
+	// The number of keys that the sort shader sorts in shared memory, must match the shader
+	static const uint32_t SORT_BLOCK_SIZE = 512;
+	// The smallest pool we will create
+	static const uint32_t MIN_CAPACITY = 4096;
+
+	/// <summary>
+	/// Creates a new particle pool. Capacity will be rounded up to a power of two (for sorting)
+	/// </summary>
+	/// <param name="capacity">The maximum number of particles that can be alive at once</param>
+	GpuParticlePool(uint32_t capacity = 65536);
+	virtual ~GpuParticlePool();
+
+	// Inherited from IParticlePool
+
+	virtual void Reserve(uint32_t capacity) override;
+	virtual void Clear() override;
+	virtual void Emit(const EmitRequest& request) override;
+	virtual void Simulate(float deltaTime) override;
+	virtual void Render() override;
+	virtual uint32_t GetCapacity() const override { return _capacity; }
+	virtual uint32_t GetAliveCount() const override { return _aliveCount; }
+	virtual bool IsEmpty() const override { return _aliveUpperBound == 0; }
+
+protected:
+	// Matches the Emitter struct in particle_pool.glsl, laid out for std430
+	struct GpuEmitter {
+		glm::vec4 PositionCone;
+		glm::vec4 Velocity;
+		glm::vec4 Color;
+		glm::vec4 Gravity;
+		glm::vec2 LifetimeRange;
+		uint32_t  SpawnCount;
+		uint32_t  Seed;
+	};
+
+	// Matches the layout of our counter buffer in particle_pool.glsl. This buffer is also our indirect
+	// dispatch and draw buffer, so the arguments need to stay at these offsets
+	struct GpuCounters {
+		int32_t  AliveCount[2];
+		int32_t  DeadCount;
+		uint32_t _padding0;
+		uint32_t SimulateArgs[3];  // DispatchIndirectCommand
+		uint32_t _padding1;
+		uint32_t DrawArgs[4];      // DrawArraysIndirectCommand
+	};
+
+	// We read back the alive count through a ring of small buffers, so that we never wait on the GPU
+	static const int READBACK_COUNT = 4;
+
+	uint32_t _capacity;
+	// Which of the two alive lists holds the particles from the last update
+	uint32_t _currentList;
+	uint32_t _seed;
+
+	StorageBuffer::Sptr _particles;
+	StorageBuffer::Sptr _deadList;
+	StorageBuffer::Sptr _aliveLists;
+	StorageBuffer::Sptr _emitters;
+	StorageBuffer::Sptr _counters;
+	StorageBuffer::Sptr _sortEntries;
+
+	std::vector<GpuEmitter> _pendingEmitters;
+
+	ShaderProgram::Sptr _emitShader;
+	ShaderProgram::Sptr _prepareShader;
+	ShaderProgram::Sptr _simulateShader;
+	ShaderProgram::Sptr _finalizeShader;
+	ShaderProgram::Sptr _sortKeysShader;
+	ShaderProgram::Sptr _sortPresortShader;
+	ShaderProgram::Sptr _sortMergeShader;
+	ShaderProgram::Sptr _sortStepShader;
+	ShaderProgram::Sptr _renderShader;
+
+	UniformHandle<uint32_t> _emitCurrentUniform;
+	UniformHandle<float>    _emitTimeStepUniform;
+	UniformHandle<uint32_t> _prepareCurrentUniform;
+	UniformHandle<uint32_t> _simulateCurrentUniform;
+	UniformHandle<float>    _simulateTimeStepUniform;
+	UniformHandle<uint32_t> _finalizeCurrentUniform;
+	UniformHandle<uint32_t> _sortKeysCurrentUniform;
+	UniformHandle<uint32_t> _sortKeysSizeUniform;
+	UniformHandle<uint32_t> _sortMergeKUniform;
+	UniformHandle<uint32_t> _sortStepKUniform;
+	UniformHandle<uint32_t> _sortStepJUniform;
+
+	// An empty VAO for our draws, all of our vertex data is fetched from the storage buffers
+	GLuint _emptyVao;
+
+	GLuint   _readbackBuffers[READBACK_COUNT];
+	GLsync   _readbackFences[READBACK_COUNT];
+	// The number of particles spawned since each readback was issued
+	uint32_t _readbackSpawned[READBACK_COUNT];
+	int      _readbackIndex;
+	uint32_t _aliveCount;
+	// An upper bound on the number of particles alive right now, from the last readback plus everything
+	// spawned since. We only need to sort this many keys
+	uint32_t _aliveUpperBound;
+
+	void _CreateBuffers();
+	void _PollReadback();
+	void _BindBuffers() const;
+};
@@ -0,0 +1,305 @@
+#include "Graphics/GuiAtlas.h"
+#include <fstream>
+#include <stb_image.h>
+#include <Logging.h>
+
+// Written at the start of atlas files, so we can tell if we're loading the right kind of file
+static const char ATLAS_MAGIC[4] = { 'G', 'U', 'I', 'A' };
+static const uint32_t ATLAS_VERSION = 1;
+
+GuiAtlas::GuiAtlas(uint32_t layerSize /*= 1024*/, uint32_t padding /*= 2*/) :
+	_layerSize(layerSize),
+	_padding(padding),
+	_layers(std::vector<Layer>()),
+	_entries(std::vector<Entry>()),
+	_keyLookup(std::unordered_map<std::string, size_t>()),
+	_textureLookup(std::unordered_map<const Texture2D*, TextureEntry>()),
+	_needsRealloc(false),
+	_texture(nullptr)
+{ }
+
+GuiAtlas::~GuiAtlas() = default;
+
+bool GuiAtlas::Add(const Texture2D::Sptr& texture) {
+	if (texture == nullptr) {
+		return false;
+	}
+
+	Region region;
+	if (TryGetRegion(texture.get(), region)) {
+		return true;
+	}
+
+	// If the image is already in the atlas (ex: we loaded a baked atlas), we can just point the texture at it
+	std::string key = _GetKey(texture);
+	auto it = _keyLookup.find(key);
+	if (it == _keyLookup.end()) {
+		uint32_t width = texture->GetWidth();
+		uint32_t height = texture->GetHeight();
+		if (width + _padding * 2 > _layerSize || height + _padding * 2 > _layerSize || texture->GetDescription().MultisampleCount > 1) {
+			return false;
+		}
+
+		// Read the texture back as RGBA, OpenGL will convert from whatever format it is stored in.
+		// Single channel textures like font atlases end up in the red channel
+		std::vector<uint8_t> pixels(width * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTextureImage(texture->GetHandle(), 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)pixels.size(), pixels.data());
+
+		if (!AddImage(key, width, height, pixels.data())) {
+			return false;
+		}
+		it = _keyLookup.find(key);
+	}
+
+	_textureLookup[texture.get()] = { texture, it->second };
+	return true;
+}
+
+bool GuiAtlas::AddImage(const std::string& key, uint32_t width, uint32_t height, const uint8_t* rgba) {
+	if (_keyLookup.find(key) != _keyLookup.end()) {
+		return true;
+	}
+
+	uint32_t layerIx;
+	glm::uvec2 offset;
+	if (!_Allocate(width + _padding * 2, height + _padding * 2, layerIx, offset)) {
+		LOG_WARN("Image \"{}\" ({}x{}) is too large for a GUI atlas layer of size {}", key, width, height, _layerSize);
+		return false;
+	}
+
+	// Copy the image into the layer, filling the padding with the closest edge pixel so that filtering
+	// at the edges of the image doesn't pick up it's neighbours
+	Layer& layer = _layers[layerIx];
+	int pad = (int)_padding;
+	for (int y = -pad; y < (int)height + pad; y++) {
+		int srcY = glm::clamp(y, 0, (int)height - 1);
+		for (int x = -pad; x < (int)width + pad; x++) {
+			int srcX = glm::clamp(x, 0, (int)width - 1);
+			size_t dst = ((size_t)(offset.y + pad + y) * _layerSize + (offset.x + pad + x)) * 4;
+			size_t src = ((size_t)srcY * width + srcX) * 4;
+			memcpy(&layer.Pixels[dst], &rgba[src], 4);
+		}
+	}
+	layer.Dirty = true;
+
+	Entry entry;
+	entry.Key = key;
+	entry.Layer = layerIx;
+	entry.Offset = offset + glm::uvec2(_padding);
+	entry.Size = glm::uvec2(width, height);
+	_keyLookup[key] = _entries.size();
+	_entries.push_back(entry);
+	return true;
+}
+
+bool GuiAtlas::AddImageFile(const std::string& path) {
+	// Flip to match how Texture2D loads images, so that baked UVs line up
+	stbi_set_flip_vertically_on_load(true);
+	int width, height, channels;
+	uint8_t* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+	if (data == nullptr) {
+		LOG_WARN("Failed to load image \"{}\" for GUI atlas", path);
+		return false;
+	}
+	bool result = AddImage(path, width, height, data);
+	stbi_image_free(data);
+	return result;
+}
+
+bool GuiAtlas::TryGetRegion(const Texture2D* texture, Region& result) const {
+	auto it = _textureLookup.find(texture);
+	if (it == _textureLookup.end() || it->second.Texture.expired()) {
+		return false;
+	}
+	result = _GetRegion(_entries[it->second.Index]);
+	return true;
+}
+
+bool GuiAtlas::TryGetRegion(const std::string& key, Region& result) const {
+	auto it = _keyLookup.find(key);
+	if (it == _keyLookup.end()) {
+		return false;
+	}
+	result = _GetRegion(_entries[it->second]);
+	return true;
+}
+
+bool GuiAtlas::Upload() {
+	if (_layers.empty()) {
+		return false;
+	}
+
+	// Texture arrays can't be resized, so we need a new texture if layers were added
+	if (_texture == nullptr || _needsRealloc) {
+		Texture2DArrayDescription desc;
+		desc.Width  = _layerSize;
+		desc.Height = _layerSize;
+		desc.Layers = static_cast<uint32_t>(_layers.size());
+		desc.Format = InternalFormat::RGBA8;
+		_texture = std::make_shared<Texture2DArray>(desc);
+		for (auto& layer : _layers) {
+			layer.Dirty = true;
+		}
+		_needsRealloc = false;
+	}
+
+	bool uploaded = false;
+	for (uint32_t ix = 0; ix < _layers.size(); ix++) {
+		if (_layers[ix].Dirty) {
+			_texture->LoadData(_layerSize, _layerSize, 1, PixelFormat::RGBA, PixelType::UByte, _layers[ix].Pixels.data(), 0, 0, ix);
+			_layers[ix].Dirty = false;
+			uploaded = true;
+		}
+	}
+	return uploaded;
+}
+
+bool GuiAtlas::Save(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LOG_WARN("Failed to open \"{}\" for writing GUI atlas", path);
+		return false;
+	}
+
+	uint32_t layerCount = static_cast<uint32_t>(_layers.size());
+	uint32_t entryCount = static_cast<uint32_t>(_entries.size());
+	file.write(ATLAS_MAGIC, sizeof(ATLAS_MAGIC));
+	file.write((const char*)&ATLAS_VERSION, sizeof(uint32_t));
+	file.write((const char*)&_layerSize, sizeof(uint32_t));
+	file.write((const char*)&_padding, sizeof(uint32_t));
+	file.write((const char*)&layerCount, sizeof(uint32_t));
+	file.write((const char*)&entryCount, sizeof(uint32_t));
+
+	for (const Entry& entry : _entries) {
+		uint32_t keyLength = static_cast<uint32_t>(entry.Key.size());
+		file.write((const char*)&keyLength, sizeof(uint32_t));
+		file.write(entry.Key.data(), keyLength);
+		file.write((const char*)&entry.Layer, sizeof(uint32_t));
+		file.write((const char*)&entry.Offset, sizeof(glm::uvec2));
+		file.write((const char*)&entry.Size, sizeof(glm::uvec2));
+	}
+
+	// We store the shelves as well, so that more images can be packed into a loaded atlas
+	for (const Layer& layer : _layers) {
+		uint32_t shelfCount = static_cast<uint32_t>(layer.Shelves.size());
+		file.write((const char*)&shelfCount, sizeof(uint32_t));
+		file.write((const char*)layer.Shelves.data(), sizeof(Shelf) * shelfCount);
+		file.write((const char*)layer.Pixels.data(), layer.Pixels.size());
+	}
+
+	return file.good();
+}
+
+GuiAtlas::Sptr GuiAtlas::LoadFromFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LOG_WARN("Failed to open GUI atlas \"{}\"", path);
+		return nullptr;
+	}
+
+	char magic[4];
+	uint32_t version, layerSize, padding, layerCount, entryCount;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(uint32_t));
+	if (!file.good() || memcmp(magic, ATLAS_MAGIC, sizeof(magic)) != 0 || version != ATLAS_VERSION) {
+		LOG_WARN("\"{}\" is not a GUI atlas, or was saved with a different version", path);
+		return nullptr;
+	}
+	file.read((char*)&layerSize, sizeof(uint32_t));
+	file.read((char*)&padding, sizeof(uint32_t));
+	file.read((char*)&layerCount, sizeof(uint32_t));
+	file.read((char*)&entryCount, sizeof(uint32_t));
+
+	GuiAtlas::Sptr result = std::make_shared<GuiAtlas>(layerSize, padding);
+	result->_entries.resize(entryCount);
+	for (uint32_t ix = 0; ix < entryCount; ix++) {
+		Entry& entry = result->_entries[ix];
+		uint32_t keyLength;
+		file.read((char*)&keyLength, sizeof(uint32_t));
+		entry.Key.resize(keyLength);
+		file.read(entry.Key.data(), keyLength);
+		file.read((char*)&entry.Layer, sizeof(uint32_t));
+		file.read((char*)&entry.Offset, sizeof(glm::uvec2));
+		file.read((char*)&entry.Size, sizeof(glm::uvec2));
+		result->_keyLookup[entry.Key] = ix;
+	}
+
+	result->_layers.resize(layerCount);
+	for (Layer& layer : result->_layers) {
+		uint32_t shelfCount;
+		file.read((char*)&shelfCount, sizeof(uint32_t));
+		layer.Shelves.resize(shelfCount);
+		file.read((char*)layer.Shelves.data(), sizeof(Shelf) * shelfCount);
+		layer.Pixels.resize((size_t)layerSize * layerSize * 4);
+		file.read((char*)layer.Pixels.data(), layer.Pixels.size());
+		layer.Dirty = true;
+	}
+	result->_needsRealloc = true;
+
+	if (!file.good()) {
+		LOG_WARN("GUI atlas \"{}\" is truncated", path);
+		return nullptr;
+	}
+	return result;
+}
+
+GuiAtlas::Region GuiAtlas::_GetRegion(const Entry& entry) const {
+	Region result;
+	result.Layer = entry.Layer;
+	result.UVMin = glm::vec2(entry.Offset) / (float)_layerSize;
+	result.UVMax = glm::vec2(entry.Offset + entry.Size) / (float)_layerSize;
+	return result;
+}
+
+bool GuiAtlas::_Allocate(uint32_t width, uint32_t height, uint32_t& layer, glm::uvec2& offset) {
+	if (width > _layerSize || height > _layerSize) {
+		return false;
+	}
+
+	for (uint32_t ix = 0; ix < _layers.size(); ix++) {
+		Layer& current = _layers[ix];
+
+		// Find the shelf that fits us with the least wasted height
+		Shelf* best = nullptr;
+		for (Shelf& shelf : current.Shelves) {
+			if (shelf.Height >= height && shelf.X + width <= _layerSize && (best == nullptr || shelf.Height < best->Height)) {
+				best = &shelf;
+			}
+		}
+
+		// Otherwise start a new shelf above the last one, if there's room
+		if (best == nullptr) {
+			uint32_t top = current.Shelves.empty() ? 0 : current.Shelves.back().Y + current.Shelves.back().Height;
+			if (top + height <= _layerSize) {
+				current.Shelves.push_back({ top, height, 0 });
+				best = &current.Shelves.back();
+			}
+		}
+
+		if (best != nullptr) {
+			layer = ix;
+			offset = glm::uvec2(best->X, best->Y);
+			best->X += width;
+			return true;
+		}
+	}
+
+	// Nothing has room, add a new layer
+	Layer newLayer;
+	newLayer.Pixels.resize((size_t)_layerSize * _layerSize * 4, 0);
+	newLayer.Shelves.push_back({ 0, height, width });
+	newLayer.Dirty = true;
+	_layers.push_back(std::move(newLayer));
+	_needsRealloc = true;
+
+	layer = static_cast<uint32_t>(_layers.size() - 1);
+	offset = glm::uvec2(0);
+	return true;
+}
+
+std::string GuiAtlas::_GetKey(const Texture2D::Sptr& texture) {
+	// Textures loaded from files can be found in baked atlases, generated ones only exist at runtime
+	const std::string& filename = texture->GetDescription().Filename;
+	return filename.empty() ? texture->GetGUID().str() : filename;
+}
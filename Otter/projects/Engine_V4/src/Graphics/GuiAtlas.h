@@ -0,0 +1,158 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Textures/Texture2D.h"
+#include "Graphics/Textures/Texture2DArray.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Packs GUI images (panel backgrounds, font pages) into the layers of a texture array, so that the
+/// GuiBatcher can draw the whole interface with a single texture bound.
+///
+/// Images are packed into shelves as they are added, existing images never move so adding one only
+/// touches the layer it lands in. A copy of every layer is kept on the CPU, which lets us save the atlas
+/// to disk and load it again later without re-packing (see Save and LoadFromFile). This also lets us
+/// pack offline, since AddImage and AddImageFile don't need an OpenGL context
+/// </summary>
+class GuiAtlas {
+public:
+	MAKE_PTRS(GuiAtlas);
+	NO_COPY(GuiAtlas);
+	NO_MOVE(GuiAtlas);
+
+	/// <summary>
+	/// The area that an image takes up in the atlas
+	/// </summary>
+	struct Region {
+		uint32_t  Layer;
+		// The UV coords of the image's bottom left and top right corners
+		glm::vec2 UVMin;
+		glm::vec2 UVMax;
+	};
+
+	/// <summary>
+	/// Creates a new empty atlas
+	/// </summary>
+	/// <param name="layerSize">The width and height of each layer in pixels, images larger than this can't be added</param>
+	/// <param name="padding">The number of pixels around each image that are filled with it's edge, to avoid bleeding when filtering</param>
+	GuiAtlas(uint32_t layerSize = 1024, uint32_t padding = 2);
+	~GuiAtlas();
+
+	/// <summary>
+	/// Copies a texture into the atlas, reading it back from the GPU. If an image with the same file
+	/// name is already in the atlas (ex: from a baked atlas) it is used instead of reading the texture
+	/// </summary>
+	/// <param name="texture">The texture to add</param>
+	/// <returns>True if the texture is in the atlas, false if it is too large</returns>
+	bool Add(const Texture2D::Sptr& texture);
+	/// <summary>
+	/// Adds RGBA8 image data to the atlas under the given key, rows are ordered bottom to top like OpenGL
+	/// </summary>
+	/// <param name="key">The key to find the image with, textures use their file name</param>
+	/// <param name="width">The width of the image in pixels</param>
+	/// <param name="height">The height of the image in pixels</param>
+	/// <param name="rgba">The pixel data, 4 bytes per pixel</param>
+	/// <returns>True if the image was added, false if it is too large</returns>
+	bool AddImage(const std::string& key, uint32_t width, uint32_t height, const uint8_t* rgba);
+	/// <summary>
+	/// Loads an image file from disk and adds it to the atlas, using the path as the key
+	/// </summary>
+	/// <param name="path">The path to the image to load</param>
+	/// <returns>True if the image was loaded and added</returns>
+	bool AddImageFile(const std::string& path);
+
+	/// <summary>
+	/// Looks up the region that a texture was packed into
+	/// </summary>
+	/// <param name="texture">The texture to search for</param>
+	/// <param name="result">Receives the region if the texture is in the atlas</param>
+	/// <returns>True if the texture is in the atlas</returns>
+	bool TryGetRegion(const Texture2D* texture, Region& result) const;
+	/// <summary>
+	/// Looks up the region for an image by it's key
+	/// </summary>
+	bool TryGetRegion(const std::string& key, Region& result) const;
+
+	/// <summary>
+	/// Uploads any layers that have changed since the last upload, recreating the texture if layers were added
+	/// </summary>
+	/// <returns>True if anything was uploaded</returns>
+	bool Upload();
+	/// <summary>
+	/// Gets the texture array holding the atlas, will be nullptr until Upload has been called
+	/// </summary>
+	const Texture2DArray::Sptr& GetTexture() const { return _texture; }
+
+	/// <summary>
+	/// Gets the size of each layer in pixels
+	/// </summary>
+	uint32_t GetLayerSize() const { return _layerSize; }
+	/// <summary>
+	/// Gets the number of layers that images have been packed into
+	/// </summary>
+	uint32_t GetLayerCount() const { return static_cast<uint32_t>(_layers.size()); }
+	/// <summary>
+	/// Gets the number of images in the atlas
+	/// </summary>
+	uint32_t GetImageCount() const { return static_cast<uint32_t>(_entries.size()); }
+
+	/// <summary>
+	/// Writes the atlas, including all of it's pixel data, to a binary file
+	/// </summary>
+	/// <param name="path">The path to write the atlas to</param>
+	/// <returns>True if the file was written</returns>
+	bool Save(const std::string& path) const;
+	/// <summary>
+	/// Loads an atlas that was written with Save. Textures that are added afterwards will find their
+	/// image by file name, so they don't need to be read back and packed again
+	/// </summary>
+	/// <param name="path">The path to load the atlas from</param>
+	/// <returns>The loaded atlas, or nullptr if the file could not be read</returns>
+	static GuiAtlas::Sptr LoadFromFile(const std::string& path);
+
+protected:
+	// A row of images within a layer, images are placed left to right along the shelf
+	struct Shelf {
+		uint32_t Y;
+		uint32_t Height;
+		uint32_t X;
+	};
+
+	struct Layer {
+		std::vector<uint8_t> Pixels;
+		std::vector<Shelf>   Shelves;
+		bool                 Dirty;
+	};
+
+	struct Entry {
+		std::string Key;
+		uint32_t    Layer;
+		glm::uvec2  Offset;
+		glm::uvec2  Size;
+	};
+
+	// Lets us find the entry for a texture without building it's key every time, the weak pointer is
+	// used to make sure the texture at an address hasn't been replaced
+	struct TextureEntry {
+		std::weak_ptr<Texture2D> Texture;
+		size_t                   Index;
+	};
+
+	uint32_t _layerSize;
+	uint32_t _padding;
+	std::vector<Layer> _layers;
+	std::vector<Entry> _entries;
+	std::unordered_map<std::string, size_t> _keyLookup;
+	std::unordered_map<const Texture2D*, TextureEntry> _textureLookup;
+	// Set when layers have been added, so the texture needs to be recreated
+	bool _needsRealloc;
+
+	Texture2DArray::Sptr _texture;
+
+	Region _GetRegion(const Entry& entry) const;
+	bool _Allocate(uint32_t width, uint32_t height, uint32_t& layer, glm::uvec2& offset);
+	static std::string _GetKey(const Texture2D::Sptr& texture);
+};
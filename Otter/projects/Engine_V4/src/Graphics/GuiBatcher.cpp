@@ -1,225 +1,327 @@
 #include "Graphics/GuiBatcher.h"
 #include <GLM/gtc/matrix_transform.hpp>
-#include <GLM/gtc/matrix_inverse.hpp>
 #include "Utils/ResourceManager/ResourceManager.h"
-#include <locale>
-#include <codecvt>
+#include "Utils/StringUtils.h"
+#include <algorithm>
+#include <cstring>
 
+// Each instance is drawn as 9 cells, with 2 triangles each
+#define VERTICES_PER_INSTANCE 54
 
-std::unordered_map<Texture2D*, GuiBatcher::MeshData> GuiBatcher::_meshBuilders;
+// Used as the clip rect when no scissor rects are pushed, large enough to never clip anything
+static const glm::vec4 NO_CLIP = glm::vec4(-1.0e9f, -1.0e9f, 1.0e9f, 1.0e9f);
 
+std::vector<GuiBatcher::Segment> GuiBatcher::__segments;
 VertexArrayObject::Sptr GuiBatcher::__vao = nullptr;
-IndexBuffer::Sptr GuiBatcher::__ibo = nullptr;
+
+PersistentStreamBuffer<StorageBuffer, GuiBatcher::Instance> GuiBatcher::__instances("GUI instance buffer", 1024);
+
+std::vector<GuiBatcher::CacheState> GuiBatcher::__cacheStack;
+uint32_t GuiBatcher::__cacheOrder = 0;
+uint32_t GuiBatcher::__cacheGeneration = 0;
+GuiBatcher::GeometryCache GuiBatcher::__immediateCache;
 
 Texture2D::Sptr GuiBatcher::__defaultUITexture = nullptr;
 int GuiBatcher::__defaultEdgeRadius = 0;
 
-VertexBuffer::Sptr GuiBatcher::__vbo = nullptr;
+TextLayout GuiBatcher::__scratchLayout;
+std::wstring GuiBatcher::__scratchText;
+
 ShaderProgram::Sptr GuiBatcher::__shader = nullptr;
-ShaderProgram::Sptr GuiBatcher::__fontShader = nullptr;
+ShaderProgram::Sptr GuiBatcher::__atlasShader = nullptr;
+GuiAtlas::Sptr GuiBatcher::__atlas = std::make_shared<GuiAtlas>();
 glm::ivec2 GuiBatcher::__windowSize = {0, 0};
 glm::mat4 GuiBatcher::__projection = glm::mat4(1.0f);
 glm::mat3 GuiBatcher::__model = glm::mat3(1.0f);
 std::vector<glm::mat3> GuiBatcher::__modelTransformStack = std::vector<glm::mat3>();
-std::vector<GuiBatcher::IRect> GuiBatcher::__scissorRects = std::vector<GuiBatcher::IRect>();
+std::vector<glm::vec4> GuiBatcher::__scissorRects = std::vector<glm::vec4>();
+glm::vec4 GuiBatcher::__clip = NO_CLIP;
+
+GuiBatcher::GeometryCache::GeometryCache() :
+	Dirty(true),
+	Model(glm::mat3(1.0f)),
+	Clip(NO_CLIP),
+	Generation(0),
+	PushCount(0),
+	Batches(std::vector<Batch>())
+{ }
+
+void GuiBatcher::BeginCache(GeometryCache& cache) {
+	CacheState state;
+	state.Cache = &cache;
+	state.Order = __cacheOrder++;
+	state.PushCount = 0;
+	// Instances store the model transform and clip rect, so any change to them (including from our
+	// parents) means we need to rebuild
+	state.Replaying = !cache.Dirty && cache.Model == __model && cache.Clip == __clip && cache.Generation == __cacheGeneration;
+
+	if (!state.Replaying) {
+		cache.Batches.clear();
+		cache.Model = __model;
+		cache.Clip = __clip;
+		cache.Generation = __cacheGeneration;
+		cache.Dirty = false;
+	}
 
-void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, const glm::vec2 uvMin, const glm::vec2 uvMax) {
-	// Create vertices and transform positions
-	VertexPosColTex verts[4];
-	verts[0].Position = __model * glm::vec3(min.x, min.y, 1.0f);
-	verts[1].Position = __model * glm::vec3(min.x, max.y, 1.0f);
-	verts[2].Position = __model * glm::vec3(max.x, max.y, 1.0f);
-	verts[3].Position = __model * glm::vec3(max.x, min.y, 1.0f);
-		
-	// Grab mesh info for the texture batch
-	MeshData& mesh = _meshBuilders[tex.get()];
-	// We can use the vertex count for depth, so that things drawn later have a bit of spacing
-	float depth = mesh.Builder.GetVertexCount() / 1000.0f;
-
-	// Copy in all color and set depth 
-	for (int ix = 0; ix < 4; ix++) {
-		verts[ix].Color = color;
-		verts[ix].Position.z = depth;
+	__cacheStack.push_back(state);
+}
+
+void GuiBatcher::EndCache() {
+	LOG_ASSERT(__cacheStack.size() > 0, "Cache begin/end mismatch");
+	CacheState state = __cacheStack.back();
+	__cacheStack.pop_back();
+
+	if (state.Replaying) {
+		// If a different number of things were pushed than when we built the cache, something was
+		// enabled or disabled without marking the cache dirty. We've already skipped the new geometry,
+		// so draw the old geometry this frame and rebuild next frame
+		if (state.PushCount != state.Cache->PushCount) {
+			state.Cache->Dirty = true;
+		}
+	} else {
+		state.Cache->PushCount = state.PushCount;
+		// Drop any batches that ended up empty (ex: text where every glyph came from a glyph cache page)
+		auto it = std::remove_if(state.Cache->Batches.begin(), state.Cache->Batches.end(), [](const GeometryCache::Batch& batch) {
+			return batch.Instances.empty();
+		});
+		state.Cache->Batches.erase(it, state.Cache->Batches.end());
 	}
 
-	// Copy over UV coords
-	verts[0].UV = glm::vec2(uvMin.x, uvMax.y);
-	verts[1].UV = glm::vec2(uvMin.x, uvMin.y);
-	verts[2].UV = glm::vec2(uvMax.x, uvMin.y);
-	verts[3].UV = glm::vec2(uvMax.x, uvMax.y);
+	__SubmitCache(*state.Cache, state.Order);
+}
 
-	// Add vertices and indices to range
-	uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
-	mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 1);
-	mesh.Builder.AddIndexTri(ix + 0, ix + 3, ix + 2);
+bool GuiBatcher::IsReplayingCache() {
+	return __cacheStack.size() > 0 && __cacheStack.back().Replaying;
 }
 
-void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, int edgeRadius)
-{
-	if (edgeRadius <= 0) {
-		PushRect(min, max, color, tex, { 0,0 }, { 1,1 });
-	} 
-	else {
-		glm::vec2 edgeOffset;
-		edgeOffset.x = edgeRadius / ((float)tex->GetWidth() - 2);
-		edgeOffset.y = edgeRadius / ((float)tex->GetHeight() - 2);
-		
-		// edge [min/max] [X,Y] screen
-		float eMinXS = min.x + edgeRadius;
-		float eMaxXS = max.x - edgeRadius;
-		float eMinYS = min.y + edgeRadius;
-		float eMaxYS = max.y - edgeRadius;
-
-		// UV [min/max] [X,Y]
-		float uMinXS = edgeOffset.x;
-		float uMaxXS = 1.0f - edgeOffset.x;
-		float uMinYS = edgeOffset.y;
-		float uMaxYS = 1.0f - edgeOffset.y;
-
-		// Left column
-		PushRect(glm::vec2(min.x, min.y),  glm::vec2(eMinXS, eMinYS), color, tex, glm::vec2(0.0f, uMaxYS),   glm::vec2(uMinXS, 1.0f));
-		PushRect(glm::vec2(min.x, eMinYS), glm::vec2(eMinXS, eMaxYS), color, tex, glm::vec2(0.0f, uMinYS), glm::vec2(uMinXS, uMaxYS));
-		PushRect(glm::vec2(min.x, eMaxYS), glm::vec2(eMinXS, max.y),  color, tex, glm::vec2(0.0f, 0.0f), glm::vec2(uMinXS, uMinYS));
-
-		// Center column
-		PushRect(glm::vec2(eMinXS, min.y),  glm::vec2(eMaxXS, eMinYS), color, tex, glm::vec2(uMinXS, uMaxYS),   glm::vec2(uMaxXS, 1.0f));
-		PushRect(glm::vec2(eMinXS, eMinYS), glm::vec2(eMaxXS, eMaxYS), color, tex, glm::vec2(uMinXS, uMinYS), glm::vec2(uMaxXS, uMaxYS));
-		PushRect(glm::vec2(eMinXS, eMaxYS), glm::vec2(eMaxXS, max.y), color, tex,  glm::vec2(uMinXS, 0.0f), glm::vec2(uMaxXS, uMinYS));
-
-		// Right column
-		PushRect(glm::vec2(eMaxXS, min.y),  glm::vec2(max.x, eMinYS), color, tex, glm::vec2(uMaxXS, uMaxYS),   glm::vec2(1.0f, 1.0f));
-		PushRect(glm::vec2(eMaxXS, eMinYS), glm::vec2(max.x, eMaxYS), color, tex, glm::vec2(uMaxXS, uMinYS), glm::vec2(1.0f, uMaxYS));
-		PushRect(glm::vec2(eMaxXS, eMaxYS), glm::vec2(max.x, max.y),  color, tex, glm::vec2(uMaxXS, 0.0f), glm::vec2(1.0f, uMinYS));
+void GuiBatcher::InvalidateCaches() {
+	__cacheGeneration++;
+}
+
+GuiBatcher::GeometryCache::Batch& GuiBatcher::__GetCacheBatch(const Texture2D::Sptr& tex) {
+	GeometryCache& cache = __cacheStack.size() > 0 ? *__cacheStack.back().Cache : __immediateCache;
+	// Only the last batch can be added to, otherwise things pushed later could end up drawn underneath
+	// things pushed earlier with a different texture
+	if (!cache.Batches.empty() && cache.Batches.back().Texture == tex) {
+		return cache.Batches.back();
 	}
+	cache.Batches.push_back({ tex, std::vector<Instance>() });
+	return cache.Batches.back();
 }
 
-void GuiBatcher::SetProjection(const glm::mat4& projection) {
-	__projection = projection;
+void GuiBatcher::__SubmitCache(const GeometryCache& cache, uint32_t order) {
+	for (const auto& batch : cache.Batches) {
+		if (batch.Instances.empty()) {
+			continue;
+		}
+		__segments.push_back({ order, batch.Texture.get(), batch.Instances.data(), static_cast<uint32_t>(batch.Instances.size()) });
+	}
 }
 
-void GuiBatcher::RenderText(const std::wstring& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/) {
-	// How many characters we have
-	size_t length = text.size();
+bool GuiBatcher::__BeginPush() {
+	if (__cacheStack.size() > 0) {
+		__cacheStack.back().PushCount++;
+		// The geometry for the current cache is already built, nothing to do
+		return !__cacheStack.back().Replaying;
+	}
+	return true;
+}
 
-	// Tracks the offset of the character
-	glm::vec2 offset = glm::vec2(0.0f);
+void GuiBatcher::__PushInstance(const Texture2D::Sptr& tex, const glm::vec2& min, const glm::vec2& max, const glm::vec2& uvAtMin, const glm::vec2& uvAtMax, const glm::vec4& color, const glm::vec4& border, uint32_t flags) {
+	if (tex == nullptr) {
+		return;
+	}
 
-	// Transform the origin based off the model transform
-	glm::vec2 origin = position;
+	Instance instance;
+	instance.Rect        = glm::vec4(min, max);
+	instance.UVRect      = glm::vec4(uvAtMin, uvAtMax);
+	instance.Border      = border;
+
+	// If the texture is in the atlas, remap the UVs into it's region and draw with the atlas instead
+	Texture2D::Sptr batchKey = tex;
+	GuiAtlas::Region region;
+	if (__atlas != nullptr && __atlas->TryGetRegion(tex.get(), region)) {
+		glm::vec2 regionSize = region.UVMax - region.UVMin;
+		instance.UVRect = glm::vec4(region.UVMin + uvAtMin * regionSize, region.UVMin + uvAtMax * regionSize);
+		instance.Border.z *= regionSize.x;
+		instance.Border.w *= regionSize.y;
+		flags |= region.Layer << InstanceLayerShift;
+		batchKey = nullptr;
+	}
 
-	// Gets the texture used to render the font
-	Texture2D::Sptr atlas = font->GetAtlas();
+	instance.Color       = color;
+	instance.Clip        = __clip;
+	instance.Transform   = glm::vec4(__model[0].x, __model[0].y, __model[1].x, __model[1].y);
+	instance.Translation = glm::vec2(__model[2]);
+	instance.Padding     = 0.0f;
+	instance.Flags       = flags;
+
+	__GetCacheBatch(batchKey).Instances.push_back(instance);
+}
 
-	// Grab the mesh builder and make sure it's a texture batch
-	MeshData& mesh = _meshBuilders[atlas.get()];
-	mesh.IsFont = true;
+void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, const glm::vec2 uvMin, const glm::vec2 uvMax) {
+	if (__BeginPush()) {
+		// The V coordinate is flipped, since screen space Y goes down
+		__PushInstance(tex, min, max, glm::vec2(uvMin.x, uvMax.y), glm::vec2(uvMax.x, uvMin.y), color, glm::vec4(0.0f), 0);
+	}
+}
 
-	// Allocate some space for the vertices
-	VertexPosColTex verts[4];
-	verts[0].Color = color;
-	verts[1].Color = color;
-	verts[2].Color = color;
-	verts[3].Color = color;
+void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, int edgeRadius)
+{
+	if (!__BeginPush()) {
+		return;
+	}
 
-	float depth = mesh.Builder.GetVertexCount() / 1000.0f;
+	// The shader takes care of slicing the rect, we just need to know how big the border is
+	glm::vec4 border = glm::vec4(0.0f);
+	if (edgeRadius > 0 && tex != nullptr) {
+		border.x = border.y = (float)edgeRadius;
+		border.z = edgeRadius / ((float)tex->GetWidth() - 2);
+		border.w = edgeRadius / ((float)tex->GetHeight() - 2);
+	}
 
-	// Iterate over all characters in string
-	for (int i = 0; i < length; i++) {
-		// Grab the glyph data for the character
-		GlyphInfo glyph = font->GetGlyph(text[i], offset.x, offset.y);
+	__PushInstance(tex, min, max, glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 0.0f), color, border, 0);
+}
 
-		// A newline will advance to the next line and return to the start of the line
-		if (text[i] == '\n') {
-			offset.y  += font->GetLineHeight() * scale;
-			offset.x = 0;
-		}
-		// A return character simply returns to the start of the line
-		else if (text[i] == '\r') {
-			offset.x = 0;
-		}
-		// A tab character is 4 spaces
-		else if (text[i] == '\t') {
-			float xOffTemp{ 0 }, yOffTemp{ 0 };
-			glyph = font->GetGlyph(' ', xOffTemp, yOffTemp);
-			offset.x += glyph.OffsetX * 4;
-		}
-		// All other characters get rendered
-		else {
-			verts[0].Position = __model * glm::vec3(origin + (offset + glyph.Positions[0]) * scale, 1.0f);
-			verts[1].Position = __model * glm::vec3(origin + (offset + glyph.Positions[1]) * scale, 1.0f);
-			verts[2].Position = __model * glm::vec3(origin + (offset + glyph.Positions[2]) * scale, 1.0f);
-			verts[3].Position = __model * glm::vec3(origin + (offset + glyph.Positions[3]) * scale, 1.0f);
-			verts[0].UV = glyph.UVs[0];
-			verts[1].UV = glyph.UVs[1];
-			verts[2].UV = glyph.UVs[2];
-			verts[3].UV = glyph.UVs[3];
-
-			verts[0].Position.z = verts[1].Position.z = verts[2].Position.z = verts[3].Position.z = depth;
-
-			uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
-			mesh.Builder.AddIndexTri(ix + 0, ix + 1, ix + 2);
-			mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 3);
-
-			// Advance the offset based on the size of the glyph
-			offset.x = glyph.OffsetX;
-			offset.y = glyph.OffsetY;
-
-			// If we have more characters, see if there's any kerning between the
-			// current and next character and add it to the x offset
-			if (i < length - 1) {
-				float kerning = font->GetKerning(text[i], text[i + 1]);
-				offset.x += kerning;
-			}
-		}
+void GuiBatcher::SetProjection(const glm::mat4& projection) {
+	__projection = projection;
+}
 
+void GuiBatcher::RenderText(const std::wstring& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/) {
+	if (__BeginPush()) {
+		font->LayoutText(text, scale, __scratchLayout);
+		__PushText(__scratchLayout, font, position, color);
 	}
-
 }
 
 void GuiBatcher::RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/)
 {
-	static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-	RenderText(converter.from_bytes(text), font, position, color, scale);
+	// Skip the conversion if the text is already cached
+	if (__BeginPush()) {
+		StringTools::ToUnicode(text, __scratchText);
+		font->LayoutText(__scratchText, scale, __scratchLayout);
+		__PushText(__scratchLayout, font, position, color);
+	}
+}
+
+void GuiBatcher::RenderText(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color) {
+	if (__BeginPush()) {
+		__PushText(layout, font, position, color);
+	}
+}
+
+void GuiBatcher::__PushText(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color) {
+	// Gets the texture used to render the font's baked glyphs
+	Texture2D::Sptr atlas = font->GetAtlas();
+
+	// Make room for an instance per character, in whichever batch the font will end up in
+	GuiAtlas::Region region;
+	bool inAtlas = __atlas != nullptr && atlas != nullptr && __atlas->TryGetRegion(atlas.get(), region);
+	GeometryCache::Batch& batch = __GetCacheBatch(inAtlas ? nullptr : atlas);
+	batch.Instances.reserve(batch.Instances.size() + layout.Glyphs.size());
+
+	uint32_t flags = font->IsSignedDistanceField() ? InstanceSdf : InstanceFont;
+	for (const TextLayout::Glyph& glyph : layout.Glyphs) {
+		// Glyphs from the font's dynamic glyph cache are drawn from their page, which never goes in the GUI atlas
+		const Texture2D::Sptr& texture = glyph.Page == 0 ? atlas : font->GetPageTexture(glyph.Page);
+		__PushInstance(texture, position + glyph.Min, position + glyph.Max, glyph.UVMin, glyph.UVMax, color, glm::vec4(0.0f), flags);
+	}
 }
 
 void GuiBatcher::Flush()
 {
 	__StaticInit();
 
-	// Iterate over each texture and it's mesh
-	for (auto&[key, value] : _meshBuilders) {
-		Texture2D* tex = key;
-		// If the texture exists and the mesh has data
-		if (tex != nullptr && value.Builder.GetIndexCount() > 0) {
-			// Update the VAO and it's buffers
-			__vao->Bind();
-			__vbo->UpdateData(value.Builder.GetVertexDataPtr(), sizeof(VertexPosColTex), value.Builder.GetVertexCount(), true);
-			__ibo->UpdateData(value.Builder.GetIndexDataPtr(), sizeof(uint32_t), value.Builder.GetIndexCount(), true);
-
-			// Bind texture, send uniforms to shader
-			tex->Bind(0);
-			ShaderProgram::Sptr shader = value.IsFont ? __fontShader : __shader;
-			shader->Bind();
-			shader->SetUniformMatrix(0, &__projection, 1, false);
-
-			// Draw geometry
-			__vao->Draw();
-
-			// Clear mesh
-			value.Builder.Reset();
+	// Upload anything that was packed into the atlas since the last frame
+	if (__atlas != nullptr) {
+		__atlas->Upload();
+	}
+
+	// Geometry that was pushed outside of any cache gets drawn on top of everything else
+	__SubmitCache(__immediateCache, __cacheOrder++);
+
+	// Keep glyph cache pages that we're about to draw from alive, then upload any glyphs that were
+	// rasterized this frame. If pages were evicted, caches built with them need to be rebuilt
+	for (const Segment& segment : __segments) {
+		GlyphCache::MarkUsed(segment.Texture);
+	}
+	if (GlyphCache::UploadAll()) {
+		InvalidateCaches();
+	}
+
+	// Caches are submitted when they finish, so children come before their parents. Put them
+	// back in the order they were started in so that parents are drawn underneath. The sort is
+	// stable so each cache's batches stay in the order they were pushed
+	std::stable_sort(__segments.begin(), __segments.end(), [](const Segment& a, const Segment& b) {
+		return a.Order < b.Order;
+	});
+	uint32_t instanceCount = 0;
+	for (const Segment& segment : __segments) {
+		instanceCount += segment.Count;
+	}
+
+	if (instanceCount > 0) {
+		__instances.Reserve(instanceCount);
+		uint32_t regionStart = 0;
+		Instance* region = __instances.Allocate(instanceCount, regionStart);
+
+		__vao->Bind();
+		__instances.GetBuffer()->Bind(0);
+		__shader->SetUniformMatrix(0, &__projection, 1, false);
+		__atlasShader->SetUniformMatrix(0, &__projection, 1, false);
+		const ShaderProgram* boundShader = nullptr;
+
+		// Copy the segments into the mapped buffer in draw order. Neighbouring segments with the same texture
+		// are drawn with a single instanced draw, with the atlas most of the HUD ends up in one run
+		uint32_t written = 0;
+		for (size_t ix = 0; ix < __segments.size();) {
+			Texture2D* tex = __segments[ix].Texture;
+			uint32_t runStart = written;
+			for (; ix < __segments.size() && __segments[ix].Texture == tex; ix++) {
+				memcpy(region + written, __segments[ix].Data, __segments[ix].Count * sizeof(Instance));
+				written += __segments[ix].Count;
+			}
+
+			// The atlas run is stored under nullptr, and samples from a texture array
+			const ShaderProgram::Sptr& shader = tex == nullptr ? __atlasShader : __shader;
+			if (tex == nullptr) {
+				// Can happen for a frame if the atlas was swapped out after things were cached
+				if (__atlas == nullptr || __atlas->GetTexture() == nullptr) {
+					continue;
+				}
+				__atlas->GetTexture()->Bind(0);
+			} else {
+				tex->Bind(0);
+			}
+			if (boundShader != shader.get()) {
+				shader->Bind();
+				boundShader = shader.get();
+			}
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, VERTICES_PER_INSTANCE, written - runStart, regionStart + runStart);
 		}
+
+		VertexArrayObject::Unbind();
+		StorageBuffer::UnBind(0);
+
+		__instances.Advance();
 	}
+
+	// Anything pushed outside of a cache is only drawn once
+	__segments.clear();
+	__immediateCache.Batches.clear();
+	__cacheOrder = 0;
 }
 
 void GuiBatcher::PushModelTransform(const glm::mat3& transform) {
-	__modelTransformStack.push_back(transform);
+	// Store the transform we had before, so that popping doesn't need an inverse
+	__modelTransformStack.push_back(__model);
 	__model = __model * transform;
 }
 
 void GuiBatcher::PopModelTransform()
 {
 	LOG_ASSERT(__modelTransformStack.size() > 0, "Transform push/pop mismatch");
-	__model = __model * glm::inverse(__modelTransformStack.back());
+	__model = __modelTransformStack.back();
 	__modelTransformStack.pop_back();
 }
 
@@ -232,78 +334,12 @@ void GuiBatcher::__StaticInit()
 	static bool needsInit = true;
 	if (needsInit) {
 		__shader = ShaderProgram::Create();
-		__shader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec3 inPos;
-					layout(location = 1) in vec4 inColor;
-					layout(location = 3) in vec2 inUV;
-
-					layout(location = 0) out vec4 outColor;
-					layout(location = 1) out vec2 outUV;
-
-					layout(location = 0) uniform mat4 u_Projection;
-
-					void main() {
-						outColor = inColor;
-						outUV = inUV;
-						gl_Position = u_Projection * vec4(inPos, 1);
-					}
-				)LIT", ShaderPartType::Vertex);
-
-		__shader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec4 inColor;
-					layout(location = 1) in vec2 inUV;
-
-					layout(location = 0) out vec4 outColor;
-
-					uniform layout(binding=0) sampler2D s_Texture;
-
-					void main() {
-						outColor = texture(s_Texture, inUV) * inColor;
-					}
-				)LIT", ShaderPartType::Fragment);
-
+		__shader->LoadShaderPartFromFile("shaders/vertex_shaders/gui_vs.glsl", ShaderPartType::Vertex);
+		__shader->LoadShaderPartFromFile("shaders/fragment_shaders/gui_fs.glsl", ShaderPartType::Fragment);
 		__shader->Link();
-
-		__fontShader = ShaderProgram::Create();
-		__fontShader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec3 inPos;
-					layout(location = 1) in vec4 inColor;
-					layout(location = 3) in vec2 inUV;
-
-					layout(location = 0) out vec4 outColor;
-					layout(location = 1) out vec2 outUV;
-
-					layout(location = 0) uniform mat4 u_Projection;
-
-					void main() {
-						outColor = inColor;
-						outUV = inUV;
-						gl_Position = u_Projection * vec4(inPos, 1);
-					}
-				)LIT", ShaderPartType::Vertex);
-
-		__fontShader->LoadShaderPart(R"LIT(#version 460
-					layout(location = 0) in vec4 inColor;
-					layout(location = 1) in vec2 inUV;
-
-					layout(location = 0) out vec4 outColor;
-
-					uniform layout(binding=0) sampler2D s_Texture;
-
-					void main() {
-						float fontPow = texture(s_Texture, inUV).r;
-						outColor = vec4(inColor.rgb, fontPow);
-					}
-				)LIT" , ShaderPartType::Fragment);
-
-		__fontShader->Link();
-
-		__vbo = VertexBuffer::Create(BufferUsage::DynamicDraw);
-		__ibo = IndexBuffer::Create(BufferUsage::DynamicDraw, IndexType::UInt);
+		__atlasShader = __shader->GetVariant({ { "GUI_ATLAS", "1" } });
 
 		__vao = VertexArrayObject::Create();
-		__vao->AddVertexBuffer(__vbo, VertexPosColTex::V_DECL);
-		__vao->SetIndexBuffer(__ibo);
 
 		// Generate a simple white texture with a black border
 		if (__defaultUITexture == nullptr) {
@@ -327,6 +363,10 @@ void GuiBatcher::__StaticInit()
 				}
 			}
 			__defaultUITexture->LoadData(16, 16, PixelFormat::RGBA, PixelType::UByte, data);
+			AddToAtlas(__defaultUITexture);
+
+			// Anything that was cached before now should draw with the new texture
+			InvalidateCaches();
 		}
 
 		needsInit = false;
@@ -334,48 +374,35 @@ void GuiBatcher::__StaticInit()
 }
 
 void GuiBatcher::PushScissorRect(const glm::vec2& min, const glm::vec2& max) {
-	// Convert input to the current space
-	glm::vec2 modelMin = __model * glm::vec3(min, 1.0f);
-	glm::vec2 modelMax = __model * glm::vec3(max, 1.0f);
-
-	// Project the values, will be in Normalized Device Coordinates ([-1,1])
-	glm::vec2 minNDC = __projection * glm::vec4(modelMin, 0.0f, 1.0f);
-	glm::vec2 maxNDC = __projection * glm::vec4(modelMax, 0.0f, 1.0f);
-
-	// Convert NDC to screenspace
-	glm::ivec2 minWin = glm::floor(((minNDC + 1.0f) / 2.0f) * (glm::vec2)__windowSize);
-	glm::ivec2 maxWin = glm::ceil(((maxNDC + 1.0f) / 2.0f)  * (glm::vec2)__windowSize);
-
-	// Store the bounds
-	__scissorRects.push_back({ minWin, maxWin });
-
-	// Calculate the actual size
-	int width  = glm::max(maxWin.x, minWin.x) - glm::min(maxWin.x, minWin.x);
-	int height = glm::max(maxWin.y, minWin.y) - glm::min(maxWin.y, minWin.y);
+	// Store the bounds of the rect in screen space, we use the bounds of all 4 corners in case the model is rotated
+	glm::vec2 corners[4] = {
+		__model * glm::vec3(min.x, min.y, 1.0f),
+		__model * glm::vec3(min.x, max.y, 1.0f),
+		__model * glm::vec3(max.x, max.y, 1.0f),
+		__model * glm::vec3(max.x, min.y, 1.0f)
+	};
+	glm::vec2 screenMin = corners[0];
+	glm::vec2 screenMax = corners[0];
+	for (int ix = 1; ix < 4; ix++) {
+		screenMin = glm::min(screenMin, corners[ix]);
+		screenMax = glm::max(screenMax, corners[ix]);
+	}
 
-	// Draw current geo with the current scissor, then update it
-	Flush();
-	glScissor(minWin.x, maxWin.y, width, height);
+	// Nested scissor rects can only shrink the visible region
+	__scissorRects.push_back(__clip);
+	__clip = glm::vec4(glm::max(glm::vec2(__clip), screenMin), glm::min(glm::vec2(__clip.z, __clip.w), screenMax));
 }
 
 void GuiBatcher::PopScissorRect() {
 	LOG_ASSERT(__scissorRects.size() > 0, "Scissor rect push/pop mismatch!");
+	__clip = __scissorRects.back();
 	__scissorRects.pop_back();
-
-	// Grab the last scissor rect, or just use window bounds if none left
-	IRect bounds = __scissorRects.size() > 0 ? __scissorRects.back() : IRect{ { 0, 0 }, { __windowSize.x, __windowSize.y } };
-
-	// Calculate the actual size
-	int width  = glm::max(bounds.Min.x, bounds.Max.x) - glm::min(bounds.Min.x, bounds.Max.x);
-	int height = glm::max(bounds.Min.y, bounds.Max.y) - glm::min(bounds.Min.y, bounds.Max.y);
-
-	// Draw current geo with the current scissor, then update it
-	Flush();
-	glScissor(glm::min(bounds.Min.x, bounds.Max.x), glm::min(bounds.Min.y, bounds.Max.y), width, height);
 }
 
 void GuiBatcher::SetDefaultTexture(const Texture2D::Sptr& value) {
 	__defaultUITexture = value;
+	AddToAtlas(value);
+	InvalidateCaches();
 }
 
 const Texture2D::Sptr& GuiBatcher::GetDefaultTexture() {
@@ -384,8 +411,33 @@ const Texture2D::Sptr& GuiBatcher::GetDefaultTexture() {
 
 void GuiBatcher::SetDefaultBorderRadius(int value) {
 	__defaultEdgeRadius = value;
+	InvalidateCaches();
 }
 
 int GuiBatcher::GetDefaultBorderRadius() {
 	return __defaultEdgeRadius;
 }
+
+void GuiBatcher::SetAtlas(const GuiAtlas::Sptr& value) {
+	__atlas = value;
+	// Cached geometry has UVs for the old atlas baked in
+	InvalidateCaches();
+}
+
+const GuiAtlas::Sptr& GuiBatcher::GetAtlas() {
+	return __atlas;
+}
+
+void GuiBatcher::AddToAtlas(const Texture2D::Sptr& texture) {
+	if (__atlas == nullptr || texture == nullptr) {
+		return;
+	}
+	GuiAtlas::Region region;
+	if (__atlas->TryGetRegion(texture.get(), region)) {
+		return;
+	}
+	// Anything that was already cached with the texture needs to be rebuilt to use the atlas
+	if (__atlas->Add(texture)) {
+		InvalidateCaches();
+	}
+}
@@ -5,10 +5,11 @@
 #include "Graphics/Textures/Texture2D.h"
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/VertexArrayObject.h"
-#include "Graphics/VertexTypes.h"
+#include "Graphics/Buffers/StorageBuffer.h"
+#include "Graphics/Buffers/PersistentStreamBuffer.h"
 #include "Graphics/Font.h"
-#include "Utils/MeshBuilder.h"
-#include <unordered_map>
+#include "Graphics/GuiAtlas.h"
+#include "Utils/Macros.h"
 
 	/// <summary>
 	/// The GUI Batcher class provides utilities for drawing rectangles and
@@ -16,10 +17,102 @@
 	/// </summary>
 	class GuiBatcher {
 	public:
+		/// <summary>
+		/// A single panel or glyph, the GUI shader expands each of these into a 9-sliced quad.
+		/// This layout must match GuiInstance in shaders/fragments/gui_instance.glsl
+		/// </summary>
+		struct Instance {
+			// The bounds of the rectangle in model space, xy is the min and zw is the max
+			glm::vec4 Rect;
+			// The UV coords at the min (xy) and max (zw) corners of Rect
+			glm::vec4 UVRect;
+			// xy is the size of the 9-slice border in model space, zw is the size of the border in UV space
+			glm::vec4 Border;
+			glm::vec4 Color;
+			// The region of the window that the instance is clipped to in pixels, xy is the min and zw is the max
+			glm::vec4 Clip;
+			// The columns of the rotation and scale part of the model transform
+			glm::vec4 Transform;
+			// The translation part of the model transform
+			glm::vec2 Translation;
+			// Unused, keeps Flags where std430 expects it
+			float     Padding;
+			// See InstanceFlags
+			uint32_t  Flags;
+		};
+
+		/// <summary>
+		/// Flags for the GUI shader that can be set on an instance
+		/// </summary>
+		enum InstanceFlags : uint32_t {
+			// The texture is a font atlas, it's red channel is used as alpha
+			InstanceFont = 1 << 0,
+			// The texture is a signed distance field font atlas, see Font::SetSignedDistanceField
+			InstanceSdf  = 1 << 1,
+			// Instances drawn from the atlas store the layer to sample in the bits above this
+			InstanceLayerShift = 8
+		};
+
+		/// <summary>
+		/// Holds the instances that a GUI element generated in an earlier frame, so that they can be
+		/// drawn again without being rebuilt. See BeginCache
+		/// </summary>
+		struct GeometryCache {
+			NO_COPY(GeometryCache);
+			NO_MOVE(GeometryCache);
+
+			struct Batch {
+				Texture2D::Sptr Texture;
+				std::vector<Instance> Instances;
+			};
+
+			GeometryCache();
+
+			// Set this when anything that the element draws has changed, the geometry will be rebuilt
+			// the next time the element is drawn. Changes to the model transform are detected automatically
+			bool      Dirty;
+
+			// The model transform that the geometry was built with
+			glm::mat3 Model;
+			// The clip rect that the geometry was built with
+			glm::vec4 Clip;
+			// The value of GuiBatcher's generation when the geometry was built, see InvalidateCaches
+			uint32_t  Generation;
+			// The number of push calls that built the geometry, used to detect elements that have been enabled or disabled
+			uint32_t  PushCount;
+			// The geometry that this element draws, a new batch is started whenever the texture changes so
+			// that the batches are in the same order things were pushed in
+			std::vector<Batch> Batches;
+		};
+
+		/// <summary>
+		/// Starts recording GUI geometry into the given cache. If the cache is still valid for the
+		/// current model transform and scissor rect, the stored geometry is used instead and any rects or text pushed
+		/// before the matching EndCache are ignored. Caches can be nested, geometry goes to the
+		/// innermost cache
+		/// </summary>
+		/// <param name="cache">The cache to record into or draw from</param>
+		static void BeginCache(GeometryCache& cache);
+		/// <summary>
+		/// Finishes the cache started by the last call to BeginCache, and queues it's geometry
+		/// to be drawn in the next Flush
+		/// </summary>
+		static void EndCache();
+		/// <summary>
+		/// Returns true if the innermost cache is being drawn from and does not need new geometry,
+		/// GUI elements can use this to skip work that would be ignored anyways
+		/// </summary>
+		static bool IsReplayingCache();
+		/// <summary>
+		/// Forces every cache to be rebuilt the next time it is drawn, for changes that affect all
+		/// GUI elements (ex: the default texture)
+		/// </summary>
+		static void InvalidateCaches();
+
 		/// <summary>
 		/// Adds a rectangle to the GUI batch, with a given border radius in pixels.
 		/// This can be used with textures to create rounded borders
-		/// Creates 9 sub rectangles, note that the center and edge regions will be stretched
+		/// The GUI shader slices the rect into 9 regions, note that the center and edge regions will be stretched
 		/// </summary>
 		/// <param name="min">The minimum bounds in projection space coordinates</param>
 		/// <param name="max">The maximum bounds in projection space coordinates</param>
@@ -55,6 +148,15 @@
 		/// <param name="color">The color of the text</param>
 		/// <param name="scale">The scaling to apply to the text</param>
 		static void RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale = 1.0f);
+		/// <summary>
+		/// Renders text that has already been laid out with Font::LayoutText, skipping all glyph
+		/// and kerning lookups
+		/// </summary>
+		/// <param name="layout">The layout to render, scaling has already been applied</param>
+		/// <param name="font">The font that the text was laid out with</param>
+		/// <param name="position">The position of the text in model space</param>
+		/// <param name="color">The color of the text</param>
+		static void RenderText(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color);
 
 		/// <summary>
 		/// Sets the projection matrix to use for rendering, should ideally be an orthographic
@@ -66,7 +168,8 @@
 		/// </summary>
 		static void SetWindowSize(const glm::ivec2& size);
 		/// <summary>
-		/// Draws all geometry to the screen and prepares for the next batch
+		/// Draws all geometry to the screen and prepares for the next frame. Instances are copied into a
+		/// persistently mapped buffer, and each texture is drawn with a single instanced draw call
 		/// </summary>
 		static void Flush();
 
@@ -82,14 +185,13 @@
 		static void PopModelTransform();
 
 		/// <summary>
-		/// Sets a new scissor region in model space. Note that this will invoke a 
-		/// flush
+		/// Sets a new scissor region in model space, anything pushed afterwards is clipped to it
 		/// </summary>
 		/// <param name="min">The minimum bounds of the scissor rectangle</param>
 		/// <param name="min">The maximum bounds of the scissor rectangle</param>
 		static void PushScissorRect(const glm::vec2& min, const glm::vec2& max);
 		/// <summary>
-		/// Pops the last scissor region, not that this will invoke a flush
+		/// Pops the last scissor region
 		/// </summary>
 		static void PopScissorRect();
 
@@ -112,31 +214,82 @@
 		/// </summary>
 		static int GetDefaultBorderRadius();
 
+		/// <summary>
+		/// Sets the atlas that GUI textures are packed into. Anything drawn with a texture in the atlas
+		/// is drawn with the atlas instead, so that it can share a draw call with everything else in it.
+		/// Set to nullptr to draw every texture separately
+		/// </summary>
+		static void SetAtlas(const GuiAtlas::Sptr& value);
+		/// <summary>
+		/// Gets the atlas that GUI textures are packed into, may be nullptr
+		/// </summary>
+		static const GuiAtlas::Sptr& GetAtlas();
+		/// <summary>
+		/// Packs a texture into the GUI atlas if it isn't already, GUI components call this for the
+		/// textures and fonts they draw with. Textures that don't fit are still drawn on their own
+		/// </summary>
+		/// <param name="texture">The texture to add</param>
+		static void AddToAtlas(const Texture2D::Sptr& texture);
+
 	private:
-		struct IRect {
-			glm::ivec2 Min;
-			glm::ivec2 Max;
+		// A range of instances from a single cache that all use the same texture
+		struct Segment {
+			// The order that the cache was started in, parents are drawn before their children
+			uint32_t Order;
+			// Instances drawn from the atlas are stored under nullptr
+			Texture2D* Texture;
+			const Instance* Data;
+			uint32_t Count;
 		};
 
-		struct MeshData {
-			MeshBuilder<VertexPosColTex> Builder;
-			bool IsFont;
+		// The state of a cache between BeginCache and EndCache
+		struct CacheState {
+			GeometryCache* Cache;
+			bool           Replaying;
+			uint32_t       Order;
+			uint32_t       PushCount;
 		};
 
 		static glm::ivec2 __windowSize;
 		static glm::mat4 __projection;
 		static glm::mat3 __model;
+		// The model transform before each push, so we can pop without inverting
 		static std::vector<glm::mat3> __modelTransformStack;
-		static std::vector<IRect> __scissorRects;
+		// The clip rect before each scissor rect was pushed
+		static std::vector<glm::vec4> __scissorRects;
+		// The region of the screen that new instances are clipped to, xy is the min and zw is the max
+		static glm::vec4 __clip;
 		static ShaderProgram::Sptr __shader;
-		static ShaderProgram::Sptr __fontShader;
-		static std::unordered_map<Texture2D*, MeshData> _meshBuilders;
+		// Everything submitted this frame. We draw these in element order, merging neighbours that use
+		// the same texture, since the GUI is drawn without depth testing
+		static std::vector<Segment> __segments;
+		// We don't need any vertex attributes, but OpenGL requires a VAO to be bound to draw
 		static VertexArrayObject::Sptr __vao;
-		static VertexBuffer::Sptr __vbo;
-		static IndexBuffer::Sptr __ibo;
+
+		// Instances are copied straight into a persistently mapped buffer every frame
+		static PersistentStreamBuffer<StorageBuffer, Instance> __instances;
+
+		static std::vector<CacheState> __cacheStack;
+		static uint32_t __cacheOrder;
+		static uint32_t __cacheGeneration;
+		// Geometry that is pushed outside of any cache is rebuilt every frame
+		static GeometryCache __immediateCache;
 
 		static Texture2D::Sptr __defaultUITexture;
 		static int __defaultEdgeRadius;
 
+		// Reused by the RenderText overloads that need to lay out text every time
+		static TextLayout __scratchLayout;
+		static std::wstring __scratchText;
+
+		static GuiAtlas::Sptr __atlas;
+		// Drawn in place of the regular GUI shader for the atlas batch, samples from a texture array
+		static ShaderProgram::Sptr __atlasShader;
+
 		static void __StaticInit();
+		static bool __BeginPush();
+		static void __PushText(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color);
+		static void __PushInstance(const Texture2D::Sptr& tex, const glm::vec2& min, const glm::vec2& max, const glm::vec2& uvAtMin, const glm::vec2& uvAtMax, const glm::vec4& color, const glm::vec4& border, uint32_t flags);
+		static GeometryCache::Batch& __GetCacheBatch(const Texture2D::Sptr& tex);
+		static void __SubmitCache(const GeometryCache& cache, uint32_t order);
 	};
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Base class for the engine-wide particle pool that every particle system spawns into. Particle systems
+/// only ever queue up emission, the pool owns the particles and simulates and draws all of them at once,
+/// so the same systems can run on the GPU (GpuParticlePool) or on the CPU (CpuParticlePool)
+/// </summary>
+class IParticlePool {
+public:
+	MAKE_PTRS(IParticlePool);
+	NO_COPY(IParticlePool);
+	NO_MOVE(IParticlePool);
+
+	/// <summary>
+	/// A request to spawn a number of particles this update, see Emit
+	/// </summary>
+	struct EmitRequest {
+		// The world space position to spawn particles at
+		glm::vec3 Position;
+		// The world space initial velocity of new particles
+		glm::vec3 Velocity;
+		// The color of new particles, alpha fades out over the particle's life
+		glm::vec4 Color;
+		// The acceleration applied to new particles over their life
+		glm::vec3 Gravity;
+		// The maximum angle in radians that new particles can deviate from Velocity
+		float     ConeAngle;
+		// The range that new particles pick their lifetime from, in seconds
+		glm::vec2 LifetimeRange;
+		// The number of particles to spawn, if the pool runs out of room some of these will be dropped
+		uint32_t  Count;
+	};
+
+	virtual ~IParticlePool() = default;
+
+	/// <summary>
+	/// Makes sure that the pool can hold at least the given number of particles. Growing the pool
+	/// may clear all particles that are currently alive
+	/// </summary>
+	virtual void Reserve(uint32_t capacity) = 0;
+	/// <summary>
+	/// Kills every particle in the pool, and drops any emission that has not been simulated yet
+	/// </summary>
+	virtual void Clear() = 0;
+
+	/// <summary>
+	/// Queues particles to be spawned during the next call to Simulate. Any number of emitters can
+	/// submit requests each update, so emitters can come and go at any time
+	/// </summary>
+	virtual void Emit(const EmitRequest& request) = 0;
+
+	/// <summary>
+	/// Spawns all queued particles, then updates and compacts every particle in the pool
+	/// </summary>
+	/// <param name="deltaTime">The time in seconds to advance the particles by</param>
+	virtual void Simulate(float deltaTime) = 0;
+
+	/// <summary>
+	/// Draws all of the particles as points. Expects the frame level uniforms to be bound with the
+	/// camera that we are drawing for
+	/// </summary>
+	virtual void Render() = 0;
+
+	/// <summary>
+	/// Gets the maximum number of particles that can be alive at once
+	/// </summary>
+	virtual uint32_t GetCapacity() const = 0;
+	/// <summary>
+	/// Gets the number of particles that are alive. Depending on the pool this may be a few frames old,
+	/// so is only meant for stats and tools
+	/// </summary>
+	virtual uint32_t GetAliveCount() const = 0;
+	/// <summary>
+	/// Returns true if the pool has nothing to draw
+	/// </summary>
+	virtual bool IsEmpty() const = 0;
+
+protected:
+	IParticlePool() = default;
+};
@@ -0,0 +1,295 @@
+#include "Graphics/OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <immintrin.h>
+
+// Any vertex with a clip space w smaller than this is treated as being behind the camera
+#define OCCLUSION_NEAR_W 1e-4f
+
+OcclusionCuller::OcclusionCuller() :
+	_views(),
+	_viewCount(0),
+	_occluders(),
+	_occludees(),
+	_executionTimeMs(0.0f),
+	_clipPositions()
+{ }
+
+OcclusionCuller::~OcclusionCuller() = default;
+
+void OcclusionCuller::Clear() {
+	_viewCount = 0;
+	_occluders.clear();
+	_occludees.clear();
+}
+
+int OcclusionCuller::AddView(const glm::mat4& viewProjection) {
+	// Allocate a new view and it's pyramid if we've never had this many views before
+	if (static_cast<size_t>(_viewCount) >= _views.size()) {
+		View view;
+		glm::ivec2 size = glm::ivec2(DEPTH_WIDTH, DEPTH_HEIGHT);
+		while (true) {
+			view.LevelSizes.push_back(size);
+			view.HiZ.push_back(std::vector<float>(size.x * size.y, 1.0f));
+			if (size.x == 1 && size.y == 1) {
+				break;
+			}
+			size = glm::max(size / 2, glm::ivec2(1));
+		}
+		_views.push_back(view);
+	}
+
+	View& view = _views[_viewCount];
+	view.ViewProjection = viewProjection;
+	view.CulledCount = 0;
+	return _viewCount++;
+}
+
+void OcclusionCuller::AddOccluder(const Gameplay::MeshResource::CpuMeshData::Sptr& mesh, const glm::mat4& transform) {
+	if (mesh != nullptr && !mesh->Indices.empty()) {
+		_occluders.push_back({ mesh, transform });
+	}
+}
+
+int OcclusionCuller::AddOccludee(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform) {
+	_occludees.push_back({ boundsMin, boundsMax, transform });
+	return static_cast<int>(_occludees.size()) - 1;
+}
+
+void OcclusionCuller::Execute() {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (int ix = 0; ix < _viewCount; ix++) {
+		View& view = _views[ix];
+		view.Visibility.resize(_occludees.size());
+
+		_RasterizeOccluders(view);
+		_BuildHiZ(view);
+
+		// Test every object against the pyramid
+		view.CulledCount = 0;
+		for (size_t jx = 0; jx < _occludees.size(); jx++) {
+			bool visible = _TestBounds(view, _occludees[jx]);
+			view.Visibility[jx] = visible ? 1 : 0;
+			view.CulledCount += visible ? 0 : 1;
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	_executionTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+bool OcclusionCuller::IsVisible(int view, int occludee) const {
+	if (view < 0 || view >= _viewCount || occludee < 0 || static_cast<size_t>(occludee) >= _views[view].Visibility.size()) {
+		return true;
+	}
+	return _views[view].Visibility[occludee] != 0;
+}
+
+int OcclusionCuller::GetCulledCount(int view) const {
+	return (view >= 0 && view < _viewCount) ? _views[view].CulledCount : 0;
+}
+
+float OcclusionCuller::GetExecutionTimeMs() const {
+	return _executionTimeMs;
+}
+
+void OcclusionCuller::_RasterizeOccluders(View& view) {
+	std::vector<float>& depth = view.HiZ[0];
+	std::fill(depth.begin(), depth.end(), 1.0f);
+
+	const glm::vec2 screenSize = glm::vec2(DEPTH_WIDTH, DEPTH_HEIGHT);
+
+	for (const Occluder& occluder : _occluders) {
+		const std::vector<glm::vec3>& positions = occluder.Mesh->Positions;
+		const std::vector<uint32_t>& indices = occluder.Mesh->Indices;
+
+		// Transform all the vertices into clip space up front, since most will be shared by several triangles
+		glm::mat4 mvp = view.ViewProjection * occluder.Transform;
+		_clipPositions.resize(positions.size());
+		for (size_t ix = 0; ix < positions.size(); ix++) {
+			_clipPositions[ix] = mvp * glm::vec4(positions[ix], 1.0f);
+		}
+
+		for (size_t ix = 0; ix + 2 < indices.size(); ix += 3) {
+			const glm::vec4& c0 = _clipPositions[indices[ix + 0]];
+			const glm::vec4& c1 = _clipPositions[indices[ix + 1]];
+			const glm::vec4& c2 = _clipPositions[indices[ix + 2]];
+
+			// We don't clip against the near plane, triangles that cross it are simply skipped.
+			// Dropping part of an occluder is always safe, it just means we cull a bit less
+			if (c0.w < OCCLUSION_NEAR_W || c1.w < OCCLUSION_NEAR_W || c2.w < OCCLUSION_NEAR_W) {
+				continue;
+			}
+
+			// Perspective divide and map x,y to pixels and z to the 0-1 range
+			glm::vec3 s0 = glm::vec3(c0) / c0.w;
+			glm::vec3 s1 = glm::vec3(c1) / c1.w;
+			glm::vec3 s2 = glm::vec3(c2) / c2.w;
+			s0 = glm::vec3((glm::vec2(s0) * 0.5f + 0.5f) * screenSize, s0.z * 0.5f + 0.5f);
+			s1 = glm::vec3((glm::vec2(s1) * 0.5f + 0.5f) * screenSize, s1.z * 0.5f + 0.5f);
+			s2 = glm::vec3((glm::vec2(s2) * 0.5f + 0.5f) * screenSize, s2.z * 0.5f + 0.5f);
+
+			_RasterizeTriangle(depth.data(), s0, s1, s2);
+		}
+	}
+}
+
+void OcclusionCuller::_RasterizeTriangle(float* depth, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2) {
+	// Make sure our winding is counter-clockwise, so the edge functions are positive inside
+	// Occluders are treated as double sided, since either side blocks the view
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (std::abs(area) < 1e-6f) {
+		return;
+	}
+	if (area < 0.0f) {
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	// Determine the pixels we need to touch, snapping the start of each row to a group of 4
+	int minX = std::max(static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))), 0) & ~3;
+	int maxX = std::min(static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))), DEPTH_WIDTH - 1);
+	int minY = std::max(static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))), 0);
+	int maxY = std::min(static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))), DEPTH_HEIGHT - 1);
+	if (minX > maxX || minY > maxY) {
+		return;
+	}
+
+	// Edge functions in the form E(x, y) = A*x + B*y + C, where the edge opposite to
+	// a vertex gives that vertex's (unnormalized) barycentric weight
+	float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = -(a0 * v1.x + b0 * v1.y);
+	float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = -(a1 * v2.x + b1 * v2.y);
+	float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = -(a2 * v0.x + b2 * v0.y);
+
+	// Depth is linear in screen space after the perspective divide, so we can express it as a plane as well
+	float invArea = 1.0f / area;
+	float za = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+	float zb = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+	float zc = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+	// We sample at pixel centers, 4 pixels at a time
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one  = _mm_set1_ps(1.0f);
+	const __m128 ea0 = _mm_set1_ps(a0), ea1 = _mm_set1_ps(a1), ea2 = _mm_set1_ps(a2);
+	const __m128 dza = _mm_set1_ps(za);
+
+	for (int y = minY; y <= maxY; y++) {
+		float py = y + 0.5f;
+		const __m128 row0 = _mm_set1_ps(b0 * py + c0);
+		const __m128 row1 = _mm_set1_ps(b1 * py + c1);
+		const __m128 row2 = _mm_set1_ps(b2 * py + c2);
+		const __m128 rowZ = _mm_set1_ps(zb * py + zc);
+
+		float* rowDepth = depth + (y * DEPTH_WIDTH);
+
+		for (int x = minX; x <= maxX; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+
+			// Evaluate all 3 edges and determine which lanes are inside the triangle
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(ea0, px), row0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(ea1, px), row1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(ea2, px), row2);
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+
+			// Interpolate depth and keep the closest value for any lanes that are covered
+			__m128 z = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(dza, px), rowZ), zero), one);
+			__m128 existing = _mm_loadu_ps(rowDepth + x);
+			__m128 closest = _mm_min_ps(existing, z);
+			_mm_storeu_ps(rowDepth + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, existing)));
+		}
+	}
+}
+
+void OcclusionCuller::_BuildHiZ(View& view) {
+	for (size_t level = 1; level < view.HiZ.size(); level++) {
+		const std::vector<float>& src = view.HiZ[level - 1];
+		std::vector<float>& dst = view.HiZ[level];
+		glm::ivec2 srcSize = view.LevelSizes[level - 1];
+		glm::ivec2 dstSize = view.LevelSizes[level];
+
+		for (int y = 0; y < dstSize.y; y++) {
+			// Clamp our source rows, in case one dimension has already reached 1 texel
+			int sy0 = std::min(y * 2, srcSize.y - 1);
+			int sy1 = std::min(y * 2 + 1, srcSize.y - 1);
+			for (int x = 0; x < dstSize.x; x++) {
+				int sx0 = std::min(x * 2, srcSize.x - 1);
+				int sx1 = std::min(x * 2 + 1, srcSize.x - 1);
+
+				// We store the furthest depth, since anything behind that is guaranteed to be occluded
+				dst[y * dstSize.x + x] = std::max(
+					std::max(src[sy0 * srcSize.x + sx0], src[sy0 * srcSize.x + sx1]),
+					std::max(src[sy1 * srcSize.x + sx0], src[sy1 * srcSize.x + sx1])
+				);
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::_TestBounds(const View& view, const Occludee& occludee) const {
+	glm::mat4 mvp = view.ViewProjection * occludee.Transform;
+
+	// Project all 8 corners of the box, tracking the screen bounds and the closest depth
+	glm::vec2 ndcMin = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 ndcMax = glm::vec2(-std::numeric_limits<float>::max());
+	float closestDepth = 1.0f;
+	for (int ix = 0; ix < 8; ix++) {
+		glm::vec3 corner = glm::vec3(
+			(ix & 1) ? occludee.BoundsMax.x : occludee.BoundsMin.x,
+			(ix & 2) ? occludee.BoundsMax.y : occludee.BoundsMin.y,
+			(ix & 4) ? occludee.BoundsMax.z : occludee.BoundsMin.z
+		);
+		glm::vec4 clip = mvp * glm::vec4(corner, 1.0f);
+
+		// If the box crosses the camera plane it's right on top of us, always draw it
+		if (clip.w < OCCLUSION_NEAR_W) {
+			return true;
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, glm::vec2(ndc));
+		ndcMax = glm::max(ndcMax, glm::vec2(ndc));
+		closestDepth = std::min(closestDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	// Objects that are entirely off-screen are left to the rest of the renderer, we only
+	// reason about things that are hidden behind our occluders
+	if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f || closestDepth <= 0.0f) {
+		return true;
+	}
+
+	// Find the pixels that the box covers at full resolution
+	const glm::vec2 screenSize = glm::vec2(DEPTH_WIDTH, DEPTH_HEIGHT);
+	glm::ivec2 pixMin = glm::clamp(glm::ivec2(glm::floor((ndcMin * 0.5f + 0.5f) * screenSize)), glm::ivec2(0), glm::ivec2(DEPTH_WIDTH - 1, DEPTH_HEIGHT - 1));
+	glm::ivec2 pixMax = glm::clamp(glm::ivec2(glm::floor((ndcMax * 0.5f + 0.5f) * screenSize)), glm::ivec2(0), glm::ivec2(DEPTH_WIDTH - 1, DEPTH_HEIGHT - 1));
+
+	// Pick the pyramid level where our box covers at most 2 texels in each direction (3 if it straddles a boundary)
+	int extent = std::max(pixMax.x - pixMin.x + 1, pixMax.y - pixMin.y + 1);
+	int level = 0;
+	while ((extent >> level) > 2 && level < static_cast<int>(view.HiZ.size()) - 1) {
+		level++;
+	}
+
+	const std::vector<float>& hiz = view.HiZ[level];
+	glm::ivec2 levelSize = view.LevelSizes[level];
+	glm::ivec2 levelMin = glm::min(pixMin >> level, levelSize - 1);
+	glm::ivec2 levelMax = glm::min(pixMax >> level, levelSize - 1);
+
+	// Find the furthest occluder depth over the covered region
+	float furthest = 0.0f;
+	for (int y = levelMin.y; y <= levelMax.y; y++) {
+		for (int x = levelMin.x; x <= levelMax.x; x++) {
+			furthest = std::max(furthest, hiz[y * levelSize.x + x]);
+		}
+	}
+
+	// If the closest point of the box is behind every occluder in the region, it can't be seen
+	return closestDepth <= furthest;
+}
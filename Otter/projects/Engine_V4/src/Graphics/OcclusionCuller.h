@@ -0,0 +1,114 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Gameplay/MeshResource.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// A software occlusion culler. Rasterizes a small set of occluder meshes into low
+/// resolution depth buffers on the CPU (using SSE to shade 4 pixels at a time), builds
+/// a hierarchical-Z pyramid from them, then tests object bounds against that pyramid
+///
+/// Execute does not touch OpenGL, so it can be run on a worker thread so long as the
+/// views, occluders and occludees are not modified until it finishes
+/// </summary>
+class OcclusionCuller {
+public:
+	MAKE_PTRS(OcclusionCuller);
+	NO_COPY(OcclusionCuller);
+	NO_MOVE(OcclusionCuller);
+
+	// The size of the depth buffers that we rasterize occluders into,
+	// width must be a multiple of 4 so that rows line up with our SIMD lanes
+	static const int DEPTH_WIDTH  = 256;
+	static const int DEPTH_HEIGHT = 128;
+
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	/// <summary>
+	/// Removes all views, occluders and occludees, keeping the allocated depth buffers
+	/// around so they can be re-used next frame
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Adds a view that occludees will be tested against, each view gets it's own depth buffer
+	/// </summary>
+	/// <param name="viewProjection">The view projection matrix for the view, does not need to be perspective</param>
+	/// <returns>The index of the view, for use with IsVisible</returns>
+	int AddView(const glm::mat4& viewProjection);
+	/// <summary>
+	/// Adds a mesh that will be rasterized into the depth buffer of every view. Occluders should
+	/// be large, low-poly meshes such as walls or terrain
+	/// </summary>
+	/// <param name="mesh">The CPU side data for the mesh</param>
+	/// <param name="transform">The mesh's local to world transform</param>
+	void AddOccluder(const Gameplay::MeshResource::CpuMeshData::Sptr& mesh, const glm::mat4& transform);
+	/// <summary>
+	/// Adds an object that will be tested against the depth buffers
+	/// </summary>
+	/// <param name="boundsMin">The minimum corner of the object's local space AABB</param>
+	/// <param name="boundsMax">The maximum corner of the object's local space AABB</param>
+	/// <param name="transform">The object's local to world transform</param>
+	/// <returns>The index of the occludee, for use with IsVisible</returns>
+	int AddOccludee(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform);
+
+	/// <summary>
+	/// Rasterizes all occluders, builds the HiZ pyramids, and tests all occludees for every view
+	/// </summary>
+	void Execute();
+
+	/// <summary>
+	/// Returns true if the given occludee may be visible in the given view, only valid after
+	/// Execute has finished. Indices that are out of range are always considered visible
+	/// </summary>
+	bool IsVisible(int view, int occludee) const;
+
+	/// <summary>
+	/// Gets the number of occludees that were culled in the given view during the last execution
+	/// </summary>
+	int GetCulledCount(int view) const;
+	/// <summary>
+	/// Gets how long the last call to Execute took, in milliseconds
+	/// </summary>
+	float GetExecutionTimeMs() const;
+
+protected:
+	struct View {
+		glm::mat4 ViewProjection;
+		// Level 0 is the full resolution depth buffer, each level after stores
+		// the furthest depth of the 2x2 texels below it
+		std::vector<std::vector<float>> HiZ;
+		std::vector<glm::ivec2>         LevelSizes;
+		std::vector<uint8_t>            Visibility;
+		int                             CulledCount;
+	};
+
+	struct Occluder {
+		Gameplay::MeshResource::CpuMeshData::Sptr Mesh;
+		glm::mat4 Transform;
+	};
+
+	struct Occludee {
+		glm::vec3 BoundsMin;
+		glm::vec3 BoundsMax;
+		glm::mat4 Transform;
+	};
+
+	// We keep views around between frames so that we don't re-allocate the depth buffers
+	std::vector<View>      _views;
+	int                    _viewCount;
+	std::vector<Occluder>  _occluders;
+	std::vector<Occludee>  _occludees;
+	float                  _executionTimeMs;
+
+	// Scratch space for transformed occluder vertices
+	std::vector<glm::vec4> _clipPositions;
+
+	void _RasterizeOccluders(View& view);
+	void _RasterizeTriangle(float* depth, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+	void _BuildHiZ(View& view);
+	bool _TestBounds(const View& view, const Occludee& occludee) const;
+};
@@ -0,0 +1,603 @@
+#include "Graphics/RenderGraph.h"
+
+#include <algorithm>
+#include "Logging.h"
+
+/// <summary>
+/// Gets a rough estimate of how many bytes a single pixel in the given format takes up in VRAM
+/// </summary>
+static size_t GetBytesPerPixel(RenderTargetType format) {
+	switch (format) {
+		case RenderTargetType::ColorRed8:    return 1;
+		case RenderTargetType::ColorRG8:     return 2;
+		case RenderTargetType::Depth16:      return 2;
+		case RenderTargetType::Stencil4:
+		case RenderTargetType::Stencil8:     return 1;
+		case RenderTargetType::Stencil16:    return 2;
+		// Most drivers pad 3 component formats out to 4
+		case RenderTargetType::ColorRgb8:
+		case RenderTargetType::ColorRgba8:
+		case RenderTargetType::ColorRgb10:
+		case RenderTargetType::Depth24:
+		case RenderTargetType::Depth32:
+		case RenderTargetType::DepthStencil: return 4;
+		case RenderTargetType::ColorRgb16F:
+		case RenderTargetType::ColorRgba16F: return 8;
+		default: return 4;
+	}
+}
+
+Texture2D::Sptr RenderGraph::PassContext::GetTexture(ResourceHandle handle) const {
+	return _graph->_GetTexture(handle);
+}
+
+const Framebuffer::Sptr& RenderGraph::PassContext::GetFramebuffer() const {
+	return _graph->_passes[_pass].Target;
+}
+
+const glm::ivec2& RenderGraph::PassContext::GetViewportSize() const {
+	return _graph->_passes[_pass].ViewportSize;
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::Create(const std::string& name, const TextureDesc& desc) {
+	return _graph->_AddResource(name, desc, nullptr, false);
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::Read(ResourceHandle handle) {
+	LOG_ASSERT(handle >= 0 && handle < (int)_graph->_resources.size(), "Invalid resource handle passed to Read");
+	_graph->_passes[_pass].Reads.push_back(handle);
+	return handle;
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::Write(ResourceHandle handle, RenderTargetAttachment attachment, LoadOp load, const glm::vec4& clearValue) {
+	LOG_ASSERT(handle >= 0 && handle < (int)_graph->_resources.size(), "Invalid resource handle passed to Write");
+	PassNode& pass = _graph->_passes[_pass];
+
+	Attachment write;
+	write.Resource   = handle;
+	write.Slot       = attachment;
+	write.Load       = load;
+	write.ClearValue = clearValue;
+	pass.Writes.push_back(write);
+
+	// Building on top of the existing contents means we depend on whoever wrote them
+	if (load == LoadOp::Load) {
+		pass.Loads.push_back(handle);
+	}
+	return handle;
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::WriteStorage(ResourceHandle handle) {
+	LOG_ASSERT(handle >= 0 && handle < (int)_graph->_resources.size(), "Invalid resource handle passed to WriteStorage");
+	_graph->_passes[_pass].StorageWrites.push_back(handle);
+	return handle;
+}
+
+void RenderGraph::PassBuilder::SideEffect() {
+	_graph->_passes[_pass].HasSideEffects = true;
+}
+
+RenderGraph::RenderGraph() :
+	_targetSize(glm::ivec2(1)),
+	_renderScale(1.0f),
+	_resources(),
+	_passes(),
+	_physical(),
+	_backbuffer(INVALID_HANDLE),
+	_namedResources(),
+	_texturePool(),
+	_framebufferCache()
+{
+	Reset();
+}
+
+RenderGraph::~RenderGraph() = default;
+
+void RenderGraph::Reset() {
+	_resources.clear();
+	_passes.clear();
+	_physical.clear();
+	_namedResources.clear();
+
+	// The backbuffer always exists, so that passes can draw to the window
+	_backbuffer = _AddResource("Backbuffer", TextureDesc(), nullptr, true);
+}
+
+void RenderGraph::SetTargetSize(const glm::ivec2& size) {
+	_targetSize = glm::max(size, glm::ivec2(1));
+}
+
+const glm::ivec2& RenderGraph::GetTargetSize() const {
+	return _targetSize;
+}
+
+void RenderGraph::SetRenderScale(float scale) {
+	_renderScale = glm::clamp(scale, 0.0f, 1.0f);
+}
+
+RenderGraph::ResourceHandle RenderGraph::Import(const std::string& name, const Texture2D::Sptr& texture) {
+	LOG_ASSERT(texture != nullptr, "Cannot import a null texture into a render graph");
+	return _AddResource(name, TextureDesc((RenderTargetType)texture->GetFormat()), texture, false);
+}
+
+RenderGraph::ResourceHandle RenderGraph::GetBackbuffer() const {
+	return _backbuffer;
+}
+
+void RenderGraph::Export(ResourceHandle handle) {
+	LOG_ASSERT(handle >= 0 && handle < (int)_resources.size(), "Invalid resource handle passed to Export");
+	_resources[handle].IsExported = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string& name, const ExecuteCallback& execute) {
+	PassNode pass;
+	pass.Name           = name;
+	pass.Execute        = execute;
+	pass.HasSideEffects = false;
+	pass.RefCount       = 0;
+	pass.IsCulled       = false;
+	pass.Barriers       = 0;
+	pass.Target         = nullptr;
+	pass.ViewportSize   = glm::ivec2(0);
+	_passes.push_back(pass);
+	return PassBuilder(this, static_cast<int>(_passes.size()) - 1);
+}
+
+void RenderGraph::SetNamedResource(const std::string& name, ResourceHandle handle) {
+	_namedResources[name] = handle;
+}
+
+RenderGraph::ResourceHandle RenderGraph::GetNamedResource(const std::string& name) const {
+	auto it = _namedResources.find(name);
+	return it != _namedResources.end() ? it->second : INVALID_HANDLE;
+}
+
+bool RenderGraph::Compile() {
+	bool isValid = true;
+	const int passCount = static_cast<int>(_passes.size());
+
+	// Returns true if the pass renders into or stores to the given resource
+	auto writesTo = [](const PassNode& pass, ResourceHandle handle) {
+		for (const Attachment& write : pass.Writes) {
+			if (write.Resource == handle) return true;
+		}
+		return std::find(pass.StorageWrites.begin(), pass.StorageWrites.end(), handle) != pass.StorageWrites.end();
+	};
+
+	for (ResourceNode& resource : _resources) {
+		resource.RefCount = 0;
+		resource.FirstUse = -1;
+		resource.LastUse  = -1;
+		resource.Physical = -1;
+	}
+
+	// Count how many resources each pass produces, and how many passes consume each resource. A pass that
+	// reads back what it writes (ex: particles blending into the scene) doesn't keep itself alive
+	std::vector<bool> isRoot(passCount, false);
+	for (int ix = 0; ix < passCount; ix++) {
+		PassNode& pass = _passes[ix];
+		pass.RefCount = static_cast<int>(pass.Writes.size() + pass.StorageWrites.size());
+		pass.IsCulled = false;
+		pass.Barriers = 0;
+
+		for (const std::vector<ResourceHandle>* list : { &pass.Reads, &pass.Loads }) {
+			for (ResourceHandle handle : *list) {
+				if (!writesTo(pass, handle)) {
+					_resources[handle].RefCount++;
+				}
+			}
+		}
+
+		isRoot[ix] = pass.HasSideEffects;
+		for (const Attachment& write : pass.Writes) {
+			isRoot[ix] = isRoot[ix] || _resources[write.Resource].IsBackbuffer || _resources[write.Resource].IsExported;
+		}
+		for (ResourceHandle handle : pass.StorageWrites) {
+			isRoot[ix] = isRoot[ix] || _resources[handle].IsExported;
+		}
+	}
+
+	// Walk backwards from every resource that nobody reads, culling the passes that only exist to produce them
+	std::vector<ResourceHandle> unused;
+	for (int ix = 0; ix < (int)_resources.size(); ix++) {
+		const ResourceNode& resource = _resources[ix];
+		if (resource.RefCount == 0 && !resource.IsExported && !resource.IsBackbuffer) {
+			unused.push_back(ix);
+		}
+	}
+	while (!unused.empty()) {
+		ResourceHandle handle = unused.back();
+		unused.pop_back();
+
+		for (int ix = 0; ix < passCount; ix++) {
+			PassNode& pass = _passes[ix];
+			if (pass.IsCulled || isRoot[ix] || !writesTo(pass, handle)) {
+				continue;
+			}
+			if (--pass.RefCount > 0) {
+				continue;
+			}
+
+			// Nothing this pass makes is used, so the things it reads may no longer be needed either
+			pass.IsCulled = true;
+			for (const std::vector<ResourceHandle>* list : { &pass.Reads, &pass.Loads }) {
+				for (ResourceHandle read : *list) {
+					ResourceNode& resource = _resources[read];
+					if (writesTo(pass, read)) {
+						continue;
+					}
+					if (--resource.RefCount == 0 && !resource.IsExported && !resource.IsBackbuffer) {
+						unused.push_back(read);
+					}
+				}
+			}
+		}
+	}
+
+	// Loading an attachment builds on whatever the last pass to write it left behind. Those loads aren't counted
+	// above (or the loading pass would keep itself alive), so once we know what survives we bring back the writer
+	// of every version a surviving pass loads, along with anything that writer needs in turn
+	std::vector<int> needed;
+	for (int ix = 0; ix < passCount; ix++) {
+		if (!_passes[ix].IsCulled) {
+			needed.push_back(ix);
+		}
+	}
+	auto revive = [&](int ix) {
+		if (_passes[ix].IsCulled) {
+			_passes[ix].IsCulled = false;
+			needed.push_back(ix);
+		}
+	};
+	while (!needed.empty()) {
+		int passIx = needed.back();
+		needed.pop_back();
+		const PassNode& pass = _passes[passIx];
+
+		// Only the closest earlier writer matters, if it loads as well it will bring back the one before it
+		for (ResourceHandle handle : pass.Loads) {
+			for (int writer = passIx - 1; writer >= 0; writer--) {
+				if (writesTo(_passes[writer], handle)) {
+					revive(writer);
+					break;
+				}
+			}
+		}
+		// Passes we brought back need their inputs too, like the reference counts, a read keeps every writer alive
+		for (ResourceHandle handle : pass.Reads) {
+			for (int writer = 0; writer < passCount; writer++) {
+				if (writer != passIx && writesTo(_passes[writer], handle)) {
+					revive(writer);
+				}
+			}
+		}
+	}
+
+	// Work out the range of passes each resource is alive for, and check for misuse along the way
+	auto touch = [&](ResourceHandle handle, int pass) {
+		ResourceNode& resource = _resources[handle];
+		resource.FirstUse = resource.FirstUse < 0 ? pass : resource.FirstUse;
+		resource.LastUse = pass;
+	};
+	for (int ix = 0; ix < passCount; ix++) {
+		const PassNode& pass = _passes[ix];
+		if (pass.IsCulled) {
+			continue;
+		}
+
+		for (ResourceHandle handle : pass.Reads) {
+			const ResourceNode& resource = _resources[handle];
+			if (resource.FirstUse < 0 && resource.Imported == nullptr && !resource.IsBackbuffer) {
+				LOG_WARN("Render pass \"{}\" reads \"{}\" before anything has written to it", pass.Name, resource.Name);
+			}
+			for (const Attachment& write : pass.Writes) {
+				if (write.Resource == handle) {
+					LOG_ERROR("Render pass \"{}\" samples \"{}\" while rendering into it", pass.Name, resource.Name);
+					isValid = false;
+				}
+			}
+			touch(handle, ix);
+		}
+		for (const Attachment& write : pass.Writes) {
+			const ResourceNode& resource = _resources[write.Resource];
+			if (write.Load == LoadOp::Load && resource.FirstUse < 0 && resource.Imported == nullptr && !resource.IsBackbuffer) {
+				LOG_WARN("Render pass \"{}\" loads \"{}\" before anything has written to it", pass.Name, resource.Name);
+			}
+			touch(write.Resource, ix);
+		}
+		for (ResourceHandle handle : pass.StorageWrites) {
+			touch(handle, ix);
+		}
+	}
+	for (ResourceNode& resource : _resources) {
+		if (resource.IsExported && resource.FirstUse >= 0) {
+			resource.LastUse = passCount;
+		}
+	}
+
+	// Assign transient resources to physical textures, in the order they come alive. Any texture with the
+	// same description whose last user has already run can be handed to the next resource
+	std::vector<ResourceHandle> transients;
+	for (int ix = 0; ix < (int)_resources.size(); ix++) {
+		const ResourceNode& resource = _resources[ix];
+		if (resource.Imported == nullptr && !resource.IsBackbuffer && resource.FirstUse >= 0) {
+			transients.push_back(ix);
+		}
+	}
+	std::stable_sort(transients.begin(), transients.end(), [&](ResourceHandle a, ResourceHandle b) {
+		return _resources[a].FirstUse < _resources[b].FirstUse;
+	});
+
+	_physical.clear();
+	for (ResourceHandle handle : transients) {
+		ResourceNode& resource = _resources[handle];
+		int poolIndex = 0;
+		for (int ix = 0; ix < (int)_physical.size(); ix++) {
+			PhysicalTexture& physical = _physical[ix];
+			if (physical.Desc != resource.Desc) {
+				continue;
+			}
+			if (physical.LastUse < resource.FirstUse) {
+				resource.Physical = ix;
+				physical.LastUse = resource.LastUse;
+				break;
+			}
+			poolIndex++;
+		}
+		if (resource.Physical < 0) {
+			PhysicalTexture physical;
+			physical.Desc      = resource.Desc;
+			physical.PoolIndex = poolIndex;
+			physical.LastUse   = resource.LastUse;
+			resource.Physical = static_cast<int>(_physical.size());
+			_physical.push_back(physical);
+		}
+	}
+
+	// Image stores aren't coherent with later reads, so any pass touching a resource that was stored to
+	// since the last barrier needs one first. A single barrier covers every store before it
+	std::vector<bool> pendingStores(_resources.size(), false);
+	bool anyPending = false;
+	for (int ix = 0; ix < passCount; ix++) {
+		PassNode& pass = _passes[ix];
+		if (pass.IsCulled) {
+			continue;
+		}
+
+		if (anyPending) {
+			bool needsBarrier = false;
+			for (ResourceHandle handle : pass.Reads)         needsBarrier = needsBarrier || pendingStores[handle];
+			for (ResourceHandle handle : pass.StorageWrites) needsBarrier = needsBarrier || pendingStores[handle];
+			for (const Attachment& write : pass.Writes)      needsBarrier = needsBarrier || pendingStores[write.Resource];
+
+			if (needsBarrier) {
+				pass.Barriers = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT;
+				std::fill(pendingStores.begin(), pendingStores.end(), false);
+				anyPending = false;
+			}
+		}
+
+		for (ResourceHandle handle : pass.StorageWrites) {
+			pendingStores[handle] = true;
+			anyPending = true;
+		}
+	}
+
+	return isValid;
+}
+
+void RenderGraph::Execute() {
+	// Make sure every physical texture exists, and is the right size for this frame
+	for (const PhysicalTexture& physical : _physical) {
+		_AllocateTexture(physical.Desc, physical.PoolIndex);
+	}
+
+	for (int ix = 0; ix < (int)_passes.size(); ix++) {
+		PassNode& pass = _passes[ix];
+		if (pass.IsCulled) {
+			continue;
+		}
+
+		if (pass.Barriers != 0) {
+			glMemoryBarrier(pass.Barriers);
+		}
+
+		// Split the backbuffer off from the attachments we need to build a framebuffer for
+		bool toBackbuffer = false;
+		const Attachment* firstAttachment = nullptr;
+		for (const Attachment& write : pass.Writes) {
+			if (_resources[write.Resource].IsBackbuffer) {
+				toBackbuffer = true;
+			} else if (firstAttachment == nullptr) {
+				firstAttachment = &write;
+			}
+		}
+
+		pass.Target = nullptr;
+		if (firstAttachment != nullptr) {
+			LOG_ASSERT(!toBackbuffer, "Render pass \"{}\" cannot render to the backbuffer and a texture at the same time", pass.Name);
+
+			pass.Target = _GetFramebuffer(pass);
+			pass.Target->Bind();
+
+			// Transient targets only use the region for the current render scale, imported ones are used entirely
+			const ResourceNode& resource = _resources[firstAttachment->Resource];
+			glm::ivec2 size = pass.Target->GetSize();
+			if (resource.Imported == nullptr) {
+				size = glm::max(glm::ivec2(glm::round(glm::vec2(size) * _renderScale)), glm::ivec2(1));
+			}
+			pass.ViewportSize = size;
+			glViewport(0, 0, size.x, size.y);
+
+			// Clear only the region we're rendering to, making sure our masks don't get in the way
+			bool hasClears = false;
+			int colorIndex = 0;
+			for (const Attachment& write : pass.Writes) {
+				if (write.Load == LoadOp::Clear) {
+					if (!hasClears) {
+						glEnable(GL_SCISSOR_TEST);
+						glScissor(0, 0, size.x, size.y);
+						glDepthMask(GL_TRUE);
+						glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+						hasClears = true;
+					}
+
+					if (IsColorAttachment(write.Slot)) {
+						glClearNamedFramebufferfv(pass.Target->GetHandle(), GL_COLOR, colorIndex, &write.ClearValue.x);
+					} else if (write.Slot == RenderTargetAttachment::DepthStencil) {
+						glClearNamedFramebufferfi(pass.Target->GetHandle(), GL_DEPTH_STENCIL, 0, write.ClearValue.x, static_cast<GLint>(write.ClearValue.y));
+					} else if (write.Slot == RenderTargetAttachment::Depth) {
+						glClearNamedFramebufferfv(pass.Target->GetHandle(), GL_DEPTH, 0, &write.ClearValue.x);
+					}
+				}
+				if (IsColorAttachment(write.Slot)) {
+					colorIndex++;
+				}
+			}
+			if (hasClears) {
+				glDisable(GL_SCISSOR_TEST);
+			}
+		} else if (toBackbuffer) {
+			// The window is owned by the application, so we leave the viewport up to the pass
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			pass.ViewportSize = _targetSize;
+			for (const Attachment& write : pass.Writes) {
+				if (write.Load == LoadOp::Clear) {
+					glClearNamedFramebufferfv(0, GL_COLOR, 0, &write.ClearValue.x);
+				}
+			}
+		}
+
+		pass.Execute(PassContext(this, ix));
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+int RenderGraph::GetPassCount() const {
+	return static_cast<int>(_passes.size());
+}
+
+const std::string& RenderGraph::GetPassName(int pass) const {
+	return _passes[pass].Name;
+}
+
+bool RenderGraph::IsPassCulled(int pass) const {
+	return _passes[pass].IsCulled;
+}
+
+uint32_t RenderGraph::GetPassBarriers(int pass) const {
+	return _passes[pass].Barriers;
+}
+
+int RenderGraph::GetResourceCount() const {
+	return static_cast<int>(_resources.size());
+}
+
+int RenderGraph::GetPhysicalIndex(ResourceHandle handle) const {
+	return _resources[handle].Physical;
+}
+
+int RenderGraph::GetPhysicalCount() const {
+	return static_cast<int>(_physical.size());
+}
+
+size_t RenderGraph::GetAllocatedBytes() const {
+	size_t result = 0;
+	for (const auto& kvp : _texturePool) {
+		for (const Texture2D::Sptr& texture : kvp.second) {
+			if (texture != nullptr) {
+				result += (size_t)texture->GetWidth() * texture->GetHeight() * GetBytesPerPixel((RenderTargetType)texture->GetFormat());
+			}
+		}
+	}
+	return result;
+}
+
+RenderGraph::ResourceHandle RenderGraph::_AddResource(const std::string& name, const TextureDesc& desc, const Texture2D::Sptr& imported, bool isBackbuffer) {
+	ResourceNode resource;
+	resource.Name         = name;
+	resource.Desc         = desc;
+	resource.Imported     = imported;
+	resource.IsBackbuffer = isBackbuffer;
+	resource.IsExported   = false;
+	resource.RefCount     = 0;
+	resource.FirstUse     = -1;
+	resource.LastUse      = -1;
+	resource.Physical     = -1;
+	_resources.push_back(resource);
+	return static_cast<ResourceHandle>(_resources.size()) - 1;
+}
+
+Texture2D::Sptr RenderGraph::_GetTexture(ResourceHandle handle) const {
+	LOG_ASSERT(handle >= 0 && handle < (int)_resources.size(), "Invalid resource handle");
+	const ResourceNode& resource = _resources[handle];
+	if (resource.Imported != nullptr) {
+		return resource.Imported;
+	}
+	if (resource.Physical < 0) {
+		return nullptr;
+	}
+
+	const PhysicalTexture& physical = _physical[resource.Physical];
+	auto it = _texturePool.find(_GetDescKey(physical.Desc));
+	return it != _texturePool.end() && physical.PoolIndex < (int)it->second.size() ? it->second[physical.PoolIndex] : nullptr;
+}
+
+glm::ivec2 RenderGraph::_GetTextureSize(const TextureDesc& desc) const {
+	return glm::max(glm::ivec2(glm::round(glm::vec2(_targetSize) * desc.Scale)), glm::ivec2(1));
+}
+
+const Texture2D::Sptr& RenderGraph::_AllocateTexture(const TextureDesc& desc, int poolIndex) {
+	std::vector<Texture2D::Sptr>& pool = _texturePool[_GetDescKey(desc)];
+	if ((int)pool.size() <= poolIndex) {
+		pool.resize(poolIndex + 1);
+	}
+
+	Texture2D::Sptr& texture = pool[poolIndex];
+	glm::ivec2 size = _GetTextureSize(desc);
+	if (texture == nullptr || texture->GetWidth() != (uint32_t)size.x || texture->GetHeight() != (uint32_t)size.y) {
+		// Same setup that Framebuffer uses for it's own attachments
+		Texture2DDescription descriptor = Texture2DDescription();
+		descriptor.Width              = size.x;
+		descriptor.Height             = size.y;
+		descriptor.Format             = (InternalFormat)desc.Format;
+		descriptor.GenerateMipMaps    = false;
+		descriptor.MinificationFilter = MinFilter::Linear;
+		descriptor.HorizontalWrap     = WrapMode::ClampToEdge;
+		descriptor.VerticalWrap       = WrapMode::ClampToEdge;
+		texture = std::make_shared<Texture2D>(descriptor);
+		texture->SetDebugName("RenderGraph_" + _GetDescKey(desc) + "_" + std::to_string(poolIndex));
+
+		// Any framebuffers made from the old texture are no longer valid
+		_framebufferCache.clear();
+	}
+	return texture;
+}
+
+const Framebuffer::Sptr& RenderGraph::_GetFramebuffer(const PassNode& pass) {
+	// Passes that render into the same textures in the same slots can share a framebuffer
+	std::string key;
+	for (const Attachment& write : pass.Writes) {
+		key += std::to_string(*write.Slot) + ":" + std::to_string(_GetTexture(write.Resource)->GetHandle()) + ";";
+	}
+
+	Framebuffer::Sptr& result = _framebufferCache[key];
+	if (result == nullptr) {
+		Texture2D::Sptr first = _GetTexture(pass.Writes[0].Resource);
+
+		FramebufferDescriptor descriptor;
+		descriptor.Width  = first->GetWidth();
+		descriptor.Height = first->GetHeight();
+		result = std::make_shared<Framebuffer>(descriptor);
+		for (const Attachment& write : pass.Writes) {
+			result->AttachTexture(write.Slot, _GetTexture(write.Resource));
+		}
+		result->Validate();
+	}
+	return result;
+}
+
+std::string RenderGraph::_GetDescKey(const TextureDesc& desc) {
+	return ~desc.Format + "@" + std::to_string(desc.Scale.x) + "x" + std::to_string(desc.Scale.y);
+}
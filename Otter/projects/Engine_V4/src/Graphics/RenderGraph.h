@@ -0,0 +1,294 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/GlEnums.h"
+#include "Graphics/Framebuffer.h"
+#include "Graphics/Textures/Texture2D.h"
+
+/// <summary>
+/// A render graph describes a frame as a list of passes, where each pass declares which textures it
+/// reads and writes. From that, the graph can:
+///   - cull passes whose results are never used
+///   - work out how long each transient texture is alive for, and let textures with the same format and
+///     size share the same memory when their lifetimes don't overlap
+///   - turn load operations into clears, and insert memory barriers after image stores
+///
+/// The graph is rebuilt every frame. Passes execute in the order they were added, which must be a valid
+/// order for their reads and writes (the same as hand ordering them, but the graph does the bookkeeping).
+///
+/// Compile does not touch OpenGL, all textures and framebuffers are created lazily in Execute. This means
+/// that graphs can be built and compiled in tests without a GPU or context
+/// </summary>
+class RenderGraph
+{
+public:
+	MAKE_PTRS(RenderGraph);
+	NO_COPY(RenderGraph);
+	NO_MOVE(RenderGraph);
+
+	typedef int ResourceHandle;
+	static const ResourceHandle INVALID_HANDLE = -1;
+
+	/// <summary>
+	/// Describes a transient texture that the graph will allocate
+	/// </summary>
+	struct TextureDesc {
+		RenderTargetType Format;
+		// The size of the texture relative to the graph's target size
+		glm::vec2        Scale;
+
+		TextureDesc(RenderTargetType format = RenderTargetType::ColorRgba8, const glm::vec2& scale = glm::vec2(1.0f)) :
+			Format(format), Scale(scale) { }
+
+		bool operator ==(const TextureDesc& other) const { return Format == other.Format && Scale == other.Scale; }
+		bool operator !=(const TextureDesc& other) const { return !(*this == other); }
+	};
+
+	/// <summary>
+	/// What a pass expects to find in an attachment when it starts rendering
+	/// </summary>
+	enum class LoadOp {
+		// Keep whatever was previously rendered into the texture
+		Load,
+		// Clear the rendered region of the texture to the clear value
+		Clear,
+		// The pass will overwrite every pixel, so the previous contents don't matter
+		DontCare
+	};
+
+	/// <summary>
+	/// Used by passes during setup to declare the resources they use
+	/// </summary>
+	class PassBuilder {
+	public:
+		/// <summary>
+		/// Declares a new transient texture, which will be allocated (or aliased) by the graph
+		/// </summary>
+		/// <param name="name">The name of the resource, used for debugging</param>
+		/// <param name="desc">The format and size of the texture</param>
+		ResourceHandle Create(const std::string& name, const TextureDesc& desc);
+		/// <summary>
+		/// Declares that this pass samples the given resource in a shader
+		/// </summary>
+		ResourceHandle Read(ResourceHandle handle);
+		/// <summary>
+		/// Declares that this pass renders into the given resource
+		/// </summary>
+		/// <param name="handle">The resource to render into</param>
+		/// <param name="attachment">The framebuffer attachment to bind the resource to</param>
+		/// <param name="load">What the pass expects to be in the texture when it starts</param>
+		/// <param name="clearValue">The value to clear to when load is Clear, depth attachments use the x component</param>
+		ResourceHandle Write(ResourceHandle handle, RenderTargetAttachment attachment, LoadOp load = LoadOp::Load, const glm::vec4& clearValue = glm::vec4(0.0f));
+		/// <summary>
+		/// Declares that this pass writes to the given resource using image stores, rather than as a render target
+		/// </summary>
+		ResourceHandle WriteStorage(ResourceHandle handle);
+		/// <summary>
+		/// Marks this pass as having effects outside of the graph, so that it is never culled
+		/// </summary>
+		void SideEffect();
+
+	protected:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph* graph, int pass) : _graph(graph), _pass(pass) { }
+
+		RenderGraph* _graph;
+		int          _pass;
+	};
+
+	/// <summary>
+	/// Given to passes when they execute, lets them look up the real textures behind their resources
+	/// </summary>
+	class PassContext {
+	public:
+		/// <summary>
+		/// Gets the texture that backs the given resource this frame
+		/// </summary>
+		Texture2D::Sptr GetTexture(ResourceHandle handle) const;
+		/// <summary>
+		/// Gets the framebuffer that the graph built from this pass's attachments, or nullptr if the pass
+		/// renders to the backbuffer or has no attachments. The framebuffer will already be bound
+		/// </summary>
+		const Framebuffer::Sptr& GetFramebuffer() const;
+		/// <summary>
+		/// Gets the size of the viewport the graph set up for this pass
+		/// </summary>
+		const glm::ivec2& GetViewportSize() const;
+
+	protected:
+		friend class RenderGraph;
+		PassContext(const RenderGraph* graph, int pass) : _graph(graph), _pass(pass) { }
+
+		const RenderGraph* _graph;
+		int                _pass;
+	};
+
+	typedef std::function<void(const PassContext&)> ExecuteCallback;
+
+	RenderGraph();
+	~RenderGraph();
+
+	/// <summary>
+	/// Removes all passes and resources, ready for the next frame to be declared. Allocated
+	/// textures are kept so that they can be re-used
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Sets the size that texture scales are relative to, usually the window size
+	/// </summary>
+	void SetTargetSize(const glm::ivec2& size);
+	const glm::ivec2& GetTargetSize() const;
+
+	/// <summary>
+	/// Sets the fraction of transient textures that passes render into, see RenderLayer::GetRenderScale.
+	/// Viewports and clears for transient attachments are limited to this region
+	/// </summary>
+	void SetRenderScale(float scale);
+
+	/// <summary>
+	/// Adds a texture that is owned outside of the graph (ex: a shadow map) so that passes can use it.
+	/// Imported textures are never aliased
+	/// </summary>
+	/// <param name="name">The name of the resource, used for debugging</param>
+	/// <param name="texture">The texture to import</param>
+	ResourceHandle Import(const std::string& name, const Texture2D::Sptr& texture);
+	/// <summary>
+	/// Gets the handle representing the window's default framebuffer. Passes that write to it are never culled
+	/// </summary>
+	ResourceHandle GetBackbuffer() const;
+	/// <summary>
+	/// Marks a resource as being used after the graph executes, so it's writers won't be culled
+	/// and it's memory won't be aliased for the rest of the frame
+	/// </summary>
+	void Export(ResourceHandle handle);
+
+	/// <summary>
+	/// Adds a new pass to the end of the graph
+	/// </summary>
+	/// <param name="name">The name of the pass, used for debugging</param>
+	/// <param name="execute">The callback that records the pass's rendering commands</param>
+	/// <returns>A builder for declaring the pass's resources</returns>
+	PassBuilder AddPass(const std::string& name, const ExecuteCallback& execute);
+
+	/// <summary>
+	/// Stores a resource handle under a name, so that passes added by other layers can find it
+	/// </summary>
+	void SetNamedResource(const std::string& name, ResourceHandle handle);
+	/// <summary>
+	/// Gets a resource stored with SetNamedResource, or INVALID_HANDLE if none has been stored
+	/// </summary>
+	ResourceHandle GetNamedResource(const std::string& name) const;
+
+	/// <summary>
+	/// Culls unused passes, and works out the lifetimes, aliasing and barriers for the graph. Does not
+	/// make any OpenGL calls
+	/// </summary>
+	/// <returns>True if the graph is valid</returns>
+	bool Compile();
+	/// <summary>
+	/// Allocates any textures that the compiled graph needs, then runs all the passes that weren't culled
+	/// </summary>
+	void Execute();
+
+	int GetPassCount() const;
+	const std::string& GetPassName(int pass) const;
+	/// <summary>
+	/// Returns true if the pass was culled during the last compile
+	/// </summary>
+	bool IsPassCulled(int pass) const;
+	/// <summary>
+	/// Gets the memory barrier bits that will be issued before the given pass runs
+	/// </summary>
+	uint32_t GetPassBarriers(int pass) const;
+
+	int GetResourceCount() const;
+	/// <summary>
+	/// Gets the index of the physical texture a transient resource was assigned to, or -1 for imported
+	/// or unused resources. Resources with the same index share memory
+	/// </summary>
+	int GetPhysicalIndex(ResourceHandle handle) const;
+	/// <summary>
+	/// Gets the number of physical textures the last compile needs
+	/// </summary>
+	int GetPhysicalCount() const;
+	/// <summary>
+	/// Gets the number of bytes used by the textures the graph has allocated
+	/// </summary>
+	size_t GetAllocatedBytes() const;
+
+protected:
+	struct Attachment {
+		ResourceHandle         Resource;
+		RenderTargetAttachment Slot;
+		LoadOp                 Load;
+		glm::vec4              ClearValue;
+	};
+
+	struct ResourceNode {
+		std::string      Name;
+		TextureDesc      Desc;
+		// Set for imported textures, which the graph does not allocate
+		Texture2D::Sptr  Imported;
+		bool             IsBackbuffer;
+		bool             IsExported;
+		// Filled in by compile
+		int              RefCount;
+		int              FirstUse;
+		int              LastUse;
+		int              Physical;
+	};
+
+	struct PassNode {
+		std::string                 Name;
+		ExecuteCallback             Execute;
+		// Resources sampled by the pass
+		std::vector<ResourceHandle> Reads;
+		// Resources whose existing contents the pass builds on (loaded attachments)
+		std::vector<ResourceHandle> Loads;
+		std::vector<Attachment>     Writes;
+		std::vector<ResourceHandle> StorageWrites;
+		bool                        HasSideEffects;
+		// Filled in by compile
+		int                         RefCount;
+		bool                        IsCulled;
+		uint32_t                    Barriers;
+		// Filled in by execute
+		Framebuffer::Sptr           Target;
+		glm::ivec2                  ViewportSize;
+	};
+
+	struct PhysicalTexture {
+		TextureDesc     Desc;
+		// The index of this texture among the allocated textures with the same description
+		int             PoolIndex;
+		int             LastUse;
+	};
+
+	glm::ivec2 _targetSize;
+	float      _renderScale;
+
+	std::vector<ResourceNode>    _resources;
+	std::vector<PassNode>        _passes;
+	std::vector<PhysicalTexture> _physical;
+	ResourceHandle               _backbuffer;
+	std::unordered_map<std::string, ResourceHandle> _namedResources;
+
+	// Textures we've allocated, keyed by their description, these persist between frames
+	std::unordered_map<std::string, std::vector<Texture2D::Sptr>> _texturePool;
+	// Framebuffers built from sets of textures, these persist between frames
+	std::unordered_map<std::string, Framebuffer::Sptr>              _framebufferCache;
+
+	ResourceHandle _AddResource(const std::string& name, const TextureDesc& desc, const Texture2D::Sptr& imported, bool isBackbuffer);
+	Texture2D::Sptr _GetTexture(ResourceHandle handle) const;
+	glm::ivec2 _GetTextureSize(const TextureDesc& desc) const;
+	const Texture2D::Sptr& _AllocateTexture(const TextureDesc& desc, int poolIndex);
+	const Framebuffer::Sptr& _GetFramebuffer(const PassNode& pass);
+
+	static std::string _GetDescKey(const TextureDesc& desc);
+};
@@ -6,17 +6,23 @@
 
 #include "Utils/FileHelpers.h"
 #include "Utils/JsonGlmHelpers.h"
+#include "Utils/HashUtils.h"
+
+bool        ShaderProgram::_binaryCacheEnabled = true;
+std::string ShaderProgram::_binaryCachePath = "cache/shaders/";
 
 ShaderProgram::ShaderProgram() : 
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_interleavedVaryings(true)
 {
 	_rendererId = glCreateProgram();
 }
 
 ShaderProgram::ShaderProgram(const std::unordered_map<ShaderPartType, std::string>& filePaths) :
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_interleavedVaryings(true)
 {
 	_rendererId = glCreateProgram();
 	for (auto& [type, path] : filePaths) {
@@ -33,11 +39,34 @@ ShaderProgram::~ShaderProgram() {
 }
 
 bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
+	if (source == nullptr || source[0] == '\0') {
+		LOG_WARN("Ignoring empty shader source");
+		return false;
+	}
+
+	// If we're overwriting, warn before we store
+	if (_partSources.find(type) != _partSources.end()) {
+		LOG_WARN("Another shader has been attached to this slot, overwriting");
+	}
+
+	// Add our defines to the source, so that #ifdefs in the shader select the features we want. We
+	// hold on to the result until Link, since we may not need to compile it at all
+	_partSources[type] = _InjectDefines(source);
+
+	// Store info about where we got this data from
+	_fileSourceMap[type].IsFilePath = false;
+	_fileSourceMap[type].Source = source;
+
+	return true;
+}
+
+GLuint ShaderProgram::_CompilePart(ShaderPartType type, const std::string& source) {
 	// Creates a new shader part (VS, FS, GS, etc...)
 	GLuint handle = glCreateShader((GLenum)type);
 
 	// Load the GLSL source and compile it
-	glShaderSource(handle, 1, &source, nullptr);
+	const char* sourcePtr = source.c_str();
+	glShaderSource(handle, 1, &sourcePtr, nullptr);
 	glCompileShader(handle);
 
 	// Get the compilation status for the shader part
@@ -57,29 +86,23 @@ bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
 
 		// Dump error log
 		LOG_ERROR("Failed to compile shader part:\n{}", log);
+		if (_fileSourceMap[type].IsFilePath) {
+			LOG_ERROR("Source File: {}", _fileSourceMap[type].Source);
+		}
 
 		// Clean up our log memory
 		delete[] log;
 
 		// Delete the broken shader result
 		glDeleteShader(handle);
-		handle = 0;
-
-		return false;
+		return 0;
 	}
 
-	// If we're overwriting, warn and clean up the old program before we store
-	if (_handles[type] != 0) {
-		LOG_WARN("Another shader has been attached to this slot, overwriting");
-		glDeleteShader(_handles[type]);
+	if (_fileSourceMap[type].IsFilePath) {
+		glObjectLabel(GL_SHADER, handle, -1, _fileSourceMap[type].Source.c_str());
 	}
-	_handles[type] = handle;
-
-	// Store info about where we got this data from
-	_fileSourceMap[type].IsFilePath = false;
-	_fileSourceMap[type].Source = source;
 
-	return status != GL_FALSE;
+	return handle;
 }
 
 bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type) {
@@ -92,10 +115,6 @@ bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type
 		bool result =  LoadShaderPart(source.c_str(), type);
 		_fileSourceMap[type].IsFilePath = true;
 		_fileSourceMap[type].Source = path;
-		if (result == false) {
-			LOG_ERROR("Source File: {}", path);
-		}
-		glObjectLabel(GL_SHADER, _handles[type], -1, path);
 		return result; 
 	} else {
 		LOG_WARN("Could not open file at \"{}\"", path);
@@ -105,30 +124,49 @@ bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type
 
 bool ShaderProgram::Link() {
 
+	// If we've linked these exact sources before, we can skip compilation and linking entirely
+	std::string cacheFile = _binaryCacheEnabled ? _GetBinaryCacheFile() : "";
+	if (!cacheFile.empty() && _LoadProgramBinary(cacheFile)) {
+		LOG_TRACE("Loaded shader program from binary cache ({})", cacheFile);
+		_partSources.clear();
+		_Introspect();
+		return true;
+	}
+
 	LOG_TRACE("Starting shader link:");
 	GLenum err = glGetError();
 
+	// Compile all our parts
+	std::unordered_map<ShaderPartType, GLuint> handles;
+	for (auto& [type, source] : _partSources) {
+		handles[type] = _CompilePart(type, source);
+	}
+	_partSources.clear();
+
 	// Attach all our shaders
-	for (auto& [type, id] : _handles) {
+	for (auto& [type, id] : handles) {
 		if (id != 0) {
 			glAttachShader(_rendererId, id);
 			LOG_TRACE("\t{} - {}", ~type, _fileSourceMap[type].IsFilePath ? _fileSourceMap[type].Source : "<from source>");
 		}
 	}
 
+	// Let the driver know we'll want to read back the binary for our cache
+	if (!cacheFile.empty()) {
+		glProgramParameteri(_rendererId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	// Perform linking
 	glLinkProgram(_rendererId);
 	err = glGetError();
 
 	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
-	for (auto& [type, id] : _handles) { 
+	for (auto& [type, id] : handles) { 
 		if (id != 0) {
 			glDetachShader(_rendererId, id);
 			glDeleteShader(id);
 		}
 	}
-	// Remove all the handles so we don't accidentally use them
-	_handles.clear();
 	err = glGetError();
 
 	GLint status = 0;
@@ -152,6 +190,9 @@ bool ShaderProgram::Link() {
 		}
 	} else {
 		LOG_TRACE("Linking complete, starting introspection");
+		if (!cacheFile.empty()) {
+			_SaveProgramBinary(cacheFile);
+		}
 	}
 
 	// Perform our uniform introspection to see what uniforms are in the shader
@@ -218,19 +259,19 @@ void ShaderProgram::SetUniform(int location, const glm::uvec4* value, int count)
 
 void ShaderProgram::SetUniform(int location, const bool* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform1i(location, *value, 1);
+	glProgramUniform1i(_rendererId, location, *value);
 }
 void ShaderProgram::SetUniform(int location, const glm::bvec2* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform2i(location, value->x, value->y, 1);
+	glProgramUniform2i(_rendererId, location, value->x, value->y);
 }
 void ShaderProgram::SetUniform(int location, const glm::bvec3* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform3i(location, value->x, value->y, value->z, 1);
+	glProgramUniform3i(_rendererId, location, value->x, value->y, value->z);
 }
 void ShaderProgram::SetUniform(int location, const glm::bvec4* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform4i(location, value->x, value->y, value->z, value->w, 1);
+	glProgramUniform4i(_rendererId, location, value->x, value->y, value->z, value->w);
 }
 
 void ShaderProgram::SetUniform(int location, ShaderDataType type, void* data, int count /*= 1*/, bool transposed  /* =false*/) {
@@ -324,15 +365,23 @@ void ShaderProgram::SetUniform(int location, ShaderDataType type, void* data, in
 }
 
 int ShaderProgram::__GetUniformLocation(const std::string& name) {
-	// Since the default constructor for UniformInfo sets location to -1,
-	// we can simply index the map and if it doesn't exist, the default
-	// will be used
-	return _uniforms[name].Location;
+	// We use find rather than indexing, so that looking up missing uniforms doesn't add them to our map
+	auto it = _uniforms.find(name);
+	return it != _uniforms.end() ? it->second.Location : -1;
+}
+
+void ShaderProgram::_ReportMissingUniform(const std::string& name) {
+	if (_missingUniforms.insert(name).second) {
+		LOG_WARN("Uniform \"{}\" does not exist in shader \"{}\", ignoring", name, _debugName);
+	}
 }
 
 nlohmann::json ShaderProgram::ToJson() const {
 	nlohmann::json result;
 	result["name"] = _debugName;
+	if (!_defines.empty()) {
+		result["defines"] = _defines;
+	}
 	for (auto& [key, value] : _fileSourceMap) {
 		result[~key][value.IsFilePath ? "path" : "source"] = value.Source;
 	}
@@ -343,6 +392,12 @@ nlohmann::json ShaderProgram::ToJson() const {
 ShaderProgram::Sptr ShaderProgram::FromJson(const nlohmann::json& data) {
 	ShaderProgram::Sptr result = std::make_shared<ShaderProgram>();
 	result->SetDebugName(JsonGet(data, "name", result->_debugName));
+	// Defines need to be known before any of the parts are compiled
+	if (data.contains("defines")) {
+		for (auto& [name, value] : data["defines"].items()) {
+			result->AddDefine(name, value.get<std::string>());
+		}
+	}
 	for (auto& [key, blob] : data.items()) {
 		// Get the shader part type from the key
 		ShaderPartType type = ParseShaderPartType(key, ShaderPartType::Unknown);
@@ -537,4 +592,203 @@ GlResourceType ShaderProgram::GetResourceClass() const {
 void ShaderProgram::RegisterVaryings(const char* const* names, int numVaryings, bool interleaved /*= true*/)
 {
 	glTransformFeedbackVaryings(_rendererId, numVaryings, names, interleaved ? GL_INTERLEAVED_ATTRIBS : GL_SEPARATE_ATTRIBS);
+	_varyings.assign(names, names + numVaryings);
+	_interleavedVaryings = interleaved;
+}
+
+void ShaderProgram::AddDefine(const std::string& name, const std::string& value)
+{
+	LOG_ASSERT(_partSources.empty(), "Defines must be added before any shader parts are loaded");
+	_defines[name] = value;
+}
+
+const ShaderProgram::DefineSet& ShaderProgram::GetDefines() const
+{
+	return _defines;
+}
+
+ShaderProgram::Sptr ShaderProgram::GetVariant(const DefineSet& defines)
+{
+	// Our own defines are the base, the requested ones are added on top (and win if they conflict)
+	DefineSet combined = _defines;
+	for (const auto& [name, value] : defines) {
+		combined[name] = value;
+	}
+
+	std::string key = GetDefineKey(combined);
+	auto it = _variants.find(key);
+	if (it != _variants.end()) {
+		return it->second;
+	}
+
+	// Re-compile from the same sources we were built from
+	LOG_TRACE("Compiling shader variant [{}]", key);
+	Sptr result = std::make_shared<ShaderProgram>();
+	result->_defines = combined;
+	for (const auto& [type, source] : _fileSourceMap) {
+		if (source.IsFilePath) {
+			result->LoadShaderPartFromFile(source.Source.c_str(), type);
+		} else {
+			result->LoadShaderPart(source.Source.c_str(), type);
+		}
+	}
+	result->Link();
+	result->SetDebugName(_debugName.empty() ? key : _debugName + " [" + key + "]");
+
+	_variants[key] = result;
+	return result;
+}
+
+std::string ShaderProgram::GetDefineKey(const DefineSet& defines)
+{
+	// Our define sets are sorted, so the same set always builds the same key
+	std::string result;
+	for (const auto& [name, value] : defines) {
+		if (!result.empty()) {
+			result += ";";
+		}
+		result += value == "1" ? name : name + "=" + value;
+	}
+	return result;
+}
+
+std::string ShaderProgram::_InjectDefines(const std::string& source) const
+{
+	if (_defines.empty()) {
+		return source;
+	}
+
+	std::string defines;
+	for (const auto& [name, value] : _defines) {
+		defines += "#define " + name + " " + value + "\n";
+	}
+
+	// GLSL requires #version to come before anything else, so our defines go on the line after it
+	size_t version = source.find("#version");
+	if (version == std::string::npos) {
+		return defines + source;
+	}
+	size_t lineEnd = source.find('\n', version);
+	if (lineEnd == std::string::npos) {
+		return source + "\n" + defines;
+	}
+	return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+void ShaderProgram::SetBinaryCacheEnabled(bool enabled)
+{
+	_binaryCacheEnabled = enabled;
+}
+
+void ShaderProgram::SetBinaryCachePath(const std::string& path)
+{
+	_binaryCachePath = path;
+}
+
+std::string ShaderProgram::_GetBinaryCacheFile() const
+{
+	// Binaries are only valid for the driver that produced them, so figure out who that is once
+	static std::string driver;
+	static bool isSupported = false;
+	if (driver.empty()) {
+		driver += reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+		driver += reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		driver += reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		isSupported = formats > 0;
+		if (!isSupported) {
+			LOG_WARN("Driver does not support program binaries, shader binary cache disabled");
+		}
+	}
+	if (!isSupported || _partSources.empty()) {
+		return "";
+	}
+
+	uint64_t hash = HashUtils::FNV_OFFSET_BASIS;
+	HashUtils::HashString(hash, driver);
+
+	// Our parts are stored in an unordered map, so sort them to keep the hash stable
+	std::map<ShaderPartType, const std::string*> parts;
+	for (const auto& [type, source] : _partSources) {
+		parts[type] = &source;
+	}
+	for (const auto& [type, source] : parts) {
+		HashUtils::HashBytes(hash, &type, sizeof(ShaderPartType));
+		HashUtils::HashString(hash, *source);
+	}
+
+	for (const auto& name : _varyings) {
+		HashUtils::HashString(hash, name);
+	}
+	HashUtils::HashBytes(hash, &_interleavedVaryings, sizeof(bool));
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hash));
+	return _binaryCachePath + name;
+}
+
+// Written before the program binary in our cache files
+struct ProgramBinaryHeader {
+	uint32_t Magic;
+	GLenum   Format;
+	uint32_t Length;
+};
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42505347; // "GSPB"
+
+bool ShaderProgram::_LoadProgramBinary(const std::string& file)
+{
+	std::ifstream in(file, std::ios::in | std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	ProgramBinaryHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(ProgramBinaryHeader)) || header.Magic != PROGRAM_BINARY_MAGIC) {
+		LOG_WARN("Ignoring invalid shader cache file \"{}\"", file);
+		return false;
+	}
+
+	std::vector<char> binary(header.Length);
+	if (!in.read(binary.data(), header.Length)) {
+		LOG_WARN("Ignoring truncated shader cache file \"{}\"", file);
+		return false;
+	}
+
+	// The driver may still reject the binary (ex: after a driver update that doesn't change the version string),
+	// in which case the program is left unlinked and we fall back to compiling from source
+	glProgramBinary(_rendererId, header.Format, binary.data(), header.Length);
+	GLint status = 0;
+	glGetProgramiv(_rendererId, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		LOG_TRACE("Driver rejected cached shader binary \"{}\", recompiling", file);
+		return false;
+	}
+	return true;
+}
+
+void ShaderProgram::_SaveProgramBinary(const std::string& file)
+{
+	GLint length = 0;
+	glGetProgramiv(_rendererId, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	ProgramBinaryHeader header;
+	header.Magic = PROGRAM_BINARY_MAGIC;
+	std::vector<char> binary(length);
+	glGetProgramBinary(_rendererId, length, &length, &header.Format, binary.data());
+	header.Length = length;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+	std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out) {
+		LOG_WARN("Failed to write shader cache file \"{}\"", file);
+		return;
+	}
+	out.write(reinterpret_cast<const char*>(&header), sizeof(ProgramBinaryHeader));
+	out.write(binary.data(), length);
 }
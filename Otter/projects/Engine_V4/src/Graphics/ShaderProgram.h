@@ -3,6 +3,10 @@
 #include <memory>
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <map>                  // for std::map
+#include <vector>               // for std::vector
+#include <unordered_set>        // for std::unordered_set
+#include <type_traits>          // for std::is_same
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include <Logging.h>            // for the logging functions
@@ -12,6 +16,9 @@
 #include "Graphics/GlEnums.h"
 #include "Graphics/IGraphicsResource.h"
 
+template <typename T>
+class UniformHandle;
+
 /// <summary>
 /// This class will wrap around an OpenGL shader program
 /// </summary>
@@ -24,6 +31,12 @@ public:
 		return std::make_shared<ShaderProgram>();
 	}
 
+	/// <summary>
+	/// A set of preprocessor definitions (name -> value) used to compile a variant of a shader. Kept
+	/// sorted by name so that the same set of defines always produces the same key
+	/// </summary>
+	typedef std::map<std::string, std::string> DefineSet;
+
 public:
 	// Stores information about a uniform in the shader
 	struct UniformInfo {
@@ -71,6 +84,9 @@ public:
 
 	/// <summary>
 	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader)
+	/// 
+	/// Note that compiling the stage is deferred until Link, so that we can skip compiling entirely
+	/// if we have a cached binary for the program
 	/// </summary>
 	/// <param name="source">The source code of the shader to load</param>
 	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
@@ -93,7 +109,36 @@ public:
 	void RegisterVaryings(const char* const* names, int numVaryings, bool interleaved = true);
 
 	/// <summary>
-	/// Links the vertex and fragment shader, and allows this shader program to be used
+	/// Adds a #define that will be inserted after the #version line of every shader part loaded after
+	/// this call, so must be called before loading the shader's parts
+	/// </summary>
+	/// <param name="name">The name of the define</param>
+	/// <param name="value">The value of the define, defaults to 1</param>
+	void AddDefine(const std::string& name, const std::string& value = "1");
+	/// <summary>
+	/// Gets the defines this shader was compiled with
+	/// </summary>
+	const DefineSet& GetDefines() const;
+
+	/// <summary>
+	/// Gets a permutation of this shader compiled from the same sources, with the given defines added
+	/// on top of this shader's own. Permutations are compiled the first time they are requested and
+	/// cached by their defines, so this is cheap to call once a variant exists. This lets shaders
+	/// use #ifdef for features instead of branching on uniforms for every pixel
+	/// </summary>
+	/// <param name="defines">The defines to add to this shader's defines</param>
+	/// <returns>The compiled variant of this shader</returns>
+	Sptr GetVariant(const DefineSet& defines);
+
+	/// <summary>
+	/// Gets a key that uniquely identifies a set of defines
+	/// </summary>
+	static std::string GetDefineKey(const DefineSet& defines);
+
+	/// <summary>
+	/// Compiles and links all the loaded shader parts, and allows this shader program to be used. If the
+	/// binary cache is enabled and we've linked the exact same sources on this driver before, the program
+	/// is loaded from the cached binary instead
 	/// </summary>
 	/// <returns>True if the linking was successful, false if otherwise</returns>
 	bool Link();
@@ -107,8 +152,28 @@ public:
 	/// </summary>
 	static void Unbind();
 
+	/// <summary>
+	/// Enables or disables the on-disk cache of linked program binaries, enabled by default
+	/// </summary>
+	static void SetBinaryCacheEnabled(bool enabled);
+	/// <summary>
+	/// Sets the folder that program binaries will be cached in, defaults to cache/shaders/
+	/// </summary>
+	static void SetBinaryCachePath(const std::string& path);
+
 	const std::unordered_map<std::string, UniformInfo>& GetUniforms() const { return _uniforms; }
 
+	/// <summary>
+	/// Gets a typed handle to a uniform in this shader, which can be set without any name lookups. This
+	/// should be called once after linking, and the handle stored. If the uniform doesn't exist in the
+	/// linked program (or was optimized out), a warning is logged once and the handle will do nothing
+	/// </summary>
+	/// <typeparam name="T">The type of the uniform, use int for samplers</typeparam>
+	/// <param name="name">The name of the uniform, without any [] for arrays</param>
+	/// <param name="required">False if the uniform may legitimately be compiled out (ex: by a define), in which case no warning is logged</param>
+	template <typename T>
+	UniformHandle<T> GetUniformHandle(const std::string& name, bool required = true);
+
 	// Inherited from IGraphicsResource
 
 	virtual GlResourceType GetResourceClass() const override;
@@ -156,7 +221,7 @@ public:
 		if (location != -1) {
 			SetUniform(location, &value, 1);
 		} else {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
+			_ReportMissingUniform(name);
 		}
 	}
 	template <typename T>
@@ -165,7 +230,7 @@ public:
 		if (location != -1) {
 			SetUniform(location, values, count);
 		} else {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
+			_ReportMissingUniform(name);
 		}
 	}
 	template <typename T>
@@ -174,20 +239,28 @@ public:
 		if (location != -1) {
 			SetUniformMatrix(location, &value, 1, transposed);
 		} else {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
+			_ReportMissingUniform(name);
 		}
 	}
 	
 	void BindUniformBlockToSlot(const std::string& name, int uboSlot);
 
+	// Note that the string based setters above need to look up the uniform on every call, prefer
+	// GetUniformHandle for anything that is set every frame
+
 protected:
-	// Stores all the handles to our shaders until we
-	// are ready to compile them into a program
-	std::unordered_map<ShaderPartType, int> _handles;
+	// Stores the sources of our shader parts (with defines injected) until
+	// we are ready to compile them into a program
+	std::unordered_map<ShaderPartType, std::string> _partSources;
+	// The varyings registered for transform feedback, these change the linked program so need to be in our cache key
+	std::vector<std::string> _varyings;
+	bool                     _interleavedVaryings;
 	
 	// Map access to look up uniform locations and blocks
 	std::unordered_map<std::string, UniformInfo> _uniforms;
 	std::unordered_map<std::string, UniformBlockInfo> _uniformBlocks;
+	// Uniforms that have been requested but don't exist, so we only warn about each one once
+	std::unordered_set<std::string> _missingUniforms;
 
 	// Stores information about the source of our shader parts
 	// EX: if a VS shader is loaded from a file, will contain
@@ -198,6 +271,38 @@ protected:
 	};
 	std::unordered_map<ShaderPartType, ShaderSource> _fileSourceMap;
 
+	// The defines we inject into our sources, and the permutations we've compiled with extra defines
+	DefineSet _defines;
+	std::unordered_map<std::string, Sptr> _variants;
+
+	/// <summary>
+	/// Inserts our defines into a shader's source, after the #version directive if there is one
+	/// </summary>
+	std::string _InjectDefines(const std::string& source) const;
+
+	/// <summary>
+	/// Compiles a single shader part, returning it's handle or 0 if compilation failed
+	/// </summary>
+	GLuint _CompilePart(ShaderPartType type, const std::string& source);
+
+	/// <summary>
+	/// Gets the name of the file that this program's binary would be cached in. The name is a hash of the
+	/// resolved sources (including defines), the transform feedback varyings, and the driver, so any change
+	/// to them results in a new file
+	/// </summary>
+	std::string _GetBinaryCacheFile() const;
+	/// <summary>
+	/// Tries to load our program from a cached binary, returns true if the program was loaded and linked
+	/// </summary>
+	bool _LoadProgramBinary(const std::string& file);
+	/// <summary>
+	/// Stores the binary for our linked program in the cache
+	/// </summary>
+	void _SaveProgramBinary(const std::string& file);
+
+	static bool        _binaryCacheEnabled;
+	static std::string _binaryCachePath;
+
 	/// <summary>
 	/// Performs program introspection, where we examine the uniforms that
 	/// the program contains
@@ -213,5 +318,79 @@ protected:
 	/// </summary>
 	void _IntrospectUnifromBlocks();
 
+	/// <summary>
+	/// Logs a warning that a uniform does not exist in this program, the first time it is requested
+	/// </summary>
+	void _ReportMissingUniform(const std::string& name);
+
 	int __GetUniformLocation(const std::string& name);
-};
\ No newline at end of file
+};
+
+/// <summary>
+/// A typed reference to a uniform in a shader program, resolved once from the program's reflection
+/// data so that setting it is just a call with an integer location. Handles for uniforms that don't
+/// exist in the program are invalid, and setting them does nothing
+/// 
+/// Handles don't keep their shader alive, so should be stored alongside the shader they came from
+/// </summary>
+/// <typeparam name="T">The type of the uniform</typeparam>
+template <typename T>
+class UniformHandle {
+public:
+	UniformHandle() : _shader(nullptr), _location(-1), _arraySize(0) {}
+
+	/// <summary>
+	/// Returns true if the uniform exists in the shader
+	/// </summary>
+	bool IsValid() const { return _location != -1; }
+	/// <summary>
+	/// Returns true if this handle was resolved from the given shader
+	/// </summary>
+	bool IsFor(const ShaderProgram* shader) const { return _shader == shader; }
+	int GetLocation() const { return _location; }
+	int GetArraySize() const { return _arraySize; }
+
+	/// <summary>
+	/// Sets the value of the uniform, does nothing if the handle is invalid
+	/// </summary>
+	void Set(const T& value) const { Set(&value, 1); }
+	/// <summary>
+	/// Sets the values of an array uniform, does nothing if the handle is invalid
+	/// </summary>
+	void Set(const T* values, int count) const {
+		if (_location != -1) {
+			if constexpr (std::is_same<T, glm::mat3>::value || std::is_same<T, glm::mat4>::value) {
+				_shader->SetUniformMatrix(_location, values, count);
+			} else {
+				_shader->SetUniform(_location, values, count);
+			}
+		}
+	}
+
+protected:
+	friend class ShaderProgram;
+	UniformHandle(ShaderProgram* shader, int location, int arraySize) :
+		_shader(shader), _location(location), _arraySize(arraySize) {}
+
+	ShaderProgram* _shader;
+	int            _location;
+	int            _arraySize;
+};
+
+template <typename T>
+UniformHandle<T> ShaderProgram::GetUniformHandle(const std::string& name, bool required) {
+	auto it = _uniforms.find(name);
+	if (it == _uniforms.end()) {
+		if (required) {
+			_ReportMissingUniform(name);
+		}
+		return UniformHandle<T>(this, -1, 0);
+	}
+
+	// Samplers are set with ints, so we can only check the type of value uniforms
+	const UniformInfo& info = it->second;
+	if (GetShaderDataTypeCode(info.Type) != ShaderDataTypecode::Texture && GetShaderDataType<T>() != info.Type) {
+		LOG_WARN("Type mismatch for uniform \"{}\" in shader \"{}\", uniform is {}, handle is {}", name, _debugName, ~info.Type, ~GetShaderDataType<T>());
+	}
+	return UniformHandle<T>(this, info.Location, info.ArraySize);
+}
\ No newline at end of file
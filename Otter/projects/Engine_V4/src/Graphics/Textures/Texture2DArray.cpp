@@ -0,0 +1,72 @@
+#include "Texture2DArray.h"
+#include <Logging.h>
+#include "GLM/glm.hpp"
+#include "Utils/JsonGlmHelpers.h"
+
+Texture2DArray::Texture2DArray(const Texture2DArrayDescription& description) :
+	ITexture(TextureType::_2DArray),
+	_description(description)
+{
+	_SetTextureParams();
+}
+
+void Texture2DArray::LoadData(uint32_t width, uint32_t height, uint32_t layers, PixelFormat format, PixelType type, const void* data, uint32_t offsetX /*= 0*/, uint32_t offsetY /*= 0*/, uint32_t layer /*= 0*/)
+{
+	LOG_ASSERT(((width + offsetX) <= _description.Width) && ((height + offsetY) <= _description.Height) && ((layers + layer) <= _description.Layers), "Pixel bounds are outside of the extents of the image!");
+
+	// Align the data store to the size of a single component to ensure we don't get weirdness with images that aren't RGBA
+	int componentSize = (GLint)GetTexelComponentSize(type);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, componentSize);
+
+	// Upload our data to our image
+	glTextureSubImage3D(_rendererId, 0, offsetX, offsetY, layer, width, height, layers, (GLenum)format, (GLenum)type, data);
+
+	// If requested, generate mip-maps for our texture
+	if (_description.GenerateMipMaps) {
+		glGenerateTextureMipmap(_rendererId);
+	}
+}
+
+nlohmann::json Texture2DArray::ToJson() const
+{
+	return {
+		{ "size_x",     _description.Width },
+		{ "size_y",     _description.Height },
+		{ "layers",     _description.Layers },
+		{ "format",     ~_description.Format },
+		{ "wrap_s",     ~_description.HorizontalWrap },
+		{ "wrap_t",     ~_description.VerticalWrap },
+		{ "filter_min", ~_description.MinificationFilter },
+		{ "filter_mag", ~_description.MagnificationFilter },
+		{ "generate_mipmaps", _description.GenerateMipMaps }
+	};
+}
+
+Texture2DArray::Sptr Texture2DArray::FromJson(const nlohmann::json& data)
+{
+	Texture2DArrayDescription description = Texture2DArrayDescription();
+	description.Width  = JsonGet(data, "size_x", description.Width);
+	description.Height = JsonGet(data, "size_y", description.Height);
+	description.Layers = JsonGet(data, "layers", description.Layers);
+	description.Format = JsonParseEnum(InternalFormat, data, "format", InternalFormat::RGBA8);
+	description.HorizontalWrap = JsonParseEnum(WrapMode, data, "wrap_s", description.HorizontalWrap);
+	description.VerticalWrap   = JsonParseEnum(WrapMode, data, "wrap_t", description.VerticalWrap);
+	description.MinificationFilter  = JsonParseEnum(MinFilter, data, "filter_min", description.MinificationFilter);
+	description.MagnificationFilter = JsonParseEnum(MagFilter, data, "filter_mag", description.MagnificationFilter);
+	description.GenerateMipMaps = JsonGet(data, "generate_mipmaps", false);
+
+	return std::make_shared<Texture2DArray>(description);
+}
+
+void Texture2DArray::_SetTextureParams()
+{
+	// Calculate how many levels of storage to allocate based on whether mipmaps are enabled or not
+	int levels = _description.GenerateMipMaps ? (1 + (int)floor(log2(glm::max(_description.Width, _description.Height)))) : 1;
+	// Allocates the memory for every layer of our texture
+	glTextureStorage3D(_rendererId, levels, (GLenum)_description.Format, _description.Width, _description.Height, _description.Layers);
+
+	glTextureParameteri(_rendererId, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
+	glTextureParameteri(_rendererId, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+	glTextureParameteri(_rendererId, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
+	glTextureParameteri(_rendererId, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "ITexture.h"
+
+/// <summary>
+/// Describes all parameters we can manipulate with our 2D texture arrays
+/// </summary>
+struct Texture2DArrayDescription {
+	/// <summary>
+	/// The number of texels in each layer along the x axis
+	/// </summary>
+	uint32_t       Width;
+	/// <summary>
+	/// The number of texels in each layer along the y axis
+	/// </summary>
+	uint32_t       Height;
+	/// <summary>
+	/// The number of layers in the array
+	/// </summary>
+	uint32_t       Layers;
+	/// <summary>
+	/// The internal format that OpenGL should use when storing this texture
+	/// </summary>
+	InternalFormat Format;
+	/// <summary>
+	/// The wrap mode to use when a UV coordinate is outside the 0-1 range on the x axis
+	/// </summary>
+	WrapMode       HorizontalWrap;
+	/// <summary>
+	/// The wrap mode to use when a UV coordinate is outside the 0-1 range on the y axis
+	/// </summary>
+	WrapMode       VerticalWrap;
+	/// <summary>
+	/// The filter to use when multiple texels will map to a single pixel
+	/// </summary>
+	MinFilter      MinificationFilter;
+	/// <summary>
+	/// The filter to use when one texel will map to multiple pixels
+	/// </summary>
+	MagFilter      MagnificationFilter;
+	/// <summary>
+	/// True if this texture should generate mip maps (smaller copies of the image with filtering pre-applied)
+	/// </summary>
+	bool           GenerateMipMaps;
+
+	Texture2DArrayDescription() :
+		Width(0), Height(0), Layers(0),
+		Format(InternalFormat::Unknown),
+		HorizontalWrap(WrapMode::ClampToEdge),
+		VerticalWrap(WrapMode::ClampToEdge),
+		MinificationFilter(MinFilter::Linear),
+		MagnificationFilter(MagFilter::Linear),
+		GenerateMipMaps(false)
+	{ }
+};
+
+/// <summary>
+/// A texture made up of a number of 2D layers that are all the same size, shaders sample them
+/// with a sampler2DArray and pick the layer with the 3rd texture coordinate
+/// </summary>
+class Texture2DArray : public ITexture {
+public:
+	DEFINE_RESOURCE(Texture2DArray)
+
+	// Make sure we mark our destructor as virtual so base class is called
+	virtual ~Texture2DArray() = default;
+
+public:
+	Texture2DArray(const Texture2DArrayDescription& description);
+
+	/// <summary>
+	/// Gets the internal format OpenGL is using for this texture
+	/// </summary>
+	InternalFormat GetFormat() const { return _description.Format; }
+	/// <summary>
+	/// Gets the width of each layer in pixels
+	/// </summary>
+	uint32_t GetWidth() const { return _description.Width; }
+	/// <summary>
+	/// Gets the height of each layer in pixels
+	/// </summary>
+	uint32_t GetHeight() const { return _description.Height; }
+	/// <summary>
+	/// Gets the number of layers in this texture
+	/// </summary>
+	uint32_t GetLayers() const { return _description.Layers; }
+
+	/// <summary>
+	/// Loads a region of data into some of the layers of this texture
+	/// Bounds must be contained by the bounds of the texture
+	/// format and type must be convertible to the texture's internal format
+	/// </summary>
+	/// <param name="width">The width of the data frame, in pixels</param>
+	/// <param name="height">The height of the data frame, in pixels</param>
+	/// <param name="layers">The number of layers in the data frame</param>
+	/// <param name="format">The pixel layout of the data</param>
+	/// <param name="type">The pixel base type of the data</param>
+	/// <param name="data">A pointer to the data to load into this texture</param>
+	/// <param name="offsetX">The x edge of the destination rectangle in the texture, left->right</param>
+	/// <param name="offsetY">The y edge of the destination rectangle in the texture, bottom->top</param>
+	/// <param name="layer">The first layer to load into</param>
+	void LoadData(uint32_t width, uint32_t height, uint32_t layers, PixelFormat format, PixelType type, const void* data, uint32_t offsetX = 0, uint32_t offsetY = 0, uint32_t layer = 0);
+
+	/// <summary>
+	/// Gets this texture's description, which contains basic information about the
+	/// texture's dimensions and creation parameters
+	/// </summary>
+	const Texture2DArrayDescription& GetDescription() const { return _description; }
+
+	virtual nlohmann::json ToJson() const override;
+	static Texture2DArray::Sptr FromJson(const nlohmann::json& data);
+
+protected:
+	Texture2DArrayDescription _description;
+
+	/// <summary>
+	/// Allocates our texture's memory and sets sampling / filtering parameters
+	/// </summary>
+	void _SetTextureParams();
+};
@@ -5,7 +5,8 @@
 
 TextureCube::TextureCube(const std::string& baseFilename) :
 	ITexture(TextureType::Cubemap),
-	_description(TextureCubeDescription())
+	_description(TextureCubeDescription()),
+	_sphericalHarmonics()
 {
 	_description.Filename = baseFilename;
 	_LoadFromDescription();
@@ -13,7 +14,8 @@ TextureCube::TextureCube(const std::string& baseFilename) :
 
 TextureCube::TextureCube(const std::unordered_map<CubeMapFace, std::string>& faceFilenames) :
 	ITexture(TextureType::Cubemap),
-	_description(TextureCubeDescription())
+	_description(TextureCubeDescription()),
+	_sphericalHarmonics()
 {
 	_description.FaceFileNames = faceFilenames;
 	_LoadFromDescription();
@@ -21,7 +23,8 @@ TextureCube::TextureCube(const std::unordered_map<CubeMapFace, std::string>& fac
 
 TextureCube::TextureCube(const TextureCubeDescription& description) :
 	ITexture(TextureType::Cubemap),
-	_description(description)
+	_description(description),
+	_sphericalHarmonics()
 {
 	_LoadFromDescription();
 }
@@ -61,8 +64,26 @@ TextureCube::Sptr TextureCube::FromJson(const nlohmann::json& data)
 	return std::make_shared<TextureCube>(descr);
 }
 
+uint32_t TextureCube::GetMipLevels() const
+{
+	if (!_description.GenerateMipMaps) {
+		return 1;
+	}
+	uint32_t levels = 1;
+	for (uint32_t size = _description.Size; size > 1; size >>= 1) {
+		levels++;
+	}
+	return levels;
+}
+
 void TextureCube::_LoadFromDescription()
 {
+	// If we weren't given any files, we allocate an empty texture (ex: for rendering into)
+	if (_description.FaceFileNames.empty() && _description.Filename.empty()) {
+		_SetTextureParams();
+		return;
+	}
+
 	// If we weren't passed face filenames but WERE passed a base filename, try and get the 6 face files
 	if (_description.FaceFileNames.empty() && !_description.Filename.empty()) {
 		// Get the file path and it's directory to extract the root file name w/o extension
@@ -174,14 +195,23 @@ void TextureCube::_LoadImages(const std::unordered_map<CubeMapFace, std::string>
 
 	// Upload our data to our image (note that the custom enum tools let us convert to base type [GLenum] with the * operator)
 	glTextureSubImage3D(_rendererId, 0, 0, 0, 0, _description.Size, _description.Size, 6, *_description.FormatHint, *PixelType::UByte, datastore);
+
+	// We have the pixels on hand, so this is the cheapest time to work out the diffuse lighting from the cubemap
+	if (numChannels >= 3) {
+		_sphericalHarmonics = SphericalHarmonics::ProjectCubemap(datastore, _description.Size, numChannels);
+	}
 	delete[] datastore;
+
+	if (_description.GenerateMipMaps) {
+		glGenerateTextureMipmap(_rendererId);
+	}
 }
 
 void TextureCube::_SetTextureParams(){
 	// Make sure the size is greater than zero and that we have a format specified before trying to set parameters
 	if (_description.Size > 0 && _description.Format != InternalFormat::Unknown) {
 		// Allocates the memory for our texture
-		glTextureStorage2D(_rendererId, 1, (GLenum)_description.Format, _description.Size, _description.Size);
+		glTextureStorage2D(_rendererId, GetMipLevels(), (GLenum)_description.Format, _description.Size, _description.Size);
 
 		// Set up our texture parameters
 		glTextureParameteri(_rendererId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
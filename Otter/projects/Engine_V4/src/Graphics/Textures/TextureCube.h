@@ -1,6 +1,7 @@
 #pragma once
 #include <EnumToString.h>
 #include "ITexture.h"
+#include "Utils/SphericalHarmonics.h"
 
 /*
 0 	GL_TEXTURE_CUBE_MAP_POSITIVE_X
@@ -60,6 +61,12 @@ struct TextureCubeDescription {
 	/// </summary>
 	PixelFormat    FormatHint;
 
+	/// <summary>
+	/// True if storage should be allocated for a full mip chain, and mips generated from
+	/// the loaded images (if any)
+	/// </summary>
+	bool           GenerateMipMaps;
+
 	/// <summary>
 	/// Creates a default (empty) cubemap description
 	/// </summary>
@@ -69,7 +76,8 @@ struct TextureCubeDescription {
 		MinificationFilter(MinFilter::NearestMipLinear),
 		MagnificationFilter(MagFilter::Linear),
 		Filename(""),
-		FormatHint(PixelFormat::RGBA)
+		FormatHint(PixelFormat::RGBA),
+		GenerateMipMaps(false)
 	{ }
 };
 
@@ -101,6 +109,15 @@ public:
 	/// Gets the magnification filter that the texture is using
 	/// </summary>
 	MagFilter GetMagFilter() const { return _description.MagnificationFilter; }
+	/// <summary>
+	/// Gets the number of mip levels this texture has storage for
+	/// </summary>
+	uint32_t GetMipLevels() const;
+	/// <summary>
+	/// Gets the diffuse lighting this cubemap casts as spherical harmonics, projected on the CPU when the
+	/// faces were loaded. Will be all zeros for cubemaps that were not loaded from images
+	/// </summary>
+	const SphericalHarmonics& GetSphericalHarmonics() const { return _sphericalHarmonics; }
 
 	/// <summary>
 	/// Gets this texture's description, which contains basic information about the
@@ -113,6 +130,7 @@ public:
 
 protected:
 	TextureCubeDescription _description;
+	SphericalHarmonics     _sphericalHarmonics;
 
 	virtual void _LoadFromDescription();
 	virtual void _LoadImages(const std::unordered_map<CubeMapFace, std::string>& faceFilenames);
@@ -3,12 +3,25 @@
 #include "Buffers/VertexBuffer.h"
 #include "Logging.h"
 
+// Sets up the pointer for a vertex attribute on the currently bound VAO and buffer, selecting
+// between the float and integer versions of glVertexAttribPointer
+inline void SetAttributePointer(const BufferAttribute& attrib) {
+	bool isIntegerType = attrib.Type != AttributeType::Float && attrib.Type != AttributeType::HalfFloat && attrib.Type != AttributeType::Double;
+	if (attrib.Integer && isIntegerType) {
+		glVertexAttribIPointer(attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Stride, (void*)(size_t)attrib.Offset);
+	} else {
+		glVertexAttribPointer(attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Normalized, attrib.Stride, (void*)(size_t)attrib.Offset);
+	}
+}
+
 VertexArrayObject::VertexArrayObject() :
 	_indexBuffer(nullptr),
 	_handle(0),
 	_vertexCount(0),
 	_elementCount(0),
-	_vertexBuffers(std::vector<VertexBufferBinding*>())
+	_vertexBuffers(std::vector<VertexBufferBinding*>()),
+	_positionScale(glm::vec3(1.0f)),
+	_positionOffset(glm::vec3(0.0f))
 {
 	glCreateVertexArrays(1, &_handle);
 }
@@ -58,8 +71,7 @@ VertexArrayObject::VertexBufferBinding* VertexArrayObject::AddVertexBuffer(const
 	buffer->Bind();
 	for (const BufferAttribute& attrib : attributes) {
 		glEnableVertexArrayAttrib(_handle, attrib.Slot);
-		glVertexAttribPointer(attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Normalized, attrib.Stride,
-							  (void*)attrib.Offset);
+		SetAttributePointer(attrib);
 
 		// Here is where we select whether the attribute is instanced or not
 		glVertexAttribDivisor(attrib.Slot, instanced ? 1 : 0);
@@ -89,8 +101,7 @@ void VertexArrayObject::ReplaceVertexBuffer(VertexBufferBinding* binding, const
 		buffer->Bind();
 		for (const BufferAttribute& attrib : binding->Attributes) {
 			glEnableVertexArrayAttrib(_handle, attrib.Slot);
-			glVertexAttribPointer(attrib.Slot, attrib.Size, (GLenum)attrib.Type, attrib.Normalized, attrib.Stride,
-				(void*)attrib.Offset);
+			SetAttributePointer(attrib);
 
 			// Here is where we select whether the attribute is instanced or not
 			glVertexAttribDivisor(attrib.Slot, binding->Instanced ? 1 : 0);
@@ -128,6 +139,19 @@ void VertexArrayObject::DrawInstanced(uint32_t instanceCount, DrawMode mode /*=
 	
 }
 
+void VertexArrayObject::DrawIndirect(const IndirectBuffer::Sptr& commands, uint32_t commandCount, DrawMode mode /*= DrawMode::TriangleList*/)
+{
+	LOG_ASSERT(_indexBuffer != nullptr, "Indirect draws require an index buffer!");
+	if (commandCount == 0) {
+		return;
+	}
+	Bind();
+	commands->Bind();
+	glMultiDrawElementsIndirect((GLenum)mode, (GLenum)_indexBuffer->GetElementType(), nullptr, commandCount, sizeof(DrawElementsIndirectCommand));
+	IndirectBuffer::UnBind();
+	Unbind();
+}
+
 void VertexArrayObject::Bind() {
 	glBindVertexArray(_handle);
 }
@@ -136,6 +160,11 @@ void VertexArrayObject::Unbind() {
 	glBindVertexArray(0);
 }
 
+void VertexArrayObject::SetPositionDequantization(const glm::vec3& scale, const glm::vec3& offset) {
+	_positionScale = scale;
+	_positionOffset = offset;
+}
+
 void VertexArrayObject::SetVDecl(const VertexDeclaration& vDecl) {
 	_vDecl = vDecl;
 }
@@ -177,6 +206,7 @@ VertexArrayObject::Sptr VertexArrayObject::Clone() const
 	}
 
 	result->SetVDecl(_vDecl);
+	result->SetPositionDequantization(_positionScale, _positionOffset);
 
 	return result;
 }
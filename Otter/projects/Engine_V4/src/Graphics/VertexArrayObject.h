@@ -4,9 +4,11 @@
 #include <vector>
 #include <memory>
 #include <EnumToString.h>
+#include <GLM/glm.hpp>
 
 #include "Graphics/Buffers/VertexBuffer.h"
 #include "Graphics/Buffers/IndexBuffer.h"
+#include "Graphics/Buffers/IndirectBuffer.h"
 #include "Graphics/GlEnums.h"
 #include "Graphics/IGraphicsResource.h"
 
@@ -31,6 +33,12 @@ struct BufferAttribute {
 	/// </summary>
 	bool    Normalized;
 	/// <summary>
+	/// True if the attribute should be passed to the shader as an integer (ex: ivec4) rather than converted
+	/// to floating point. Ignored for float types, and takes priority over Normalized
+	/// Note: this sits in what used to be padding after Normalized, so the size of this struct is unchanged
+	/// </summary>
+	bool    Integer;
+	/// <summary>
 	/// The total size of an element in this buffer
 	/// </summary>
 	GLsizei Stride;
@@ -44,10 +52,10 @@ struct BufferAttribute {
 	AttribUsage Usage;
 
 	BufferAttribute() :
-		Slot(0), Size(0), Type(AttributeType::Unknown), Normalized(false), Stride(0), Offset(0), Usage(AttribUsage::Unknown){}
+		Slot(0), Size(0), Type(AttributeType::Unknown), Normalized(false), Integer(false), Stride(0), Offset(0), Usage(AttribUsage::Unknown){}
 
-	BufferAttribute(uint32_t slot, uint32_t size, AttributeType type, GLsizei stride, GLsizei offset, AttribUsage usage, bool normalized = false) :
-		Slot(slot), Size(size), Type(type), Stride(stride), Offset(offset), Usage(usage), Normalized(normalized) { }
+	BufferAttribute(uint32_t slot, uint32_t size, AttributeType type, GLsizei stride, GLsizei offset, AttribUsage usage, bool normalized = false, bool integer = false) :
+		Slot(slot), Size(size), Type(type), Stride(stride), Offset(offset), Usage(usage), Normalized(normalized), Integer(integer) { }
 };
 
 /// <summary>
@@ -119,6 +127,10 @@ public:
 	/// <param name="usage">The attribute usage hint to search for</param>
 	/// <returns>A const pointer to the binding, or nullptr if none is found</returns>
 	VertexBufferBinding* GetBufferBinding(AttribUsage usage);
+	/// <summary>
+	/// Gets all of the vertex buffers bound to this VAO, in the order they were added
+	/// </summary>
+	const std::vector<VertexBufferBinding*>& GetVertexBuffers() const { return _vertexBuffers; }
 
 	/// <summary>
 	/// Renders this VAO, using the specified draw mode
@@ -134,6 +146,15 @@ public:
 	/// <param name="mode">The primitive mode for rendering the mesh</param>
 	void DrawInstanced(uint32_t instanceCount, DrawMode mode = DrawMode::TriangleList);
 
+	/// <summary>
+	/// Renders ranges of this VAO's index buffer using the draw commands stored in the given buffer.
+	/// Internally this will call glMultiDrawElementsIndirect, so this VAO must have an index buffer
+	/// </summary>
+	/// <param name="commands">The buffer holding DrawElementsIndirectCommand entries</param>
+	/// <param name="commandCount">The number of commands to read from the start of the buffer</param>
+	/// <param name="mode">The primitive mode for rendering the mesh</param>
+	void DrawIndirect(const IndirectBuffer::Sptr& commands, uint32_t commandCount, DrawMode mode = DrawMode::TriangleList);
+
 	/// <summary>
 	/// Binds this VAO as the source of data for draw operations
 	/// </summary>
@@ -151,6 +172,22 @@ public:
 	void SetVDecl(const VertexDeclaration& vDecl);
 	const VertexDeclaration& GetVDecl();
 
+	/// <summary>
+	/// Sets how positions stored in this VAO should be decoded into model space, for meshes whose positions
+	/// are quantized to their bounding box. Model space position = stored position * scale + offset
+	/// </summary>
+	/// <param name="scale">The size of the box the positions were quantized to</param>
+	/// <param name="offset">The minimum corner of the box the positions were quantized to</param>
+	void SetPositionDequantization(const glm::vec3& scale, const glm::vec3& offset);
+	/// <summary>
+	/// Gets the scale to apply to positions to bring them into model space, 1 for unquantized meshes
+	/// </summary>
+	const glm::vec3& GetPositionScale() const { return _positionScale; }
+	/// <summary>
+	/// Gets the offset to apply to positions to bring them into model space, 0 for unquantized meshes
+	/// </summary>
+	const glm::vec3& GetPositionOffset() const { return _positionOffset; }
+
 protected:
 	
 	// The index buffer bound to this VAO
@@ -165,6 +202,10 @@ protected:
 	uint32_t _vertexCount;
 	uint32_t _elementCount;
 
+	// Decoding info for quantized positions
+	glm::vec3 _positionScale;
+	glm::vec3 _positionOffset;
+
 	// The underlying OpenGL handle that this class is wrapping around
 	GLuint _handle;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GLM/glm.hpp>
+#include <GLM/gtc/type_precision.hpp>
 #include "VertexArrayObject.h"
 
 
@@ -116,4 +117,32 @@ struct VertexPosNormTexColTangents {
 	{}
 
 	static const std::vector<BufferAttribute> V_DECL;
-};
\ No newline at end of file
+};
+
+/// <summary>
+/// A compact version of VertexPosNormTexColTangents, at 28 bytes instead of 72
+///   - Positions are unorm16, quantized to the mesh's bounding box (see VertexArrayObject::SetPositionDequantization)
+///   - Normals, tangents and bitangents are snorm 10:10:10:2, which OpenGL will unpack into vec3s for us
+///   - UVs are half floats
+///   - Colors are unorm8
+/// See MeshQuantizer for converting full precision meshes into this format
+/// </summary>
+struct VertexQuantized {
+	glm::u16vec4 Position; // W is unused, it pads positions out to 4 byte alignment
+	uint32_t     Color;
+	uint32_t     Normal;
+	uint32_t     UV;
+	uint32_t     Tangent;
+	uint32_t     BiTangent;
+
+	VertexQuantized() :
+		Position(glm::u16vec4(0)),
+		Color(0xFFFFFFFF),
+		Normal(0),
+		UV(0),
+		Tangent(0),
+		BiTangent(0)
+	{}
+
+	static const std::vector<BufferAttribute> V_DECL;
+};
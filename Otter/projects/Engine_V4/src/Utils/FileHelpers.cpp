@@ -5,6 +5,9 @@
 
 #include "Utils/StringUtils.h"
 
+std::unordered_map<std::string, std::string> FileHelpers::_fileCache;
+std::unordered_map<std::string, std::string> FileHelpers::_resolvedCache;
+
 std::string FileHelpers::ReadFile(const std::string& filename) {
 	std::string result;
 	std::ifstream in(filename, std::ios::in | std::ios::binary); // ifstream closes itself due to RAII
@@ -31,9 +34,33 @@ std::string FileHelpers::ReadFile(const std::string& filename) {
 	return result;
 }
 
+const std::string& FileHelpers::_ReadFileCached(const std::string& filename) {
+	auto it = _fileCache.find(filename);
+	if (it == _fileCache.end()) {
+		it = _fileCache.emplace(filename, ReadFile(filename)).first;
+	}
+	return it->second;
+}
+
+void FileHelpers::ClearIncludeCache() {
+	_fileCache.clear();
+	_resolvedCache.clear();
+}
+
 std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths) {
+	// Only top level files can use the resolved cache, since the contents of an included file
+	// depend on what has already been included before it
+	const bool isTopLevel = resolvedPaths.empty();
+	const std::string key = std::filesystem::path(filename).lexically_normal().string();
+	if (isTopLevel) {
+		auto it = _resolvedCache.find(key);
+		if (it != _resolvedCache.end()) {
+			return it->second;
+		}
+	}
+
 	// Read the entire file contents for processing
-	std::string result = ReadFile(filename);
+	std::string result = _ReadFileCached(key);
 	// Determine where the file we just read resides on the filesystem
 	const std::filesystem::path folder = std::filesystem::path(filename).parent_path();
 
@@ -93,6 +120,10 @@ std::string FileHelpers::ReadResolveIncludes(const std::string& filename, std::v
 		}
 	}
 
+	if (isTopLevel) {
+		_resolvedCache[key] = result;
+	}
+
 	return result;
 }
 
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 class FileHelpers {
 public:
@@ -16,12 +17,20 @@ public:
 	/// <summary>
 	/// Reads the entire contents of a file, and will also recursively include
 	/// any other files needed as indicated by a #include fileName on a line
+	/// 
+	/// Results are memoized, so shared files (ex: frame_uniforms.glsl) are only read from disk once,
+	/// and resolving the same file again is just a lookup. Use ClearIncludeCache if files change on disk
 	/// </summary>
 	/// <param name="filename">The path of the file to load</param>
 	/// <param name="resolvedPaths">The list of paths that have already been included</param>
 	/// <returns>The entire contents of the file, with includes resolved, stored in a string</returns>
 	static std::string ReadResolveIncludes(const std::string& filename, std::vector<std::string> resolvedPaths = std::vector<std::string>());
 
+	/// <summary>
+	/// Forgets all the files that ReadResolveIncludes has read, so that the next call will re-read them from disk
+	/// </summary>
+	static void ClearIncludeCache();
+
 	/// <summary>
 	/// Helper for writing the contents of a string into a file
 	/// </summary>
@@ -29,4 +38,12 @@ public:
 	/// <param name="contents">The contents of the file to write</param>
 	/// <param name="append">True if contents should be appended to end of existing files</param>
 	static void WriteContentsToFile(const std::string& filename, const std::string& contents, bool append = false);
+
+private:
+	// The raw contents of files read while resolving includes, keyed by their normalized path
+	static std::unordered_map<std::string, std::string> _fileCache;
+	// The fully resolved contents of files passed to ReadResolveIncludes, keyed by their normalized path
+	static std::unordered_map<std::string, std::string> _resolvedCache;
+
+	static const std::string& _ReadFileCached(const std::string& filename);
 };
\ No newline at end of file
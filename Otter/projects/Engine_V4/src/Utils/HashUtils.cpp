@@ -0,0 +1,14 @@
+#include "Utils/HashUtils.h"
+
+void HashUtils::HashBytes(uint64_t& hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t ix = 0; ix < size; ix++) {
+		hash ^= bytes[ix];
+		hash *= FNV_PRIME;
+	}
+}
+
+void HashUtils::HashString(uint64_t& hash, const std::string& value) {
+	HashBytes(hash, value.data(), value.size());
+	HashBytes(hash, "\0", 1);
+}
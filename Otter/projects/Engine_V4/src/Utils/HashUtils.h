@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// Provides a 64 bit FNV-1a hash, for when we need something that is stable between runs and spread
+/// well enough to use as a file name (ex: the shader binary and font bake caches). Not suitable for
+/// anything security related!
+/// </summary>
+class HashUtils {
+public:
+	// The value a hash should start with before any data is added
+	inline static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+	inline static const uint64_t FNV_PRIME        = 0x100000001b3ull;
+
+	/// <summary>
+	/// Mixes a block of bytes into an existing hash
+	/// </summary>
+	/// <param name="hash">The hash to update, should start as FNV_OFFSET_BASIS</param>
+	/// <param name="data">The bytes to add to the hash</param>
+	/// <param name="size">The number of bytes to add</param>
+	static void HashBytes(uint64_t& hash, const void* data, size_t size);
+	/// <summary>
+	/// Mixes a string into an existing hash, followed by a separator so that "ab"+"c" and "a"+"bc"
+	/// don't collide
+	/// </summary>
+	/// <param name="hash">The hash to update, should start as FNV_OFFSET_BASIS</param>
+	/// <param name="value">The string to add to the hash</param>
+	static void HashString(uint64_t& hash, const std::string& value);
+};
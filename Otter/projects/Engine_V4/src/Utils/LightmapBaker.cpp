@@ -0,0 +1,516 @@
+#include "Utils/LightmapBaker.h"
+#include "Utils/TriangleBvh.h"
+#include "Utils/ThreadPool.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <GLM/gtc/constants.hpp>
+#include <stb_rect_pack.h>
+#include <stb_image_write.h>
+
+// The size of the grid that charts are packed into, before being scaled down to the unit square
+static const int   LIGHTMAP_PACK_SIZE = 1024;
+// How many times we shrink the charts and try packing again before giving up
+static const int   LIGHTMAP_PACK_ATTEMPTS = 32;
+// The fraction of the packing area we aim to fill on our first attempt
+static const float LIGHTMAP_PACK_FILL = 0.6f;
+// How many texels each worker grabs at once when baking
+static const size_t LIGHTMAP_BAKE_CHUNK = 64;
+
+/// <summary>
+/// A texel that is covered by a triangle, and where on the surface it is
+/// </summary>
+struct LightmapTexelSample {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	uint32_t  Instance;
+	uint32_t  Texel;
+};
+
+/// <summary>
+/// A small PCG hash, good enough for picking ray directions and cheap enough to seed per texel
+/// </summary>
+static uint32_t LightmapHash(uint32_t value) {
+	uint32_t state = value * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+static float LightmapRandom(uint32_t& state) {
+	state = LightmapHash(state);
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+/// <summary>
+/// Builds an orthonormal basis around a normal, see Duff et al. "Building an Orthonormal Basis, Revisited"
+/// </summary>
+static void MakeBasis(const glm::vec3& n, glm::vec3& outTangent, glm::vec3& outBitangent) {
+	float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+	float a = -1.0f / (sign + n.z);
+	float b = n.x * n.y * a;
+	outTangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	outBitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+/// <summary>
+/// Fills in texels that aren't covered by any triangle with the average of their neighbours, so that bilinear
+/// filtering and mip maps near the edges of charts don't pull in black
+/// </summary>
+static void DilateLightmap(LightmapBaker::Lightmap& lightmap, uint32_t passes) {
+	int res = static_cast<int>(lightmap.Resolution);
+	std::vector<uint8_t> filled = lightmap.Coverage;
+	std::vector<uint8_t> nextFilled = filled;
+
+	for (uint32_t pass = 0; pass < passes; pass++) {
+		bool changed = false;
+		for (int y = 0; y < res; y++) {
+			for (int x = 0; x < res; x++) {
+				size_t index = (size_t)y * res + x;
+				if (filled[index]) {
+					continue;
+				}
+
+				glm::vec3 sum = glm::vec3(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; dy++) {
+					for (int dx = -1; dx <= 1; dx++) {
+						int nx = x + dx, ny = y + dy;
+						if (nx < 0 || ny < 0 || nx >= res || ny >= res) {
+							continue;
+						}
+						size_t neighbour = (size_t)ny * res + nx;
+						if (filled[neighbour]) {
+							sum += lightmap.Texels[neighbour];
+							count++;
+						}
+					}
+				}
+
+				if (count > 0) {
+					lightmap.Texels[index] = sum / static_cast<float>(count);
+					nextFilled[index] = 1;
+					changed = true;
+				}
+			}
+		}
+		filled = nextFilled;
+		if (!changed) {
+			break;
+		}
+	}
+}
+
+LightmapUvs LightmapBaker::GenerateUvs(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, float maxChartAngle) {
+	LightmapUvs result;
+	size_t vertexCount = positions.size();
+	size_t triCount = indices.size() / 3;
+
+	result.VertexRemap.resize(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		result.VertexRemap[ix] = static_cast<uint32_t>(ix);
+	}
+	result.Uvs.resize(vertexCount, glm::vec2(0.0f));
+	result.Indices.resize(triCount * 3);
+	if (triCount == 0) {
+		return result;
+	}
+
+	// Meshes are usually already split along their texture and normal seams, so we weld vertices by position
+	// to find which triangles actually touch
+	std::vector<uint32_t> sorted(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		sorted[ix] = static_cast<uint32_t>(ix);
+	}
+	auto lessPosition = [&](uint32_t a, uint32_t b) {
+		const glm::vec3& pa = positions[a];
+		const glm::vec3& pb = positions[b];
+		return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+	};
+	std::sort(sorted.begin(), sorted.end(), lessPosition);
+	std::vector<uint32_t> welded(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		welded[sorted[ix]] = (ix > 0 && positions[sorted[ix]] == positions[sorted[ix - 1]]) ? welded[sorted[ix - 1]] : sorted[ix];
+	}
+
+	// Find triangles that share an edge by sorting all the edges, so matching ones end up next to each other
+	std::vector<std::pair<uint64_t, uint32_t>> edges;
+	edges.reserve(triCount * 3);
+	for (size_t tri = 0; tri < triCount; tri++) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t a = welded[indices[tri * 3 + corner]];
+			uint32_t b = welded[indices[tri * 3 + (corner + 1) % 3]];
+			if (a == b) {
+				continue;
+			}
+			uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+			edges.emplace_back(key, static_cast<uint32_t>(tri));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::vector<std::vector<uint32_t>> neighbours(triCount);
+	for (size_t begin = 0, end = 0; begin < edges.size(); begin = end) {
+		for (end = begin + 1; end < edges.size() && edges[end].first == edges[begin].first; end++) {}
+		for (size_t a = begin; a < end; a++) {
+			for (size_t b = a + 1; b < end; b++) {
+				neighbours[edges[a].second].push_back(edges[b].second);
+				neighbours[edges[b].second].push_back(edges[a].second);
+			}
+		}
+	}
+
+	// The area weighted normal of every triangle, degenerate triangles get a length of zero
+	std::vector<glm::vec3> faceNormals(triCount);
+	for (size_t tri = 0; tri < triCount; tri++) {
+		const glm::vec3& p0 = positions[indices[tri * 3 + 0]];
+		const glm::vec3& p1 = positions[indices[tri * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[tri * 3 + 2]];
+		faceNormals[tri] = glm::cross(p1 - p0, p2 - p0);
+	}
+
+	struct Chart {
+		glm::vec2 Min;
+		glm::vec2 Max;
+		uint32_t  FirstVertex;
+		uint32_t  VertexCount;
+	};
+	std::vector<Chart> charts;
+	// The vertices of each chart, in chart order, and where they sit on the chart's plane
+	std::vector<uint32_t>  chartVertices;
+	std::vector<glm::vec2> planar(vertexCount);
+
+	float minCosine = glm::cos(glm::radians(maxChartAngle));
+	std::vector<uint32_t> triChart(triCount, UINT32_MAX);
+	std::vector<uint32_t> vertexOwner(vertexCount, UINT32_MAX);
+	std::unordered_map<uint32_t, uint32_t> copies;
+	std::vector<uint32_t> chartTris;
+	std::vector<uint32_t> queue;
+
+	for (size_t seed = 0; seed < triCount; seed++) {
+		if (triChart[seed] != UINT32_MAX) {
+			continue;
+		}
+		uint32_t chartIndex = static_cast<uint32_t>(charts.size());
+
+		// Flood fill out from the seed while triangles face roughly the same way as it
+		float seedLength = glm::length(faceNormals[seed]);
+		glm::vec3 seedNormal = seedLength > 0.0f ? faceNormals[seed] / seedLength : glm::vec3(0.0f, 0.0f, 1.0f);
+		glm::vec3 normalSum = glm::vec3(0.0f);
+		chartTris.clear();
+		queue.clear();
+		queue.push_back(static_cast<uint32_t>(seed));
+		triChart[seed] = chartIndex;
+		while (!queue.empty()) {
+			uint32_t tri = queue.back();
+			queue.pop_back();
+			chartTris.push_back(tri);
+			normalSum += faceNormals[tri];
+
+			for (uint32_t other : neighbours[tri]) {
+				if (triChart[other] != UINT32_MAX) {
+					continue;
+				}
+				float length = glm::length(faceNormals[other]);
+				if (length == 0.0f || glm::dot(faceNormals[other] / length, seedNormal) >= minCosine) {
+					triChart[other] = chartIndex;
+					queue.push_back(other);
+				}
+			}
+		}
+
+		// Project onto the chart's average plane
+		glm::vec3 normal = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : seedNormal;
+		glm::vec3 tangent, bitangent;
+		MakeBasis(normal, tangent, bitangent);
+
+		Chart chart;
+		chart.Min = glm::vec2(std::numeric_limits<float>::max());
+		chart.Max = glm::vec2(-std::numeric_limits<float>::max());
+		chart.FirstVertex = static_cast<uint32_t>(chartVertices.size());
+
+		// The first chart to use a vertex gets the original, any others get a copy at the end of the mesh
+		copies.clear();
+		for (uint32_t tri : chartTris) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t vertex = indices[tri * 3 + corner];
+				uint32_t unwrapped;
+				if (vertexOwner[vertex] == UINT32_MAX) {
+					vertexOwner[vertex] = chartIndex;
+					unwrapped = vertex;
+					chartVertices.push_back(unwrapped);
+				} else if (vertexOwner[vertex] == chartIndex) {
+					unwrapped = vertex;
+				} else {
+					auto it = copies.find(vertex);
+					if (it == copies.end()) {
+						unwrapped = static_cast<uint32_t>(result.VertexRemap.size());
+						result.VertexRemap.push_back(vertex);
+						result.Uvs.emplace_back(0.0f);
+						planar.emplace_back(0.0f);
+						chartVertices.push_back(unwrapped);
+						copies[vertex] = unwrapped;
+					} else {
+						unwrapped = it->second;
+					}
+				}
+				result.Indices[tri * 3 + corner] = unwrapped;
+
+				glm::vec2 point = glm::vec2(glm::dot(positions[vertex], tangent), glm::dot(positions[vertex], bitangent));
+				planar[unwrapped] = point;
+				chart.Min = glm::min(chart.Min, point);
+				chart.Max = glm::max(chart.Max, point);
+			}
+		}
+		chart.VertexCount = static_cast<uint32_t>(chartVertices.size()) - chart.FirstVertex;
+		charts.push_back(chart);
+	}
+
+	// Pick a starting scale that would fill most of the grid, then shrink until everything fits
+	float totalArea = 0.0f;
+	for (const Chart& chart : charts) {
+		glm::vec2 size = chart.Max - chart.Min;
+		totalArea += size.x * size.y;
+	}
+	int padding = static_cast<int>(CHART_PADDING * LIGHTMAP_PACK_SIZE / MIN_RESOLUTION);
+	float scale = totalArea > 0.0f ? glm::sqrt(LIGHTMAP_PACK_FILL * LIGHTMAP_PACK_SIZE * LIGHTMAP_PACK_SIZE / totalArea) : 1.0f;
+
+	std::vector<stbrp_rect> rects(charts.size());
+	std::vector<stbrp_node> nodes(LIGHTMAP_PACK_SIZE);
+	bool packed = false;
+	for (int attempt = 0; attempt < LIGHTMAP_PACK_ATTEMPTS && !packed; attempt++, scale *= 0.9f) {
+		for (size_t ix = 0; ix < charts.size(); ix++) {
+			glm::vec2 size = (charts[ix].Max - charts[ix].Min) * scale;
+			rects[ix].id = static_cast<int>(ix);
+			rects[ix].w = static_cast<int>(glm::ceil(size.x)) + padding;
+			rects[ix].h = static_cast<int>(glm::ceil(size.y)) + padding;
+		}
+		stbrp_context context;
+		stbrp_init_target(&context, LIGHTMAP_PACK_SIZE, LIGHTMAP_PACK_SIZE, nodes.data(), static_cast<int>(nodes.size()));
+		packed = stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size())) != 0;
+	}
+	if (!packed) {
+		LOG_WARN("Failed to pack {} lightmap charts, some will overlap", charts.size());
+	}
+	// The loop shrinks once more after the attempt that worked
+	scale /= 0.9f;
+
+	for (size_t ix = 0; ix < charts.size(); ix++) {
+		const Chart& chart = charts[ix];
+		glm::vec2 offset = glm::vec2(rects[ix].x, rects[ix].y) + padding * 0.5f;
+		for (uint32_t vert = 0; vert < chart.VertexCount; vert++) {
+			uint32_t vertex = chartVertices[chart.FirstVertex + vert];
+			result.Uvs[vertex] = (offset + (planar[vertex] - chart.Min) * scale) / static_cast<float>(LIGHTMAP_PACK_SIZE);
+		}
+	}
+
+	return result;
+}
+
+std::vector<LightmapBaker::Lightmap> LightmapBaker::Bake(const std::vector<Instance>& instances, const std::vector<Light>& lights, const Settings& settings) {
+	std::vector<Lightmap> result(instances.size());
+	uint32_t threadCount = settings.ThreadCount > 0 ? settings.ThreadCount : std::max(std::thread::hardware_concurrency(), 1u);
+
+	// Gather every instance's triangles in world space, so they can all shadow and bounce onto each other
+	std::vector<glm::vec3> worldPositions;
+	std::vector<uint32_t>  worldIndices;
+	std::vector<glm::vec3> worldNormals;
+	std::vector<uint32_t>  triangleInstance;
+	std::vector<uint32_t>  instanceFirstTriangle(instances.size());
+	for (size_t inst = 0; inst < instances.size(); inst++) {
+		const Instance& instance = instances[inst];
+		const LightmapUvs& uvs = *instance.Uvs;
+		uint32_t baseVertex = static_cast<uint32_t>(worldPositions.size());
+		instanceFirstTriangle[inst] = static_cast<uint32_t>(worldIndices.size() / 3);
+
+		for (uint32_t original : uvs.VertexRemap) {
+			worldPositions.push_back(glm::vec3(instance.Transform * glm::vec4((*instance.Positions)[original], 1.0f)));
+		}
+		for (size_t ix = 0; ix + 2 < uvs.Indices.size(); ix += 3) {
+			const glm::vec3& p0 = worldPositions[baseVertex + uvs.Indices[ix + 0]];
+			const glm::vec3& p1 = worldPositions[baseVertex + uvs.Indices[ix + 1]];
+			const glm::vec3& p2 = worldPositions[baseVertex + uvs.Indices[ix + 2]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			worldNormals.push_back(length > 0.0f ? normal / length : glm::vec3(0.0f));
+			triangleInstance.push_back(static_cast<uint32_t>(inst));
+			for (int corner = 0; corner < 3; corner++) {
+				worldIndices.push_back(baseVertex + uvs.Indices[ix + corner]);
+			}
+		}
+	}
+
+	TriangleBvh bvh;
+	bvh.Build(worldPositions, worldIndices);
+
+	// Rasterize every triangle into it's instance's lightmap to find where each texel is in the world. We use
+	// face normals, since we don't have anything better without the vertex layout
+	std::vector<LightmapTexelSample> samples;
+	for (size_t inst = 0; inst < instances.size(); inst++) {
+		const Instance& instance = instances[inst];
+		const LightmapUvs& uvs = *instance.Uvs;
+		Lightmap& lightmap = result[inst];
+		int res = static_cast<int>(std::max(instance.Resolution, 1u));
+		lightmap.Resolution = static_cast<uint32_t>(res);
+		lightmap.Texels.assign((size_t)res * res, glm::vec3(0.0f));
+		lightmap.Coverage.assign((size_t)res * res, 0);
+
+		uint32_t firstTri = instanceFirstTriangle[inst];
+		for (size_t tri = 0; tri * 3 + 2 < uvs.Indices.size(); tri++) {
+			glm::vec2 t0 = uvs.Uvs[uvs.Indices[tri * 3 + 0]] * (float)res;
+			glm::vec2 t1 = uvs.Uvs[uvs.Indices[tri * 3 + 1]] * (float)res;
+			glm::vec2 t2 = uvs.Uvs[uvs.Indices[tri * 3 + 2]] * (float)res;
+			float area = (t1.x - t0.x) * (t2.y - t0.y) - (t2.x - t0.x) * (t1.y - t0.y);
+			const glm::vec3& normal = worldNormals[firstTri + tri];
+			if (glm::abs(area) < 1e-8f || normal == glm::vec3(0.0f)) {
+				continue;
+			}
+
+			glm::ivec2 minTexel = glm::max(glm::ivec2(glm::floor(glm::min(t0, glm::min(t1, t2)))), glm::ivec2(0));
+			glm::ivec2 maxTexel = glm::min(glm::ivec2(glm::ceil(glm::max(t0, glm::max(t1, t2)))), glm::ivec2(res - 1));
+			const glm::vec3& p0 = worldPositions[worldIndices[(firstTri + tri) * 3 + 0]];
+			const glm::vec3& p1 = worldPositions[worldIndices[(firstTri + tri) * 3 + 1]];
+			const glm::vec3& p2 = worldPositions[worldIndices[(firstTri + tri) * 3 + 2]];
+
+			for (int y = minTexel.y; y <= maxTexel.y; y++) {
+				for (int x = minTexel.x; x <= maxTexel.x; x++) {
+					// Barycentrics of the texel's center
+					glm::vec2 p = glm::vec2(x + 0.5f, y + 0.5f);
+					float w1 = ((p.x - t0.x) * (t2.y - t0.y) - (t2.x - t0.x) * (p.y - t0.y)) / area;
+					float w2 = ((t1.x - t0.x) * (p.y - t0.y) - (p.x - t0.x) * (t1.y - t0.y)) / area;
+					float w0 = 1.0f - w1 - w2;
+					size_t texel = (size_t)y * res + x;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f || lightmap.Coverage[texel]) {
+						continue;
+					}
+					lightmap.Coverage[texel] = 1;
+
+					LightmapTexelSample sample;
+					sample.Position = p0 * w0 + p1 * w1 + p2 * w2;
+					sample.Normal = normal;
+					sample.Instance = static_cast<uint32_t>(inst);
+					sample.Texel = static_cast<uint32_t>(texel);
+					samples.push_back(sample);
+				}
+			}
+		}
+	}
+
+	// Direct lighting, matching the attenuation our deferred lights use
+	ThreadPool::Get().ParallelFor(samples.size(), LIGHTMAP_BAKE_CHUNK, threadCount, [&](size_t ix) {
+		const LightmapTexelSample& sample = samples[ix];
+		glm::vec3 origin = sample.Position + sample.Normal * settings.RayBias;
+		glm::vec3 total = glm::vec3(0.0f);
+		for (const Light& light : lights) {
+			glm::vec3 toLight = light.Position - sample.Position;
+			float distSq = glm::dot(toLight, toLight);
+			float dist = glm::sqrt(distSq);
+			if (dist <= 0.0f) {
+				continue;
+			}
+			glm::vec3 dir = toLight / dist;
+			float nDotL = glm::dot(sample.Normal, dir);
+			if (nDotL <= 0.0f) {
+				continue;
+			}
+			if (bvh.IsOccluded(origin, dir, dist - settings.RayBias)) {
+				continue;
+			}
+			float attenuation = 1.0f / (1.0f + light.Attenuation * distSq);
+			total += light.Color * (nDotL * attenuation * light.Intensity);
+		}
+		result[sample.Instance].Texels[sample.Texel] = total;
+	});
+
+	// Dilate far enough to cover the padding between charts
+	auto getDilatePasses = [](uint32_t resolution) {
+		return std::max(CHART_PADDING * resolution / MIN_RESOLUTION, 1u) + 1;
+	};
+
+	if (settings.BounceSamples > 0 && settings.BounceAlbedo > 0.0f) {
+		// Bounces look up the direct lighting wherever they land, so fill in the gaps around the charts first
+		// so that hits near the edge of a triangle don't pick up black
+		for (Lightmap& lightmap : result) {
+			DilateLightmap(lightmap, getDilatePasses(lightmap.Resolution));
+		}
+
+		std::vector<glm::vec3> indirect(samples.size());
+		ThreadPool::Get().ParallelFor(samples.size(), LIGHTMAP_BAKE_CHUNK, threadCount, [&](size_t ix) {
+			const LightmapTexelSample& sample = samples[ix];
+			glm::vec3 tangent, bitangent;
+			MakeBasis(sample.Normal, tangent, bitangent);
+			glm::vec3 origin = sample.Position + sample.Normal * settings.RayBias;
+			uint32_t rng = LightmapHash(static_cast<uint32_t>(ix) * 9781u + 1u);
+
+			// With cosine weighted directions, the average radiance of the rays is the irradiance / pi
+			glm::vec3 total = glm::vec3(0.0f);
+			for (uint32_t ray = 0; ray < settings.BounceSamples; ray++) {
+				float r1 = LightmapRandom(rng);
+				float r2 = LightmapRandom(rng);
+				float phi = 2.0f * glm::pi<float>() * r1;
+				float radius = glm::sqrt(r2);
+				glm::vec3 dir = tangent * (radius * glm::cos(phi)) + bitangent * (radius * glm::sin(phi)) + sample.Normal * glm::sqrt(1.0f - r2);
+
+				TriangleBvh::Hit hit;
+				if (!bvh.Intersect(origin, dir, settings.BounceDistance, hit)) {
+					continue;
+				}
+				// The back sides of surfaces aren't lit, so they only block light
+				if (glm::dot(worldNormals[hit.Triangle], dir) > 0.0f) {
+					continue;
+				}
+
+				uint32_t hitInstance = triangleInstance[hit.Triangle];
+				const LightmapUvs& uvs = *instances[hitInstance].Uvs;
+				const Lightmap& hitMap = result[hitInstance];
+				size_t local = hit.Triangle - instanceFirstTriangle[hitInstance];
+				glm::vec2 uv =
+					uvs.Uvs[uvs.Indices[local * 3 + 0]] * (1.0f - hit.Barycentric.x - hit.Barycentric.y) +
+					uvs.Uvs[uvs.Indices[local * 3 + 1]] * hit.Barycentric.x +
+					uvs.Uvs[uvs.Indices[local * 3 + 2]] * hit.Barycentric.y;
+				glm::ivec2 texel = glm::clamp(glm::ivec2(uv * (float)hitMap.Resolution), glm::ivec2(0), glm::ivec2((int)hitMap.Resolution - 1));
+				total += hitMap.Texels[(size_t)texel.y * hitMap.Resolution + texel.x];
+			}
+			indirect[ix] = total * (settings.BounceAlbedo / settings.BounceSamples);
+		});
+
+		for (size_t ix = 0; ix < samples.size(); ix++) {
+			result[samples[ix].Instance].Texels[samples[ix].Texel] += indirect[ix];
+		}
+	}
+
+	// Re-fill the gaps from the final covered texels
+	for (Lightmap& lightmap : result) {
+		DilateLightmap(lightmap, getDilatePasses(lightmap.Resolution));
+	}
+
+	return result;
+}
+
+bool LightmapBaker::SaveLightmap(const std::string& path, const Lightmap& lightmap) {
+	uint32_t res = lightmap.Resolution;
+	if (res == 0 || lightmap.Texels.size() < (size_t)res * res) {
+		return false;
+	}
+
+	// Our texture loader flips images on load, so rows are written top down to end up with row 0 at v = 0
+	std::vector<uint8_t> pixels((size_t)res * res * 4);
+	for (uint32_t y = 0; y < res; y++) {
+		for (uint32_t x = 0; x < res; x++) {
+			glm::vec3 color = glm::max(lightmap.Texels[(size_t)y * res + x], glm::vec3(0.0f)) / RGBM_RANGE;
+			// Round the multiplier up so that the color never needs to go above 1
+			float m = glm::clamp(glm::max(glm::max(color.r, color.g), glm::max(color.b, 1e-6f)), 0.0f, 1.0f);
+			m = glm::ceil(m * 255.0f) / 255.0f;
+			glm::vec3 rgb = glm::clamp(color / m, 0.0f, 1.0f);
+
+			uint8_t* pixel = &pixels[((size_t)(res - 1 - y) * res + x) * 4];
+			pixel[0] = static_cast<uint8_t>(rgb.r * 255.0f + 0.5f);
+			pixel[1] = static_cast<uint8_t>(rgb.g * 255.0f + 0.5f);
+			pixel[2] = static_cast<uint8_t>(rgb.b * 255.0f + 0.5f);
+			pixel[3] = static_cast<uint8_t>(m * 255.0f + 0.5f);
+		}
+	}
+
+	return stbi_write_png(path.c_str(), res, res, 4, pixels.data(), res * 4) != 0;
+}
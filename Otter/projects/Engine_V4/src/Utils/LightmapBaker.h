@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// A second set of texture coordinates for a mesh, where every triangle gets it's own non-overlapping
+/// space in the texture so that lighting can be stored for it (a lightmap).
+///
+/// Unwrapping splits the mesh into charts along sharp edges, so vertices that sit on the border between
+/// charts need a copy for each chart. The original vertices keep their indices, and copies are added to
+/// the end, so index buffers that only use the original vertices (ex: lower LODs) still work
+/// </summary>
+struct LightmapUvs {
+	// For each vertex of the unwrapped mesh, the index of the original vertex it was copied from
+	std::vector<uint32_t>  VertexRemap;
+	// The lightmap coordinates of each vertex of the unwrapped mesh, between 0 and 1
+	std::vector<glm::vec2> Uvs;
+	// The triangle list for the unwrapped mesh, in the same order as the original triangles
+	std::vector<uint32_t>  Indices;
+};
+
+/// <summary>
+/// Bakes direct and single bounce indirect lighting from static lights into lightmaps, by tracing rays against
+/// the static geometry on the CPU. None of this touches OpenGL, so bakes can run on worker threads or in a tool
+/// without a window, see Gameplay::Lightmapper for baking a scene
+/// </summary>
+class LightmapBaker
+{
+public:
+	/// <summary>
+	/// The settings for a bake
+	/// </summary>
+	struct Settings {
+		// The number of threads to bake with, 0 to use one per hardware thread
+		uint32_t ThreadCount;
+		// The number of rays to trace from each texel when gathering bounced light, 0 to only bake direct light
+		uint32_t BounceSamples;
+		// The fraction of bounced light that surfaces reflect, we don't know material colors on the CPU so this is the same for everything
+		float    BounceAlbedo;
+		// How far to push rays off of surfaces, to stop them from hitting the surface they start on
+		float    RayBias;
+		// The furthest that bounced light is gathered from
+		float    BounceDistance;
+
+		Settings() :
+			ThreadCount(0),
+			BounceSamples(64),
+			BounceAlbedo(0.5f),
+			RayBias(0.01f),
+			BounceDistance(50.0f)
+		{ }
+	};
+
+	/// <summary>
+	/// A point light to bake, lit the same way as our deferred point lights
+	/// </summary>
+	struct Light {
+		glm::vec3 Position;
+		glm::vec3 Color;
+		float     Intensity;
+		// The quadratic attenuation factor, see RenderLayer::_AccumulateLighting
+		float     Attenuation;
+	};
+
+	/// <summary>
+	/// An object to bake a lightmap for. Every instance also casts shadows and bounces light onto the others
+	/// </summary>
+	struct Instance {
+		// The mesh space positions of the mesh's original vertices
+		const std::vector<glm::vec3>* Positions;
+		// The unwrapped mesh, from GenerateUvs
+		const LightmapUvs*            Uvs;
+		// The transform from mesh to world space
+		glm::mat4                     Transform;
+		// The width and height of this instance's lightmap in texels
+		uint32_t                      Resolution;
+	};
+
+	/// <summary>
+	/// The baked lighting for a single instance, in linear RGB with one texel per Resolution^2
+	/// </summary>
+	struct Lightmap {
+		uint32_t               Resolution;
+		std::vector<glm::vec3> Texels;
+		// True for texels that are covered by a triangle, the rest are filled in from their neighbours
+		std::vector<uint8_t>   Coverage;
+	};
+
+	// The resolution that chart padding is calculated for, lightmaps smaller than this may bleed between charts
+	static const uint32_t MIN_RESOLUTION = 128;
+	// The padding between charts, in texels at MIN_RESOLUTION
+	static const uint32_t CHART_PADDING = 2;
+	// The range that lightmap colors are encoded into when saving as RGBM, see SaveLightmap
+	static constexpr float RGBM_RANGE = 8.0f;
+
+	/// <summary>
+	/// Unwraps a mesh into lightmap coordinates. Triangles are grouped into charts by flood filling across shared edges
+	/// while their normals stay close to the chart's, each chart is projected onto it's average plane, and then all the
+	/// charts are packed into the unit square, scaled so that texel density is the same everywhere
+	/// </summary>
+	/// <param name="positions">The mesh space positions of the mesh's vertices</param>
+	/// <param name="indices">The triangle list of the mesh</param>
+	/// <param name="maxChartAngle">The largest angle (in degrees) a triangle's normal can have from it's chart's normal</param>
+	static LightmapUvs GenerateUvs(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, float maxChartAngle = 45.0f);
+
+	/// <summary>
+	/// Bakes lightmaps for a set of instances. Direct lighting (with shadows) is baked for every instance first, then
+	/// if bouncing is enabled, each texel gathers light from the direct lighting of whatever it can see
+	/// </summary>
+	/// <returns>A lightmap for each instance, in the same order</returns>
+	static std::vector<Lightmap> Bake(const std::vector<Instance>& instances, const std::vector<Light>& lights, const Settings& settings = Settings());
+
+	/// <summary>
+	/// Saves a lightmap as an RGBM encoded PNG, where the color is rgb * a * RGBM_RANGE
+	/// </summary>
+	/// <returns>True if the file was written</returns>
+	static bool SaveLightmap(const std::string& path, const Lightmap& lightmap);
+
+protected:
+	LightmapBaker() = default;
+	~LightmapBaker() = default;
+};
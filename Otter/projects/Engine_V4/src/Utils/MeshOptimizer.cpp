@@ -0,0 +1,286 @@
+#include "Utils/MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "Logging.h"
+
+// Simulates a single vertex going through a FIFO cache, where a vertex is in the cache if fewer than
+// cacheSize misses have happened since it was last loaded. Returns true if the vertex was a miss
+inline bool SimulateCacheVertex(uint32_t vertex, std::vector<uint32_t>& cacheTimes, uint32_t& time, int cacheSize) {
+	if (time - cacheTimes[vertex] > (uint32_t)cacheSize) {
+		cacheTimes[vertex] = time++;
+		return true;
+	}
+	return false;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+	// This is an implementation of Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+	// by Sander, Nehab and Barczak. We fan around a vertex emitting all of it's triangles, then pick the next vertex
+	// to fan around based on what is still likely to be in the cache
+	std::vector<uint32_t> clusters;
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return clusters;
+	}
+
+	// Build a vertex -> triangle adjacency list, liveCount tracks how many un-emitted triangles each vertex has
+	std::vector<uint32_t> liveCount(vertexCount, 0);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		liveCount[indices[ix]]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	std::partial_sum(liveCount.begin(), liveCount.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+			adjacency[fill[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+		}
+	}
+
+	std::vector<uint32_t> cacheTimes(vertexCount, 0);
+	std::vector<uint8_t>  emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+	int64_t  fanVertex = 0;
+
+	// The first cluster always starts at the first triangle
+	clusters.push_back(0);
+
+	while (fanVertex >= 0) {
+		candidates.clear();
+
+		// Emit all the live triangles around our fanning vertex
+		for (uint32_t ix = offsets[fanVertex]; ix < offsets[fanVertex + 1]; ix++) {
+			uint32_t tri = adjacency[ix];
+			if (emitted[tri]) {
+				continue;
+			}
+			for (int v = 0; v < 3; v++) {
+				uint32_t vertex = indices[tri * 3 + v];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveCount[vertex]--;
+				SimulateCacheVertex(vertex, cacheTimes, time, cacheSize);
+			}
+			emitted[tri] = 1;
+		}
+
+		// Pick the candidate that will still be in the cache after emitting all of it's triangles,
+		// preferring the one that's been in the cache the longest
+		int64_t next = -1;
+		int bestPriority = -1;
+		for (uint32_t vertex : candidates) {
+			if (liveCount[vertex] == 0) {
+				continue;
+			}
+			int priority = 0;
+			if ((int)(time - cacheTimes[vertex]) + 2 * (int)liveCount[vertex] <= cacheSize) {
+				priority = time - cacheTimes[vertex];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		// We've hit a dead end, try our recently used vertices first, then fall back to scanning the mesh
+		if (next == -1) {
+			while (!deadEnds.empty() && next == -1) {
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveCount[vertex] > 0) {
+					next = vertex;
+				}
+			}
+			while (next == -1 && cursor < vertexCount) {
+				if (liveCount[cursor] > 0) {
+					next = cursor;
+				}
+				cursor++;
+			}
+
+			// Jumping to a new part of the mesh is a hard boundary between clusters
+			if (next != -1 && result.size() / 3 < triangleCount) {
+				clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+			}
+		}
+
+		fanVertex = next;
+	}
+
+	// Drop any duplicate boundaries (ex: a dead end that was resolved without emitting anything)
+	clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+
+	// Keep any trailing indices that don't make a full triangle, so we never lose data
+	result.insert(result.end(), indices.begin() + triangleCount * 3, indices.end());
+	indices.swap(result);
+	return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& clusters, float threshold, int cacheSize) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusters.empty()) {
+		return;
+	}
+
+	// Hard boundaries usually leave us with a handful of huge clusters, so we split them further at points where
+	// starting with a cold cache doesn't push the cluster's ACMR above the threshold (soft boundaries)
+	// Rather than clearing the cache between runs, we push time forward so every entry is stale
+	std::vector<uint32_t> cacheTimes(positions.size(), 0);
+	std::vector<uint32_t> splits;
+	uint32_t time = cacheSize + 1;
+	for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+		uint32_t start = clusters[cluster];
+		uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : static_cast<uint32_t>(triangleCount);
+
+		// Determine the ACMR of the cluster as a whole
+		time += cacheSize + 1;
+		uint32_t misses = 0;
+		for (uint32_t tri = start; tri < end; tri++) {
+			for (int v = 0; v < 3; v++) {
+				misses += SimulateCacheVertex(indices[tri * 3 + v], cacheTimes, time, cacheSize) ? 1 : 0;
+			}
+		}
+		float clusterACMR = (float)misses / (float)(end - start);
+
+		// Walk the cluster again, splitting once the running ACMR has settled close to the cluster's
+		splits.push_back(start);
+		time += cacheSize + 1;
+		misses = 0;
+		uint32_t subStart = start;
+		for (uint32_t tri = start; tri < end; tri++) {
+			for (int v = 0; v < 3; v++) {
+				misses += SimulateCacheVertex(indices[tri * 3 + v], cacheTimes, time, cacheSize) ? 1 : 0;
+			}
+			if (tri + 1 < end && (float)misses / (float)(tri + 1 - subStart) <= clusterACMR * threshold) {
+				splits.push_back(tri + 1);
+				subStart = tri + 1;
+				misses = 0;
+				// Start the next cluster with a cold cache, since it may end up anywhere in the draw order
+				time += cacheSize + 1;
+			}
+		}
+	}
+
+	// Calculate the center of the mesh, weighted by triangle area
+	glm::dvec3 meshCenter = glm::dvec3(0.0);
+	double meshArea = 0.0;
+	for (size_t tri = 0; tri < triangleCount; tri++) {
+		const glm::vec3& p0 = positions[indices[tri * 3 + 0]];
+		const glm::vec3& p1 = positions[indices[tri * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[tri * 3 + 2]];
+		double area = glm::length(glm::cross(p1 - p0, p2 - p0));
+		meshCenter += glm::dvec3(p0 + p1 + p2) * (area / 3.0);
+		meshArea += area;
+	}
+	meshCenter = meshArea > 0.0 ? meshCenter / meshArea : meshCenter;
+
+	// Score each cluster by how far it's center is in front of the mesh's center, along the cluster's normal.
+	// Clusters that face outwards from the mesh are likely to occlude the rest of it, so they should draw first
+	struct ClusterSort {
+		uint32_t Start;
+		uint32_t End;
+		float    Score;
+	};
+	std::vector<ClusterSort> sorted(splits.size());
+	for (size_t ix = 0; ix < splits.size(); ix++) {
+		ClusterSort& sort = sorted[ix];
+		sort.Start = splits[ix];
+		sort.End = ix + 1 < splits.size() ? splits[ix + 1] : static_cast<uint32_t>(triangleCount);
+
+		glm::dvec3 center = glm::dvec3(0.0);
+		glm::dvec3 normal = glm::dvec3(0.0);
+		double area = 0.0;
+		for (uint32_t tri = sort.Start; tri < sort.End; tri++) {
+			const glm::vec3& p0 = positions[indices[tri * 3 + 0]];
+			const glm::vec3& p1 = positions[indices[tri * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[tri * 3 + 2]];
+			glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+			double triArea = glm::length(cross);
+			center += glm::dvec3(p0 + p1 + p2) * (triArea / 3.0);
+			normal += cross;
+			area += triArea;
+		}
+		center = area > 0.0 ? center / area : center;
+		double normalLength = glm::length(normal);
+		normal = normalLength > 0.0 ? normal / normalLength : normal;
+
+		sort.Score = static_cast<float>(glm::dot(center - meshCenter, normal));
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const ClusterSort& l, const ClusterSort& r) {
+		return l.Score > r.Score;
+	});
+
+	// Rebuild the index list in our new cluster order
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const ClusterSort& cluster : sorted) {
+		result.insert(result.end(), indices.begin() + cluster.Start * 3, indices.begin() + cluster.End * 3);
+	}
+	result.insert(result.end(), indices.begin() + triangleCount * 3, indices.end());
+	indices.swap(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const uint32_t UNASSIGNED = ~0u;
+	std::vector<uint32_t> remap(vertexCount, UNASSIGNED);
+
+	// Hand out new indices in the order that vertices are first used
+	uint32_t next = 0;
+	for (uint32_t& index : indices) {
+		if (remap[index] == UNASSIGNED) {
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+
+	// Any vertices that were never used get pushed to the back of the buffer
+	for (uint32_t& entry : remap) {
+		if (entry == UNASSIGNED) {
+			entry = next++;
+		}
+	}
+
+	return remap;
+}
+
+float MeshOptimizer::CalculateACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return 0.0f;
+	}
+
+	std::vector<uint32_t> cacheTimes(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		misses += SimulateCacheVertex(indices[ix], cacheTimes, time, cacheSize) ? 1 : 0;
+	}
+	return (float)misses / (float)triangleCount;
+}
+
+std::vector<uint32_t> MeshOptimizer::Optimize(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::string& debugName) {
+	float acmrBefore = CalculateACMR(indices, positions.size());
+
+	std::vector<uint32_t> clusters = OptimizeVertexCache(indices, positions.size());
+	float acmrCache = CalculateACMR(indices, positions.size());
+
+	OptimizeOverdraw(indices, positions, clusters);
+	float acmrAfter = CalculateACMR(indices, positions.size());
+
+	std::vector<uint32_t> remap = OptimizeVertexFetch(indices, positions.size());
+
+	LOG_TRACE("Optimized mesh \"{}\" ({} triangles), ACMR {:.3f} -> {:.3f} (cache) -> {:.3f} (overdraw)",
+			  debugName.empty() ? "unnamed" : debugName, indices.size() / 3, acmrBefore, acmrCache, acmrAfter);
+
+	return remap;
+}
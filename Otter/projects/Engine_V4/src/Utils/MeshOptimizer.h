@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "Utils/MeshBuilder.h"
+
+/// <summary>
+/// Provides tools for reordering mesh data so that it renders faster on the GPU. None of these
+/// functions touch OpenGL, so they can be run at load time, while cooking assets, or in isolation
+///
+/// Optimization happens in three stages:
+///   - Triangles are reordered for post-transform vertex cache hits using Tipsify
+///   - Clusters of triangles are sorted so that outward facing clusters draw first, reducing overdraw
+///   - Vertices are reordered so they are fetched in the order they are first used
+/// </summary>
+class MeshOptimizer
+{
+public:
+	// The number of entries in the FIFO vertex cache we optimize for and simulate
+	static const int DEFAULT_CACHE_SIZE = 16;
+
+	/// <summary>
+	/// Reorders triangles in an index list to improve post-transform vertex cache hits
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder in place</param>
+	/// <param name="vertexCount">The number of vertices referenced by the triangle list</param>
+	/// <param name="cacheSize">The size of the vertex cache to optimize for</param>
+	/// <returns>The offsets (in triangles) of the start of each cluster that the triangles were emitted in</returns>
+	static std::vector<uint32_t> OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = DEFAULT_CACHE_SIZE);
+
+	/// <summary>
+	/// Sorts the clusters of a cache optimized triangle list so that clusters facing away from the center
+	/// of the mesh draw first, allowing early depth testing to reject more of the clusters behind them
+	/// </summary>
+	/// <param name="indices">The triangle list to reorder in place, should have been run through OptimizeVertexCache</param>
+	/// <param name="positions">The positions of all vertices in the mesh</param>
+	/// <param name="clusters">The cluster offsets returned from OptimizeVertexCache</param>
+	/// <param name="threshold">How much worse than the original ACMR we're willing to go to get smaller clusters</param>
+	/// <param name="cacheSize">The size of the vertex cache to optimize for</param>
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& clusters, float threshold = 1.05f, int cacheSize = DEFAULT_CACHE_SIZE);
+
+	/// <summary>
+	/// Renumbers vertices in the order they are first referenced by the triangle list, so that vertex
+	/// fetches walk through memory linearly. Unreferenced vertices are moved to the end of the buffer
+	/// </summary>
+	/// <param name="indices">The triangle list to renumber in place</param>
+	/// <param name="vertexCount">The number of vertices in the mesh</param>
+	/// <returns>A table mapping old vertex indices to new ones, for use with RemapVertices</returns>
+	static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// Reorders a vertex array using a remap table from OptimizeVertexFetch
+	/// </summary>
+	template <typename T>
+	static void RemapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap);
+
+	/// <summary>
+	/// Calculates the average cache miss ratio (vertex shader invocations per triangle) of a triangle
+	/// list by simulating a FIFO vertex cache. 3.0 is the worst case, ~0.5 is the best a mesh can do
+	/// </summary>
+	/// <param name="indices">The triangle list to simulate</param>
+	/// <param name="vertexCount">The number of vertices referenced by the triangle list</param>
+	/// <param name="cacheSize">The size of the vertex cache to simulate</param>
+	static float CalculateACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = DEFAULT_CACHE_SIZE);
+
+	/// <summary>
+	/// Runs all optimization stages on an index list, and reports the ACMR before and after
+	/// </summary>
+	/// <param name="indices">The triangle list to optimize in place</param>
+	/// <param name="positions">The positions of all vertices in the mesh</param>
+	/// <param name="debugName">A name for the mesh to include in the log output</param>
+	/// <returns>A table mapping old vertex indices to new ones, for use with RemapVertices</returns>
+	static std::vector<uint32_t> Optimize(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, const std::string& debugName = "");
+
+	/// <summary>
+	/// Runs all optimization stages on a mesh builder, reordering both it's indices and vertices
+	/// </summary>
+	/// <param name="mesh">The mesh to optimize</param>
+	/// <param name="debugName">A name for the mesh to include in the log output</param>
+	template <typename VertType>
+	static void Optimize(MeshBuilder<VertType>& mesh, const std::string& debugName = "");
+
+protected:
+	MeshOptimizer() = default;
+	~MeshOptimizer() = default;
+};
+
+template <typename T>
+void MeshOptimizer::RemapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap) {
+	std::vector<T> result(vertices.size());
+	for (size_t ix = 0; ix < vertices.size(); ix++) {
+		result[remap[ix]] = vertices[ix];
+	}
+	vertices.swap(result);
+}
+
+template <typename VertType>
+void MeshOptimizer::Optimize(MeshBuilder<VertType>& mesh, const std::string& debugName) {
+	// Nothing to reorder for non-indexed meshes
+	if (mesh._indices.empty()) {
+		return;
+	}
+
+	std::vector<glm::vec3> positions(mesh._vertices.size());
+	for (size_t ix = 0; ix < positions.size(); ix++) {
+		positions[ix] = mesh._vertices[ix].Position;
+	}
+
+	std::vector<uint32_t> remap = Optimize(mesh._indices, positions, debugName);
+	RemapVertices(mesh._vertices, remap);
+}
@@ -0,0 +1,60 @@
+#include "Utils/MeshQuantizer.h"
+
+#include <GLM/gtc/packing.hpp>
+
+VertexQuantized MeshQuantizer::QuantizeVertex(const VertexPosNormTexColTangents& vertex, const glm::vec3& scale, const glm::vec3& offset) {
+	VertexQuantized result;
+
+	// Map our position into the 0-1 range of the bounding box, then into the full range of a ushort
+	glm::vec3 normalized = glm::clamp((vertex.Position - offset) / scale, glm::vec3(0.0f), glm::vec3(1.0f));
+	result.Position = glm::u16vec4(glm::round(normalized * 65535.0f), 0);
+
+	// Vectors are packed into 10 bits per component, the 2 bit W is unused
+	result.Normal    = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+	result.Tangent   = glm::packSnorm3x10_1x2(glm::vec4(vertex.Tangent, 0.0f));
+	result.BiTangent = glm::packSnorm3x10_1x2(glm::vec4(vertex.BiTangent, 0.0f));
+
+	result.UV    = glm::packHalf2x16(vertex.UV);
+	result.Color = glm::packUnorm4x8(vertex.Color);
+
+	return result;
+}
+
+void MeshQuantizer::Quantize(const MeshBuilder<VertexPosNormTexColTangents>& mesh, MeshBuilder<VertexQuantized>& outMesh, glm::vec3& outScale, glm::vec3& outOffset) {
+	const VertexPosNormTexColTangents* vertices = mesh.GetVertexDataPtr();
+	const size_t vertexCount = mesh.GetVertexCount();
+
+	// Find the bounding box that we'll quantize positions to
+	glm::vec3 boundsMin = vertexCount > 0 ? vertices[0].Position : glm::vec3(0.0f);
+	glm::vec3 boundsMax = boundsMin;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		boundsMin = glm::min(boundsMin, vertices[ix].Position);
+		boundsMax = glm::max(boundsMax, vertices[ix].Position);
+	}
+
+	// Avoid dividing by zero for flat meshes (ex: planes)
+	outOffset = boundsMin;
+	outScale = glm::max(boundsMax - boundsMin, glm::vec3(0.0001f));
+
+	outMesh.ReserveVertexSpace(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		outMesh.AddVertex(QuantizeVertex(vertices[ix], outScale, outOffset));
+	}
+
+	const uint32_t* indices = mesh.GetIndexDataPtr();
+	outMesh.ReserveIndexSpace(mesh.GetIndexCount());
+	for (size_t ix = 0; ix < mesh.GetIndexCount(); ix++) {
+		outMesh.AddIndex(indices[ix]);
+	}
+}
+
+VertexArrayObject::Sptr MeshQuantizer::Bake(const MeshBuilder<VertexPosNormTexColTangents>& mesh) {
+	MeshBuilder<VertexQuantized> quantized;
+	glm::vec3 scale, offset;
+	Quantize(mesh, quantized, scale, offset);
+
+	// The mesh builder will let the index buffer pick 16 bit indices for us
+	VertexArrayObject::Sptr result = quantized.Bake();
+	result->SetPositionDequantization(scale, offset);
+	return result;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <GLM/glm.hpp>
+
+#include "Graphics/VertexTypes.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Utils/MeshBuilder.h"
+
+/// <summary>
+/// Provides tools for converting full precision meshes into the compact VertexQuantized format
+/// </summary>
+class MeshQuantizer
+{
+public:
+	/// <summary>
+	/// Converts a full precision mesh into a quantized one, copying over the indices as-is
+	/// </summary>
+	/// <param name="mesh">The full precision mesh to convert</param>
+	/// <param name="outMesh">The mesh builder to add quantized vertices and indices to</param>
+	/// <param name="outScale">Will receive the scale needed to decode positions (see VertexArrayObject::SetPositionDequantization)</param>
+	/// <param name="outOffset">Will receive the offset needed to decode positions</param>
+	static void Quantize(const MeshBuilder<VertexPosNormTexColTangents>& mesh, MeshBuilder<VertexQuantized>& outMesh, glm::vec3& outScale, glm::vec3& outOffset);
+
+	/// <summary>
+	/// Quantizes a full precision mesh and uploads it to OpenGL, the returned VAO will be set up to
+	/// decode it's positions. Indices will be stored as 16 bit if possible
+	/// </summary>
+	/// <param name="mesh">The full precision mesh to bake</param>
+	/// <returns>A VAO using the VertexQuantized format</returns>
+	static VertexArrayObject::Sptr Bake(const MeshBuilder<VertexPosNormTexColTangents>& mesh);
+
+	/// <summary>
+	/// Quantizes a single vertex
+	/// </summary>
+	/// <param name="vertex">The vertex to quantize</param>
+	/// <param name="scale">The size of the box to quantize the position to</param>
+	/// <param name="offset">The minimum corner of the box to quantize the position to</param>
+	static VertexQuantized QuantizeVertex(const VertexPosNormTexColTangents& vertex, const glm::vec3& scale, const glm::vec3& offset);
+
+protected:
+	MeshQuantizer() = default;
+	~MeshQuantizer() = default;
+};
@@ -0,0 +1,305 @@
+#include "Utils/MeshSimplifier.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "Utils/MeshOptimizer.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <GLM/gtx/hash.hpp>
+
+MeshSimplifier::Quadric MeshSimplifier::Quadric::FromPlane(const glm::vec3& n, float d, double weight) {
+	Quadric result;
+	result.A2 = n.x * n.x * weight; result.AB = n.x * n.y * weight; result.AC = n.x * n.z * weight; result.AD = n.x * d * weight;
+	result.B2 = n.y * n.y * weight; result.BC = n.y * n.z * weight; result.BD = n.y * d * weight;
+	result.C2 = n.z * n.z * weight; result.CD = n.z * d * weight;
+	result.D2 = (double)d * d * weight;
+	result.Weight = weight;
+	return result;
+}
+
+MeshSimplifier::Quadric& MeshSimplifier::Quadric::operator +=(const Quadric& other) {
+	A2 += other.A2; AB += other.AB; AC += other.AC; AD += other.AD;
+	B2 += other.B2; BC += other.BC; BD += other.BD;
+	C2 += other.C2; CD += other.CD;
+	D2 += other.D2;
+	Weight += other.Weight;
+	return *this;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const glm::vec3& p) const {
+	// v^T * Q * v, expanded out for our symmetric matrix
+	double result =
+		A2 * p.x * p.x + 2 * AB * p.x * p.y + 2 * AC * p.x * p.z + 2 * AD * p.x +
+		B2 * p.y * p.y + 2 * BC * p.y * p.z + 2 * BD * p.y +
+		C2 * p.z * p.z + 2 * CD * p.z +
+		D2;
+	return Weight > 0.0 ? std::abs(result) / Weight : 0.0;
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<uint32_t>& indices,
+	size_t targetIndexCount,
+	float targetError,
+	float* resultError)
+{
+	std::vector<uint32_t> result = indices;
+	double maxErrorSq = 0.0;
+	const double targetErrorSq = (double)targetError * targetError;
+	const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+
+	if (result.size() <= targetIndexCount || vertexCount == 0) {
+		if (resultError) { *resultError = 0.0f; }
+		return result;
+	}
+
+	// Group vertices that share a position (they've been split for UVs or normals), each vertex
+	// maps to the first vertex that shares it's position
+	std::vector<uint32_t> positionGroup(vertexCount);
+	std::vector<uint32_t> groupSize(vertexCount, 0);
+	{
+		std::unordered_map<glm::vec3, uint32_t> firstWithPosition;
+		firstWithPosition.reserve(vertexCount);
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			auto it = firstWithPosition.emplace(positions[ix], ix).first;
+			positionGroup[ix] = it->second;
+			groupSize[it->second]++;
+		}
+	}
+
+	// Count how many triangles use each edge (by position) so we can find open borders
+	std::vector<uint8_t> lockedGroup(vertexCount, 0);
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		edgeUses.reserve(result.size());
+		for (size_t ix = 0; ix + 2 < result.size(); ix += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = positionGroup[result[ix + e]];
+				uint32_t b = positionGroup[result[ix + (e + 1) % 3]];
+				uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+				edgeUses[key]++;
+			}
+		}
+		// Any edge that isn't shared by exactly 2 triangles is a border (or non-manifold), lock it in place
+		for (const auto& [key, uses] : edgeUses) {
+			if (uses != 2) {
+				lockedGroup[key >> 32] = 1;
+				lockedGroup[key & 0xFFFFFFFF] = 1;
+			}
+		}
+		// Vertices on seams are locked as well, otherwise collapsing one side would tear the seam open
+		for (uint32_t ix = 0; ix < vertexCount; ix++) {
+			if (groupSize[ix] > 1) {
+				lockedGroup[ix] = 1;
+			}
+		}
+	}
+
+	// Accumulate the plane of every triangle into it's vertices
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t ix = 0; ix + 2 < result.size(); ix += 3) {
+		const glm::vec3& p0 = positions[result[ix + 0]];
+		const glm::vec3& p1 = positions[result[ix + 1]];
+		const glm::vec3& p2 = positions[result[ix + 2]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length <= 0.0f) {
+			continue;
+		}
+		normal /= length;
+		Quadric q = Quadric::FromPlane(normal, -glm::dot(normal, p0), length * 0.5);
+		quadrics[result[ix + 0]] += q;
+		quadrics[result[ix + 1]] += q;
+		quadrics[result[ix + 2]] += q;
+	}
+
+	struct Collapse {
+		uint32_t From;
+		uint32_t To;
+		double   Cost;
+	};
+
+	std::vector<Collapse>  collapses;
+	std::vector<uint8_t>   touched(vertexCount);
+	std::vector<uint32_t>  remap(vertexCount);
+	std::vector<uint32_t>  adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t>  adjacency;
+
+	while (result.size() > targetIndexCount) {
+		// Build a vertex -> triangle adjacency list for the current triangles
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : result) {
+			adjacencyOffsets[index + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(result.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t ix = 0; ix < result.size(); ix++) {
+				adjacency[fill[result[ix]]++] = static_cast<uint32_t>(ix / 3);
+			}
+		}
+
+		// Find the cheapest collapse for every vertex that is allowed to move
+		collapses.clear();
+		for (size_t ix = 0; ix + 2 < result.size(); ix += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = result[ix + e];
+				uint32_t b = result[ix + (e + 1) % 3];
+				for (int dir = 0; dir < 2; dir++) {
+					uint32_t from = dir == 0 ? a : b;
+					uint32_t to   = dir == 0 ? b : a;
+					if (lockedGroup[positionGroup[from]]) {
+						continue;
+					}
+					Quadric q = quadrics[from];
+					q += quadrics[to];
+					collapses.push_back({ from, to, q.Evaluate(positions[to]) });
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) {
+			return l.Cost < r.Cost;
+		});
+
+		// Each collapse removes ~2 triangles, we only do a portion of what's needed each pass so that
+		// later decisions are made with up to date quadrics
+		size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t collapseBudget = std::max<size_t>(trianglesToRemove / 2, 1);
+		size_t performed = 0;
+
+		std::fill(touched.begin(), touched.end(), 0);
+		std::iota(remap.begin(), remap.end(), 0);
+
+		for (const Collapse& collapse : collapses) {
+			if (collapse.Cost > targetErrorSq || performed >= collapseBudget) {
+				break;
+			}
+			if (touched[collapse.From] || touched[collapse.To]) {
+				continue;
+			}
+			if (_CausesFlip(positions, result, adjacencyOffsets, adjacency, collapse.From, collapse.To)) {
+				continue;
+			}
+
+			remap[collapse.From] = collapse.To;
+			quadrics[collapse.To] += quadrics[collapse.From];
+			maxErrorSq = std::max(maxErrorSq, collapse.Cost);
+			performed++;
+
+			// Everything around the collapsed vertex is changing, don't touch it again this pass
+			for (uint32_t ix = adjacencyOffsets[collapse.From]; ix < adjacencyOffsets[collapse.From + 1]; ix++) {
+				uint32_t tri = adjacency[ix];
+				touched[result[tri * 3 + 0]] = 1;
+				touched[result[tri * 3 + 1]] = 1;
+				touched[result[tri * 3 + 2]] = 1;
+			}
+		}
+
+		if (performed == 0) {
+			break;
+		}
+
+		// Apply our collapses and strip out any triangles that have become degenerate
+		size_t writeIx = 0;
+		for (size_t ix = 0; ix + 2 < result.size(); ix += 3) {
+			uint32_t a = remap[result[ix + 0]];
+			uint32_t b = remap[result[ix + 1]];
+			uint32_t c = remap[result[ix + 2]];
+			if (a != b && b != c && a != c) {
+				result[writeIx++] = a;
+				result[writeIx++] = b;
+				result[writeIx++] = c;
+			}
+		}
+		result.resize(writeIx);
+	}
+
+	if (resultError) {
+		*resultError = static_cast<float>(std::sqrt(maxErrorSq));
+	}
+	return result;
+}
+
+std::vector<std::vector<uint32_t>> MeshSimplifier::GenerateLods(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<uint32_t>& indices,
+	int levels)
+{
+	std::vector<std::vector<uint32_t>> result;
+	if (positions.empty() || indices.size() < 3) {
+		return result;
+	}
+
+	// We scale our allowed error by the size of the mesh, so that small and large meshes behave the same
+	glm::vec3 boundsMin = positions[0];
+	glm::vec3 boundsMax = positions[0];
+	for (const glm::vec3& pos : positions) {
+		boundsMin = glm::min(boundsMin, pos);
+		boundsMax = glm::max(boundsMax, pos);
+	}
+	float extent = glm::length(boundsMax - boundsMin);
+
+	const std::vector<uint32_t>* previous = &indices;
+	for (int level = 1; level <= levels; level++) {
+		// Each level targets half the triangles of the last, and is allowed a bit more error
+		size_t target = (previous->size() / 6) * 3;
+		float  error  = extent * 0.01f * (float)(1 << level);
+		std::vector<uint32_t> lod = Simplify(positions, *previous, target, error);
+
+		// If we couldn't remove at least 10% of the triangles there's no point keeping this level
+		if (lod.empty() || lod.size() > (previous->size() * 9) / 10) {
+			break;
+		}
+
+		// Collapses leave holes in the triangle order, so re-optimize for the vertex cache. LODs share their
+		// vertex buffer with the full mesh, so we can't reorder vertices for fetch locality here
+		std::vector<uint32_t> clusters = MeshOptimizer::OptimizeVertexCache(lod, positions.size());
+		MeshOptimizer::OptimizeOverdraw(lod, positions, clusters);
+		result.push_back(std::move(lod));
+		previous = &result.back();
+	}
+
+	return result;
+}
+
+bool MeshSimplifier::_CausesFlip(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<uint32_t>& indices,
+	const std::vector<uint32_t>& adjacencyOffsets,
+	const std::vector<uint32_t>& adjacency,
+	uint32_t from, uint32_t to)
+{
+	// Check every triangle that will survive the collapse, and make sure it's normal doesn't flip
+	for (uint32_t ix = adjacencyOffsets[from]; ix < adjacencyOffsets[from + 1]; ix++) {
+		uint32_t tri = adjacency[ix];
+		uint32_t i0 = indices[tri * 3 + 0];
+		uint32_t i1 = indices[tri * 3 + 1];
+		uint32_t i2 = indices[tri * 3 + 2];
+
+		// Triangles that contain both ends of the edge will be removed
+		if (i0 == to || i1 == to || i2 == to) {
+			continue;
+		}
+
+		const glm::vec3& p0 = positions[i0];
+		const glm::vec3& p1 = positions[i1];
+		const glm::vec3& p2 = positions[i2];
+		glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+
+		glm::vec3 q0 = i0 == from ? positions[to] : p0;
+		glm::vec3 q1 = i1 == from ? positions[to] : p1;
+		glm::vec3 q2 = i2 == from ? positions[to] : p2;
+		glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+
+		if (glm::dot(before, after) <= 0.0f) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Provides tools for generating simplified versions of meshes for use as levels of detail.
+///
+/// Simplification uses quadric error metrics and edge collapses onto existing vertices, so
+/// the result is just a new index buffer that can share the original mesh's vertex buffer.
+/// Vertices on UV/normal seams and open borders are locked so the silhouette and texturing
+/// of the mesh don't tear apart as it gets simplified
+/// </summary>
+class MeshSimplifier
+{
+public:
+	/// <summary>
+	/// Simplifies a triangle list, returning a new index list referencing the same vertices
+	/// </summary>
+	/// <param name="positions">The positions of all vertices in the mesh</param>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="targetIndexCount">The number of indices we want to reduce the mesh to</param>
+	/// <param name="targetError">The maximum distance a surface is allowed to move, in model space units</param>
+	/// <param name="resultError">If non-null, will receive the largest error introduced by simplification</param>
+	/// <returns>A new index list with at most as many indices as the original</returns>
+	static std::vector<uint32_t> Simplify(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<uint32_t>& indices,
+		size_t targetIndexCount,
+		float targetError,
+		float* resultError = nullptr);
+
+	/// <summary>
+	/// Generates a chain of progressively simpler index lists for a mesh, each level having roughly
+	/// half the triangles of the one before it. Generation stops early once a level can no longer be
+	/// meaningfully reduced (ex: a cube where every vertex sits on a seam)
+	/// </summary>
+	/// <param name="positions">The positions of all vertices in the mesh</param>
+	/// <param name="indices">The full detail triangle list</param>
+	/// <param name="levels">The maximum number of levels to generate, not including the full detail level</param>
+	/// <returns>The index lists for LODs 1 and up</returns>
+	static std::vector<std::vector<uint32_t>> GenerateLods(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<uint32_t>& indices,
+		int levels);
+
+protected:
+	MeshSimplifier() = default;
+	~MeshSimplifier() = default;
+
+	// A symmetric 4x4 matrix representing the sum of squared distances to a set of planes,
+	// weighted by the area of the triangles that contributed them
+	struct Quadric {
+		double A2 = 0, AB = 0, AC = 0, AD = 0;
+		double B2 = 0, BC = 0, BD = 0;
+		double C2 = 0, CD = 0;
+		double D2 = 0;
+		double Weight = 0;
+
+		static Quadric FromPlane(const glm::vec3& normal, float d, double weight);
+		Quadric& operator +=(const Quadric& other);
+		// Returns the (weight normalized) squared distance from the point to the quadric's planes
+		double Evaluate(const glm::vec3& point) const;
+	};
+
+	static bool _CausesFlip(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<uint32_t>& indices,
+		const std::vector<uint32_t>& adjacencyOffsets,
+		const std::vector<uint32_t>& adjacency,
+		uint32_t from, uint32_t to);
+};
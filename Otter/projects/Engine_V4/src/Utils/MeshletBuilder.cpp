@@ -0,0 +1,332 @@
+#include "Utils/MeshletBuilder.h"
+#include "Utils/MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+std::vector<Meshlet> MeshletBuilder::Build(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, uint32_t maxVertices, uint32_t maxTriangles) {
+	std::vector<Meshlet> result;
+	const size_t triangleCount = indices.size() / 3;
+	const size_t vertexCount = positions.size();
+	if (triangleCount == 0 || vertexCount == 0) {
+		return result;
+	}
+
+	// We'll need the center and facing of each triangle to decide which ones to group together
+	std::vector<glm::vec3> triCenters(triangleCount);
+	std::vector<glm::vec3> triNormals(triangleCount);
+	for (size_t tri = 0; tri < triangleCount; tri++) {
+		const glm::vec3& p0 = positions[indices[tri * 3 + 0]];
+		const glm::vec3& p1 = positions[indices[tri * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[tri * 3 + 2]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		triCenters[tri] = (p0 + p1 + p2) / 3.0f;
+		triNormals[tri] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+	}
+
+	// Build a vertex -> triangle adjacency list so we can find the neighbours of a meshlet
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+		offsets[indices[ix] + 1]++;
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t ix = 0; ix < triangleCount * 3; ix++) {
+			adjacency[fill[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+		}
+	}
+
+	// Stamps track which meshlet last used each vertex or considered each triangle (0 means never)
+	std::vector<uint32_t> vertexStamp(vertexCount, 0);
+	std::vector<uint32_t> candidateStamp(triangleCount, 0);
+	std::vector<uint8_t>  emitted(triangleCount, 0);
+	std::vector<uint32_t> vertices;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> ordered;
+	ordered.reserve(triangleCount * 3);
+	vertices.reserve(maxVertices);
+
+	uint32_t meshletId = 0;
+	uint32_t cursor = 0;
+	int64_t  seed = -1;
+
+	while (true) {
+		// If the last meshlet didn't leave us a neighbour to continue from, scan for the next unused triangle
+		if (seed < 0) {
+			while (cursor < triangleCount && emitted[cursor]) {
+				cursor++;
+			}
+			if (cursor == triangleCount) {
+				break;
+			}
+			seed = cursor;
+		}
+
+		meshletId++;
+		Meshlet current = {};
+		current.FirstIndex = static_cast<uint32_t>(ordered.size());
+		vertices.clear();
+		candidates.clear();
+		glm::vec3 centerSum = glm::vec3(0.0f);
+		glm::vec3 normalSum = glm::vec3(0.0f);
+
+		int64_t next = seed;
+		while (next >= 0) {
+			uint32_t tri = static_cast<uint32_t>(next);
+			emitted[tri] = 1;
+			current.IndexCount += 3;
+			centerSum += triCenters[tri];
+			normalSum += triNormals[tri];
+
+			// Add the triangle, and make any triangles touching it's new vertices candidates for the meshlet
+			for (int v = 0; v < 3; v++) {
+				uint32_t vertex = indices[tri * 3 + v];
+				ordered.push_back(vertex);
+				if (vertexStamp[vertex] == meshletId) {
+					continue;
+				}
+				vertexStamp[vertex] = meshletId;
+				vertices.push_back(vertex);
+				for (uint32_t ix = offsets[vertex]; ix < offsets[vertex + 1]; ix++) {
+					uint32_t neighbour = adjacency[ix];
+					if (!emitted[neighbour] && candidateStamp[neighbour] != meshletId) {
+						candidateStamp[neighbour] = meshletId;
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+
+			if (current.IndexCount / 3 >= maxTriangles) {
+				break;
+			}
+
+			// Pick the candidate that adds the fewest vertices, then the one closest to our center that faces our way
+			glm::vec3 center = centerSum / (float)(current.IndexCount / 3);
+			float     normalLength = glm::length(normalSum);
+			glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+			next = -1;
+			uint32_t bestNewVertices = 4;
+			float    bestCost = 0.0f;
+			for (size_t ix = 0; ix < candidates.size();) {
+				uint32_t candidate = candidates[ix];
+				if (emitted[candidate]) {
+					candidates[ix] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				ix++;
+
+				uint32_t newVertices = 0;
+				for (int v = 0; v < 3; v++) {
+					newVertices += vertexStamp[indices[candidate * 3 + v]] != meshletId ? 1 : 0;
+				}
+				if (vertices.size() + newVertices > maxVertices) {
+					continue;
+				}
+
+				glm::vec3 offset = triCenters[candidate] - center;
+				float cost = glm::dot(offset, offset) * (2.0f - glm::dot(triNormals[candidate], axis));
+				if (newVertices < bestNewVertices || (newVertices == bestNewVertices && cost < bestCost)) {
+					bestNewVertices = newVertices;
+					bestCost = cost;
+					next = candidate;
+				}
+			}
+		}
+
+		_CalculateBounds(current, positions, ordered, vertices);
+		result.push_back(current);
+
+		// Start the next meshlet from one of our leftover neighbours, so that meshlets stay connected
+		seed = -1;
+		for (uint32_t candidate : candidates) {
+			if (!emitted[candidate]) {
+				seed = candidate;
+				break;
+			}
+		}
+	}
+
+	// Find the center of the mesh, so we can sort meshlets that face outwards from it first. These are the most
+	// likely to occlude the rest of the mesh, same as the cluster sort in MeshOptimizer::OptimizeOverdraw
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	for (const glm::vec3& triCenter : triCenters) {
+		meshCenter += triCenter;
+	}
+	meshCenter /= (float)triangleCount;
+
+	std::vector<float> scores(result.size());
+	std::vector<uint32_t> order(result.size());
+	for (size_t ix = 0; ix < result.size(); ix++) {
+		scores[ix] = glm::dot(result[ix].Center - meshCenter, result[ix].ConeAxis);
+		order[ix] = static_cast<uint32_t>(ix);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r) {
+		return scores[l] > scores[r];
+	});
+
+	// Write out our final index list with each meshlet's triangles grouped together
+	std::vector<Meshlet> sorted;
+	sorted.reserve(result.size());
+	indices.clear();
+	std::vector<uint32_t> localIndices;
+	std::vector<uint32_t> localToGlobal;
+	std::vector<uint32_t> globalToLocal(vertexCount, ~0u);
+	for (uint32_t ix : order) {
+		Meshlet meshlet = result[ix];
+
+		// Grouping triangles into meshlets throws away the vertex cache order from MeshOptimizer, which the regular
+		// draw path still relies on. Re-run the cache optimization within the meshlet, using local vertex indices
+		// so that the optimizer only needs to track the meshlet's own vertices
+		localIndices.resize(meshlet.IndexCount);
+		localToGlobal.clear();
+		for (uint32_t jx = 0; jx < meshlet.IndexCount; jx++) {
+			uint32_t vertex = ordered[meshlet.FirstIndex + jx];
+			if (globalToLocal[vertex] == ~0u) {
+				globalToLocal[vertex] = static_cast<uint32_t>(localToGlobal.size());
+				localToGlobal.push_back(vertex);
+			}
+			localIndices[jx] = globalToLocal[vertex];
+		}
+		MeshOptimizer::OptimizeVertexCache(localIndices, localToGlobal.size());
+		for (uint32_t local : localIndices) {
+			indices.push_back(localToGlobal[local]);
+		}
+		for (uint32_t vertex : localToGlobal) {
+			globalToLocal[vertex] = ~0u;
+		}
+
+		meshlet.FirstIndex = static_cast<uint32_t>(indices.size()) - meshlet.IndexCount;
+		sorted.push_back(meshlet);
+	}
+
+	return sorted;
+}
+
+void MeshletBuilder::_CalculateBounds(Meshlet& meshlet, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& vertices) {
+	// Bounding sphere around the center of the meshlet's AABB
+	glm::vec3 boundsMin = positions[vertices[0]];
+	glm::vec3 boundsMax = boundsMin;
+	for (uint32_t vertex : vertices) {
+		boundsMin = glm::min(boundsMin, positions[vertex]);
+		boundsMax = glm::max(boundsMax, positions[vertex]);
+	}
+	meshlet.Center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.Radius = 0.0f;
+	for (uint32_t vertex : vertices) {
+		meshlet.Radius = glm::max(meshlet.Radius, glm::length(positions[vertex] - meshlet.Center));
+	}
+
+	// The cone axis is the average of the triangle normals, and the cutoff is based on the normal that
+	// deviates from it the most. See "Optimizing the Graphics Pipeline with Compute" (Wihlidal, GDC 2016)
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.IndexCount / 3);
+	glm::vec3 axis = glm::vec3(0.0f);
+	for (uint32_t ix = meshlet.FirstIndex; ix < meshlet.FirstIndex + meshlet.IndexCount; ix += 3) {
+		const glm::vec3& p0 = positions[indices[ix + 0]];
+		const glm::vec3& p1 = positions[indices[ix + 1]];
+		const glm::vec3& p2 = positions[indices[ix + 2]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		// Degenerate triangles don't have a facing, so they can be ignored
+		if (length <= 0.0f) {
+			continue;
+		}
+		normal /= length;
+		normals.push_back(normal);
+		axis += normal;
+	}
+
+	float axisLength = glm::length(axis);
+	meshlet.ConeAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.ConeCutoff = 1.0f;
+	if (axisLength <= 0.0f || normals.empty()) {
+		return;
+	}
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals) {
+		minDot = glm::min(minDot, glm::dot(normal, meshlet.ConeAxis));
+	}
+
+	// If the normals spread out past ~85 degrees from the axis, there's no view where the whole meshlet faces away
+	if (minDot > 0.1f) {
+		meshlet.ConeCutoff = glm::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+uint32_t MeshletBuilder::Cull(const std::vector<Meshlet>& meshlets, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, bool coneCulling, std::vector<DrawElementsIndirectCommand>& outCommands) {
+	outCommands.clear();
+
+	glm::mat4 modelView = view * model;
+	glm::mat4 mvp = projection * modelView;
+
+	// Extract our frustum planes from the MVP, which gives them to us in model space so we can
+	// test our meshlet bounds directly (Gribb and Hartmann)
+	glm::vec4 planes[6];
+	glm::vec4 rowX = glm::vec4(mvp[0][0], mvp[1][0], mvp[2][0], mvp[3][0]);
+	glm::vec4 rowY = glm::vec4(mvp[0][1], mvp[1][1], mvp[2][1], mvp[3][1]);
+	glm::vec4 rowZ = glm::vec4(mvp[0][2], mvp[1][2], mvp[2][2], mvp[3][2]);
+	glm::vec4 rowW = glm::vec4(mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+	planes[0] = rowW + rowX;
+	planes[1] = rowW - rowX;
+	planes[2] = rowW + rowY;
+	planes[3] = rowW - rowY;
+	planes[4] = rowW + rowZ;
+	planes[5] = rowW - rowZ;
+	for (glm::vec4& plane : planes) {
+		float length = glm::length(glm::vec3(plane));
+		plane = length > 0.0f ? plane / length : plane;
+	}
+
+	// Angles aren't preserved under non-uniform scale, so we only trust the cones if the scale is uniform
+	float scaleX = glm::length(glm::vec3(model[0]));
+	float scaleY = glm::length(glm::vec3(model[1]));
+	float scaleZ = glm::length(glm::vec3(model[2]));
+	float minScale = glm::min(scaleX, glm::min(scaleY, scaleZ));
+	float maxScale = glm::max(scaleX, glm::max(scaleY, scaleZ));
+	coneCulling = coneCulling && minScale > 0.0f && maxScale / minScale < 1.01f;
+
+	// Orthographic cameras (ex: directional shadows) look along a fixed direction rather than from a point
+	bool isOrthographic = projection[3][3] == 1.0f;
+	glm::mat4 invModelView = glm::inverse(modelView);
+	glm::vec3 cameraPos = glm::vec3(invModelView[3]);
+	glm::vec3 cameraDir = glm::normalize(glm::vec3(invModelView * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+
+	uint32_t visibleCount = 0;
+	for (const Meshlet& meshlet : meshlets) {
+		bool visible = true;
+		for (const glm::vec4& plane : planes) {
+			if (glm::dot(glm::vec3(plane), meshlet.Center) + plane.w < -meshlet.Radius) {
+				visible = false;
+				break;
+			}
+		}
+
+		if (visible && coneCulling && meshlet.ConeCutoff < 1.0f) {
+			if (isOrthographic) {
+				visible = glm::dot(cameraDir, meshlet.ConeAxis) < meshlet.ConeCutoff;
+			} else {
+				glm::vec3 toCenter = meshlet.Center - cameraPos;
+				visible = glm::dot(toCenter, meshlet.ConeAxis) < meshlet.ConeCutoff * glm::length(toCenter) + meshlet.Radius;
+			}
+		}
+
+		if (!visible) {
+			continue;
+		}
+		visibleCount++;
+
+		// Meshlets are contiguous in the index buffer, so we can extend the last command if it ends where we start
+		if (!outCommands.empty() && outCommands.back().FirstIndex + outCommands.back().Count == meshlet.FirstIndex) {
+			outCommands.back().Count += meshlet.IndexCount;
+		} else {
+			outCommands.push_back({ meshlet.IndexCount, 1, meshlet.FirstIndex, 0, 0 });
+		}
+	}
+
+	return visibleCount;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+#include "Graphics/Buffers/IndirectBuffer.h"
+
+/// <summary>
+/// A small cluster of triangles within a mesh's index buffer, along with the bounds we need to cull it.
+/// Meshlets are contiguous ranges of the index buffer, so they can be drawn straight from the mesh's
+/// existing IBO with indirect draw commands
+/// </summary>
+struct Meshlet {
+	// The offset (in indices) of the meshlet's first index within the index buffer
+	uint32_t  FirstIndex;
+	// The number of indices in the meshlet (3 per triangle)
+	uint32_t  IndexCount;
+	// The model space bounding sphere of the meshlet
+	glm::vec3 Center;
+	float     Radius;
+	// The average facing direction of the meshlet's triangles, in model space
+	glm::vec3 ConeAxis;
+	// The sine of the angle between the cone axis and the furthest triangle normal, or 1 if the triangles
+	// face too many directions for the meshlet to ever be fully back facing
+	float     ConeCutoff;
+};
+
+/// <summary>
+/// Provides tools for splitting meshes into meshlets, and for culling meshlets against a camera. None of the
+/// building functions touch OpenGL, so they can be run at load time, while cooking assets, or in isolation
+/// </summary>
+class MeshletBuilder
+{
+public:
+	// Limits that keep our meshlets in line with what mesh shading hardware expects
+	static const uint32_t MAX_VERTICES  = 64;
+	static const uint32_t MAX_TRIANGLES = 124;
+
+	/// <summary>
+	/// Splits a triangle list into meshlets, reordering it so that each meshlet is a contiguous range of indices.
+	/// Meshlets are grown greedily from a seed triangle, preferring neighbours that add the fewest new vertices and
+	/// that face the same way, so they end up compact with tight cones. The finished meshlets are then sorted so
+	/// that the ones facing out from the mesh's center draw first, keeping the overdraw benefits of MeshOptimizer.
+	/// Triangles within each meshlet are re-optimized for the vertex cache, since the index buffer is also used for
+	/// regular draws
+	/// </summary>
+	/// <param name="positions">The positions of all vertices in the mesh</param>
+	/// <param name="indices">The triangle list to split, will be reordered in place</param>
+	/// <param name="maxVertices">The maximum number of unique vertices in a meshlet</param>
+	/// <param name="maxTriangles">The maximum number of triangles in a meshlet</param>
+	/// <returns>The meshlets, in index buffer order</returns>
+	static std::vector<Meshlet> Build(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices, uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+	/// <summary>
+	/// Tests a list of meshlets against a camera's frustum, and optionally whether they are entirely back facing,
+	/// and writes draw commands for the ones that pass. Neighbouring visible meshlets are merged into a single command
+	/// </summary>
+	/// <param name="meshlets">The meshlets to test</param>
+	/// <param name="model">The model transform of the object being drawn</param>
+	/// <param name="view">The view matrix of the camera</param>
+	/// <param name="projection">The projection matrix of the camera, may be perspective or orthographic</param>
+	/// <param name="coneCulling">True if meshlets that are entirely back facing should be culled</param>
+	/// <param name="outCommands">The list to write draw commands to, will be cleared first</param>
+	/// <returns>The number of meshlets that passed culling</returns>
+	static uint32_t Cull(const std::vector<Meshlet>& meshlets, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, bool coneCulling, std::vector<DrawElementsIndirectCommand>& outCommands);
+
+protected:
+	MeshletBuilder() = default;
+	~MeshletBuilder() = default;
+
+	static void _CalculateBounds(Meshlet& meshlet, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& vertices);
+};
@@ -6,9 +6,12 @@
 #include <iostream>
 #include <GLFW/glfw3.h>
 #include <filesystem>
+#include <type_traits>
 
 #include "MeshBuilder.h"
 #include "MeshFactory.h"
+#include "MeshOptimizer.h"
+#include "MeshQuantizer.h"
 #include "Graphics/VertexTypes.h"
 #include "Utils/StringUtils.h"
 
@@ -183,10 +186,17 @@ VertexArrayObject::Sptr ObjLoader::LoadFromFile(const std::string& filename, boo
 		MeshFactory::CalculateTBN(mesh);
 	}
 
+	// Reorder our triangles and vertices to make better use of the GPU's caches
+	MeshOptimizer::Optimize(mesh, filename);
+
 	// Calculate and trace out how long it took us to load
 	float endTime = static_cast<float>(glfwGetTime());
 	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, mesh.GetVertexCount(), mesh.GetIndexCount());
 
-	// Move our data into a VAO and return it
-	return mesh.Bake();
+	// Move our data into a VAO and return it, compressing it if we're using the default vertex format
+	if constexpr (std::is_same_v<VertexType, VertexPosNormTexColTangents>) {
+		return MeshQuantizer::Bake(mesh);
+	} else {
+		return mesh.Bake();
+	}
 }
\ No newline at end of file
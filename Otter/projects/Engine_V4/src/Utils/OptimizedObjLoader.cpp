@@ -9,6 +9,9 @@
 #include <filesystem>
 
 #include "Utils/StringUtils.h"
+#include "Utils/MeshSimplifier.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshQuantizer.h"
 #include "GLFW/glfw3.h"
 #include "Logging.h"
 
@@ -17,7 +20,7 @@ const std::string binaryExtension = ".bin";
 
 namespace fs = std::filesystem;
 
-VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename) {
+VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& filename, std::vector<IndexBuffer::Sptr>* outLods) {
 	// Get the file extension and lowercase it
 	fs::path filePath = std::filesystem::path(filename);
 	std::string extension = filePath.extension().string();
@@ -32,11 +35,11 @@ VertexArrayObject::Sptr OptimizedObjLoader::LoadFromFile(const std::string& file
 			ConvertToBinary(filename, binPath.string());
 		}
 		// Load the corresponding binary file
-		return _LoadFromBinFile(binPath.string());
+		return _LoadFromBinFile(binPath.string(), outLods);
 	} 
 	// Load our fancy binary files
 	else if (extension == ".bin") {
-		return _LoadFromBinFile(filename);
+		return _LoadFromBinFile(filename, outLods);
 	}
 	// We've never met this extension in our life
 	else {
@@ -62,11 +65,29 @@ void OptimizedObjLoader::ConvertToBinary(const std::string& inFile, const std::s
 		outFileName = path.string();
 	}
 
+	// Generate our LODs offline, so that we don't need to simplify the mesh every time it's loaded
+	std::vector<std::vector<uint32_t>> lods;
+	if (mesh->GetIndexCount() > 0) {
+		std::vector<glm::vec3> positions(mesh->GetVertexCount());
+		const VertexPosNormTexColTangents* vertices = reinterpret_cast<const VertexPosNormTexColTangents*>(mesh->GetVertexDataPtr());
+		for (size_t ix = 0; ix < positions.size(); ix++) {
+			positions[ix] = vertices[ix].Position;
+		}
+		const uint32_t* indexPtr = reinterpret_cast<const uint32_t*>(mesh->GetIndexDataPtr());
+		std::vector<uint32_t> indices(indexPtr, indexPtr + mesh->GetIndexCount());
+		lods = MeshSimplifier::GenerateLods(positions, indices, 3);
+	}
+
+	// Compress our vertices, our LODs only reference vertices by index so they're unaffected
+	MeshBuilder<VertexQuantized> quantized;
+	glm::vec3 positionScale, positionOffset;
+	MeshQuantizer::Quantize(*mesh, quantized, positionScale, positionOffset);
+
 	// Save the mesh to the file
-	SaveBinaryFile(*mesh, outFileName);
+	SaveBinaryFile(quantized, outFileName, lods, positionScale, positionOffset);
 
 	float endTime = static_cast<float>(glfwGetTime());
-	LOG_TRACE("Converted OBJ file to binary \"{}\" in {} seconds ({} vertices, {} indices)", inFile, endTime - startTime, mesh->GetVertexCount(), mesh->GetIndexCount());
+	LOG_TRACE("Converted OBJ file to binary \"{}\" in {} seconds ({} vertices, {} indices, {} LODs)", inFile, endTime - startTime, mesh->GetVertexCount(), mesh->GetIndexCount(), lods.size());
 
 	// We no longer need the mesh data, free it
 	delete mesh;
@@ -225,6 +246,10 @@ MeshBuilder<VertexPosNormTexColTangents>* OptimizedObjLoader::_LoadFromObjFile(c
 	// Calculate our tangents
 	MeshFactory::CalculateTBN(*mesh);
 
+	// Reorder our triangles and vertices to make better use of the GPU's caches, since this
+	// is only done when converting to binary the cost is paid once per model
+	MeshOptimizer::Optimize(*mesh, filename);
+
 	// Calculate and trace out how long it took us to load
 	float endTime = static_cast<float>(glfwGetTime());
 	LOG_TRACE("Loaded OBJ file \"{}\" in {} seconds ({} vertices, {} indices)", filename, endTime - startTime, mesh->GetVertexCount(), mesh->GetIndexCount());
@@ -233,7 +258,7 @@ MeshBuilder<VertexPosNormTexColTangents>* OptimizedObjLoader::_LoadFromObjFile(c
 	return mesh;
 }
 
-VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string& filename) {
+VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string& filename, std::vector<IndexBuffer::Sptr>* outLods) {
 
 	// Open the output file
 	std::ifstream file(filename, std::ios::binary);
@@ -258,12 +283,14 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 
 	// TODO: validate header
 
-	// Handle our version
-	if (header.Version == 0x01) {
+	// Handle our version, version 2 is the same as version 1 with LODs tacked onto the end, version 3
+	// adds position dequantization info after the attributes, and stores LODs using the header's index type
+	if (header.Version >= 0x01 && header.Version <= 0x03) {
 		// Determine how many bytes we need in the file
 		size_t requiredBytes =
 			sizeof(BinaryHeader) +
 			(header.NumAttributes * sizeof(BufferAttribute)) +
+			(header.Version >= 0x03 ? sizeof(glm::vec3) * 2 : 0) +
 			(header.VertexStride * (size_t)header.NumVertices) +
 			(header.NumIndices * GetIndexTypeSize(header.IndicesType));
 
@@ -278,6 +305,18 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 		vertexDeclaration.resize(header.NumAttributes);
 		for (int ix = 0; ix < header.NumAttributes; ix++) {
 			file.read(reinterpret_cast<char*>(&vertexDeclaration[ix]), sizeof(BufferAttribute));
+			// Older versions had padding where the integer flag now lives
+			if (header.Version < 0x03) {
+				vertexDeclaration[ix].Integer = false;
+			}
+		}
+
+		// Read how to decode our positions, older versions were always full precision
+		glm::vec3 positionScale = glm::vec3(1.0f);
+		glm::vec3 positionOffset = glm::vec3(0.0f);
+		if (header.Version >= 0x03) {
+			file.read(reinterpret_cast<char*>(&positionScale), sizeof(glm::vec3));
+			file.read(reinterpret_cast<char*>(&positionOffset), sizeof(glm::vec3));
 		}
 
 		// These will have the buffer pointers
@@ -316,6 +355,33 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 
 		// Copy in the vertex declaration we loaded
 		result->SetVDecl(vertexDeclaration);
+		result->SetPositionDequantization(positionScale, positionOffset);
+
+		// Load in any LODs that were stored in the file
+		if (header.Version >= 0x02) {
+			IndexType lodIndexType = header.Version >= 0x03 ? header.IndicesType : IndexType::UInt;
+			uint32_t  lodIndexSize = static_cast<uint32_t>(GetIndexTypeSize(lodIndexType));
+
+			uint8_t numLods = 0;
+			file.read(reinterpret_cast<char*>(&numLods), sizeof(uint8_t));
+			for (int ix = 0; ix < numLods && file; ix++) {
+				uint32_t numIndices = 0;
+				file.read(reinterpret_cast<char*>(&numIndices), sizeof(uint32_t));
+
+				std::vector<uint8_t> lodIndices(numIndices * (size_t)lodIndexSize);
+				file.read(reinterpret_cast<char*>(lodIndices.data()), lodIndices.size());
+				if (!file) {
+					LOG_WARN("LOD {} in \"{}\" is truncated, ignoring", ix + 1, filename);
+					break;
+				}
+
+				if (outLods != nullptr) {
+					IndexBuffer::Sptr lod = IndexBuffer::Create(BufferUsage::StaticDraw);
+					lod->LoadData(lodIndices.data(), lodIndexSize, numIndices, lodIndexType);
+					outLods->push_back(lod);
+				}
+			}
+		}
 
 		// Calculate and trace out how long it took us to load
 		float endTime = static_cast<float>(glfwGetTime());
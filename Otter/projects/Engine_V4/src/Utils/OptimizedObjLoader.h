@@ -24,8 +24,9 @@ public:
 	/// to a binary file and load that instead. On subsequent runs, the binary file will be loaded instead
 	/// </summary>
 	/// <param name="filename">The path to the .obj or .bin file to load</param>
+	/// <param name="outLods">If non-null, will receive the index buffers for any LODs stored in the file</param>
 	/// <returns>A VAO loaded from disk</returns>
-	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename);
+	static VertexArrayObject::Sptr LoadFromFile(const std::string& filename, std::vector<IndexBuffer::Sptr>* outLods = nullptr);
 	/// <summary>
 	/// Manually converts an OBJ file into a binary mesh file
 	/// </summary>
@@ -39,8 +40,12 @@ public:
 	/// <typeparam name="VertexType"></typeparam>
 	/// <param name="mesh"></param>
 	/// <param name="outFilename"></param>
+	/// <param name="lods">The index lists for any lower levels of detail to store alongside the mesh</param>
+	/// <param name="positionScale">For quantized meshes, the scale to decode positions with (see VertexArrayObject::SetPositionDequantization)</param>
+	/// <param name="positionOffset">For quantized meshes, the offset to decode positions with</param>
 	template <typename VertexType>
-	static void SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename);
+	static void SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename, const std::vector<std::vector<uint32_t>>& lods = {},
+							   const glm::vec3& positionScale = glm::vec3(1.0f), const glm::vec3& positionOffset = glm::vec3(0.0f));
 
 protected:
 	// Will be put at the start of the binary file, contains info about the contents of the file
@@ -65,11 +70,12 @@ protected:
 	~OptimizedObjLoader() = default;
 
 	static MeshBuilder<VertexPosNormTexColTangents>* _LoadFromObjFile(const std::string& filename);
-	static VertexArrayObject::Sptr _LoadFromBinFile(const std::string& filename);
+	static VertexArrayObject::Sptr _LoadFromBinFile(const std::string& filename, std::vector<IndexBuffer::Sptr>* outLods);
 };
 
 template <typename VertexType>
-void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename) {
+void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std::string& outFilename, const std::vector<std::vector<uint32_t>>& lods,
+										  const glm::vec3& positionScale, const glm::vec3& positionOffset) {
 	// Open the output file
 	std::ofstream file(outFilename, std::ios::binary);
 	if (!file) {
@@ -78,9 +84,10 @@ void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std
 
 	// Create the fixed size header for our output file
 	BinaryHeader header  = BinaryHeader();
-	header.Version       = 0x01; // This is version 1! Update this and implement different readers if changes to format are made
+	header.Version       = 0x03; // Version 3 adds position dequantization and 16 bit indices. Update this and implement different readers if changes to format are made
 	header.NumIndices    = mesh.GetIndexCount();
-	header.IndicesType   = IndexType::UInt;
+	// If all our vertices can be addressed with 16 bits, we can halve the size of our indices
+	header.IndicesType   = mesh.GetVertexCount() < 0xFFFF ? IndexType::UShort : IndexType::UInt;
 	header.NumVertices   = mesh.GetVertexCount();
 	header.VertexStride  = sizeof(VertexType);
 	header.NumAttributes = VertexType::V_DECL.size();
@@ -92,11 +99,34 @@ void OptimizedObjLoader::SaveBinaryFile(MeshBuilder<VertexType>& mesh, const std
 	for (int ix = 0; ix < VertexType::V_DECL.size(); ix++) {
 		file.write(reinterpret_cast<const char*>(&VertexType::V_DECL[ix]), sizeof(BufferAttribute));
 	}
+	// Write the info for decoding positions
+	file.write(reinterpret_cast<const char*>(&positionScale), sizeof(glm::vec3));
+	file.write(reinterpret_cast<const char*>(&positionOffset), sizeof(glm::vec3));
+
+	// Helper for writing out indices in the header's index type
+	auto writeIndices = [&](const uint32_t* indices, size_t count) {
+		if (header.IndicesType == IndexType::UShort) {
+			std::vector<uint16_t> compact(indices, indices + count);
+			file.write(reinterpret_cast<const char*>(compact.data()), count * sizeof(uint16_t));
+		} else {
+			file.write(reinterpret_cast<const char*>(indices), count * sizeof(uint32_t));
+		}
+	};
+
 	// Write any index data to the file
 	if (mesh.GetIndexCount() > 0) {
-		file.write(reinterpret_cast<const char*>(mesh.GetIndexDataPtr()), mesh.GetIndexCount() * sizeof(uint32_t));
+		writeIndices(mesh.GetIndexDataPtr(), mesh.GetIndexCount());
 	}
 
 	// Write vertex data to file
 	file.write(reinterpret_cast<const char*>(mesh.GetVertexDataPtr()), mesh.GetVertexCount() * sizeof(VertexType));
+
+	// Write the LOD count, followed by the index count and indices for each LOD
+	uint8_t numLods = static_cast<uint8_t>(lods.size());
+	file.write(reinterpret_cast<const char*>(&numLods), sizeof(uint8_t));
+	for (int ix = 0; ix < numLods; ix++) {
+		uint32_t numIndices = static_cast<uint32_t>(lods[ix].size());
+		file.write(reinterpret_cast<const char*>(&numIndices), sizeof(uint32_t));
+		writeIndices(lods[ix].data(), numIndices);
+	}
 }
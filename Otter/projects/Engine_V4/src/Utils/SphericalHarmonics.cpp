@@ -0,0 +1,150 @@
+#include "Utils/SphericalHarmonics.h"
+
+#include <algorithm>
+#include <GLM/gtc/constants.hpp>
+
+// The constant parts of the real spherical harmonic basis functions
+static const float SH_K0 = 0.282095f; // 1/2 * sqrt(1/pi)
+static const float SH_K1 = 0.488603f; // sqrt(3/(4pi))
+static const float SH_K2 = 1.092548f; // 1/2 * sqrt(15/pi)
+static const float SH_K3 = 0.315392f; // 1/4 * sqrt(5/pi)
+static const float SH_K4 = 0.546274f; // 1/4 * sqrt(15/pi)
+
+// Convolving with a cosine lobe scales each band by pi, 2pi/3 and pi/4 respectively. We divide those
+// by pi since our lighting buffers store irradiance / pi (the same units as the rest of our lights)
+static const float SH_BAND_SCALE[SphericalHarmonics::COEFFICIENT_COUNT] = {
+	1.0f,
+	2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+	0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+};
+
+// The constant that each basis function's polynomial is multiplied by
+static const float SH_BASIS_SCALE[SphericalHarmonics::COEFFICIENT_COUNT] = {
+	SH_K0,
+	SH_K1, SH_K1, SH_K1,
+	SH_K2, SH_K2, SH_K3, SH_K2, SH_K4
+};
+
+SphericalHarmonics::SphericalHarmonics() {
+	for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+		Coefficients[ix] = glm::vec3(0.0f);
+	}
+}
+
+SphericalHarmonics SphericalHarmonics::FromConstant(const glm::vec3& color) {
+	// Projecting a constant radiance only touches the first band, the integral of Y00 over the sphere is 4pi * K0
+	SphericalHarmonics result;
+	result.Coefficients[0] = color * (4.0f * glm::pi<float>() * SH_K0);
+	return result;
+}
+
+SphericalHarmonics SphericalHarmonics::ProjectCubemap(const uint8_t* pixels, uint32_t faceSize, uint32_t channels, uint32_t maxSamples) {
+	SphericalHarmonics result;
+	if (pixels == nullptr || faceSize == 0 || channels < 3) {
+		return result;
+	}
+
+	uint32_t samples = std::min(faceSize, std::max(maxSamples, 1u));
+	size_t faceBytes = (size_t)faceSize * faceSize * channels;
+	float totalWeight = 0.0f;
+	float basis[COEFFICIENT_COUNT];
+
+	for (int face = 0; face < 6; face++) {
+		const uint8_t* faceData = pixels + faceBytes * face;
+
+		for (uint32_t sy = 0; sy < samples; sy++) {
+			// Pick the texel in the middle of the region this sample covers
+			uint32_t y = (sy * faceSize + faceSize / 2) / samples;
+			float v = (y + 0.5f) / faceSize;
+
+			for (uint32_t sx = 0; sx < samples; sx++) {
+				uint32_t x = (sx * faceSize + faceSize / 2) / samples;
+				float u = (x + 0.5f) / faceSize;
+
+				// Texels near the edges of a face cover less of the sphere than those at the center
+				glm::vec2 p = glm::vec2(u, v) * 2.0f - 1.0f;
+				float distSq = 1.0f + glm::dot(p, p);
+				float weight = 1.0f / (distSq * glm::sqrt(distSq));
+
+				const uint8_t* texel = faceData + ((size_t)y * faceSize + x) * channels;
+				glm::vec3 color = glm::vec3(texel[0], texel[1], texel[2]) / 255.0f;
+
+				_EvaluateBasis(GetCubemapDirection(face, glm::vec2(u, v)), basis);
+				for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+					result.Coefficients[ix] += color * (basis[ix] * weight);
+				}
+				totalWeight += weight;
+			}
+		}
+	}
+
+	// Our weights are only proportional to the solid angle, scale them so they add up to the whole sphere
+	result *= 4.0f * glm::pi<float>() / totalWeight;
+	return result;
+}
+
+glm::vec3 SphericalHarmonics::GetCubemapDirection(int face, const glm::vec2& uv) {
+	glm::vec2 p = uv * 2.0f - 1.0f;
+	switch (face) {
+		case 0:  return glm::normalize(glm::vec3( 1.0f, -p.y, -p.x));
+		case 1:  return glm::normalize(glm::vec3(-1.0f, -p.y,  p.x));
+		case 2:  return glm::normalize(glm::vec3( p.x,  1.0f,  p.y));
+		case 3:  return glm::normalize(glm::vec3( p.x, -1.0f, -p.y));
+		case 4:  return glm::normalize(glm::vec3( p.x, -p.y,  1.0f));
+		default: return glm::normalize(glm::vec3(-p.x, -p.y, -1.0f));
+	}
+}
+
+glm::vec3 SphericalHarmonics::Evaluate(const glm::vec3& direction) const {
+	float basis[COEFFICIENT_COUNT];
+	_EvaluateBasis(glm::normalize(direction), basis);
+
+	glm::vec3 result = glm::vec3(0.0f);
+	for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+		result += Coefficients[ix] * basis[ix];
+	}
+	return result;
+}
+
+glm::vec3 SphericalHarmonics::EvaluateDiffuse(const glm::vec3& normal) const {
+	float basis[COEFFICIENT_COUNT];
+	_EvaluateBasis(glm::normalize(normal), basis);
+
+	glm::vec3 result = glm::vec3(0.0f);
+	for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+		result += Coefficients[ix] * (basis[ix] * SH_BAND_SCALE[ix]);
+	}
+	return glm::max(result, glm::vec3(0.0f));
+}
+
+void SphericalHarmonics::GetDiffuseCoefficients(glm::vec4* outCoefficients) const {
+	for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+		outCoefficients[ix] = glm::vec4(Coefficients[ix] * (SH_BAND_SCALE[ix] * SH_BASIS_SCALE[ix]), 0.0f);
+	}
+}
+
+SphericalHarmonics& SphericalHarmonics::operator+=(const SphericalHarmonics& other) {
+	for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+		Coefficients[ix] += other.Coefficients[ix];
+	}
+	return *this;
+}
+
+SphericalHarmonics& SphericalHarmonics::operator*=(float scale) {
+	for (int ix = 0; ix < COEFFICIENT_COUNT; ix++) {
+		Coefficients[ix] *= scale;
+	}
+	return *this;
+}
+
+void SphericalHarmonics::_EvaluateBasis(const glm::vec3& dir, float* outBasis) {
+	outBasis[0] = SH_K0;
+	outBasis[1] = SH_K1 * dir.y;
+	outBasis[2] = SH_K1 * dir.z;
+	outBasis[3] = SH_K1 * dir.x;
+	outBasis[4] = SH_K2 * dir.x * dir.y;
+	outBasis[5] = SH_K2 * dir.y * dir.z;
+	outBasis[6] = SH_K3 * (3.0f * dir.z * dir.z - 1.0f);
+	outBasis[7] = SH_K2 * dir.x * dir.z;
+	outBasis[8] = SH_K4 * (dir.x * dir.x - dir.y * dir.y);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Stores the lighting around a point as 3rd order (L2) spherical harmonics, 9 RGB coefficients
+/// that capture the low frequency part of an environment map. That's all diffuse lighting needs, since
+/// the cosine lobe blurs away everything above L2, so we can light a surface from an entire cubemap
+/// with a handful of multiply-adds instead of thousands of texture samples.
+///
+/// Coefficients are stored in the order L00, L1-1, L10, L11, L2-2, L2-1, L20, L21, L22. Nothing here
+/// touches OpenGL, so projections can be run and checked on the CPU
+/// </summary>
+class SphericalHarmonics
+{
+public:
+	static const int COEFFICIENT_COUNT = 9;
+
+	/// <summary>
+	/// The radiance coefficients of the projected environment
+	/// </summary>
+	glm::vec3 Coefficients[COEFFICIENT_COUNT];
+
+	/// <summary>
+	/// Creates a set of harmonics with all coefficients set to zero (no light)
+	/// </summary>
+	SphericalHarmonics();
+
+	/// <summary>
+	/// Creates harmonics representing light of the same color coming from every direction, this is
+	/// equivalent to a flat ambient color
+	/// </summary>
+	/// <param name="color">The diffuse lighting a surface should receive from every direction</param>
+	static SphericalHarmonics FromConstant(const glm::vec3& color);
+
+	/// <summary>
+	/// Projects an 8 bit cubemap into spherical harmonics. Each texel is weighted by the solid angle it
+	/// covers, so the corners of the faces don't count for more than the centers
+	/// </summary>
+	/// <param name="pixels">The faces of the cubemap, one after another in the order +X, -X, +Y, -Y, +Z, -Z, with rows in OpenGL order (bottom up)</param>
+	/// <param name="faceSize">The size of a single face in texels</param>
+	/// <param name="channels">The number of channels per texel (at least 3), only RGB is used</param>
+	/// <param name="maxSamples">The maximum number of texels to sample along each axis of a face, larger faces will be strided
+	/// over. The harmonics are so low frequency that a few thousand samples per face is plenty</param>
+	static SphericalHarmonics ProjectCubemap(const uint8_t* pixels, uint32_t faceSize, uint32_t channels, uint32_t maxSamples = 64);
+
+	/// <summary>
+	/// Gets the direction through the center of a texel in a cubemap, following OpenGL's conventions
+	/// </summary>
+	/// <param name="face">The face index, in the order +X, -X, +Y, -Y, +Z, -Z</param>
+	/// <param name="uv">The position on the face, between 0 and 1</param>
+	static glm::vec3 GetCubemapDirection(int face, const glm::vec2& uv);
+
+	/// <summary>
+	/// Reconstructs the radiance arriving from a given direction
+	/// </summary>
+	glm::vec3 Evaluate(const glm::vec3& direction) const;
+	/// <summary>
+	/// Calculates the diffuse lighting for a surface with the given normal, this is the irradiance divided
+	/// by pi, so it can be multiplied with albedo like any other light in our lighting buffers
+	/// </summary>
+	glm::vec3 EvaluateDiffuse(const glm::vec3& normal) const;
+
+	/// <summary>
+	/// Gets the coefficients to upload to shaders, with the cosine convolution and the constant parts of the
+	/// basis functions pre-multiplied in. Shaders can then evaluate the diffuse lighting as
+	///    c0 + c1*y + c2*z + c3*x + c4*x*y + c5*y*z + c6*(3z^2 - 1) + c7*x*z + c8*(x^2 - y^2)
+	/// </summary>
+	/// <param name="outCoefficients">The 9 coefficients to write to, w is left as 0 for std140 packing</param>
+	void GetDiffuseCoefficients(glm::vec4* outCoefficients) const;
+
+	SphericalHarmonics& operator +=(const SphericalHarmonics& other);
+	SphericalHarmonics& operator *=(float scale);
+
+protected:
+	/// <summary>
+	/// Evaluates the 9 basis functions for a given (normalized) direction
+	/// </summary>
+	static void _EvaluateBasis(const glm::vec3& dir, float* outBasis);
+};
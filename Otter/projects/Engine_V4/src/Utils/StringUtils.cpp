@@ -1,4 +1,5 @@
 #include "Utils/StringUtils.h"
+#include <cstdint>
 
 std::string StringTools::SanitizeClassName(const std::string& name)
 {
@@ -65,3 +66,106 @@ int StringTools::Split(const std::string& s, std::vector<std::string>& results,
 	results.push_back(s.substr(lastPos, seek));
 	return ++result;
 }
+
+int StringTools::ReplaceAll(std::string& s, const std::string& token, const std::string& replacement) {
+	if (token.empty()) {
+		return 0;
+	}
+	int result = 0;
+	size_t seek = s.find(token, 0);
+	while (seek != std::string::npos) {
+		s.replace(seek, token.size(), replacement);
+		result++;
+		// Skip past what we just inserted, so replacements containing the token don't loop forever
+		seek = s.find(token, seek + replacement.size());
+	}
+	return result;
+}
+
+void StringTools::ToUnicode(const std::string& s, std::wstring& result) {
+	result.clear();
+	result.reserve(s.size());
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(s.data());
+	size_t length = s.size();
+	size_t ix = 0;
+	while (ix < length) {
+		uint8_t lead = data[ix];
+		uint32_t codePoint;
+		size_t extra;
+
+		// The lead byte tells us how many continuation bytes follow
+		if (lead < 0x80)                { codePoint = lead;        extra = 0; }
+		else if ((lead & 0xE0) == 0xC0) { codePoint = lead & 0x1F; extra = 1; }
+		else if ((lead & 0xF0) == 0xE0) { codePoint = lead & 0x0F; extra = 2; }
+		else if ((lead & 0xF8) == 0xF0) { codePoint = lead & 0x07; extra = 3; }
+		else {
+			result.push_back(0xFFFD);
+			ix++;
+			continue;
+		}
+
+		bool valid = ix + extra < length;
+		for (size_t b = 1; valid && b <= extra; b++) {
+			uint8_t next = data[ix + b];
+			valid = (next & 0xC0) == 0x80;
+			codePoint = (codePoint << 6) | (next & 0x3F);
+		}
+		if (!valid) {
+			result.push_back(0xFFFD);
+			ix++;
+			continue;
+		}
+		ix += extra + 1;
+
+		// Windows wide strings are UTF-16, so anything outside the BMP needs a surrogate pair
+		if (sizeof(wchar_t) == 2 && codePoint > 0xFFFF) {
+			codePoint -= 0x10000;
+			result.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+			result.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+		} else {
+			result.push_back(static_cast<wchar_t>(codePoint));
+		}
+	}
+}
+
+std::wstring StringTools::ToUnicode(const std::string& s) {
+	std::wstring result;
+	ToUnicode(s, result);
+	return result;
+}
+
+std::string StringTools::ToUtf8(const std::wstring& s) {
+	std::string result;
+	result.reserve(s.size());
+
+	for (size_t ix = 0; ix < s.size(); ix++) {
+		uint32_t codePoint = static_cast<uint32_t>(s[ix]);
+
+		// Combine surrogate pairs back into a single code point
+		if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint <= 0xDBFF && ix + 1 < s.size()) {
+			uint32_t low = static_cast<uint32_t>(s[ix + 1]);
+			if (low >= 0xDC00 && low <= 0xDFFF) {
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				ix++;
+			}
+		}
+
+		if (codePoint < 0x80) {
+			result.push_back(static_cast<char>(codePoint));
+		} else if (codePoint < 0x800) {
+			result.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+			result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		} else if (codePoint < 0x10000) {
+			result.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+			result.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		} else {
+			result.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+			result.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+			result.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			result.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+	}
+	return result;
+}
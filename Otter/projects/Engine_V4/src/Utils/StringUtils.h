@@ -115,4 +115,31 @@ public:
 	/// <param name="splitOn">The delimiter string to split on</param>
 	/// <returns>The number of tokens this command appended to the results</returns>
 	static int Split(const std::string& s, std::vector<std::string>& results, const std::string& splitOn = ",");
+
+	/// <summary>
+	/// Replaces every occurrence of a token within a string, in place
+	/// </summary>
+	/// <param name="s">A reference to the string to modify</param>
+	/// <param name="token">The string to search for</param>
+	/// <param name="replacement">The string to replace each occurrence of token with</param>
+	/// <returns>The number of occurrences that were replaced</returns>
+	static int ReplaceAll(std::string& s, const std::string& token, const std::string& replacement);
+
+	/// <summary>
+	/// Decodes a UTF-8 string into a wide string (UTF-16 on Windows, UTF-32 elsewhere). Invalid
+	/// bytes are replaced with U+FFFD instead of throwing
+	/// </summary>
+	/// <param name="s">The UTF-8 string to decode</param>
+	/// <param name="result">The string to store the result in, it's memory is reused if possible</param>
+	static void ToUnicode(const std::string& s, std::wstring& result);
+	/// <summary>
+	/// Decodes a UTF-8 string into a wide string
+	/// </summary>
+	/// <param name="s">The UTF-8 string to decode</param>
+	static std::wstring ToUnicode(const std::string& s);
+	/// <summary>
+	/// Encodes a wide string as UTF-8
+	/// </summary>
+	/// <param name="s">The wide string to encode</param>
+	static std::string ToUtf8(const std::wstring& s);
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+
+// Set while a thread is working on a job, so that nested ParallelFor calls run inline instead of waiting
+// on the job they're part of
+static thread_local bool t_InJob = false;
+
+ThreadPool::ThreadPool(uint32_t workerCount) :
+	_workers(std::vector<std::thread>()),
+	_job(nullptr),
+	_generation(0),
+	_stopping(false)
+{
+	_workers.reserve(workerCount);
+	for (uint32_t ix = 0; ix < workerCount; ix++) {
+		_workers.emplace_back([this]() { _WorkerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::Get() {
+	static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	return pool;
+}
+
+void ThreadPool::_Run(size_t count, size_t chunkSize, uint32_t maxThreads, std::function<void(size_t, size_t)> body) {
+	if (count == 0) {
+		return;
+	}
+
+	Job job;
+	job.Body = std::move(body);
+	job.Count = count;
+	job.ChunkSize = std::max(chunkSize, (size_t)1);
+	job.Next = 0;
+	job.MaxThreads = maxThreads;
+	job.Joined = 1;
+	job.Active = 0;
+
+	// Not worth waking anyone up for, or we're already part of a job and would wait on ourselves
+	size_t chunkCount = (count + job.ChunkSize - 1) / job.ChunkSize;
+	if (maxThreads <= 1 || chunkCount <= 1 || _workers.empty() || t_InJob) {
+		_Work(job);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(_submitLock);
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_job = &job;
+		_generation++;
+	}
+	_wake.notify_all();
+
+	// The calling thread does it's share of the work as well
+	_Work(job);
+
+	// Workers can only join while holding the lock, so once none are active and we clear the job we're done
+	std::unique_lock<std::mutex> lock(_lock);
+	_done.wait(lock, [&]() { return job.Active == 0; });
+	_job = nullptr;
+}
+
+void ThreadPool::_WorkerLoop() {
+	uint64_t seenGeneration = 0;
+	while (true) {
+		Job* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_wake.wait(lock, [&]() { return _stopping || _generation != seenGeneration; });
+			if (_stopping) {
+				return;
+			}
+			seenGeneration = _generation;
+
+			// The job may have finished before we woke up, or already have all the threads it asked for
+			if (_job == nullptr || _job->Joined >= _job->MaxThreads) {
+				continue;
+			}
+			job = _job;
+			job->Joined++;
+			job->Active++;
+		}
+
+		_Work(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			job->Active--;
+		}
+		_done.notify_all();
+	}
+}
+
+void ThreadPool::_Work(Job& job) {
+	bool wasInJob = t_InJob;
+	t_InJob = true;
+	for (size_t begin = job.Next.fetch_add(job.ChunkSize); begin < job.Count; begin = job.Next.fetch_add(job.ChunkSize)) {
+		job.Body(begin, std::min(begin + job.ChunkSize, job.Count));
+	}
+	t_InJob = wasInJob;
+}
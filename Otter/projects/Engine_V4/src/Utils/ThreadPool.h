@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+#include "Utils/Macros.h"
+
+/// <summary>
+/// A set of worker threads that stay alive for the lifetime of the app, so that systems that split their
+/// work over threads every frame (ex: CPU particles) don't pay to start and join threads each time.
+///
+/// Work is handed out with ParallelFor, which blocks until every item is done. The calling thread does
+/// it's share of the work as well. Only one ParallelFor runs on the pool at a time, calls from other threads
+/// wait their turn, and calls from inside a job run inline rather than deadlocking
+/// </summary>
+class ThreadPool {
+public:
+	NO_COPY(ThreadPool);
+	NO_MOVE(ThreadPool);
+
+	/// <summary>
+	/// Creates a new thread pool
+	/// </summary>
+	/// <param name="workerCount">The number of threads to start, not including threads that call ParallelFor</param>
+	ThreadPool(uint32_t workerCount);
+	~ThreadPool();
+
+	/// <summary>
+	/// Gets the shared pool, which has one worker per hardware thread other than the calling one
+	/// </summary>
+	static ThreadPool& Get();
+
+	/// <summary>
+	/// Gets the number of worker threads in the pool
+	/// </summary>
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+	/// <summary>
+	/// Runs func(index) for every index in [0, count), handing out chunks of items as threads finish their last
+	/// one. Returns once every item has been processed
+	/// </summary>
+	/// <param name="count">The number of items to process</param>
+	/// <param name="chunkSize">How many items a thread grabs at once</param>
+	/// <param name="maxThreads">The most threads that will work on the items, including the calling one</param>
+	/// <param name="func">The function to run for each item</param>
+	template <typename Func>
+	void ParallelFor(size_t count, size_t chunkSize, uint32_t maxThreads, Func&& func) {
+		_Run(count, chunkSize, maxThreads, [&](size_t begin, size_t end) {
+			for (size_t ix = begin; ix < end; ix++) {
+				func(ix);
+			}
+		});
+	}
+
+protected:
+	struct Job {
+		std::function<void(size_t, size_t)> Body;
+		size_t              Count;
+		size_t              ChunkSize;
+		std::atomic<size_t> Next;
+		// How many threads may join, and how many have, both only touched with the pool's lock held
+		uint32_t            MaxThreads;
+		uint32_t            Joined;
+		uint32_t            Active;
+	};
+
+	std::vector<std::thread> _workers;
+	// Serializes callers, so only one job runs at a time
+	std::mutex               _submitLock;
+	std::mutex               _lock;
+	std::condition_variable  _wake;
+	std::condition_variable  _done;
+	Job*                     _job;
+	uint64_t                 _generation;
+	bool                     _stopping;
+
+	void _Run(size_t count, size_t chunkSize, uint32_t maxThreads, std::function<void(size_t, size_t)> body);
+	void _WorkerLoop();
+	static void _Work(Job& job);
+};
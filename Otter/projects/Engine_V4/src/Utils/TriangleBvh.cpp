@@ -0,0 +1,236 @@
+#include "Utils/TriangleBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+// Nodes with this many triangles or fewer are always leaves
+static const uint32_t BVH_MIN_LEAF = 4;
+// Nodes with more triangles than this are always split, even if the SAH says it's not worth it
+static const uint32_t BVH_MAX_LEAF = 16;
+// The number of bins we sort centroids into when looking for a split
+static const int      BVH_BIN_COUNT = 12;
+// How expensive a traversal step is compared to a triangle test
+static const float    BVH_TRAVERSAL_COST = 1.0f;
+
+static float SurfaceArea(const glm::vec3& min, const glm::vec3& max) {
+	glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+TriangleBvh::TriangleBvh() :
+	_nodes(),
+	_triangles(),
+	_triangleOrder()
+{ }
+
+void TriangleBvh::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+	_nodes.clear();
+	_triangles.clear();
+	_triangleOrder.clear();
+
+	size_t triCount = indices.size() / 3;
+	if (triCount == 0) {
+		return;
+	}
+
+	// We store triangles as a vertex and two edges, which is what the intersection test wants
+	_triangles.resize(triCount);
+	_triangleOrder.resize(triCount);
+	std::vector<glm::vec3> centroids(triCount);
+	std::vector<glm::vec3> boundsMin(triCount);
+	std::vector<glm::vec3> boundsMax(triCount);
+	for (size_t ix = 0; ix < triCount; ix++) {
+		const glm::vec3& p0 = positions[indices[ix * 3 + 0]];
+		const glm::vec3& p1 = positions[indices[ix * 3 + 1]];
+		const glm::vec3& p2 = positions[indices[ix * 3 + 2]];
+		_triangles[ix] = { p0, p1 - p0, p2 - p0 };
+		_triangleOrder[ix] = static_cast<uint32_t>(ix);
+		boundsMin[ix] = glm::min(p0, glm::min(p1, p2));
+		boundsMax[ix] = glm::max(p0, glm::max(p1, p2));
+		centroids[ix] = (boundsMin[ix] + boundsMax[ix]) * 0.5f;
+	}
+
+	// A binary tree has at most 2n - 1 nodes
+	_nodes.reserve(triCount * 2);
+	_BuildRecursive(centroids, boundsMin, boundsMax, 0, static_cast<uint32_t>(triCount));
+}
+
+uint32_t TriangleBvh::_BuildRecursive(std::vector<glm::vec3>& centroids, std::vector<glm::vec3>& boundsMin, std::vector<glm::vec3>& boundsMax, uint32_t begin, uint32_t end) {
+	uint32_t nodeIndex = static_cast<uint32_t>(_nodes.size());
+	_nodes.emplace_back();
+
+	// Get the bounds of the triangles, and of their centroids for picking a split
+	glm::vec3 nodeMin = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 nodeMax = glm::vec3(-std::numeric_limits<float>::max());
+	glm::vec3 centroidMin = nodeMin;
+	glm::vec3 centroidMax = nodeMax;
+	for (uint32_t ix = begin; ix < end; ix++) {
+		uint32_t tri = _triangleOrder[ix];
+		nodeMin = glm::min(nodeMin, boundsMin[tri]);
+		nodeMax = glm::max(nodeMax, boundsMax[tri]);
+		centroidMin = glm::min(centroidMin, centroids[tri]);
+		centroidMax = glm::max(centroidMax, centroids[tri]);
+	}
+	_nodes[nodeIndex].BoundsMin = nodeMin;
+	_nodes[nodeIndex].BoundsMax = nodeMax;
+
+	uint32_t count = end - begin;
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+	// Small nodes, or ones where every triangle is in the same place, become leaves
+	if (count <= BVH_MIN_LEAF || extent[axis] <= 0.0f) {
+		_nodes[nodeIndex].Offset = begin;
+		_nodes[nodeIndex].Count = count;
+		return nodeIndex;
+	}
+
+	// Sort our triangles into bins along the longest axis
+	struct Bin {
+		glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+		uint32_t  Count = 0;
+	};
+	Bin bins[BVH_BIN_COUNT];
+	float binScale = BVH_BIN_COUNT / extent[axis];
+	auto getBin = [&](uint32_t tri) {
+		return glm::min(static_cast<int>((centroids[tri][axis] - centroidMin[axis]) * binScale), BVH_BIN_COUNT - 1);
+	};
+	for (uint32_t ix = begin; ix < end; ix++) {
+		uint32_t tri = _triangleOrder[ix];
+		Bin& bin = bins[getBin(tri)];
+		bin.Min = glm::min(bin.Min, boundsMin[tri]);
+		bin.Max = glm::max(bin.Max, boundsMax[tri]);
+		bin.Count++;
+	}
+
+	// Sweep from the right to get the cost of everything past each split, then from the left to find the cheapest split
+	float rightArea[BVH_BIN_COUNT];
+	uint32_t rightCount[BVH_BIN_COUNT];
+	Bin accum;
+	for (int ix = BVH_BIN_COUNT - 1; ix > 0; ix--) {
+		accum.Min = glm::min(accum.Min, bins[ix].Min);
+		accum.Max = glm::max(accum.Max, bins[ix].Max);
+		accum.Count += bins[ix].Count;
+		rightArea[ix] = accum.Count > 0 ? SurfaceArea(accum.Min, accum.Max) : 0.0f;
+		rightCount[ix] = accum.Count;
+	}
+	accum = Bin();
+	float bestCost = std::numeric_limits<float>::max();
+	int bestSplit = -1;
+	for (int ix = 0; ix < BVH_BIN_COUNT - 1; ix++) {
+		accum.Min = glm::min(accum.Min, bins[ix].Min);
+		accum.Max = glm::max(accum.Max, bins[ix].Max);
+		accum.Count += bins[ix].Count;
+		if (accum.Count == 0 || rightCount[ix + 1] == 0) {
+			continue;
+		}
+		float cost = SurfaceArea(accum.Min, accum.Max) * accum.Count + rightArea[ix + 1] * rightCount[ix + 1];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSplit = ix;
+		}
+	}
+
+	// Compare against not splitting at all, both costs relative to the node's own area
+	float nodeArea = SurfaceArea(nodeMin, nodeMax);
+	float splitCost = BVH_TRAVERSAL_COST + (nodeArea > 0.0f ? bestCost / nodeArea : 0.0f);
+	if (bestSplit < 0 || (count <= BVH_MAX_LEAF && splitCost >= static_cast<float>(count))) {
+		_nodes[nodeIndex].Offset = begin;
+		_nodes[nodeIndex].Count = count;
+		return nodeIndex;
+	}
+
+	uint32_t* first = _triangleOrder.data() + begin;
+	uint32_t* middle = std::partition(first, _triangleOrder.data() + end, [&](uint32_t tri) { return getBin(tri) <= bestSplit; });
+	uint32_t mid = begin + static_cast<uint32_t>(middle - first);
+
+	// The left child always comes directly after us, so we only need to store where the right child is
+	_BuildRecursive(centroids, boundsMin, boundsMax, begin, mid);
+	uint32_t right = _BuildRecursive(centroids, boundsMin, boundsMax, mid, end);
+	_nodes[nodeIndex].Offset = right;
+	_nodes[nodeIndex].Count = 0;
+	return nodeIndex;
+}
+
+bool TriangleBvh::Intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& outHit) const {
+	return _Trace<false>(origin, direction, maxDistance, outHit);
+}
+
+bool TriangleBvh::IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+	Hit hit;
+	return _Trace<true>(origin, direction, maxDistance, hit);
+}
+
+template <bool AnyHit>
+bool TriangleBvh::_Trace(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& outHit) const {
+	if (_nodes.empty()) {
+		return false;
+	}
+
+	// Division by zero gives us infinities, which the slab test handles correctly
+	glm::vec3 invDir = 1.0f / direction;
+	float closest = maxDistance;
+	bool found = false;
+
+	uint32_t stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& node = _nodes[stack[--stackSize]];
+
+		// Slab test against the node's bounds
+		glm::vec3 t0 = (node.BoundsMin - origin) * invDir;
+		glm::vec3 t1 = (node.BoundsMax - origin) * invDir;
+		glm::vec3 tMin = glm::min(t0, t1);
+		glm::vec3 tMax = glm::max(t0, t1);
+		float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+		float exit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, closest));
+		if (enter > exit) {
+			continue;
+		}
+
+		if (node.Count > 0) {
+			for (uint32_t ix = 0; ix < node.Count; ix++) {
+				uint32_t triIndex = _triangleOrder[node.Offset + ix];
+				const Triangle& tri = _triangles[triIndex];
+
+				// Moller-Trumbore, we accept hits from both sides since we don't know the winding of every mesh
+				glm::vec3 p = glm::cross(direction, tri.Edge2);
+				float det = glm::dot(tri.Edge1, p);
+				if (glm::abs(det) < 1e-10f) {
+					continue;
+				}
+				float invDet = 1.0f / det;
+				glm::vec3 toOrigin = origin - tri.V0;
+				float u = glm::dot(toOrigin, p) * invDet;
+				if (u < 0.0f || u > 1.0f) {
+					continue;
+				}
+				glm::vec3 q = glm::cross(toOrigin, tri.Edge1);
+				float v = glm::dot(direction, q) * invDet;
+				if (v < 0.0f || u + v > 1.0f) {
+					continue;
+				}
+				float t = glm::dot(tri.Edge2, q) * invDet;
+				if (t > 0.0f && t < closest) {
+					closest = t;
+					found = true;
+					outHit.Distance = t;
+					outHit.Triangle = triIndex;
+					outHit.Barycentric = glm::vec2(u, v);
+					if (AnyHit) {
+						return true;
+					}
+				}
+			}
+		} else if (stackSize + 2 <= 64) {
+			// Our left child is stored directly after us
+			stack[stackSize++] = node.Offset;
+			stack[stackSize++] = static_cast<uint32_t>(&node - _nodes.data()) + 1;
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// A bounding volume hierarchy over a triangle soup, for casting rays against static geometry on the CPU
+/// (ex: baking lightmaps). Nodes are split along their longest axis using binned surface area heuristics,
+/// and stored depth first so that a node's left child always directly follows it.
+///
+/// Once built the BVH is read only, so any number of threads can trace against it at once
+/// </summary>
+class TriangleBvh
+{
+public:
+	/// <summary>
+	/// The result of tracing a ray against the BVH
+	/// </summary>
+	struct Hit {
+		// The distance along the ray to the hit
+		float     Distance;
+		// The index of the triangle that was hit, in the order they were given to Build
+		uint32_t  Triangle;
+		// The barycentric coordinates of the hit, for the triangle's 2nd and 3rd vertices
+		glm::vec2 Barycentric;
+	};
+
+	TriangleBvh();
+	~TriangleBvh() = default;
+
+	/// <summary>
+	/// Builds the hierarchy over a list of triangles, replacing anything that was built before
+	/// </summary>
+	/// <param name="positions">The world space positions of the triangles' vertices</param>
+	/// <param name="indices">A triangle list indexing into positions</param>
+	void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+	/// <summary>
+	/// Finds the closest triangle along a ray
+	/// </summary>
+	/// <param name="origin">The start of the ray</param>
+	/// <param name="direction">The direction of the ray, does not need to be normalized (distances will be in multiples of it)</param>
+	/// <param name="maxDistance">The furthest distance along the ray to accept hits at</param>
+	/// <param name="outHit">Will receive the closest hit, if any</param>
+	/// <returns>True if the ray hit a triangle</returns>
+	bool Intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& outHit) const;
+	/// <summary>
+	/// Checks if anything blocks a ray, this is cheaper than Intersect since it can stop at the first hit
+	/// </summary>
+	bool IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+	size_t GetTriangleCount() const { return _triangles.size(); }
+	size_t GetNodeCount() const { return _nodes.size(); }
+
+protected:
+	struct Node {
+		glm::vec3 BoundsMin;
+		// For leaves, the index of the first triangle in _triangleOrder, otherwise the index of the right child
+		uint32_t  Offset;
+		glm::vec3 BoundsMax;
+		// The number of triangles in a leaf, or 0 for interior nodes
+		uint32_t  Count;
+	};
+
+	struct Triangle {
+		glm::vec3 V0;
+		glm::vec3 Edge1;
+		glm::vec3 Edge2;
+	};
+
+	std::vector<Node>     _nodes;
+	std::vector<Triangle> _triangles;
+	// Triangle indices sorted so that each leaf's triangles are contiguous
+	std::vector<uint32_t> _triangleOrder;
+
+	uint32_t _BuildRecursive(std::vector<glm::vec3>& centroids, std::vector<glm::vec3>& boundsMin, std::vector<glm::vec3>& boundsMax, uint32_t begin, uint32_t end);
+	template <bool AnyHit>
+	bool _Trace(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& outHit) const;
+};